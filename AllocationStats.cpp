@@ -0,0 +1,36 @@
+
+#include "AllocationStats.h"
+
+using ::std::atomic;
+using ::std::size_t;
+using ::std::uint64_t;
+
+using Counts = AllocationStats::Counts;
+
+// These must need no dynamic initialization, because operator new may be
+// called before any other static initializer has run:
+static atomic<uint64_t> g_numAllocations{0};
+static atomic<uint64_t> g_numBytes{0};
+static thread_local Counts t_counts{0, 0};
+
+Counts AllocationStats::total() noexcept
+{
+	return { g_numAllocations.load(), g_numBytes.load() };
+}
+
+Counts AllocationStats::forThisThread() noexcept
+{
+	return t_counts;
+}
+
+void AllocationStats::countAllocation(size_t numBytes) noexcept
+{
+	++t_counts.m_numAllocations;
+	t_counts.m_numBytes += numBytes;
+	g_numAllocations.fetch_add(1, ::std::memory_order_relaxed);
+	g_numBytes.fetch_add(numBytes, ::std::memory_order_relaxed);
+	if (!isCounting())
+	{
+		s_isCounting.store(true, ::std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,50 @@
+
+#if !defined(ALLOCATIONSTATS_H_INCLUDED)
+#define ALLOCATIONSTATS_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// \brief AllocationStats counts heap allocations, so that tests can assert
+/// allocation budgets (e.g., that a scan allocates the same amount however
+/// many lines the file has) and so that the --stats report can give the
+/// allocations per file.
+///
+/// The counting is done by the replacement operator new in
+/// CountingAllocator.cpp, which is linked only into the test runner and the
+/// benchmarks.  In the tools themselves nothing calls countAllocation(),
+/// isCounting() is false, and all of the counts stay zero.
+class AllocationStats
+{
+public:
+	struct Counts
+	{
+		::std::uint64_t m_numAllocations;
+		::std::uint64_t m_numBytes;
+
+		friend Counts operator-(const Counts& lhs, const Counts& rhs) noexcept
+			{ return { lhs.m_numAllocations - rhs.m_numAllocations, lhs.m_numBytes - rhs.m_numBytes }; }
+	};
+
+	/// \brief True if the counting operator new is linked in.
+	static bool isCounting() noexcept
+		{ return s_isCounting.load(::std::memory_order_relaxed); }
+
+	/// \brief The allocations made so far by all threads.
+	static Counts total() noexcept;
+
+	/// \brief The allocations made so far by the calling thread.  Take the
+	/// difference of two of these to measure a piece of code.
+	static Counts forThisThread() noexcept;
+
+	/// \brief Called by the counting operator new for each allocation.
+	static void countAllocation(::std::size_t numBytes) noexcept;
+
+	AllocationStats() = delete;
+
+private:
+	static inline ::std::atomic<bool> s_isCounting{false};
+};
+
+#endif // ALLOCATIONSTATS_H_INCLUDED
@@ -0,0 +1,49 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "AllocationStats.h"
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(AllocationStatsTestSuite)
+
+BOOST_AUTO_TEST_CASE(countTest)
+{
+	struct alignas(64) OverAligned { char m_bytes[64]; };
+
+	const auto threadBefore = AllocationStats::forThisThread();
+	const auto totalBefore = AllocationStats::total();
+	{
+		auto pInt = ::std::make_unique<int>(1);
+		auto pArray = ::std::make_unique<char[]>(1000);
+		auto pOverAligned = ::std::make_unique<OverAligned>();
+		auto pNoThrow = ::std::unique_ptr<int>(new (::std::nothrow) int(2));
+	}
+	const auto threadDelta = AllocationStats::forThisThread() - threadBefore;
+	BOOST_REQUIRE(AllocationStats::isCounting());
+	BOOST_CHECK_EQUAL(4u, threadDelta.m_numAllocations);
+	BOOST_CHECK_EQUAL(sizeof(int) + 1000 + sizeof(OverAligned) + sizeof(int), threadDelta.m_numBytes);
+
+	// Each thread counts its own allocations, and all of them count toward
+	// the total:
+	::std::uint64_t otherThreadAllocations = 0;
+	::std::thread([&otherThreadAllocations] ()
+		{
+			const auto before = AllocationStats::forThisThread();
+			{
+				::std::vector<int> v(100);
+			}
+			otherThreadAllocations = (AllocationStats::forThisThread() - before).m_numAllocations;
+		}).join();
+	BOOST_CHECK_EQUAL(1u, otherThreadAllocations);
+	BOOST_CHECK_GE((AllocationStats::total() - totalBefore).m_numAllocations, 5u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
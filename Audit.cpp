@@ -0,0 +1,230 @@
+
+#include "Audit.h"
+#include "BlockReader.h"
+#include "RecordWriter.h"
+#include "ResultsCache.h"
+#include "ScratchArena.h"
+#include "main.h"
+
+#include <format>
+#include <iostream>
+#include <memory>
+
+using ::std::cout;
+using ::std::endl;
+using ::std::make_unique;
+using ::std::nullopt;
+using ::std::ostream;
+using ::std::string;
+using ::std::string_view;
+using ::std::unique_ptr;
+
+static constexpr string_view k_recordFields[] = { "path", "eol", "dos", "mac", "unix",
+	"lines", "spaces", "tabs", "indent", "space", "tab", "javadocTab", "javadocLeft",
+	"mixed", "indeterminate", "nonAsciiRuns" };
+
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
+int main(int argCount, const char*const*const argList)
+{
+	return commonMain<Audit>(argCount, argList);
+}
+#endif
+
+int Audit::usage(ostream& out, string_view progName, const char* pMsg)
+{
+	int exitCode = EXIT_SUCCESS;
+	if (pMsg != nullptr && *pMsg != '\0')
+	{
+		exitCode = EXIT_FAILURE;
+		out << endl << pMsg << endl;
+	}
+	out << "\n"
+		"Usage:  " << progName << " [--format=<fmt>] [-r] <file1> <file2> ...\n"
+		"\n"
+		"Does the work of xeol, stripws, isplainascii, and indents in a single\n"
+		"pass over each file.  Lists each file in the following format:\n"
+		"\n"
+		"   <E><I> <file-path>\n"
+		"\n"
+		"where <E> is the line ending convention, as listed by xeol ('D', 'M',\n"
+		"'U', 'I', or 'X'), and <I> is the indent type, as listed by indents\n"
+		"('S', 'T', 'J', 'M', or 'I').  Each finding follows on its own line:\n"
+		"mixed line endings, trailing white space, mixed indentation, and each\n"
+		"run of non-ASCII characters.\n"
+		"\n"
+		"Binary files, as judged by their first block (by a NUL byte, too many\n"
+		"control characters, or the signature of a known binary format), are\n"
+		"skipped:  they are not listed.\n"
+		"\n"
+		"Files compressed with gzip or zstd are decompressed as they are read,\n"
+		"and their contents examined as for any other file.\n"
+		"\n"
+		"Options:\n"
+		"\n"
+		"   --format=<fmt> Write one record per file in the format <fmt>, which\n"
+		"      is text (the default), jsonl (JSON Lines), or csv.  The fields are\n"
+		"      path; eol, dos, mac, and unix, as for xeol; lines, spaces, and\n"
+		"      tabs, as for stripws; indent, space, tab, javadocTab, javadocLeft,\n"
+		"      mixed, and indeterminate, as for indents; and nonAsciiRuns, the\n"
+		"      number of runs of non-ASCII characters.\n"
+		"\n"
+		"   -r Search for files in sub-directories recursively\n"
+		"\n"
+		<< FileEnumerator::k_filterOptionsUsage
+		<< endl;
+
+	return exitCode;
+}
+
+Audit::Audit(::std::span<const char*const> args) :
+	m_outputFormat(OutputFormat::text),
+	m_fileEnumerator()
+{
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		auto pArg = args[i];
+		if (isIEqual(pArg, "-?") || isIEqual(pArg, "-h") || isIEqual(pArg, "-help"))
+		{
+			throw CmdLineError();
+		}
+		else if (parseOutputFormatOption(pArg, m_outputFormat))
+		{
+			// Nothing more to do
+		}
+		else if (isIEqual(pArg, "-r"))
+		{
+			m_fileEnumerator.setRecursive();
+		}
+		else if (m_fileEnumerator.parseFilterOption(args, i))
+		{
+			// Nothing more to do
+		}
+		else
+		{
+			m_fileEnumerator.insert(pArg);
+		}
+	}
+
+	if (m_fileEnumerator.numFileSpecs() <= 0)
+	{
+		throw CmdLineError("No files specified");
+	}
+}
+
+int Audit::run() const
+{
+	unique_ptr<RecordWriter> pWriter;
+	if (m_outputFormat != OutputFormat::text)
+	{
+		pWriter = make_unique<RecordWriter>(cout, m_outputFormat, k_recordFields);
+	}
+	m_fileEnumerator.enumerateFiles([&pWriter] (const Path& p) { processFile(p, pWriter.get()); });
+	return EXIT_SUCCESS;
+}
+
+void Audit::processFile(const Path& p, RecordWriter* pWriter /* = nullptr */)
+{
+	const bool isJavaFile = isIEqual(p.extension().generic_string().c_str(), ".java");
+	auto pArena = ScratchArena::forThisThread().resource();
+	AuditScanner scanner(isJavaFile, pArena);
+	{
+		InputFile in(p);
+		BlockReader reader(in.fd(), pArena);
+		reader.decompressIfCompressed();
+		if (isBinaryFile(reader, nullptr, nullopt))
+		{
+			return;	// Binary files are skipped
+		}
+		reader.feed(scanner);
+	}
+	const auto auditReport = scanner.finish();
+	if (pWriter != nullptr)
+	{
+		writeRecord(p, auditReport, *pWriter);
+	}
+	else
+	{
+		report(p, auditReport, cout);
+	}
+}
+
+void Audit::report(const Path& p, const AuditReport& report, ostream& out)
+{
+	const auto& eolCounts = report.m_eolCounts;
+	const auto& wsCounts = report.m_whiteSpaceCounts;
+	const auto& lineTypeCounts = report.m_indentReport.m_lineTypeCounts;
+	const auto eolType = eolCounts.eolType();
+	const auto indentType = report.m_indentReport.m_fileType;
+
+	string dispPath = p.generic_string();
+	if (dispPath.starts_with("./"))
+	{
+		dispPath.erase(0, 2);
+	}
+	formatTo(out, "{0}{1} {2}", eolLetter(eolType), indentLetter(indentType), dispPath);
+	out << endl;
+
+	if (eolType == EolType::MIXED)
+	{
+		formatTo(out, "     (Mixed line endings:  {0} DOS, {1} Mac, {2} Unix)",
+			eolCounts.m_numDosEols,
+			eolCounts.m_numMacEols,
+			eolCounts.m_numUnixEols);
+		out << endl;
+	}
+	if (wsCounts.m_numLinesAffected > 0)
+	{
+		formatTo(out, "     (Trailing white space:  {0} lines end in {1} spaces and {2} tabs)",
+			wsCounts.m_numLinesAffected,
+			wsCounts.m_numSpacesStripped,
+			wsCounts.m_numTabsStripped);
+		out << endl;
+	}
+	if (indentType == IndentType::mixed)
+	{
+		formatTo(out, "     (Mixed indentation:  {0} space, {1} tab, {2} JavaDoc tab, {3} mixed, {4} indeterminate)",
+			get(lineTypeCounts, IndentType::space),
+			get(lineTypeCounts, IndentType::tab),
+			get(lineTypeCounts, IndentType::javadocTab) + get(lineTypeCounts, IndentType::javadocLeft),
+			get(lineTypeCounts, IndentType::mixed),
+			get(lineTypeCounts, IndentType::indeterminate));
+		out << endl;
+	}
+	for (const auto& run : report.m_nonAsciiRuns)
+	{
+		formatTo(out, "     (Non-ASCII, line {0}, approx. column {1}:  \"{2}\" (\"",
+			run.m_lineNum,
+			run.m_approxColNum,
+			string_view{run.m_bytes});
+		for (auto ch : run.m_bytes)
+		{
+			formatTo(out, "\\x{0:02x}", static_cast<unsigned int>(static_cast<unsigned char>(ch)));
+		}
+		out << "\"))" << endl;
+	}
+}
+
+void Audit::writeRecord(const Path& p, const AuditReport& report, RecordWriter& writer)
+{
+	const auto& eolCounts = report.m_eolCounts;
+	const auto& wsCounts = report.m_whiteSpaceCounts;
+	const auto& lineTypeCounts = report.m_indentReport.m_lineTypeCounts;
+
+	writer.field(p)
+		.field(eolTypeName(eolCounts.eolType()))
+		.field(eolCounts.m_numDosEols)
+		.field(eolCounts.m_numMacEols)
+		.field(eolCounts.m_numUnixEols)
+		.field(wsCounts.m_numLinesAffected)
+		.field(wsCounts.m_numSpacesStripped)
+		.field(wsCounts.m_numTabsStripped)
+		.field(indentTypeName(report.m_indentReport.m_fileType))
+		.field(get(lineTypeCounts, IndentType::space))
+		.field(get(lineTypeCounts, IndentType::tab))
+		.field(get(lineTypeCounts, IndentType::javadocTab))
+		.field(get(lineTypeCounts, IndentType::javadocLeft))
+		.field(get(lineTypeCounts, IndentType::mixed))
+		.field(get(lineTypeCounts, IndentType::indeterminate))
+		.field(report.m_nonAsciiRuns.size());
+	writer.endRecord();
+}
@@ -0,0 +1,41 @@
+
+#if !defined(AUDIT_H_INCLUDED)
+#define AUDIT_H_INCLUDED
+
+#include "FileEnumerator.h"
+#include "RecordWriter.h"
+#include "TextScanners.h"
+#include "Utils.h"
+
+#include <filesystem>
+#include <iosfwd>
+#include <span>
+#include <string_view>
+
+/// \brief Runs the checks of xeol, stripws, isplainascii, and indents in a
+/// single pass over each file, and reports all of their findings together.
+class Audit
+{
+public:
+	static int usage(::std::ostream& strm, ::std::string_view progName, const char* pMsg);
+
+	Audit(::std::span<const char*const> args);
+	int run() const;
+
+	Audit(const Audit&) = delete;
+	Audit& operator=(const Audit&) = delete;
+	Audit(Audit&&) = delete;
+	Audit& operator=(Audit&&) = delete;
+
+PRIVATE_EXCEPT_IN_TEST:
+	using Path = ::std::filesystem::path;
+
+	static void processFile(const Path& p, RecordWriter* pWriter = nullptr);
+	static void report(const Path& p, const AuditReport& report, ::std::ostream& out);
+	static void writeRecord(const Path& p, const AuditReport& report, RecordWriter& writer);
+
+	OutputFormat	m_outputFormat;
+	FileEnumerator	m_fileEnumerator;
+};
+
+#endif // AUDIT_H_INCLUDED
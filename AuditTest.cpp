@@ -0,0 +1,92 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "Audit.h"
+#include "Exceptions.h"
+#include "TestUtil.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <span>
+#include <sstream>
+#include <string_view>
+
+namespace utd = ::boost::unit_test::data;
+
+using ::std::as_bytes;
+using ::std::ostringstream;
+using ::std::span;
+using ::std::string_view;
+
+BOOST_AUTO_TEST_SUITE(AuditTestSuite)
+
+
+
+BOOST_AUTO_TEST_SUITE(CmdLineParseFailTestSuite)
+
+static char const*const k_args00[] = { "audit" };
+static char const*const k_args01[] = { "audit", "-?" };
+static char const*const k_args02[] = { "audit", "-h" };
+static char const*const k_args03[] = { "audit", "-help" };
+static char const*const k_args04[] = { "audit", "-r" };
+
+static CmdLineParseFailTestCase const k_testCases[] =
+{
+	{ k_args00, ".*no files.*" },
+	{ k_args01, "^$" },
+	{ k_args02, "^$" },
+	{ k_args03, "^$" },
+	{ k_args04, ".*no files.*" },
+};
+
+BOOST_DATA_TEST_CASE(cmdLineParseFailTest, utd::make(k_testCases), tc)
+{
+	BOOST_CHECK_EXCEPTION(Audit(tc.m_args), CmdLineError,
+		[&tc](const CmdLineError& ex) { return tc.doesExMatch(ex); });
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+
+
+BOOST_AUTO_TEST_SUITE(ReportTestSuite)
+
+struct ReportTestCase
+{
+	string_view	m_input;
+	string_view	m_expectedOutput;
+};
+
+static ReportTestCase const k_testCases[] =
+{
+	{ "", "II file.txt\n" },
+	{ "int x;\n\tint y;\n", "UT file.txt\n" },
+	{ "a \r\n\tb\n    c\t\n",
+		"XM file.txt\n"
+		"     (Mixed line endings:  1 DOS, 0 Mac, 2 Unix)\n"
+		"     (Trailing white space:  2 lines end in 1 spaces and 1 tabs)\n"
+		"     (Mixed indentation:  1 space, 1 tab, 0 JavaDoc tab, 0 mixed, 2 indeterminate)\n" },
+	{ "caf\xc3\xa9\n",
+		"UI file.txt\n"
+		"     (Non-ASCII, line 1, approx. column 4:  \"\xc3\xa9\" (\"\\xc3\\xa9\"))\n" },
+};
+
+static ::std::ostream& operator<<(::std::ostream& ostrm, ReportTestCase const& tc)
+{
+	return ostrm << "Test case with input \"" << tc.m_input << "\"";
+}
+
+BOOST_DATA_TEST_CASE(reportTest, utd::make(k_testCases), tc)
+{
+	ostringstream out;
+	Audit::report("./file.txt", auditText(as_bytes(span{tc.m_input.data(), tc.m_input.size()}), false), out);
+	BOOST_CHECK_EQUAL(tc.m_expectedOutput, out.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+
+
+BOOST_AUTO_TEST_SUITE_END()
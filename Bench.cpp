@@ -0,0 +1,846 @@
+
+#include "Bench.h"
+#include "AllocationStats.h"
+#include "Audit.h"
+#include "CorpusGenerator.h"
+#include "FileEnumerator.h"
+#include "FindFileExt.h"
+#include "IndentClassifier.h"
+#include "IsPlainAscii.h"
+#include "JsonFormatter.h"
+#include "JsonPP.h"
+#include "PathDeleter.h"
+#include "StripWS.h"
+#include "TextScanners.h"
+#include "Xeol.h"
+#include "main.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <streambuf>
+
+#if !defined(_WIN32)
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+namespace fs = ::std::filesystem;
+
+using ::std::back_inserter;
+using ::std::cerr;
+using ::std::cout;
+using ::std::endl;
+using ::std::format;
+using ::std::ifstream;
+using ::std::istream;
+using ::std::make_unique;
+using ::std::ofstream;
+using ::std::ostream;
+using ::std::regex;
+using ::std::set;
+using ::std::size_t;
+using ::std::streambuf;
+using ::std::streamsize;
+using ::std::string;
+using ::std::string_view;
+using ::std::uint64_t;
+using ::std::unique_ptr;
+using ::std::vector;
+
+using Clock = ::std::chrono::steady_clock;
+
+static constexpr string_view k_recordFields[] = { "suite", "benchmark", "input", "cache",
+	"repetitions", "iterations", "bytes", "files", "medianNs", "minNs", "bytesPerSecond",
+	"allocations" };
+
+// The schema of the baseline file of the regression gate:
+static constexpr string_view k_baselineFields[] = { "suite", "benchmark", "input",
+	"throughput" };
+
+// Each repetition runs enough iterations to take at least this long:
+static constexpr auto k_minRepetitionTime = ::std::chrono::milliseconds(100);
+static constexpr uint64_t k_seed = 20240229;
+
+#if defined(CMDLINEUTIL_BENCH)
+int main(int argCount, const char*const*const argList)
+{
+	return commonMain<Bench>(argCount, argList);
+}
+#endif
+
+// ============================ Inputs ============================
+
+namespace
+{
+	// A read-only stream buffer over memory, so that a microbenchmark can
+	// re-read its input without copying it:
+	class MemoryBuf : public streambuf
+	{
+	public:
+		explicit MemoryBuf(string_view bytes)
+			{
+				auto pBegin = const_cast<char*>(bytes.data());
+				setg(pBegin, pBegin, pBegin + bytes.size());
+			}
+	};
+
+	class MemoryStream : private MemoryBuf, public istream
+	{
+	public:
+		explicit MemoryStream(string_view bytes) : MemoryBuf(bytes), istream(this) {}
+	};
+
+	// Discards everything written to it, for output that is not of interest:
+	class NullBuf : public streambuf
+	{
+	protected:
+		int_type overflow(int_type ch) override
+			{ return traits_type::not_eof(ch); }
+		streamsize xsputn(const char*, streamsize count) override
+			{ return count; }
+	};
+}
+
+static void writeFile(const fs::path& p, string_view contents)
+{
+	ofstream out(p, ::std::ios::binary);
+	out.write(contents.data(), static_cast<streamsize>(contents.size()));
+	if (!out)
+	{
+		throw IOError(format("Unable to write file '{0}'", p.generic_string()));
+	}
+}
+
+// A tree three levels deep with four sub-directories per directory, and in
+// it a mix of text, source, and JSON files of various shapes
+void Bench::generateTree(const Path& treeDir)
+{
+	CorpusSpec spec;
+	spec.m_seed = k_seed;
+	spec.m_numFiles = 21 * 20;
+	spec.m_depth = 3;
+	spec.m_fanOut = 4;
+	spec.m_minFileSize = 1024;
+	spec.m_maxFileSize = 64 * 1024;
+	CorpusGenerator(spec).generate(treeDir);
+}
+
+// Returns false where the page cache cannot be dropped
+bool Bench::dropFromPageCache(const Path& treeDir)
+{
+#if defined(_WIN32) || !defined(POSIX_FADV_DONTNEED)
+	(void) treeDir;
+	return false;
+#else
+	for (const auto& entry : fs::recursive_directory_iterator(treeDir))
+	{
+		if (entry.is_regular_file())
+		{
+			if (int fd = ::open(entry.path().c_str(), O_RDONLY); fd >= 0)
+			{
+				// Only clean pages can be dropped:
+				::fdatasync(fd);
+				::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+				::close(fd);
+			}
+		}
+	}
+	return true;
+#endif
+}
+
+// ============================ Bench ============================
+
+int Bench::usage(ostream& out, string_view progName, const char* pMsg)
+{
+	int exitCode = EXIT_SUCCESS;
+	if (pMsg != nullptr && *pMsg != '\0')
+	{
+		exitCode = EXIT_FAILURE;
+		out << endl << pMsg << endl;
+	}
+	out << "\n"
+		"Usage:  " << progName << " [--micro|--macro] [--warm-only] [--repetitions <n>]\n"
+		"   [--filter <regex>] [--tree <dir>] [--output <file>]\n"
+		"   [--baseline <file> [--max-regression <percent>]] [--save-baseline <file>]\n"
+		"\n"
+		"Runs the benchmark suite and writes one line of JSON per result.\n"
+		"\n"
+		"Options:\n"
+		"\n"
+		"   --micro Run only the microbenchmarks, which time each core routine\n"
+		"      over in-memory inputs\n"
+		"\n"
+		"   --macro Run only the macro benchmarks, which time each tool over a\n"
+		"      tree of files, first with the files in the page cache (warm) and\n"
+		"      then with them dropped from it (cold)\n"
+		"\n"
+		"   --warm-only Skip the cold runs of the macro benchmarks\n"
+		"\n"
+		"   --repetitions <n> Repeat each benchmark n times (default 5), and\n"
+		"      report the median and minimum time per iteration\n"
+		"\n"
+		"   --filter <regex> Run only the benchmarks whose full name, of the form\n"
+		"      suite/benchmark/input, matches <regex>\n"
+		"\n"
+		"   --tree <dir> Run the macro benchmarks over the existing tree <dir>,\n"
+		"      instead of over a generated tree that is deleted afterward\n"
+		"\n"
+		"   --output <file> Write the results to <file> instead of to standard\n"
+		"      output\n"
+		"\n"
+		"   --baseline <file> Act as the performance regression gate:  compare\n"
+		"      the throughput of each warm result, relative to that of a fixed\n"
+		"      calibration loop, with that recorded in <file>, report the changes\n"
+		"      to standard error, and exit with failure if any has fallen by more\n"
+		"      than the allowed percentage\n"
+		"\n"
+		"   --max-regression <percent> The allowed fall in relative throughput\n"
+		"      (default 10)\n"
+		"\n"
+		"   --save-baseline <file> Write the relative throughput of each warm\n"
+		"      result to <file>, as a new baseline\n"
+		"\n"
+		"The fields of each result are suite, benchmark, input, cache (warm or\n"
+		"cold), repetitions, iterations (per repetition), bytes and files\n"
+		"(processed per iteration), medianNs and minNs (per iteration),\n"
+		"bytesPerSecond (at the median), and allocations (per iteration).\n"
+	<< endl;
+
+	return exitCode;
+}
+
+Bench::Bench(::std::span<const char*const> args) :
+	m_runMicro(true),
+	m_runMacro(true),
+	m_runCold(true),
+	m_numRepetitions(5),
+	m_filter(),
+	m_treeDir(),
+	m_outputPath(),
+	m_baselinePath(),
+	m_saveBaselinePath(),
+	m_maxRegressionPercent(10.0)
+{
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		auto pArg = args[i];
+		if (isIEqual(pArg, "-?") || isIEqual(pArg, "-h") || isIEqual(pArg, "-help"))
+		{
+			throw CmdLineError();
+		}
+		else if (isIEqual(pArg, "--micro"))
+		{
+			m_runMacro = false;
+		}
+		else if (isIEqual(pArg, "--macro"))
+		{
+			m_runMicro = false;
+		}
+		else if (isIEqual(pArg, "--warm-only"))
+		{
+			m_runCold = false;
+		}
+		else if (isIEqual(pArg, "--repetitions"))
+		{
+			const string_view value{getOptionValue(args, i)};
+			const auto result = ::std::from_chars(value.data(), value.data() + value.size(),
+				m_numRepetitions);
+			if (result.ec != ::std::errc{} || result.ptr != value.data() + value.size()
+				|| m_numRepetitions == 0)
+			{
+				throw CmdLineError(format("Invalid number of repetitions '{0}'", value));
+			}
+		}
+		else if (isIEqual(pArg, "--filter"))
+		{
+			const auto pPattern = getOptionValue(args, i);
+			try
+			{
+				m_filter.emplace(pPattern);
+			}
+			catch (const ::std::regex_error& ex)
+			{
+				throw CmdLineError(format("Invalid filter '{0}':  {1}", pPattern, ex.what()));
+			}
+		}
+		else if (isIEqual(pArg, "--tree"))
+		{
+			m_treeDir = getOptionValue(args, i);
+		}
+		else if (isIEqual(pArg, "--output"))
+		{
+			m_outputPath = getOptionValue(args, i);
+		}
+		else if (isIEqual(pArg, "--baseline"))
+		{
+			m_baselinePath = getOptionValue(args, i);
+		}
+		else if (isIEqual(pArg, "--save-baseline"))
+		{
+			m_saveBaselinePath = getOptionValue(args, i);
+		}
+		else if (isIEqual(pArg, "--max-regression"))
+		{
+			const string_view value{getOptionValue(args, i)};
+			const auto result = ::std::from_chars(value.data(), value.data() + value.size(),
+				m_maxRegressionPercent);
+			if (result.ec != ::std::errc{} || result.ptr != value.data() + value.size()
+				|| m_maxRegressionPercent < 0.0 || m_maxRegressionPercent >= 100.0)
+			{
+				throw CmdLineError(format("Invalid maximum regression '{0}'", value));
+			}
+		}
+		else
+		{
+			throw CmdLineError(format("Unrecognized argument '{0}'", pArg));
+		}
+	}
+
+	if (!m_runMicro && !m_runMacro)
+	{
+		throw CmdLineError("The options '--micro' and '--macro' are mutually exclusive");
+	}
+	else if (!m_treeDir.empty() && !is_directory(m_treeDir))
+	{
+		throw CmdLineError(format("'{0}' is not a directory", m_treeDir.generic_string()));
+	}
+	else if (!m_baselinePath.empty() && !is_regular_file(m_baselinePath))
+	{
+		throw CmdLineError(format("The baseline '{0}' does not exist", m_baselinePath.generic_string()));
+	}
+}
+
+int Bench::run() const
+{
+	unique_ptr<ofstream> pOutputFile;
+	if (!m_outputPath.empty())
+	{
+		pOutputFile = make_unique<ofstream>(m_outputPath, ::std::ios::binary);
+		if (!*pOutputFile)
+		{
+			throw IOError(format("Unable to create file '{0}'", m_outputPath.generic_string()));
+		}
+	}
+	RecordWriter writer(pOutputFile ? *pOutputFile : cout, OutputFormat::jsonl, k_recordFields);
+
+	const bool isGating = !m_baselinePath.empty() || !m_saveBaselinePath.empty();
+	auto baseline = m_baselinePath.empty() ? Baseline{} : readBaseline(m_baselinePath);
+	// Only the rows of the selected benchmarks are expected to have results:
+	::std::erase_if(baseline, [this] (const auto& row) { return !isSelected(row.first); });
+	const auto calibration = isGating ? calibrationThroughput() : 0.0;
+	vector<GateResult> gateResults;
+
+	// The tools report to standard output, which is not of interest here:
+	NullBuf nullBuf;
+	auto measureQuietly = [this, &nullBuf] (const Benchmark& benchmark, const Path* pColdTreeDir)
+		{
+			const auto pCoutBuf = cout.rdbuf(&nullBuf);
+			const auto timing = measure(benchmark.m_body, pColdTreeDir);
+			cout.rdbuf(pCoutBuf);
+			return timing;
+		};
+	auto runBenchmarks = [&] (const vector<Benchmark>& benchmarks, const Path* pColdTreeDir)
+		{
+			for (const auto& benchmark : benchmarks)
+			{
+				if (!isSelected(benchmark))
+				{
+					continue;
+				}
+				const auto timing = measureQuietly(benchmark, pColdTreeDir);
+				writeRecord(benchmark, pColdTreeDir != nullptr, timing, m_numRepetitions, writer);
+				writer.flush();
+				if (!isGating || pColdTreeDir != nullptr)
+				{
+					continue;
+				}
+
+				auto relativeThroughput = throughput(benchmark, timing) / calibration;
+				const auto it = baseline.find(fullName(benchmark.m_suite, benchmark.m_name,
+					benchmark.m_input));
+				if (it != baseline.end()
+					&& isRegressed(relativeThroughput, it->second, m_maxRegressionPercent))
+				{
+					// Measure an apparent regression a second time, along with the
+					// calibration loop, so that neither one noisy stretch nor a drift in
+					// the speed of the machine during the run fails the gate:
+					const auto recalibration = calibrationThroughput();
+					relativeThroughput = ::std::max(relativeThroughput,
+						throughput(benchmark, measureQuietly(benchmark, nullptr)) / recalibration);
+				}
+				gateResults.push_back({benchmark.m_suite, benchmark.m_name, benchmark.m_input,
+					relativeThroughput});
+			}
+		};
+
+	if (m_runMicro)
+	{
+		runBenchmarks(microBenchmarks(), nullptr);
+	}
+	if (m_runMacro)
+	{
+		Path treeDir = m_treeDir;
+		unique_ptr<PathDeleter> pTreeDeleter;
+		if (treeDir.empty())
+		{
+			treeDir = fs::temp_directory_path() / format("cmdlineutil-bench-{0}", k_seed);
+			pTreeDeleter = make_unique<PathDeleter>(treeDir);
+			remove_all(treeDir);
+			generateTree(treeDir);
+		}
+
+		const auto benchmarks = macroBenchmarks(treeDir);
+		runBenchmarks(benchmarks, nullptr);
+		if (m_runCold && dropFromPageCache(treeDir))
+		{
+			runBenchmarks(benchmarks, &treeDir);
+		}
+	}
+
+	if (!m_saveBaselinePath.empty())
+	{
+		writeBaseline(m_saveBaselinePath, gateResults);
+	}
+	if (!m_baselinePath.empty()
+		&& !compareToBaseline(gateResults, baseline, m_maxRegressionPercent, cerr))
+	{
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+bool Bench::isSelected(const Benchmark& benchmark) const
+{
+	return isSelected(fullName(benchmark.m_suite, benchmark.m_name, benchmark.m_input));
+}
+
+bool Bench::isSelected(string_view fullName) const
+{
+	const bool isSuiteRun = fullName.starts_with("micro/") ? m_runMicro
+		: fullName.starts_with("macro/") ? m_runMacro
+		: true;
+	return isSuiteRun
+		&& (!m_filter || regex_search(fullName.begin(), fullName.end(), *m_filter));
+}
+
+string Bench::fullName(string_view suite, string_view name, string_view input)
+{
+	return format("{0}/{1}/{2}", suite, name, input);
+}
+
+// Warm runs calibrate the number of iterations to k_minRepetitionTime.  A
+// cold run is a single iteration after dropping the tree from the page cache.
+Bench::Timing Bench::measure(const Body& body, const Path* pColdTreeDir) const
+{
+	body();	// Warm up
+
+	const auto allocationsBefore = AllocationStats::forThisThread();
+	const auto calibrationStart = Clock::now();
+	body();
+	const auto calibrationTime = Clock::now() - calibrationStart;
+	const auto numAllocations = (AllocationStats::forThisThread() - allocationsBefore).m_numAllocations;
+
+	uint64_t numIterations = 1;
+	if (pColdTreeDir == nullptr && calibrationTime < k_minRepetitionTime)
+	{
+		numIterations = static_cast<uint64_t>(k_minRepetitionTime / ::std::max(calibrationTime,
+			Clock::duration{1}));
+	}
+
+	vector<uint64_t> timesNs;
+	for (size_t i = 0; i < m_numRepetitions; ++i)
+	{
+		if (pColdTreeDir != nullptr)
+		{
+			dropFromPageCache(*pColdTreeDir);
+		}
+		const auto start = Clock::now();
+		for (uint64_t j = 0; j < numIterations; ++j)
+		{
+			body();
+		}
+		const auto elapsed = ::std::chrono::duration_cast< ::std::chrono::nanoseconds>(
+			Clock::now() - start);
+		timesNs.push_back(static_cast<uint64_t>(elapsed.count()) / numIterations);
+	}
+
+	::std::ranges::sort(timesNs);
+	return Timing{numIterations, timesNs[timesNs.size() / 2], timesNs.front(), numAllocations};
+}
+
+void Bench::writeRecord(const Benchmark& benchmark, bool isCold, const Timing& timing,
+	size_t numRepetitions, RecordWriter& writer)
+{
+	const auto bytesPerSecond = (timing.m_medianNs > 0)
+		? static_cast<uint64_t>(static_cast<double>(benchmark.m_numBytes) * 1e9
+			/ static_cast<double>(timing.m_medianNs))
+		: uint64_t{0};
+	writer
+		.field(benchmark.m_suite)
+		.field(benchmark.m_name)
+		.field(benchmark.m_input)
+		.field(isCold ? "cold" : "warm")
+		.field(numRepetitions)
+		.field(timing.m_numIterations)
+		.field(benchmark.m_numBytes)
+		.field(benchmark.m_numFiles)
+		.field(timing.m_medianNs)
+		.field(timing.m_minNs)
+		.field(bytesPerSecond)
+		.field(timing.m_numAllocations);
+	writer.endRecord();
+}
+
+// ============================ Regression Gate ============================
+
+// Bytes per second, or for a benchmark that reads no content, files per second
+double Bench::throughput(const Benchmark& benchmark, const Timing& timing)
+{
+	const auto amount = (benchmark.m_numBytes > 0) ? benchmark.m_numBytes : benchmark.m_numFiles;
+	return static_cast<double>(amount) * 1e9 / static_cast<double>(::std::max<uint64_t>(timing.m_medianNs, 1));
+}
+
+// FNV-1a, whose every step depends on the last, so that its speed is that of
+// the core and not of the compiler's vectorizer or of any code under test
+static uint64_t fnv1a(string_view bytes) noexcept
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (auto ch : bytes)
+	{
+		hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// The bytes per second of the calibration loop, by which the throughput of
+// each result is divided to factor out the speed of the machine.  This uses
+// the fastest repetition rather than the median:  interference can only slow
+// a loop that touches nothing but one cached buffer, and any error here
+// shifts every result of the run at once.
+double Bench::calibrationThroughput() const
+{
+	auto pText = ::std::make_shared<string>();
+	CorpusGenerator::appendText(*pText, 1024 * 1024, { CorpusEol::lf, CorpusIndent::spaces, 0, 0 },
+		k_seed);
+	auto pSink = ::std::make_shared<uint64_t>(0);
+	const Body calibration = [pText, pSink] () { *pSink += fnv1a(*pText); };
+	const auto timing = measure(calibration, nullptr);
+	return static_cast<double>(pText->size()) * 1e9 / static_cast<double>(::std::max<uint64_t>(timing.m_minNs, 1));
+}
+
+Bench::Baseline Bench::readBaseline(const Path& baselinePath)
+{
+	ifstream in(baselinePath, ::std::ios::binary);
+	if (!in)
+	{
+		throw IOError(format("Unable to open baseline '{0}'", baselinePath.generic_string()));
+	}
+
+	Baseline baseline;
+	string line;
+	for (size_t lineNum = 1; getline(in, line); ++lineNum)
+	{
+		if (line.ends_with('\r'))
+		{
+			line.pop_back();
+		}
+
+		vector<string_view> fields;
+		for (string_view rest{line};;)
+		{
+			const auto commaPos = rest.find(',');
+			fields.push_back(rest.substr(0, commaPos));
+			if (commaPos == string_view::npos)
+			{
+				break;
+			}
+			rest.remove_prefix(commaPos + 1);
+		}
+
+		double value = 0.0;
+		if (fields.size() != ::std::size(k_baselineFields) || line.find('"') != string::npos)
+		{
+			throw SyntaxError(format("Malformed line {0} in baseline '{1}'", lineNum,
+				baselinePath.generic_string()));
+		}
+		else if (lineNum == 1)
+		{
+			if (!::std::ranges::equal(fields, k_baselineFields))
+			{
+				throw SyntaxError(format("The baseline '{0}' lacks the header line",
+					baselinePath.generic_string()));
+			}
+		}
+		else if (const auto result = ::std::from_chars(fields[3].data(),
+				fields[3].data() + fields[3].size(), value);
+			result.ec != ::std::errc{} || result.ptr != fields[3].data() + fields[3].size())
+		{
+			throw SyntaxError(format("Invalid throughput '{0}' on line {1} of baseline '{2}'",
+				fields[3], lineNum, baselinePath.generic_string()));
+		}
+		else
+		{
+			baseline[fullName(fields[0], fields[1], fields[2])] = value;
+		}
+	}
+	return baseline;
+}
+
+void Bench::writeBaseline(const Path& baselinePath, const vector<GateResult>& results)
+{
+	ofstream out(baselinePath, ::std::ios::binary);
+	{
+		RecordWriter writer(out, OutputFormat::csv, k_baselineFields);
+		for (const auto& result : results)
+		{
+			writer
+				.field(result.m_suite)
+				.field(result.m_name)
+				.field(result.m_input)
+				.field(format("{0:.6g}", result.m_throughput));
+			writer.endRecord();
+		}
+	}
+	out.close();
+	if (!out)
+	{
+		throw IOError(format("Unable to write baseline '{0}'", baselinePath.generic_string()));
+	}
+}
+
+bool Bench::isRegressed(double throughput, double baselineThroughput, double maxRegressionPercent)
+{
+	return throughput < baselineThroughput * (1.0 - maxRegressionPercent / 100.0);
+}
+
+// Reports each result against the baseline, and returns false if any has
+// regressed, has no baseline row, or is missing for a baseline row.
+bool Bench::compareToBaseline(const vector<GateResult>& results, const Baseline& baseline,
+	double maxRegressionPercent, ostream& report)
+{
+	size_t numRegressions = 0;
+	size_t numUnmatched = 0;
+	set<string> matchedNames;
+	formatTo(report, "\nRegression gate (maximum regression {0}%):\n", maxRegressionPercent);
+	for (const auto& result : results)
+	{
+		const auto name = fullName(result.m_suite, result.m_name, result.m_input);
+		const auto it = baseline.find(name);
+		if (it == baseline.end())
+		{
+			++numUnmatched;
+			formatTo(report, "   {0:<48} {1:10.4g}   NO BASELINE\n", name, result.m_throughput);
+			continue;
+		}
+		matchedNames.insert(name);
+
+		const auto isRegression = isRegressed(result.m_throughput, it->second, maxRegressionPercent);
+		numRegressions += isRegression ? 1 : 0;
+		formatTo(report, "   {0:<48} {1:10.4g} {2:+7.1f}%{3}\n", name, result.m_throughput,
+			(it->second > 0.0) ? 100.0 * (result.m_throughput / it->second - 1.0) : 0.0,
+			isRegression ? "   REGRESSED" : "");
+	}
+
+	// A baseline row with no result means that a benchmark has gone missing:
+	for (const auto& [name, baselineThroughput] : baseline)
+	{
+		if (!matchedNames.contains(name))
+		{
+			++numUnmatched;
+			formatTo(report, "   {0:<48} {1:>10}   NOT RUN\n", name, "-");
+		}
+	}
+
+	if (numRegressions > 0)
+	{
+		formatTo(report, "{0} benchmark(s) regressed\n", numRegressions);
+	}
+	if (numUnmatched > 0)
+	{
+		formatTo(report, "{0} benchmark(s) missing from the baseline or the results;  "
+			"refresh the baseline with --save-baseline\n", numUnmatched);
+	}
+	report.flush();
+	return numRegressions == 0 && numUnmatched == 0;
+}
+
+// ============================ Microbenchmarks ============================
+
+vector<Bench::Benchmark> Bench::microBenchmarks() const
+{
+	struct TextInput
+	{
+		const char*	m_pName;
+		size_t		m_numBytes;
+		TextShape	m_shape;
+	};
+	static const TextInput k_textInputs[] =
+	{
+		{ "unix-4KiB", 4 * 1024, { CorpusEol::lf, CorpusIndent::spaces, 0, 0 } },
+		{ "unix-1MiB", 1024 * 1024, { CorpusEol::lf, CorpusIndent::spaces, 0, 0 } },
+		{ "dos-1MiB", 1024 * 1024, { CorpusEol::crlf, CorpusIndent::spaces, 0, 0 } },
+		{ "mixed-1MiB", 1024 * 1024, { CorpusEol::mixed, CorpusIndent::spaces, 0, 0 } },
+		{ "trailing-ws-1MiB", 1024 * 1024, { CorpusEol::lf, CorpusIndent::spaces, 50, 0 } },
+		{ "non-ascii-1MiB", 1024 * 1024, { CorpusEol::lf, CorpusIndent::spaces, 0, 20 } },
+		{ "tabs-1MiB", 1024 * 1024, { CorpusEol::lf, CorpusIndent::tabs, 0, 0 } },
+	};
+
+	// The inputs are shared by the bodies, which outlive this function:
+	auto pTexts = ::std::make_shared<vector<string>>();
+	for (const auto& input : k_textInputs)
+	{
+		CorpusGenerator::appendText(pTexts->emplace_back(), input.m_numBytes, input.m_shape, k_seed);
+	}
+
+	vector<Benchmark> benchmarks;
+	for (size_t i = 0; i < pTexts->size(); ++i)
+	{
+		const string_view text{(*pTexts)[i]};
+		const string input{k_textInputs[i].m_pName};
+		benchmarks.push_back({"micro", "xeol.scanFile", input, text.size(), 1, [pTexts, text] ()
+			{
+				MemoryStream in(text);
+				size_t numDosEols, numMacEols, numUnixEols, totalEols;
+				Xeol::scanFile(in, numDosEols, numMacEols, numUnixEols, totalEols);
+			}});
+		benchmarks.push_back({"micro", "stripws.scanFile", input, text.size(), 1, [pTexts, text] ()
+			{
+				MemoryStream in(text);
+				size_t numLinesAffected, numSpacesStripped, numTabsStripped;
+				StripWS::scanFile(in, numLinesAffected, numSpacesStripped, numTabsStripped);
+			}});
+		benchmarks.push_back({"micro", "isplainascii.scanFile2", input, text.size(), 1, [pTexts, text] ()
+			{
+				ScratchArena::ResetGuard arenaResetGuard;
+				MemoryStream in(text);
+				NullBuf nullBuf;
+				ostream out(&nullBuf);
+				IsPlainAscii::scanFile2("input.txt", in, out);
+			}});
+		benchmarks.push_back({"micro", "indents.classifyLine", input, text.size(), 1, [pTexts, text] ()
+			{
+				for (size_t lineStart = 0; lineStart < text.size();)
+				{
+					auto lineEnd = text.find('\n', lineStart);
+					lineEnd = (lineEnd == string_view::npos) ? text.size() : lineEnd + 1;
+					classifyLine(text.substr(lineStart, lineEnd - lineStart), false);
+					lineStart = lineEnd;
+				}
+			}});
+	}
+
+	for (const unsigned depth : { 1u, 16u })
+	{
+		auto pJson = ::std::make_shared<string>();
+		CorpusGenerator::appendJson(*pJson, 1024 * 1024, depth, k_seed);
+		auto pJsonPath = ::std::make_shared<Path>(fs::temp_directory_path()
+			/ format("cmdlineutil-bench-{0}-{1}.json", k_seed, depth));
+		writeFile(*pJsonPath, *pJson);
+		auto pJsonDeleter = ::std::make_shared<PathDeleter>(*pJsonPath);
+		auto pJValue = ::std::make_shared<JsonPP::JValue>(JsonPP::parseFile(*pJsonPath));
+		const auto input = format("depth-{0}-1MiB", depth);
+		benchmarks.push_back({"micro", "jsonpp.parseFile", input, pJson->size(), 1,
+			[pJsonPath, pJsonDeleter] () { JsonPP::parseFile(*pJsonPath); }});
+		benchmarks.push_back({"micro", "jsonpp.prettyPrint", input, pJson->size(), 1, [pJValue] ()
+			{
+				NullBuf nullBuf;
+				ostream out(&nullBuf);
+				writeJson(out, *pJValue, JsonStyle::pretty);
+			}});
+	}
+
+	// A tree of empty files, so that only the enumeration is timed:
+	auto pTreeDir = ::std::make_shared<Path>(fs::temp_directory_path()
+		/ format("cmdlineutil-bench-{0}-enum", k_seed));
+	auto pTreeDeleter = ::std::make_shared<PathDeleter>(*pTreeDir);
+	remove_all(*pTreeDir);
+	uint64_t numFiles = 0;
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		const auto dir = *pTreeDir / format("dir{0}", i);
+		create_directories(dir);
+		for (unsigned j = 0; j < 64; ++j, ++numFiles)
+		{
+			writeFile(dir / format("file{0}.{1}", j, (j % 2 == 0) ? "txt" : "java"), "");
+		}
+	}
+	benchmarks.push_back({"micro", "FileEnumerator.enumerateFiles", "1024-files", 0, numFiles,
+		[pTreeDir, pTreeDeleter] ()
+		{
+			FileEnumerator fileEnumerator;
+			fileEnumerator.setRecursive();
+			fileEnumerator.insert(*pTreeDir / "*.txt");
+			size_t numFilesFound = 0;
+			fileEnumerator.enumerateFiles([&numFilesFound] (const Path&) { ++numFilesFound; });
+		}});
+	return benchmarks;
+}
+
+// ============================ Macro Benchmarks ============================
+
+template<typename Tool>
+static Bench::Body toolBody(vector<string> args)
+{
+	return [args] ()
+		{
+			vector<const char*> argPtrs;
+			::std::ranges::transform(args, back_inserter(argPtrs),
+				[] (const string& arg) { return arg.c_str(); });
+			Tool tool{::std::span<const char*const>{argPtrs}};
+			tool.run();
+		};
+}
+
+vector<Bench::Benchmark> Bench::macroBenchmarks(const Path& treeDir) const
+{
+	uint64_t numTextBytes = 0, numTextFiles = 0, numJsonBytes = 0, numJsonFiles = 0;
+	for (const auto& entry : fs::recursive_directory_iterator(treeDir))
+	{
+		if (!entry.is_regular_file())
+		{
+			continue;
+		}
+		else if (entry.path().extension() == ".json")
+		{
+			numJsonBytes += entry.file_size();
+			++numJsonFiles;
+		}
+		else
+		{
+			numTextBytes += entry.file_size();
+			++numTextFiles;
+		}
+	}
+
+	const auto textSpec = (treeDir / "*.txt").string();
+	const auto javaSpec = (treeDir / "*.java").string();
+	const auto cppSpec = (treeDir / "*.cpp").string();
+	const auto hSpec = (treeDir / "*.h").string();
+	const auto jsonSpec = (treeDir / "*.json").string();
+	const auto input = treeDir.filename().string();
+	return {
+		{ "macro", "xeol", input, numTextBytes, numTextFiles,
+			toolBody<Xeol>({ "-r", textSpec, javaSpec, cppSpec, hSpec }) },
+		{ "macro", "stripws", input, numTextBytes, numTextFiles,
+			toolBody<StripWS>({ "-r", textSpec, javaSpec, cppSpec, hSpec }) },
+		{ "macro", "isplainascii", input, numTextBytes, numTextFiles,
+			toolBody<IsPlainAscii>({ "-r", textSpec, javaSpec, cppSpec, hSpec }) },
+		{ "macro", "indents", input, numTextBytes, numTextFiles,
+			toolBody<IndentClassifier>({ "-r", textSpec, javaSpec, cppSpec, hSpec }) },
+		{ "macro", "audit", input, numTextBytes, numTextFiles,
+			toolBody<Audit>({ "-r", textSpec, javaSpec, cppSpec, hSpec }) },
+		{ "macro", "findext", input, 0, numTextFiles + numJsonFiles,
+			toolBody<FindFileExt>({ "-r", treeDir.string() }) },
+		// Pretty-printing in place is idempotent after the warm-up:
+		{ "macro", "jsonpp", input, numJsonBytes, numJsonFiles,
+			toolBody<JsonPP>({ "-ip", "-r", jsonSpec }) },
+	};
+}
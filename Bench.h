@@ -0,0 +1,116 @@
+
+#if !defined(BENCH_H_INCLUDED)
+#define BENCH_H_INCLUDED
+
+#include "RecordWriter.h"
+#include "Utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <optional>
+#include <regex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// \brief The benchmark suite.  The microbenchmarks time each core routine
+/// over in-memory inputs of various shapes, and the macro benchmarks time
+/// each tool end to end over a tree of generated files, both with the files
+/// in the page cache (warm) and with them dropped from it first (cold).
+/// Each result is written as one line of JSON.
+///
+/// Given a baseline, bench is also the performance regression gate:  it
+/// divides the throughput of each warm result by that of a fixed
+/// calibration loop, so as to factor out the speed of the machine, and fails
+/// if any has fallen by more than the allowed percentage from the baseline.
+///
+/// The bench program is built in test mode, for access to the internals of
+/// the tools, and with the counting operator new, so that each result also
+/// gives the allocations made per iteration.
+class Bench
+{
+public:
+	static int usage(::std::ostream& strm, ::std::string_view progName, const char* pMsg);
+
+	Bench(::std::span<const char*const> args);
+	int run() const;
+
+	Bench(const Bench&) = delete;
+	Bench& operator=(const Bench&) = delete;
+	Bench(Bench&&) = delete;
+	Bench& operator=(Bench&&) = delete;
+
+PRIVATE_EXCEPT_IN_TEST:
+	using Path = ::std::filesystem::path;
+	using Body = ::std::function<void()>;
+
+	struct Benchmark
+	{
+		::std::string	m_suite;			///< "micro" or "macro"
+		::std::string	m_name;			///< The routine or tool
+		::std::string	m_input;			///< The shape of the input
+		::std::uint64_t	m_numBytes;		///< Processed per iteration
+		::std::uint64_t	m_numFiles;		///< Processed per iteration
+		Body				m_body;
+	};
+
+	struct Timing
+	{
+		::std::uint64_t	m_numIterations;	///< Per repetition
+		::std::uint64_t	m_medianNs;			///< Per iteration
+		::std::uint64_t	m_minNs;				///< Per iteration
+		::std::uint64_t	m_numAllocations;	///< Per iteration
+	};
+
+	/// \brief A warm result, for the regression gate.
+	struct GateResult
+	{
+		::std::string	m_suite;
+		::std::string	m_name;
+		::std::string	m_input;
+		double			m_throughput;	///< Relative to the calibration loop
+	};
+
+	/// \brief Maps suite/benchmark/input to relative throughput.
+	using Baseline = ::std::map< ::std::string, double>;
+
+	::std::vector<Benchmark> microBenchmarks() const;
+	::std::vector<Benchmark> macroBenchmarks(const Path& treeDir) const;
+	bool isSelected(const Benchmark& benchmark) const;
+	bool isSelected(::std::string_view fullName) const;
+	Timing measure(const Body& body, const Path* pColdTreeDir) const;
+	static void writeRecord(const Benchmark& benchmark, bool isCold, const Timing& timing,
+		::std::size_t numRepetitions, RecordWriter& writer);
+	static void generateTree(const Path& treeDir);
+	static ::std::string fullName(::std::string_view suite, ::std::string_view name,
+		::std::string_view input);
+	static double throughput(const Benchmark& benchmark, const Timing& timing);
+	double calibrationThroughput() const;
+	static Baseline readBaseline(const Path& baselinePath);
+	static void writeBaseline(const Path& baselinePath, const ::std::vector<GateResult>& results);
+	static bool isRegressed(double throughput, double baselineThroughput,
+		double maxRegressionPercent);
+	/// \brief Reports each result against the baseline, and returns false if
+	/// any regressed, has no baseline row, or is missing for a baseline row.
+	static bool compareToBaseline(const ::std::vector<GateResult>& results,
+		const Baseline& baseline, double maxRegressionPercent, ::std::ostream& report);
+	static bool dropFromPageCache(const Path& treeDir);
+
+	bool								m_runMicro;
+	bool								m_runMacro;
+	bool								m_runCold;
+	::std::size_t					m_numRepetitions;
+	::std::optional< ::std::regex>	m_filter;
+	Path								m_treeDir;
+	Path								m_outputPath;
+	Path								m_baselinePath;
+	Path								m_saveBaselinePath;
+	double							m_maxRegressionPercent;
+};
+
+#endif // BENCH_H_INCLUDED
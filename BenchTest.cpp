@@ -0,0 +1,148 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "Bench.h"
+#include "Exceptions.h"
+#include "PathDeleter.h"
+#include "TestUtil.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fs = ::std::filesystem;
+namespace utd = ::boost::unit_test::data;
+
+using ::std::ofstream;
+using ::std::ostringstream;
+using ::std::string;
+
+BOOST_AUTO_TEST_SUITE(BenchTestSuite)
+
+BOOST_AUTO_TEST_SUITE(CmdLineParseFailTestSuite)
+
+static char const*const k_args00[] = { "bench", "-?" };
+static char const*const k_args01[] = { "bench", "-h" };
+static char const*const k_args02[] = { "bench", "--micro", "--macro" };
+static char const*const k_args03[] = { "bench", "--repetitions" };
+static char const*const k_args04[] = { "bench", "--repetitions", "0" };
+static char const*const k_args05[] = { "bench", "--repetitions", "5x" };
+static char const*const k_args06[] = { "bench", "--filter", "(" };
+static char const*const k_args07[] = { "bench", "--tree", "NoSuchBenchTree" };
+static char const*const k_args08[] = { "bench", "Xeol.cpp" };
+static char const*const k_args09[] = { "bench", "--max-regression", "ten" };
+static char const*const k_args10[] = { "bench", "--max-regression", "100" };
+static char const*const k_args11[] = { "bench", "--baseline", "NoSuchBaseline.csv" };
+
+static CmdLineParseFailTestCase const k_testCases[] =
+{
+	{ k_args00, "^$" },
+	{ k_args01, "^$" },
+	{ k_args02, ".*mutually exclusive.*" },
+	{ k_args03, ".*requires a value.*" },
+	{ k_args04, ".*invalid number of repetitions.*" },
+	{ k_args05, ".*invalid number of repetitions.*" },
+	{ k_args06, ".*invalid filter.*" },
+	{ k_args07, ".*not a directory.*" },
+	{ k_args08, ".*unrecognized argument.*" },
+	{ k_args09, ".*invalid maximum regression.*" },
+	{ k_args10, ".*invalid maximum regression.*" },
+	{ k_args11, ".*does not exist.*" },
+};
+
+BOOST_DATA_TEST_CASE(cmdLineParseFailTest, utd::make(k_testCases), tc)
+{
+	BOOST_CHECK_EXCEPTION(Bench(tc.m_args), CmdLineError,
+		[&tc](const CmdLineError& ex) { return tc.doesExMatch(ex); });
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_CASE(cmdLineParseOkTest)
+{
+	static char const*const k_args[] = { "--macro", "--warm-only", "--repetitions", "3",
+		"--filter", "xeol", "--output", "bench.jsonl" };
+	const Bench app{ArgSpan{k_args}};
+	BOOST_CHECK(!app.m_runMicro);
+	BOOST_CHECK(app.m_runMacro);
+	BOOST_CHECK(!app.m_runCold);
+	BOOST_CHECK_EQUAL(3u, app.m_numRepetitions);
+	BOOST_CHECK(app.isSelected({"macro", "xeol", "tree", 0, 0, {}}));
+	BOOST_CHECK(!app.isSelected({"macro", "stripws", "tree", 0, 0, {}}));
+	BOOST_CHECK_EQUAL("bench.jsonl", app.m_outputPath.generic_string());
+}
+
+BOOST_AUTO_TEST_CASE(generateTreeTest)
+{
+	const fs::path treeDir{"BenchTestTree"};
+	PathDeleter treeDeleter(treeDir);
+	Bench::generateTree(treeDir);
+
+	size_t numFiles = 0;
+	for (const auto& entry : fs::recursive_directory_iterator(treeDir))
+	{
+		numFiles += entry.is_regular_file() ? 1 : 0;
+	}
+	BOOST_CHECK_EQUAL(21u * 20u, numFiles);
+}
+
+BOOST_AUTO_TEST_CASE(baselineRoundTripTest)
+{
+	const fs::path baselinePath{"BenchTestBaseline.csv"};
+	PathDeleter baselineDeleter(baselinePath);
+	Bench::writeBaseline(baselinePath, {
+		{ "macro", "xeol", "tree", 0.125 },
+		{ "micro", "xeol.scanFile", "unix-1MiB", 2.5 } });
+
+	const auto baseline = Bench::readBaseline(baselinePath);
+	BOOST_REQUIRE_EQUAL(2u, baseline.size());
+	BOOST_CHECK_EQUAL(0.125, baseline.at("macro/xeol/tree"));
+	BOOST_CHECK_EQUAL(2.5, baseline.at("micro/xeol.scanFile/unix-1MiB"));
+
+	{
+		ofstream out(baselinePath);
+		out << "suite,benchmark,input,throughput\nmacro,xeol,tree,fast\n";
+	}
+	BOOST_CHECK_THROW(Bench::readBaseline(baselinePath), SyntaxError);
+}
+
+BOOST_AUTO_TEST_CASE(compareToBaselineTest)
+{
+	const Bench::Baseline baseline{ { "macro/xeol/tree", 1.0 }, { "macro/stripws/tree", 1.0 } };
+	ostringstream report;
+	BOOST_CHECK(Bench::compareToBaseline({
+			{ "macro", "xeol", "tree", 0.91 },
+			{ "macro", "stripws", "tree", 1.5 } },
+		baseline, 10.0, report));
+	BOOST_CHECK(report.str().find("REGRESSED") == string::npos);
+
+	// A result with no baseline row fails the gate, as does a row with no result:
+	report.str("");
+	BOOST_CHECK(!Bench::compareToBaseline({
+			{ "macro", "xeol", "tree", 0.91 },
+			{ "macro", "stripws", "tree", 1.5 },
+			{ "macro", "audit", "tree", 0.01 } },
+		baseline, 10.0, report));
+	BOOST_CHECK(report.str().find("NO BASELINE") != string::npos);
+
+	report.str("");
+	BOOST_CHECK(!Bench::compareToBaseline({ { "macro", "xeol", "tree", 1.0 } },
+		baseline, 10.0, report));
+	BOOST_CHECK(report.str().find("macro/stripws/tree") != string::npos);
+	BOOST_CHECK(report.str().find("NOT RUN") != string::npos);
+
+	report.str("");
+	BOOST_CHECK(!Bench::compareToBaseline({
+			{ "macro", "xeol", "tree", 0.1 },
+			{ "macro", "stripws", "tree", 1.0 } },
+		baseline, 10.0, report));
+	BOOST_CHECK(report.str().find("macro/xeol/tree") != string::npos);
+	BOOST_CHECK(report.str().find("REGRESSED") != string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,193 @@
+
+#include "BlockReader.h"
+#include "Cancellation.h"
+#include "Exceptions.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <istream>
+
+#if defined(_WIN32)
+#	include <io.h>
+#	define CLOSE_FD ::_close
+#	define READ_FD ::_read
+#else
+#	include <unistd.h>
+#	define CLOSE_FD ::close
+#	define READ_FD ::read
+#	define O_BINARY 0
+#endif
+
+using ::std::format;
+
+// ============================ InputFile ============================
+
+static int openForReading(const InputFile::Path& p)
+{
+	RunStats::PhaseTimer openingTimer(RunStats::Phase::opening);
+#if defined(_WIN32)
+	return ::_wopen(p.c_str(), _O_RDONLY | _O_BINARY);
+#else
+	return ::open(p.c_str(), O_RDONLY | O_BINARY);
+#endif
+}
+
+InputFile::InputFile(const Path& p) :
+	m_fd(openForReading(p))
+{
+	if (m_fd < 0)
+	{
+		throw IOError(format("Unable to open file '{0}':  {1}",
+			p.generic_string(), ::std::strerror(errno)));
+	}
+}
+
+InputFile::~InputFile()
+{
+	CLOSE_FD(m_fd);
+}
+
+// ============================ BlockReader ============================
+
+BlockReader::BlockReader(int fd, ::std::pmr::memory_resource* pMemRsrc) :
+	m_fd(fd),
+	m_pIn(nullptr),
+	m_bufferReservation(MemoryBudget::Reservation::forBuffer(k_blockSize, k_minBlockSize, "a read buffer")),
+	m_buffer(m_bufferReservation.size(), pMemRsrc),
+	m_peekedBlock(),
+	m_isPeeked(false),
+	m_pDecompressor(),
+	m_decompressedBufferReservation(),
+	m_decompressedBuffer(pMemRsrc),
+	m_compressedInput(),
+	m_isAtEndOfInput(false)
+{
+}
+
+BlockReader::BlockReader(::std::istream& in, ::std::pmr::memory_resource* pMemRsrc) :
+	m_fd(-1),
+	m_pIn(&in),
+	m_bufferReservation(MemoryBudget::Reservation::forBuffer(k_blockSize, k_minBlockSize, "a read buffer")),
+	m_buffer(m_bufferReservation.size(), pMemRsrc),
+	m_peekedBlock(),
+	m_isPeeked(false),
+	m_pDecompressor(),
+	m_decompressedBufferReservation(),
+	m_decompressedBuffer(pMemRsrc),
+	m_compressedInput(),
+	m_isAtEndOfInput(false)
+{
+}
+
+ByteSpan BlockReader::peek()
+{
+	if (!m_isPeeked)
+	{
+		m_peekedBlock = next();
+		m_isPeeked = true;
+	}
+	return m_peekedBlock;
+}
+
+ByteSpan BlockReader::next()
+{
+	if (m_isPeeked)
+	{
+		m_isPeeked = false;
+		return m_peekedBlock;
+	}
+	return m_pDecompressor ? nextDecompressedBlock() : readBlock();
+}
+
+Compression BlockReader::decompressIfCompressed()
+{
+	if (m_pDecompressor)
+	{
+		return m_pDecompressor->compression();
+	}
+	const auto compression = detectCompression(peek());
+	if (compression != Compression::none)
+	{
+		// The raw block just peeked becomes the first compressed input:
+		m_compressedInput = m_peekedBlock;
+		m_isPeeked = false;
+		m_decompressedBufferReservation = MemoryBudget::Reservation::forBuffer(
+			k_blockSize, k_minBlockSize, "a decompression buffer");
+		m_decompressedBuffer.resize(m_decompressedBufferReservation.size());
+		m_pDecompressor = ::std::make_unique<Decompressor>(compression);
+	}
+	return compression;
+}
+
+ByteSpan BlockReader::nextDecompressedBlock()
+{
+	// Polled here too, because a small block of input can expand greatly:
+	CancellationToken::throwIfRequested();
+	for (;;)
+	{
+		// m_buffer is refilled only once the decompressor has consumed it:
+		if (m_compressedInput.empty() && !m_isAtEndOfInput)
+		{
+			m_compressedInput = readBlock();
+			m_isAtEndOfInput = m_compressedInput.empty();
+		}
+		const auto numBytes = m_pDecompressor->decompress(m_compressedInput, m_decompressedBuffer);
+		if (numBytes > 0)
+		{
+			return ByteSpan{m_decompressedBuffer.data(), numBytes};
+		}
+		else if (m_isAtEndOfInput)
+		{
+			if (!m_pDecompressor->isAtEndOfStream())
+			{
+				throw IOError(format("Truncated {0} input", compressionName(m_pDecompressor->compression())));
+			}
+			return ByteSpan{};
+		}
+	}
+}
+
+ByteSpan BlockReader::readBlock()
+{
+	CancellationToken::throwIfRequested();
+	RunStats::PhaseTimer readingTimer(RunStats::Phase::reading);
+
+	if (m_pIn != nullptr)
+	{
+		if (m_pIn->eof())
+		{
+			return ByteSpan{};
+		}
+		else if (!m_pIn->good())
+		{
+			throw IOError("Error while reading input file");
+		}
+		m_pIn->read(reinterpret_cast<char*>(m_buffer.data()),
+			static_cast< ::std::streamsize>(m_buffer.size()));
+		if (m_pIn->bad())
+		{
+			throw IOError("Error while reading input file");
+		}
+		RunStats::countBytesRead(static_cast<size_t>(m_pIn->gcount()));
+		return ByteSpan{m_buffer.data(), static_cast<size_t>(m_pIn->gcount())};
+	}
+
+	for (;;)
+	{
+		auto numBytesRead = READ_FD(m_fd, m_buffer.data(),
+			static_cast<unsigned>(m_buffer.size()));
+		if (numBytesRead >= 0)
+		{
+			RunStats::countBytesRead(static_cast<size_t>(numBytesRead));
+			return ByteSpan{m_buffer.data(), static_cast<size_t>(numBytesRead)};
+		}
+		else if (errno != EINTR)
+		{
+			throw IOError(format("Error while reading input file:  {0}",
+				::std::strerror(errno)));
+		}
+		CancellationToken::throwIfRequested();
+	}
+}
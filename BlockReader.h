@@ -0,0 +1,144 @@
+
+#if !defined(BLOCKREADER_H_INCLUDED)
+#define BLOCKREADER_H_INCLUDED
+
+#include "Decompressor.h"
+#include "MemoryBudget.h"
+#include "PerfCounters.h"
+#include "RunStats.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+using ByteSpan = ::std::span<const ::std::byte>;
+
+/// \brief Owns a file descriptor opened for binary reading.
+class InputFile
+{
+public:
+	using Path = ::std::filesystem::path;
+
+	/// \brief Opens the file, throwing IOError on failure.
+	explicit InputFile(const Path& p);
+	~InputFile();
+
+	int fd() const noexcept
+		{ return m_fd; }
+
+	InputFile(const InputFile&) = delete;
+	InputFile& operator=(const InputFile&) = delete;
+	InputFile(InputFile&&) = delete;
+	InputFile& operator=(InputFile&&) = delete;
+
+private:
+	int m_fd;
+};
+
+/// \brief Reads an input stream or a file descriptor in fixed-size blocks.
+///
+/// This is the single place where the scanners pull bytes from the outside
+/// world, so it is also where they poll the CancellationToken.  Its buffers
+/// are reserved against the MemoryBudget, and when that is tight they are
+/// smaller than k_blockSize, down to k_minBlockSize.
+class BlockReader
+{
+public:
+	static constexpr ::std::size_t k_blockSize = 64 * 1024;
+	static constexpr ::std::size_t k_minBlockSize = 4 * 1024;
+
+	explicit BlockReader(int fd,
+		::std::pmr::memory_resource* pMemRsrc = ::std::pmr::get_default_resource());
+	explicit BlockReader(::std::istream& in,
+		::std::pmr::memory_resource* pMemRsrc = ::std::pmr::get_default_resource());
+
+	/// \brief Returns the next block of input, or an empty span at the end of
+	/// the input.  The block remains valid until the next call.  Throws
+	/// IOError on a read error and CanceledError if cancellation is requested.
+	ByteSpan next();
+
+	/// \brief Returns the next block of input without consuming it, so that
+	/// the following call to next() returns the same block.  This is how a
+	/// file is judged by its first block (see sniffBinary()) before it is
+	/// scanned.
+	ByteSpan peek();
+
+	/// \brief Peeks at the first block, and if it starts a gzip or zstd
+	/// stream, arranges for next() and peek() to return the decompressed
+	/// input from then on, in blocks of the usual size.  Returns the
+	/// compression found.  Call this before reading anything.  A corrupt or
+	/// truncated stream makes next() throw IOError.
+	///
+	/// Only the paths that read a file without rewriting it call this, so
+	/// that a compressed file is never rewritten as plain text.
+	Compression decompressIfCompressed();
+
+	/// \brief Calls blockHandler(ByteSpan) for each block until the end of
+	/// the input is reached.
+	template<typename BlockHandler>
+	void forEachBlock(BlockHandler blockHandler)
+		{
+			RunStats::PhaseTimer scanningTimer(RunStats::Phase::scanning);
+			for (auto block = next(); !block.empty(); block = next())
+			{
+				PerfCounters::Scope perfScope(block.size());
+				blockHandler(block);
+			}
+		}
+
+	/// \brief Passes each block to scanner.scan(ByteSpan) until the end of
+	/// the input is reached.
+	template<typename Scanner>
+	void feed(Scanner& scanner)
+		{ forEachBlock([&scanner] (ByteSpan block) { scanner.scan(block); }); }
+
+	/// \brief The same as feed(), except that it stops reading as soon as
+	/// isDone() returns true after a block, e.g., because the verdict on the
+	/// input can no longer change.  Returns true if it stopped in this way.
+	template<typename Scanner, typename IsDone>
+	bool feedUntil(Scanner& scanner, IsDone isDone)
+		{
+			RunStats::PhaseTimer scanningTimer(RunStats::Phase::scanning);
+			for (auto block = next(); !block.empty(); block = next())
+			{
+				{
+					PerfCounters::Scope perfScope(block.size());
+					scanner.scan(block);
+				}
+				if (isDone())
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+	BlockReader(const BlockReader&) = delete;
+	BlockReader& operator=(const BlockReader&) = delete;
+	BlockReader(BlockReader&&) = delete;
+	BlockReader& operator=(BlockReader&&) = delete;
+
+private:
+	ByteSpan readBlock();
+	ByteSpan nextDecompressedBlock();
+
+	int											m_fd;
+	::std::istream*							m_pIn;
+	MemoryBudget::Reservation				m_bufferReservation;
+	::std::pmr::vector< ::std::byte>		m_buffer;
+	ByteSpan										m_peekedBlock;
+	bool											m_isPeeked;
+
+	// Only while decompressing:
+	::std::unique_ptr<Decompressor>		m_pDecompressor;
+	MemoryBudget::Reservation				m_decompressedBufferReservation;
+	::std::pmr::vector< ::std::byte>		m_decompressedBuffer;
+	ByteSpan										m_compressedInput;	// The rest of the last raw block
+	bool											m_isAtEndOfInput;
+};
+
+#endif // BLOCKREADER_H_INCLUDED
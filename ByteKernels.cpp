@@ -0,0 +1,547 @@
+
+#include "ByteKernels.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define BYTEKERNELS_X86
+#	include <immintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define TARGET(isas)
+#	else
+#		include <cpuid.h>
+#		define TARGET(isas) __attribute__((target(isas)))
+#	endif
+#endif
+
+using ::std::invalid_argument;
+using ::std::ptrdiff_t;
+using ::std::size_t;
+using ::std::string_view;
+using ::std::uint32_t;
+using ::std::uint64_t;
+
+using Isa = ByteKernels::Isa;
+using ByteSet = ByteKernels::ByteSet;
+using LeadingWhiteSpace = ByteKernels::LeadingWhiteSpace;
+using Table = ByteKernels::Table;
+
+// ============================ Scalar ============================
+
+// The reference implementations, against which the others are tested, and
+// which finish the ranges too short for a whole vector.
+
+static const char* findFirstOfScalar(const char* p, const char* pEnd, const ByteSet& set)
+{
+	for (; p != pEnd && !set.contains(*p); ++p)
+	{
+	}
+	return p;
+}
+
+static size_t countScalar(const char* p, const char* pEnd, char ch)
+{
+	size_t result = 0;
+	for (; p != pEnd; ++p)
+	{
+		result += (*p == ch) ? 1 : 0;
+	}
+	return result;
+}
+
+static const char* findHighBitScalar(const char* p, const char* pEnd)
+{
+	for (; p != pEnd && static_cast<unsigned char>(*p) < 0x80; ++p)
+	{
+	}
+	return p;
+}
+
+static LeadingWhiteSpace leadingWhiteSpaceScalar(const char* p, const char* pEnd)
+{
+	LeadingWhiteSpace result{0, false, false};
+	for (; p != pEnd; ++p, ++result.m_length)
+	{
+		if (*p == ' ')
+		{
+			result.m_hasSpace = true;
+		}
+		else if (*p == '\t')
+		{
+			result.m_hasTab = true;
+		}
+		else
+		{
+			break;
+		}
+	}
+	return result;
+}
+
+// Extends the white space measured by a vector loop with that of the tail
+static LeadingWhiteSpace extend(LeadingWhiteSpace head, LeadingWhiteSpace tail)
+{
+	return LeadingWhiteSpace{head.m_length + tail.m_length,
+		head.m_hasSpace || tail.m_hasSpace, head.m_hasTab || tail.m_hasTab};
+}
+
+// The bits of mask below its lowest set bit, or all of them if there is none
+template<typename Mask>
+static Mask bitsBelowFirst(Mask mask)
+{
+	return (mask == 0) ? ~Mask{0} : static_cast<Mask>((Mask{1} << ::std::countr_zero(mask)) - 1);
+}
+
+#if defined(BYTEKERNELS_X86)
+
+// ============================ SSE2 ============================
+
+TARGET("sse2")
+static const char* findFirstOfSse2(const char* p, const char* pEnd, const ByteSet& set)
+{
+	const auto b0 = _mm_set1_epi8(set.m_bytes[0]);
+	const auto b1 = _mm_set1_epi8(set.m_bytes[1]);
+	const auto b2 = _mm_set1_epi8(set.m_bytes[2]);
+	const auto b3 = _mm_set1_epi8(set.m_bytes[3]);
+	const int highBitMask = set.m_matchesHighBit ? 0xffff : 0;
+	for (; pEnd - p >= 16; p += 16)
+	{
+		const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const auto eq = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, b0), _mm_cmpeq_epi8(v, b1)),
+			_mm_or_si128(_mm_cmpeq_epi8(v, b2), _mm_cmpeq_epi8(v, b3)));
+		const auto mask = static_cast<unsigned>(_mm_movemask_epi8(eq)
+			| (_mm_movemask_epi8(v) & highBitMask));
+		if (mask != 0)
+		{
+			return p + ::std::countr_zero(mask);
+		}
+	}
+	return findFirstOfScalar(p, pEnd, set);
+}
+
+// The matches accumulate in byte lanes, which are summed before they can
+// overflow, 255 vectors at a time.
+TARGET("sse2")
+static size_t countSse2(const char* p, const char* pEnd, char ch)
+{
+	const auto needle = _mm_set1_epi8(ch);
+	size_t result = 0;
+	while (pEnd - p >= 16)
+	{
+		auto counts = _mm_setzero_si128();
+		const auto numVectors = ::std::min<ptrdiff_t>((pEnd - p) / 16, 255);
+		for (ptrdiff_t i = 0; i < numVectors; ++i, p += 16)
+		{
+			const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(v, needle));
+		}
+		const auto sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+		result += static_cast<size_t>(_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+	}
+	return result + countScalar(p, pEnd, ch);
+}
+
+TARGET("sse2")
+static const char* findHighBitSse2(const char* p, const char* pEnd)
+{
+	for (; pEnd - p >= 16; p += 16)
+	{
+		const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		if (const auto mask = static_cast<unsigned>(_mm_movemask_epi8(v)); mask != 0)
+		{
+			return p + ::std::countr_zero(mask);
+		}
+	}
+	return findHighBitScalar(p, pEnd);
+}
+
+TARGET("sse2")
+static LeadingWhiteSpace leadingWhiteSpaceSse2(const char* p, const char* pEnd)
+{
+	const auto space = _mm_set1_epi8(' ');
+	const auto tab = _mm_set1_epi8('\t');
+	LeadingWhiteSpace result{0, false, false};
+	for (; pEnd - p >= 16; p += 16)
+	{
+		const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const auto spaceMask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, space)));
+		const auto tabMask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, tab)));
+		const auto otherMask = ~(spaceMask | tabMask) & 0xffffu;
+		const auto wsMask = bitsBelowFirst(otherMask);
+		result.m_hasSpace = result.m_hasSpace || (spaceMask & wsMask) != 0;
+		result.m_hasTab = result.m_hasTab || (tabMask & wsMask) != 0;
+		if (otherMask != 0)
+		{
+			result.m_length += static_cast<size_t>(::std::countr_zero(otherMask));
+			return result;
+		}
+		result.m_length += 16;
+	}
+	return extend(result, leadingWhiteSpaceScalar(p, pEnd));
+}
+
+// ============================ AVX2 ============================
+
+// The tails of fewer than 32 bytes go to the SSE2 kernels.
+
+TARGET("avx2")
+static const char* findFirstOfAvx2(const char* p, const char* pEnd, const ByteSet& set)
+{
+	const auto b0 = _mm256_set1_epi8(set.m_bytes[0]);
+	const auto b1 = _mm256_set1_epi8(set.m_bytes[1]);
+	const auto b2 = _mm256_set1_epi8(set.m_bytes[2]);
+	const auto b3 = _mm256_set1_epi8(set.m_bytes[3]);
+	const uint32_t highBitMask = set.m_matchesHighBit ? ~uint32_t{0} : 0;
+	for (; pEnd - p >= 32; p += 32)
+	{
+		const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		const auto eq = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, b0), _mm256_cmpeq_epi8(v, b1)),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, b2), _mm256_cmpeq_epi8(v, b3)));
+		const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(eq))
+			| (static_cast<uint32_t>(_mm256_movemask_epi8(v)) & highBitMask);
+		if (mask != 0)
+		{
+			return p + ::std::countr_zero(mask);
+		}
+	}
+	return findFirstOfSse2(p, pEnd, set);
+}
+
+TARGET("avx2")
+static size_t countAvx2(const char* p, const char* pEnd, char ch)
+{
+	const auto needle = _mm256_set1_epi8(ch);
+	size_t result = 0;
+	while (pEnd - p >= 32)
+	{
+		auto counts = _mm256_setzero_si256();
+		const auto numVectors = ::std::min<ptrdiff_t>((pEnd - p) / 32, 255);
+		for (ptrdiff_t i = 0; i < numVectors; ++i, p += 32)
+		{
+			const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			counts = _mm256_sub_epi8(counts, _mm256_cmpeq_epi8(v, needle));
+		}
+		const auto sums256 = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+		const auto sums = _mm_add_epi64(_mm256_castsi256_si128(sums256),
+			_mm256_extracti128_si256(sums256, 1));
+		result += static_cast<size_t>(_mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4));
+	}
+	return result + countSse2(p, pEnd, ch);
+}
+
+TARGET("avx2")
+static const char* findHighBitAvx2(const char* p, const char* pEnd)
+{
+	for (; pEnd - p >= 32; p += 32)
+	{
+		const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		if (const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(v)); mask != 0)
+		{
+			return p + ::std::countr_zero(mask);
+		}
+	}
+	return findHighBitSse2(p, pEnd);
+}
+
+TARGET("avx2")
+static LeadingWhiteSpace leadingWhiteSpaceAvx2(const char* p, const char* pEnd)
+{
+	const auto space = _mm256_set1_epi8(' ');
+	const auto tab = _mm256_set1_epi8('\t');
+	LeadingWhiteSpace result{0, false, false};
+	for (; pEnd - p >= 32; p += 32)
+	{
+		const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		const auto spaceMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, space)));
+		const auto tabMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, tab)));
+		const auto otherMask = ~(spaceMask | tabMask);
+		const auto wsMask = bitsBelowFirst(otherMask);
+		result.m_hasSpace = result.m_hasSpace || (spaceMask & wsMask) != 0;
+		result.m_hasTab = result.m_hasTab || (tabMask & wsMask) != 0;
+		if (otherMask != 0)
+		{
+			result.m_length += static_cast<size_t>(::std::countr_zero(otherMask));
+			return result;
+		}
+		result.m_length += 32;
+	}
+	return extend(result, leadingWhiteSpaceSse2(p, pEnd));
+}
+
+// ============================ AVX-512 ============================
+
+// The last, partial vector is read with a masked load, which does not touch
+// the bytes masked off, so no tail is left over.  The loops step by the
+// length of each vector, which is short for the last, so that p never
+// passes pEnd.
+
+static ptrdiff_t vectorLength(const char* p, const char* pEnd)
+{
+	return ::std::min<ptrdiff_t>(pEnd - p, 64);
+}
+
+TARGET("avx512f,avx512bw")
+static __mmask64 loadMask(const char* p, const char* pEnd)
+{
+	const auto numBytes = vectorLength(p, pEnd);
+	return (numBytes == 64) ? ~__mmask64{0} : (__mmask64{1} << numBytes) - 1;
+}
+
+TARGET("avx512f,avx512bw")
+static const char* findFirstOfAvx512(const char* p, const char* pEnd, const ByteSet& set)
+{
+	const auto b0 = _mm512_set1_epi8(set.m_bytes[0]);
+	const auto b1 = _mm512_set1_epi8(set.m_bytes[1]);
+	const auto b2 = _mm512_set1_epi8(set.m_bytes[2]);
+	const auto b3 = _mm512_set1_epi8(set.m_bytes[3]);
+	const __mmask64 highBitMask = set.m_matchesHighBit ? ~__mmask64{0} : 0;
+	for (; pEnd - p > 0; p += vectorLength(p, pEnd))
+	{
+		const auto validMask = loadMask(p, pEnd);
+		const auto v = _mm512_maskz_loadu_epi8(validMask, p);
+		const auto mask = validMask & (_mm512_cmpeq_epi8_mask(v, b0) | _mm512_cmpeq_epi8_mask(v, b1)
+			| _mm512_cmpeq_epi8_mask(v, b2) | _mm512_cmpeq_epi8_mask(v, b3)
+			| (_mm512_movepi8_mask(v) & highBitMask));
+		if (mask != 0)
+		{
+			return p + ::std::countr_zero(static_cast<uint64_t>(mask));
+		}
+	}
+	return pEnd;
+}
+
+TARGET("avx512f,avx512bw")
+static size_t countAvx512(const char* p, const char* pEnd, char ch)
+{
+	const auto needle = _mm512_set1_epi8(ch);
+	size_t result = 0;
+	while (pEnd - p > 0)
+	{
+		auto counts = _mm512_setzero_si512();
+		for (int i = 0; i < 255 && pEnd - p > 0; ++i, p += vectorLength(p, pEnd))
+		{
+			const auto validMask = loadMask(p, pEnd);
+			const auto v = _mm512_maskz_loadu_epi8(validMask, p);
+			counts = _mm512_sub_epi8(counts, _mm512_movm_epi8(_mm512_mask_cmpeq_epi8_mask(validMask, v, needle)));
+		}
+		alignas(64) uint64_t sums[8];
+		_mm512_store_si512(sums, _mm512_sad_epu8(counts, _mm512_setzero_si512()));
+		for (auto sum : sums)
+		{
+			result += static_cast<size_t>(sum);
+		}
+	}
+	return result;
+}
+
+TARGET("avx512f,avx512bw")
+static const char* findHighBitAvx512(const char* p, const char* pEnd)
+{
+	for (; pEnd - p > 0; p += vectorLength(p, pEnd))
+	{
+		const auto v = _mm512_maskz_loadu_epi8(loadMask(p, pEnd), p);
+		if (const auto mask = static_cast<uint64_t>(_mm512_movepi8_mask(v)); mask != 0)
+		{
+			return p + ::std::countr_zero(mask);
+		}
+	}
+	return pEnd;
+}
+
+// The bytes masked off load as zero, which is not white space, so the run
+// cannot extend past pEnd.
+TARGET("avx512f,avx512bw")
+static LeadingWhiteSpace leadingWhiteSpaceAvx512(const char* p, const char* pEnd)
+{
+	const auto space = _mm512_set1_epi8(' ');
+	const auto tab = _mm512_set1_epi8('\t');
+	LeadingWhiteSpace result{0, false, false};
+	for (; pEnd - p > 0; p += vectorLength(p, pEnd))
+	{
+		const auto v = _mm512_maskz_loadu_epi8(loadMask(p, pEnd), p);
+		const auto spaceMask = static_cast<uint64_t>(_mm512_cmpeq_epi8_mask(v, space));
+		const auto tabMask = static_cast<uint64_t>(_mm512_cmpeq_epi8_mask(v, tab));
+		const auto otherMask = ~(spaceMask | tabMask);
+		const auto wsMask = bitsBelowFirst(otherMask);
+		result.m_hasSpace = result.m_hasSpace || (spaceMask & wsMask) != 0;
+		result.m_hasTab = result.m_hasTab || (tabMask & wsMask) != 0;
+		if (otherMask != 0)
+		{
+			result.m_length += static_cast<size_t>(::std::countr_zero(otherMask));
+			return result;
+		}
+		result.m_length += 64;
+	}
+	return result;
+}
+
+// ============================ CPU detection ============================
+
+namespace
+{
+	struct CpuidRegs
+	{
+		uint32_t	m_eax;
+		uint32_t	m_ebx;
+		uint32_t	m_ecx;
+		uint32_t	m_edx;
+	};
+}
+
+static CpuidRegs cpuid(uint32_t leaf, uint32_t subleaf)
+{
+	CpuidRegs regs{0, 0, 0, 0};
+#if defined(_MSC_VER)
+	int maxLeaf[4];
+	__cpuid(maxLeaf, 0);
+	if (static_cast<uint32_t>(maxLeaf[0]) >= leaf)
+	{
+		int values[4];
+		__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+		regs = CpuidRegs{static_cast<uint32_t>(values[0]), static_cast<uint32_t>(values[1]),
+			static_cast<uint32_t>(values[2]), static_cast<uint32_t>(values[3])};
+	}
+#else
+	if (__get_cpuid_count(leaf, subleaf, &regs.m_eax, &regs.m_ebx, &regs.m_ecx, &regs.m_edx) == 0)
+	{
+		regs = CpuidRegs{0, 0, 0, 0};
+	}
+#endif
+	return regs;
+}
+
+// The register state that the OS saves on a context switch (XCR0)
+static uint64_t osSavedState()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	uint32_t lo, hi;
+	__asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return (uint64_t{hi} << 32) | lo;
+#endif
+}
+
+static Isa detectIsa() noexcept
+{
+	static constexpr uint64_t k_avxState = 0x06;	// XMM and YMM
+	static constexpr uint64_t k_avx512State = 0xe6;	// Also the opmask and ZMM registers
+
+	const auto leaf1 = cpuid(1, 0);
+	const auto leaf7 = cpuid(7, 0);
+	const bool hasSse2 = (leaf1.m_edx & (1u << 26)) != 0;
+	const bool hasOsxsave = (leaf1.m_ecx & (1u << 27)) != 0;
+	const bool hasAvx = (leaf1.m_ecx & (1u << 28)) != 0;
+	const bool hasAvx2 = (leaf7.m_ebx & (1u << 5)) != 0;
+	const bool hasAvx512 = (leaf7.m_ebx & (1u << 16)) != 0	// AVX512F
+		&& (leaf7.m_ebx & (1u << 30)) != 0;						// AVX512BW
+	const auto savedState = hasOsxsave ? osSavedState() : 0;
+
+	if (!hasSse2)
+	{
+		return Isa::scalar;
+	}
+	else if (!hasAvx || !hasAvx2 || (savedState & k_avxState) != k_avxState)
+	{
+		return Isa::sse2;
+	}
+	else if (!hasAvx512 || (savedState & k_avx512State) != k_avx512State)
+	{
+		return Isa::avx2;
+	}
+	return Isa::avx512;
+}
+
+#else
+
+static Isa detectIsa() noexcept
+{
+	return Isa::scalar;
+}
+
+#endif // BYTEKERNELS_X86
+
+// ============================ Dispatch ============================
+
+static constexpr Table k_tables[] =
+{
+	{ findFirstOfScalar, countScalar, findHighBitScalar, leadingWhiteSpaceScalar },
+#if defined(BYTEKERNELS_X86)
+	{ findFirstOfSse2, countSse2, findHighBitSse2, leadingWhiteSpaceSse2 },
+	{ findFirstOfAvx2, countAvx2, findHighBitAvx2, leadingWhiteSpaceAvx2 },
+	{ findFirstOfAvx512, countAvx512, findHighBitAvx512, leadingWhiteSpaceAvx512 },
+#endif
+};
+
+static constexpr string_view k_isaNames[] = { "scalar", "sse2", "avx2", "avx512" };
+
+static Isa detectedIsa() noexcept
+{
+	static const Isa s_isa = detectIsa();
+	return s_isa;
+}
+
+// Each of these chooses the variant (which installs its table) and then
+// calls through the installed table:
+static constexpr Table k_choosingTable
+{
+	[] (const char* p, const char* pEnd, const ByteSet& set)
+		{ ByteKernels::isa(); return ByteKernels::findFirstOf(p, pEnd, set); },
+	[] (const char* p, const char* pEnd, char ch)
+		{ ByteKernels::isa(); return ByteKernels::count(p, pEnd, ch); },
+	[] (const char* p, const char* pEnd)
+		{ ByteKernels::isa(); return ByteKernels::findHighBit(p, pEnd); },
+	[] (const char* p, const char* pEnd)
+		{ ByteKernels::isa(); return ByteKernels::leadingWhiteSpace(p, pEnd); },
+};
+
+::std::atomic<const Table*> ByteKernels::s_pTable{&k_choosingTable};
+
+ByteKernels::Isa ByteKernels::isa() noexcept
+{
+	static const Isa s_isa = [] ()
+		{
+			auto chosen = detectedIsa();
+			if (const char* pCap = ::std::getenv("CMDLINEUTIL_ISA"); pCap != nullptr)
+			{
+				const auto it = ::std::ranges::find(k_isaNames, string_view{pCap});
+				if (it != ::std::end(k_isaNames))
+				{
+					chosen = ::std::min(chosen, static_cast<Isa>(it - ::std::begin(k_isaNames)));
+				}
+			}
+			s_pTable.store(&k_tables[static_cast<size_t>(chosen)]);
+			return chosen;
+		}();
+	return s_isa;
+}
+
+bool ByteKernels::isSupported(Isa isa) noexcept
+{
+	return isa <= detectedIsa();
+}
+
+const Table& ByteKernels::table(Isa isa)
+{
+	if (!isSupported(isa))
+	{
+		throw invalid_argument("The requested byte kernels are not supported on this machine");
+	}
+	return k_tables[static_cast<size_t>(isa)];
+}
+
+string_view ByteKernels::isaName(Isa isa)
+{
+	if (static_cast<size_t>(isa) >= ::std::size(k_isaNames))
+	{
+		throw invalid_argument("Unrecognized Isa enumeration value in isaName");
+	}
+	return k_isaNames[static_cast<size_t>(isa)];
+}
@@ -0,0 +1,116 @@
+
+#if !defined(BYTEKERNELS_H_INCLUDED)
+#define BYTEKERNELS_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+/// \brief ByteKernels holds the vectorized byte-scanning primitives on which
+/// the text scanners are built, each in scalar, SSE2, AVX2, and AVX-512
+/// variants.
+///
+/// On first use the best variant that both the CPU and the OS support is
+/// chosen from CPUID (and XGETBV, for the AVX register state).  Setting the
+/// environment variable CMDLINEUTIL_ISA to scalar, sse2, avx2, or avx512
+/// caps the choice, for comparing the variants.  On processors other than
+/// x86, only the scalar variant exists.
+///
+/// Every kernel takes a range [p, pEnd) and reads nothing outside it.
+class ByteKernels
+{
+public:
+	enum class Isa
+	{
+		scalar,
+		sse2,
+		avx2,
+		avx512,	///< AVX-512BW
+		numIsas
+	};
+
+	/// \brief A set of one to four bytes to search for, and optionally also
+	/// any byte with its high bit set.
+	class ByteSet
+	{
+	public:
+		constexpr ByteSet(::std::string_view bytes, bool matchesHighBit = false) :
+			m_bytes{},
+			m_matchesHighBit(matchesHighBit)
+			{
+				if (bytes.empty() || bytes.size() > k_maxNumBytes)
+				{
+					throw ::std::invalid_argument("A ByteSet holds from one to four bytes");
+				}
+				// Unused slots repeat the first byte, so that the vector kernels
+				// can compare against all of them unconditionally:
+				for (::std::size_t i = 0; i < k_maxNumBytes; ++i)
+				{
+					m_bytes[i] = bytes[(i < bytes.size()) ? i : 0];
+				}
+			}
+
+		constexpr bool contains(char ch) const noexcept
+			{
+				return ch == m_bytes[0] || ch == m_bytes[1] || ch == m_bytes[2] || ch == m_bytes[3]
+					|| (m_matchesHighBit && static_cast<unsigned char>(ch) >= 0x80);
+			}
+
+		static constexpr ::std::size_t k_maxNumBytes = 4;
+
+		char	m_bytes[k_maxNumBytes];
+		bool	m_matchesHighBit;
+	};
+
+	/// \brief The run of spaces and tabs at the start of a range.
+	struct LeadingWhiteSpace
+	{
+		::std::size_t	m_length;
+		bool				m_hasSpace;
+		bool				m_hasTab;
+	};
+
+	/// \brief One variant of each kernel.
+	struct Table
+	{
+		const char* (*m_pFindFirstOf)(const char* p, const char* pEnd, const ByteSet& set);
+		::std::size_t (*m_pCount)(const char* p, const char* pEnd, char ch);
+		const char* (*m_pFindHighBit)(const char* p, const char* pEnd);
+		LeadingWhiteSpace (*m_pLeadingWhiteSpace)(const char* p, const char* pEnd);
+	};
+
+	/// \brief Returns the first byte in set, or pEnd if there is none.
+	static const char* findFirstOf(const char* p, const char* pEnd, const ByteSet& set)
+		{ return table().m_pFindFirstOf(p, pEnd, set); }
+
+	/// \brief Returns the number of occurrences of ch.
+	static ::std::size_t count(const char* p, const char* pEnd, char ch)
+		{ return table().m_pCount(p, pEnd, ch); }
+
+	/// \brief Returns the first byte that is not ASCII, or pEnd if there is none.
+	static const char* findHighBit(const char* p, const char* pEnd)
+		{ return table().m_pFindHighBit(p, pEnd); }
+
+	/// \brief Measures the spaces and tabs at p, as for the indent of a line.
+	static LeadingWhiteSpace leadingWhiteSpace(const char* p, const char* pEnd)
+		{ return table().m_pLeadingWhiteSpace(p, pEnd); }
+
+	/// \brief The variant in use.
+	static Isa isa() noexcept;
+	static bool isSupported(Isa isa) noexcept;
+	/// \brief Returns the kernels of the given variant.  Throws
+	/// ::std::invalid_argument if this build or this machine lacks it.
+	static const Table& table(Isa isa);
+	static ::std::string_view isaName(Isa isa);
+
+private:
+	static const Table& table() noexcept
+		{ return *s_pTable.load(::std::memory_order_relaxed); }
+
+	// Until the first call, the kernels of this table choose the variant,
+	// install its table here, and forward to it:
+	static ::std::atomic<const Table*> s_pTable;
+};
+
+#endif // BYTEKERNELS_H_INCLUDED
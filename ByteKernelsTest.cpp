@@ -0,0 +1,167 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "ByteKernels.h"
+
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using ::std::size_t;
+using ::std::string;
+using ::std::string_view;
+using ::std::vector;
+
+using Isa = ByteKernels::Isa;
+using ByteSet = ByteKernels::ByteSet;
+
+static vector<Isa> supportedIsas()
+{
+	vector<Isa> isas;
+	for (auto i = static_cast<int>(Isa::sse2); i < static_cast<int>(Isa::numIsas); ++i)
+	{
+		if (ByteKernels::isSupported(static_cast<Isa>(i)))
+		{
+			isas.push_back(static_cast<Isa>(i));
+		}
+	}
+	return isas;
+}
+
+static const ByteSet k_byteSets[] =
+{
+	ByteSet{"\n"},
+	ByteSet{"\r\n"},
+	ByteSet{" \t"},
+	ByteSet{"\r\n", true},
+	ByteSet{"\x80\xff"},
+	ByteSet{string_view{"\0a\tz", 4}},
+};
+
+// Compares every kernel of every supported variant with the scalar
+// reference, over each suffix of each prefix of text up to a few vectors
+// long, so that matches fall at every position relative to each boundary.
+static void checkAgainstScalar(const string& text)
+{
+	const auto& reference = ByteKernels::table(Isa::scalar);
+	for (auto isa : supportedIsas())
+	{
+		BOOST_TEST_CONTEXT("ISA " << ByteKernels::isaName(isa))
+		{
+			const auto& kernels = ByteKernels::table(isa);
+			for (size_t begin = 0; begin < ::std::min<size_t>(text.size(), 70); ++begin)
+			{
+				for (size_t end = begin; end <= text.size(); end += (end < begin + 140) ? 1 : 61)
+				{
+					const char* p = text.data() + begin;
+					const char* pEnd = text.data() + end;
+					for (const auto& set : k_byteSets)
+					{
+						BOOST_REQUIRE_EQUAL(reference.m_pFindFirstOf(p, pEnd, set) - p,
+							kernels.m_pFindFirstOf(p, pEnd, set) - p);
+					}
+					for (auto ch : { '\n', ' ', '\0', '\xff' })
+					{
+						BOOST_REQUIRE_EQUAL(reference.m_pCount(p, pEnd, ch), kernels.m_pCount(p, pEnd, ch));
+					}
+					BOOST_REQUIRE_EQUAL(reference.m_pFindHighBit(p, pEnd) - p,
+						kernels.m_pFindHighBit(p, pEnd) - p);
+					const auto expectedWs = reference.m_pLeadingWhiteSpace(p, pEnd);
+					const auto actualWs = kernels.m_pLeadingWhiteSpace(p, pEnd);
+					BOOST_REQUIRE_EQUAL(expectedWs.m_length, actualWs.m_length);
+					BOOST_REQUIRE_EQUAL(expectedWs.m_hasSpace, actualWs.m_hasSpace);
+					BOOST_REQUIRE_EQUAL(expectedWs.m_hasTab, actualWs.m_hasTab);
+				}
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE(ByteKernelsTestSuite)
+
+BOOST_AUTO_TEST_CASE(scalarTest)
+{
+	const string text{"\t  x\r\ny\x80z"};
+	const auto& kernels = ByteKernels::table(Isa::scalar);
+	const char* p = text.data();
+	const char* pEnd = p + text.size();
+	BOOST_CHECK_EQUAL(4, kernels.m_pFindFirstOf(p, pEnd, ByteSet{"\r\n"}) - p);
+	BOOST_CHECK_EQUAL(7, kernels.m_pFindFirstOf(p + 6, pEnd, ByteSet{"\r\n", true}) - p);
+	BOOST_CHECK_EQUAL(pEnd, kernels.m_pFindFirstOf(p, pEnd, ByteSet{"q"}));
+	BOOST_CHECK_EQUAL(2u, kernels.m_pCount(p, pEnd, ' '));
+	BOOST_CHECK_EQUAL(7, kernels.m_pFindHighBit(p, pEnd) - p);
+	const auto ws = kernels.m_pLeadingWhiteSpace(p, pEnd);
+	BOOST_CHECK_EQUAL(3u, ws.m_length);
+	BOOST_CHECK(ws.m_hasSpace);
+	BOOST_CHECK(ws.m_hasTab);
+	BOOST_CHECK_EQUAL(0u, kernels.m_pLeadingWhiteSpace(p + 3, pEnd).m_length);
+	BOOST_CHECK_THROW(ByteSet{""}, ::std::invalid_argument);
+	BOOST_CHECK_THROW(ByteSet{"abcde"}, ::std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(dispatchTest)
+{
+	BOOST_TEST_MESSAGE("Byte kernels in use: " << ByteKernels::isaName(ByteKernels::isa()));
+	BOOST_CHECK(ByteKernels::isSupported(Isa::scalar));
+	BOOST_CHECK(ByteKernels::isSupported(ByteKernels::isa()));
+
+	const string text(1000, 'x');
+	BOOST_CHECK_EQUAL(text.data() + 1000, ByteKernels::findFirstOf(text.data(), text.data() + 1000, ByteSet{"\n"}));
+	BOOST_CHECK_EQUAL(1000u, ByteKernels::count(text.data(), text.data() + 1000, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE(randomInputTest)
+{
+	static constexpr char k_alphabet[] = { ' ', '\t', '\r', '\n', 'a', 'z', '\0', '\x7f',
+		'\x80', '\xc3', '\xff' };
+	::std::mt19937 rng(12345);
+	::std::uniform_int_distribution<size_t> index(0, ::std::size(k_alphabet) - 1);
+	::std::uniform_int_distribution<int> anyByte(0, 255);
+	for (int trial = 0; trial < 4; ++trial)
+	{
+		string text(300, '\0');
+		for (auto& ch : text)
+		{
+			ch = (trial % 2 == 0) ? k_alphabet[index(rng)] : static_cast<char>(anyByte(rng));
+		}
+		checkAgainstScalar(text);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(adversarialInputTest)
+{
+	// Long runs, where a vector kernel goes furthest before its first match,
+	// with lone matches and changes of run right at the vector boundaries:
+	string sparse(260, 'a');
+	for (size_t pos : { 15u, 16u, 31u, 32u, 63u, 64u, 127u, 128u, 255u })
+	{
+		sparse[pos] = (pos % 2 == 0) ? '\n' : '\x80';
+	}
+	checkAgainstScalar(sparse);
+
+	checkAgainstScalar(string(300, ' '));
+	checkAgainstScalar(string(300, '\t'));
+	checkAgainstScalar(string(300, '\n'));
+	checkAgainstScalar(string(300, '\xff'));
+	checkAgainstScalar(string(300, '\0'));
+	checkAgainstScalar(string(64, ' ') + string(64, '\t') + "x" + string(100, ' '));
+
+	// More matches of one byte than fit in the byte lanes of the counting
+	// kernels between their sums:
+	const string manyEols(255 * 64 + 100, '\n');
+	for (auto isa : supportedIsas())
+	{
+		BOOST_CHECK_EQUAL(manyEols.size(), ByteKernels::table(isa).m_pCount(manyEols.data(),
+			manyEols.data() + manyEols.size(), '\n'));
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
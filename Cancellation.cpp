@@ -0,0 +1,111 @@
+
+#include "Cancellation.h"
+#include "Exceptions.h"
+
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <mutex>
+#include <set>
+#include <system_error>
+
+namespace fs = ::std::filesystem;
+
+using ::std::atomic;
+using ::std::error_code;
+using ::std::lock_guard;
+using ::std::mutex;
+
+static atomic<bool> g_isCancellationRequested{false};
+static volatile ::std::sig_atomic_t g_signalNumber = 0;
+
+static mutex g_registryMutex;
+static ::std::multiset<fs::path> g_registry;
+
+extern "C" void cancellationSignalHandler(int signalNumber)
+{
+	// Restore the default action first, so that a second Ctrl-C
+	// terminates a process that is slow to notice the first one:
+	::std::signal(signalNumber, SIG_DFL);
+	g_signalNumber = signalNumber;
+	g_isCancellationRequested.store(true);
+}
+
+// ============================ CancellationToken ============================
+
+void CancellationToken::installSignalHandlers()
+{
+	static_assert(atomic<bool>::is_always_lock_free,
+		"The cancellation flag must be lock-free to be set from a signal handler");
+
+	::std::signal(SIGINT, cancellationSignalHandler);
+	::std::signal(SIGTERM, cancellationSignalHandler);
+
+	static const bool k_isCleanupRegistered = (::std::atexit(TempFileRegistry::deleteAll) == 0);
+	static_cast<void>(k_isCleanupRegistered);
+}
+
+void CancellationToken::requestCancellation(int signalNumber /* = 0 */) noexcept
+{
+	g_signalNumber = signalNumber;
+	g_isCancellationRequested.store(true);
+}
+
+bool CancellationToken::isRequested() noexcept
+{
+	return g_isCancellationRequested.load(::std::memory_order_relaxed);
+}
+
+int CancellationToken::signalNumber() noexcept
+{
+	return g_signalNumber;
+}
+
+void CancellationToken::throwIfRequested()
+{
+	if (isRequested())
+	{
+		throw CanceledError();
+	}
+}
+
+void CancellationToken::reset() noexcept
+{
+	g_signalNumber = 0;
+	g_isCancellationRequested.store(false);
+}
+
+// ============================ TempFileRegistry ============================
+
+void TempFileRegistry::insert(const Path& p)
+{
+	lock_guard<mutex> lock(g_registryMutex);
+	g_registry.insert(p);
+}
+
+void TempFileRegistry::erase(const Path& p) noexcept
+{
+	lock_guard<mutex> lock(g_registryMutex);
+	auto it = g_registry.find(p);
+	if (it != end(g_registry))
+	{
+		g_registry.erase(it);
+	}
+}
+
+size_t TempFileRegistry::size()
+{
+	lock_guard<mutex> lock(g_registryMutex);
+	return g_registry.size();
+}
+
+void TempFileRegistry::deleteAll() noexcept
+{
+	lock_guard<mutex> lock(g_registryMutex);
+	for (const auto& p : g_registry)
+	{
+		error_code ec;
+		remove_all(p, ec);
+	}
+	g_registry.clear();
+}
@@ -0,0 +1,48 @@
+
+#if !defined(CANCELLATION_H_INCLUDED)
+#define CANCELLATION_H_INCLUDED
+
+#include <cstddef>
+#include <filesystem>
+
+/// \brief CancellationToken is the process-wide flag that asks all file
+/// processing to stop at the next convenient point.
+///
+/// The signal handlers installed by installSignalHandlers() only set the
+/// flag.  The scanning loops poll it between blocks (see BlockReader) and
+/// throw CanceledError, so that the stack unwinds normally and every
+/// PathDeleter gets a chance to clean up.  A second signal of the same kind
+/// terminates the process immediately.
+class CancellationToken
+{
+public:
+	static void installSignalHandlers();
+	static void requestCancellation(int signalNumber = 0) noexcept;
+	static bool isRequested() noexcept;
+	static int signalNumber() noexcept;
+	static void throwIfRequested();
+	static void reset() noexcept;
+
+	CancellationToken() = delete;
+};
+
+/// \brief TempFileRegistry tracks every temporary path that is currently owned
+/// by a PathDeleter, so that a final cleanup pass can remove whatever is left
+/// behind if the normal stack unwinding did not get to it.
+class TempFileRegistry
+{
+public:
+	using Path = ::std::filesystem::path;
+
+	static void insert(const Path& p);
+	static void erase(const Path& p) noexcept;
+	static ::std::size_t size();
+
+	/// \brief Deletes every registered path that still exists and empties the
+	/// registry.  Safe to call more than once.
+	static void deleteAll() noexcept;
+
+	TempFileRegistry() = delete;
+};
+
+#endif // CANCELLATION_H_INCLUDED
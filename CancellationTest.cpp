@@ -0,0 +1,100 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "Cancellation.h"
+#include "Exceptions.h"
+#include "PathDeleter.h"
+#include "Xeol.h"
+
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fs = ::std::filesystem;
+
+using ::std::ios_base;
+using ::std::istringstream;
+using ::std::ofstream;
+using ::std::string;
+
+BOOST_AUTO_TEST_SUITE(CancellationTestSuite)
+
+// Resets the process-wide cancellation flag even if a test case fails
+struct CancellationFixture
+{
+	CancellationFixture() { CancellationToken::reset(); }
+	~CancellationFixture() { CancellationToken::reset(); }
+};
+
+BOOST_FIXTURE_TEST_CASE(registryTracksPathDeleterTest, CancellationFixture)
+{
+	fs::path tempPath("TempCancellationTestFile.txt");
+	auto initialSize = TempFileRegistry::size();
+	{
+		PathDeleter deleter(tempPath);
+		BOOST_CHECK_EQUAL(initialSize + 1, TempFileRegistry::size());
+	}
+	BOOST_CHECK_EQUAL(initialSize, TempFileRegistry::size());
+	{
+		PathDeleter deleter(tempPath);
+		deleter.releaseOwnership();
+		BOOST_CHECK_EQUAL(initialSize, TempFileRegistry::size());
+	}
+	BOOST_CHECK_EQUAL(initialSize, TempFileRegistry::size());
+}
+
+BOOST_FIXTURE_TEST_CASE(deleteAllTest, CancellationFixture)
+{
+	fs::path tempPath("TempCancellationTestFile.txt");
+	ofstream(tempPath) << "Temporary content\n";
+	TempFileRegistry::insert(tempPath);
+	TempFileRegistry::deleteAll();
+	BOOST_CHECK(!exists(tempPath));
+	BOOST_CHECK_EQUAL(0u, TempFileRegistry::size());
+}
+
+BOOST_FIXTURE_TEST_CASE(scanFileCancellationTest, CancellationFixture)
+{
+	istringstream in(string(1u << 20, 'x'));
+	size_t numDosEols;
+	size_t numMacEols;
+	size_t numUnixEols;
+	size_t totalEols;
+	CancellationToken::requestCancellation();
+	BOOST_CHECK_THROW(
+		Xeol::scanFile(in, numDosEols, numMacEols, numUnixEols, totalEols),
+		CanceledError);
+}
+
+BOOST_FIXTURE_TEST_CASE(translateFileLeavesNoDebrisTest, CancellationFixture)
+{
+	fs::path testDir("TempCancellationTestDir");
+	PathDeleter testDirDeleter(testDir);
+	create_directories(testDir);
+	fs::path testFile(testDir / "big.txt");
+	{
+		ofstream out(testFile, ios_base::out | ios_base::binary);
+		for (size_t i = 0; i < 20000; ++i)
+		{
+			out << "A line with a DOS ending\r\n";
+		}
+	}
+
+	static char const*const k_args[] = { "xeol", "-u", "TempCancellationTestDir/*.txt" };
+	Xeol app(::std::span{k_args + 1, 2});
+	CancellationToken::requestCancellation();
+	BOOST_CHECK_THROW(app.translateFile(testFile), CanceledError);
+
+	size_t numEntries = 0;
+	for (const auto& entry : fs::directory_iterator(testDir))
+	{
+		BOOST_CHECK_EQUAL(testFile.filename(), entry.path().filename());
+		++numEntries;
+	}
+	BOOST_CHECK_EQUAL(1u, numEntries);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
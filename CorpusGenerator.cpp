@@ -0,0 +1,446 @@
+
+#include "CorpusGenerator.h"
+#include "Exceptions.h"
+#include "MemoryBudget.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using ::std::atomic;
+using ::std::exception_ptr;
+using ::std::format;
+using ::std::invalid_argument;
+using ::std::lock_guard;
+using ::std::mutex;
+using ::std::ofstream;
+using ::std::size_t;
+using ::std::string;
+using ::std::string_view;
+using ::std::thread;
+using ::std::uint64_t;
+using ::std::vector;
+
+using Path = CorpusGenerator::Path;
+
+static constexpr uint64_t k_maxNumDirs = 1'000'000;
+
+static constexpr string_view k_words[] = { "alpha", "beta", "gamma", "delta", "epsilon",
+	"zeta", "theta", "lambda", "{", "}", "return", "if", "=", "x", "+", "42;" };
+static constexpr string_view k_nonAsciiWords[] = { "caf\xc3\xa9", "\xe2\x80\x94",
+	"na\xc3\xafve", "\xf0\x9f\x98\x80" };
+
+// The words padded to a fixed size, so that each is copied with a single
+// eight-byte move:
+struct PaddedWord
+{
+	char		m_bytes[8];
+	size_t	m_length;
+};
+
+template<size_t N>
+static constexpr auto padWords(const string_view (&words)[N])
+{
+	::std::array<PaddedWord, N> result{};
+	for (size_t i = 0; i < N; ++i)
+	{
+		::std::ranges::copy(words[i], result[i].m_bytes);
+		result[i].m_length = words[i].size();
+	}
+	return result;
+}
+
+static constexpr auto k_paddedWords = padWords(k_words);
+static constexpr auto k_paddedNonAsciiWords = padWords(k_nonAsciiWords);
+static constexpr string_view k_eols[] = { "\n", "\r\n", "\r" };
+static constexpr string_view k_textExtensions[] = { ".txt", ".java", ".cpp", ".h" };
+
+namespace
+{
+	// SplitMix64:  cheap enough that generating the text costs little more
+	// than writing it, and good enough for synthetic data.  Callers take
+	// several small fields from each 64-bit draw.
+	class Rng
+	{
+	public:
+		explicit Rng(uint64_t seed) noexcept : m_state(seed) {}
+
+		uint64_t next() noexcept
+			{
+				auto z = (m_state += 0x9e3779b97f4a7c15ull);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+				return z ^ (z >> 31);
+			}
+
+	private:
+		uint64_t m_state;
+	};
+
+	// Takes successive fields of a few bits each from 64-bit draws
+	class BitSource
+	{
+	public:
+		explicit BitSource(uint64_t seed) noexcept : m_rng(seed), m_bits(0), m_numBits(0) {}
+
+		unsigned take(unsigned numBits) noexcept
+			{
+				if (m_numBits < numBits)
+				{
+					m_bits = m_rng.next();
+					m_numBits = 64;
+				}
+				const auto result = static_cast<unsigned>(m_bits & ((uint64_t{1} << numBits) - 1));
+				m_bits >>= numBits;
+				m_numBits -= numBits;
+				return result;
+			}
+
+		/// Returns a value from 0 to 999
+		unsigned permille() noexcept
+			{ return (take(10) * 1000) >> 10; }
+
+	private:
+		Rng			m_rng;
+		uint64_t		m_bits;
+		unsigned		m_numBits;
+	};
+}
+
+// Returns the index of the weight chosen, given r in [0, sum of weights)
+template<typename Weights>
+static size_t chooseWeighted(const Weights& weights, uint64_t r)
+{
+	for (size_t i = 0; i < weights.size(); ++i)
+	{
+		if (r < weights[i])
+		{
+			return i;
+		}
+		r -= weights[i];
+	}
+	return weights.size() - 1;
+}
+
+template<typename Weights>
+static uint64_t sumOf(const Weights& weights)
+{
+	return ::std::accumulate(weights.begin(), weights.end(), uint64_t{0});
+}
+
+static uint64_t fileSeed(uint64_t seed, uint64_t fileIndex)
+{
+	return Rng(seed ^ (fileIndex * 0xd1b54a32d192ed03ull)).next();
+}
+
+// ============================ Content ============================
+
+// No generated line, and no JSON record short of the deepest nesting, is
+// longer than this, so that the loops below can write through a raw pointer
+// and check for room once per line:
+static constexpr size_t k_maxLineLength = 256;
+
+static char* appendStr(char* p, string_view str) noexcept
+{
+	::std::memcpy(p, str.data(), str.size());
+	return p + str.size();
+}
+
+static char* appendNumber(char* p, uint64_t value) noexcept
+{
+	return ::std::to_chars(p, p + 24, value).ptr;
+}
+
+void CorpusGenerator::appendText(string& out, size_t numBytes, const TextShape& shape,
+	uint64_t seed)
+{
+	BitSource bits(seed);
+	const auto startSize = out.size();
+	out.resize(startSize + numBytes + k_maxLineLength);
+	char* p = out.data() + startSize;
+	const char* pEnd = p + numBytes;
+	while (p < pEnd)
+	{
+		const auto depth = bits.take(2);
+		const bool useTabs = (shape.m_indent == CorpusIndent::tabs)
+			|| (shape.m_indent == CorpusIndent::mixed && bits.take(1) != 0);
+		const auto indentLength = useTabs ? depth : 4 * depth;
+		::std::memset(p, useTabs ? '\t' : ' ', indentLength);
+		p += indentLength;
+
+		for (auto numWords = 1 + bits.take(3) + bits.take(2); numWords > 0; --numWords)
+		{
+			const auto& word = (bits.permille() < shape.m_nonAsciiPermille)
+				? k_paddedNonAsciiWords[bits.take(2)]
+				: k_paddedWords[bits.take(4)];
+			::std::memcpy(p, word.m_bytes, sizeof(word.m_bytes));
+			p += word.m_length;
+			*p = ' ';
+			p += (numWords > 1) ? 1 : 0;
+		}
+
+		if (bits.permille() < 10 * shape.m_trailingWsPercent)
+		{
+			p = appendStr(p, (bits.take(1) != 0) ? " " : " \t");
+		}
+
+		switch (shape.m_eol)
+		{
+		case CorpusEol::lf:
+			*p++ = '\n';
+			break;
+		case CorpusEol::crlf:
+			p = appendStr(p, "\r\n");
+			break;
+		case CorpusEol::cr:
+			*p++ = '\r';
+			break;
+		case CorpusEol::mixed:
+			p = appendStr(p, k_eols[bits.take(8) % ::std::size(k_eols)]);
+			break;
+		}
+	}
+	out.resize(static_cast<size_t>(p - out.data()));
+}
+
+void CorpusGenerator::appendJson(string& out, size_t numBytes, unsigned maxDepth,
+	uint64_t seed)
+{
+	BitSource bits(seed);
+	maxDepth = ::std::clamp(maxDepth, 1u, k_maxJsonDepth);
+	const auto startSize = out.size();
+	out.resize(startSize + numBytes + k_maxLineLength * (maxDepth + 1));
+	char* p = out.data() + startSize;
+	const char* pEnd = p + numBytes;
+	*p++ = '[';
+	for (uint64_t i = 0; p < pEnd; ++i)
+	{
+		p = appendStr(p, (i > 0) ? ",\n" : "\n");
+		const auto depth = 1 + bits.take(8) % maxDepth;
+		for (unsigned level = 0; level < depth; ++level)
+		{
+			p = appendStr(p, "{\"id\":");
+			p = appendNumber(p, i);
+			p = appendStr(p, ",\"name\":\"");
+			p = appendStr(p, k_words[bits.take(3)]);
+			p = appendStr(p, (bits.take(1) != 0) ? "\",\"ok\":true,\"child\":" : "\",\"ok\":false,\"child\":");
+		}
+		*p++ = '[';
+		p = appendNumber(p, bits.take(16));
+		*p++ = ',';
+		p = appendNumber(p, bits.take(8));
+		p = appendStr(p, ".5,null,\"");
+		p = appendStr(p, k_words[bits.take(3)]);
+		p = appendStr(p, "\"]");
+		::std::memset(p, '}', depth);
+		p += depth;
+	}
+	p = appendStr(p, "\n]\n");
+	out.resize(static_cast<size_t>(p - out.data()));
+}
+
+// ============================ CorpusGenerator ============================
+
+struct CorpusGenerator::FilePlan
+{
+	uint64_t		m_dirIndex;
+	uint64_t		m_size;
+	bool			m_isJson;
+	TextShape	m_shape;
+	string_view	m_extension;
+	uint64_t		m_contentSeed;
+};
+
+CorpusGenerator::CorpusGenerator(const CorpusSpec& spec) :
+	m_spec(spec),
+	m_numDirs(0)
+{
+	if (m_spec.m_depth < 1 || m_spec.m_fanOut < 1)
+	{
+		throw invalid_argument("The depth and fan-out of a corpus must be at least one");
+	}
+	else if (m_spec.m_minFileSize > m_spec.m_maxFileSize)
+	{
+		throw invalid_argument("The minimum file size exceeds the maximum");
+	}
+	else if (sumOf(m_spec.m_eolWeights) == 0 || sumOf(m_spec.m_indentWeights) == 0)
+	{
+		throw invalid_argument("The EOL and indentation weights may not all be zero");
+	}
+	else if (m_spec.m_trailingWsPercent > 100 || m_spec.m_jsonPercent > 100
+		|| m_spec.m_nonAsciiPermille > 1000)
+	{
+		throw invalid_argument("A percentage exceeds 100");
+	}
+	else if (m_spec.m_jsonDepth < 1 || m_spec.m_jsonDepth > k_maxJsonDepth)
+	{
+		throw invalid_argument(format("The JSON depth must be between 1 and {0}", k_maxJsonDepth));
+	}
+
+	// The directories form a full tree, numbered breadth first:
+	for (uint64_t level = 0, levelSize = 1; level < m_spec.m_depth; ++level)
+	{
+		m_numDirs += levelSize;
+		levelSize *= m_spec.m_fanOut;
+		if (m_numDirs > k_maxNumDirs || levelSize > k_maxNumDirs)
+		{
+			throw invalid_argument(format("A corpus may have at most {0} directories", k_maxNumDirs));
+		}
+	}
+}
+
+CorpusGenerator::FilePlan CorpusGenerator::planFile(uint64_t fileIndex) const
+{
+	Rng rng(fileSeed(m_spec.m_seed, fileIndex));
+	const auto r1 = rng.next();
+	const auto r2 = rng.next();
+
+	// Log-uniform between the minimum and maximum sizes:
+	const auto u = static_cast<double>(r1 >> 11) / static_cast<double>(uint64_t{1} << 53);
+	const auto minSize = static_cast<double>(::std::max<uint64_t>(m_spec.m_minFileSize, 1));
+	const auto maxSize = static_cast<double>(::std::max<uint64_t>(m_spec.m_maxFileSize, 1));
+	const auto size = static_cast<uint64_t>(minSize * ::std::pow(maxSize / minSize, u));
+
+	return FilePlan{
+		r2 % m_numDirs,
+		::std::clamp(size, m_spec.m_minFileSize, m_spec.m_maxFileSize),
+		(r2 >> 32) % 100 < m_spec.m_jsonPercent,
+		TextShape{
+			static_cast<CorpusEol>(chooseWeighted(m_spec.m_eolWeights,
+				(r2 >> 40) % sumOf(m_spec.m_eolWeights))),
+			static_cast<CorpusIndent>(chooseWeighted(m_spec.m_indentWeights,
+				(r2 >> 48) % sumOf(m_spec.m_indentWeights))),
+			m_spec.m_trailingWsPercent,
+			m_spec.m_nonAsciiPermille },
+		k_textExtensions[(r2 >> 56) % ::std::size(k_textExtensions)],
+		rng.next() };
+}
+
+// Directory n's sub-directories are n * fanOut + 1 through n * fanOut + fanOut
+Path CorpusGenerator::dirPath(const Path& rootDir, uint64_t dirIndex) const
+{
+	vector<uint64_t> childIndices;
+	for (; dirIndex > 0; dirIndex = (dirIndex - 1) / m_spec.m_fanOut)
+	{
+		childIndices.push_back((dirIndex - 1) % m_spec.m_fanOut);
+	}
+
+	Path p = rootDir;
+	for (auto it = childIndices.rbegin(); it != childIndices.rend(); ++it)
+	{
+		p /= format("dir{0}", *it);
+	}
+	return p;
+}
+
+void CorpusGenerator::generateFile(const Path& rootDir, uint64_t fileIndex, string& buffer) const
+{
+	const auto plan = planFile(fileIndex);
+	buffer.clear();
+	if (plan.m_isJson)
+	{
+		appendJson(buffer, plan.m_size, m_spec.m_jsonDepth, plan.m_contentSeed);
+	}
+	else
+	{
+		appendText(buffer, plan.m_size, plan.m_shape, plan.m_contentSeed);
+	}
+
+	const auto filePath = dirPath(rootDir, plan.m_dirIndex)
+		/ format("file{0:06}{1}", fileIndex, plan.m_isJson ? string_view{".json"} : plan.m_extension);
+	ofstream out(filePath, ::std::ios::binary | ::std::ios::trunc);
+	out.write(buffer.data(), static_cast< ::std::streamsize>(buffer.size()));
+	out.close();
+	if (!out)
+	{
+		throw IOError(format("Unable to write file '{0}'", filePath.generic_string()));
+	}
+}
+
+CorpusGenerator::Totals CorpusGenerator::generate(const Path& rootDir) const
+{
+	// Create the directories that will hold files up front, and in one
+	// thread, so that the workers only ever write files:
+	::std::set<uint64_t> usedDirs{0};
+	for (uint64_t i = 0; i < m_spec.m_numFiles; ++i)
+	{
+		usedDirs.insert(planFile(i).m_dirIndex);
+	}
+	for (auto dirIndex : usedDirs)
+	{
+		create_directories(dirPath(rootDir, dirIndex));
+	}
+
+	// Each worker builds a whole file in memory before writing it:
+	const auto numThreads = static_cast<uint64_t>(MemoryBudget::fitWorkerCount(
+		(m_spec.m_numThreads > 0) ? m_spec.m_numThreads : ::std::max(thread::hardware_concurrency(), 1u),
+		static_cast<size_t>(m_spec.m_maxFileSize)));
+	atomic<uint64_t> nextFileIndex{0};
+	atomic<uint64_t> numBytes{0};
+	atomic<bool> isFailed{false};
+	mutex errorMutex;
+	exception_ptr pError;
+	auto worker = [&] ()
+		{
+			string buffer;
+			try
+			{
+				for (auto i = nextFileIndex++; i < m_spec.m_numFiles && !isFailed; i = nextFileIndex++)
+				{
+					generateFile(rootDir, i, buffer);
+					numBytes.fetch_add(buffer.size(), ::std::memory_order_relaxed);
+				}
+			}
+			catch (...)
+			{
+				lock_guard<mutex> lock(errorMutex);
+				if (!pError)
+				{
+					pError = ::std::current_exception();
+				}
+				isFailed = true;
+			}
+		};
+
+	vector<thread> workers;
+	for (uint64_t i = 1; i < ::std::min(numThreads, m_spec.m_numFiles); ++i)
+	{
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto& w : workers)
+	{
+		w.join();
+	}
+	if (pError)
+	{
+		::std::rethrow_exception(pError);
+	}
+
+	// Count the intermediate directories along with the used ones:
+	::std::set<uint64_t> allDirs;
+	for (auto dirIndex : usedDirs)
+	{
+		for (;; dirIndex = (dirIndex - 1) / m_spec.m_fanOut)
+		{
+			if (!allDirs.insert(dirIndex).second || dirIndex == 0)
+			{
+				break;
+			}
+		}
+	}
+	return Totals{allDirs.size(), m_spec.m_numFiles, numBytes.load()};
+}
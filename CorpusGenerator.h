@@ -0,0 +1,109 @@
+
+#if !defined(CORPUSGENERATOR_H_INCLUDED)
+#define CORPUSGENERATOR_H_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+enum class CorpusEol
+{
+	lf,
+	crlf,
+	cr,
+	mixed		///< Each line ends at random in one of the other three
+};
+
+enum class CorpusIndent
+{
+	spaces,
+	tabs,
+	mixed		///< Each line is indented at random with one or the other
+};
+
+/// \brief The content of one generated text file.
+struct TextShape
+{
+	CorpusEol		m_eol;
+	CorpusIndent	m_indent;
+	unsigned			m_trailingWsPercent;	///< Of the lines
+	unsigned			m_nonAsciiPermille;	///< Of the words
+};
+
+/// \brief The shape of a synthetic corpus.  The weights are relative to
+/// each other, and the sizes of the files are log-uniformly distributed
+/// between the minimum and maximum.
+struct CorpusSpec
+{
+	::std::uint64_t					m_seed = 1;
+	::std::uint64_t					m_numFiles = 1000;
+	unsigned								m_depth = 3;		///< Levels of directories, counting the root
+	unsigned								m_fanOut = 4;		///< Sub-directories per directory
+	::std::uint64_t					m_minFileSize = 1024;
+	::std::uint64_t					m_maxFileSize = 64 * 1024;
+	::std::array<unsigned, 4>		m_eolWeights = { 80, 15, 0, 5 };	///< In CorpusEol order
+	::std::array<unsigned, 3>		m_indentWeights = { 60, 30, 10 };	///< In CorpusIndent order
+	unsigned								m_trailingWsPercent = 5;
+	unsigned								m_nonAsciiPermille = 1;
+	unsigned								m_jsonPercent = 10;	///< Of the files
+	unsigned								m_jsonDepth = 8;		///< The maximum nesting, at most 255
+	unsigned								m_numThreads = 0;		///< Zero for one per core
+};
+
+/// \brief CorpusGenerator writes reproducible trees of synthetic text,
+/// source, and JSON files, for benchmarks and tests.
+///
+/// Each file is drawn from a random stream of its own, seeded by the spec's
+/// seed and the file's index, so the same spec generates the same bytes
+/// however many threads share the work.
+class CorpusGenerator
+{
+public:
+	using Path = ::std::filesystem::path;
+
+	struct Totals
+	{
+		::std::uint64_t m_numDirs;
+		::std::uint64_t m_numFiles;
+		::std::uint64_t m_numBytes;
+	};
+
+	static constexpr unsigned k_maxJsonDepth = 255;
+
+	/// \brief Throws ::std::invalid_argument if the spec is inconsistent.
+	explicit CorpusGenerator(const CorpusSpec& spec);
+
+	/// \brief Generates the corpus under rootDir, which is created if need
+	/// be.  Throws IOError if a file cannot be written.
+	Totals generate(const Path& rootDir) const;
+
+	/// \brief Appends about numBytes of text of the given shape to out,
+	/// ending at the end of a line.
+	static void appendText(::std::string& out, ::std::size_t numBytes,
+		const TextShape& shape, ::std::uint64_t seed);
+
+	/// \brief Appends a JSON array of about numBytes to out, whose elements
+	/// are nested up to maxDepth (at most k_maxJsonDepth) deep.
+	static void appendJson(::std::string& out, ::std::size_t numBytes,
+		unsigned maxDepth, ::std::uint64_t seed);
+
+	CorpusGenerator(const CorpusGenerator&) = delete;
+	CorpusGenerator& operator=(const CorpusGenerator&) = delete;
+	CorpusGenerator(CorpusGenerator&&) = delete;
+	CorpusGenerator& operator=(CorpusGenerator&&) = delete;
+
+private:
+	struct FilePlan;
+
+	FilePlan planFile(::std::uint64_t fileIndex) const;
+	Path dirPath(const Path& rootDir, ::std::uint64_t dirIndex) const;
+	void generateFile(const Path& rootDir, ::std::uint64_t fileIndex,
+		::std::string& buffer) const;
+
+	CorpusSpec			m_spec;
+	::std::uint64_t	m_numDirs;
+};
+
+#endif // CORPUSGENERATOR_H_INCLUDED
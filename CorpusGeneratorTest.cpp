@@ -0,0 +1,126 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "CorpusGenerator.h"
+#include "PathDeleter.h"
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace fs = ::std::filesystem;
+
+using ::std::ifstream;
+using ::std::istreambuf_iterator;
+using ::std::map;
+using ::std::string;
+
+// Maps each file's path, relative to rootDir, to its content
+static map<string, string> readTree(const fs::path& rootDir)
+{
+	map<string, string> result;
+	for (const auto& entry : fs::recursive_directory_iterator(rootDir))
+	{
+		if (entry.is_regular_file())
+		{
+			ifstream in(entry.path(), ::std::ios::binary);
+			result[relative(entry.path(), rootDir).generic_string()]
+				.assign(istreambuf_iterator<char>{in}, istreambuf_iterator<char>{});
+		}
+	}
+	return result;
+}
+
+BOOST_AUTO_TEST_SUITE(CorpusGeneratorTestSuite)
+
+BOOST_AUTO_TEST_CASE(reproducibleTest)
+{
+	const fs::path dir1{"CorpusGeneratorTest1"};
+	const fs::path dir2{"CorpusGeneratorTest2"};
+	PathDeleter dir1Deleter(dir1);
+	PathDeleter dir2Deleter(dir2);
+
+	CorpusSpec spec;
+	spec.m_seed = 42;
+	spec.m_numFiles = 200;
+	spec.m_maxFileSize = 8 * 1024;
+	spec.m_jsonPercent = 20;
+	spec.m_numThreads = 1;
+	const auto totals = CorpusGenerator(spec).generate(dir1);
+	spec.m_numThreads = 4;
+	CorpusGenerator(spec).generate(dir2);
+
+	const auto tree1 = readTree(dir1);
+	BOOST_CHECK_EQUAL(200u, totals.m_numFiles);
+	BOOST_CHECK_EQUAL(200u, tree1.size());
+	BOOST_CHECK_LE(totals.m_numDirs, 21u);
+	BOOST_CHECK(tree1 == readTree(dir2));
+
+	size_t numBytes = 0;
+	for (const auto& [path, content] : tree1)
+	{
+		numBytes += content.size();
+		BOOST_CHECK_GE(content.size(), spec.m_minFileSize);
+	}
+	BOOST_CHECK_EQUAL(totals.m_numBytes, numBytes);
+}
+
+BOOST_AUTO_TEST_CASE(textShapeTest)
+{
+	string text;
+	CorpusGenerator::appendText(text, 64 * 1024, { CorpusEol::crlf, CorpusIndent::tabs, 0, 0 }, 1);
+	BOOST_CHECK_GE(text.size(), 64u * 1024u);
+	BOOST_CHECK(text.ends_with("\r\n"));
+	BOOST_CHECK_EQUAL(::std::ranges::count(text, '\n'), ::std::ranges::count(text, '\r'));
+	BOOST_CHECK(text.find("\n ") == string::npos);
+	BOOST_CHECK(text.find(" \r") == string::npos);
+	BOOST_CHECK(::std::ranges::all_of(text, [] (char ch) { return ch > 0; }));
+
+	string mixed;
+	CorpusGenerator::appendText(mixed, 64 * 1024, { CorpusEol::mixed, CorpusIndent::mixed, 50, 100 }, 1);
+	BOOST_CHECK(mixed.find("\r\n") != string::npos);
+	BOOST_CHECK(mixed.find("\t\n") != string::npos || mixed.find(" \n") != string::npos);
+	BOOST_CHECK(!::std::ranges::all_of(mixed, [] (char ch) { return ch > 0; }));
+}
+
+BOOST_AUTO_TEST_CASE(jsonTest)
+{
+	string json;
+	CorpusGenerator::appendJson(json, 16 * 1024, 4, 1);
+	BOOST_CHECK(json.starts_with("["));
+	BOOST_CHECK(json.ends_with("]\n"));
+	BOOST_CHECK_EQUAL(::std::ranges::count(json, '{'), ::std::ranges::count(json, '}'));
+
+	int depth = 0, maxDepth = 0;
+	for (auto ch : json)
+	{
+		depth += (ch == '{') ? 1 : (ch == '}') ? -1 : 0;
+		maxDepth = ::std::max(maxDepth, depth);
+	}
+	BOOST_CHECK_EQUAL(4, maxDepth);
+}
+
+BOOST_AUTO_TEST_CASE(invalidSpecTest)
+{
+	CorpusSpec spec;
+	spec.m_fanOut = 0;
+	BOOST_CHECK_THROW(CorpusGenerator{spec}, ::std::invalid_argument);
+
+	spec = CorpusSpec{};
+	spec.m_depth = 20;
+	BOOST_CHECK_THROW(CorpusGenerator{spec}, ::std::invalid_argument);
+
+	spec = CorpusSpec{};
+	spec.m_jsonDepth = ::std::numeric_limits<unsigned>::max();
+	BOOST_CHECK_THROW(CorpusGenerator{spec}, ::std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,117 @@
+
+// Replacements for the global operator new and delete that count each
+// allocation in AllocationStats.  This file is linked only into the test
+// runner and the benchmarks, never into the tools.  The remaining forms of
+// new (array and nothrow) are defined by the standard library in terms of
+// these two, so they are counted as well.  The sized and array forms of
+// delete are defined here, forwarding to the plain ones, because a
+// library's own versions need not free what malloc allocated.
+
+#include "AllocationStats.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#	include <malloc.h>
+#endif
+
+using ::std::align_val_t;
+using ::std::size_t;
+
+static void* alignedAlloc(size_t numBytes, size_t alignment) noexcept
+{
+#if defined(_WIN32)
+	return ::_aligned_malloc(numBytes, alignment);
+#else
+	// Memory resources ask for alignments smaller than posix_memalign allows:
+	void* p = nullptr;
+	return (::posix_memalign(&p, ::std::max(alignment, sizeof(void*)), numBytes) == 0) ? p : nullptr;
+#endif
+}
+
+void* operator new(size_t numBytes)
+{
+	AllocationStats::countAllocation(numBytes);
+	for (;;)
+	{
+		if (void* p = ::std::malloc((numBytes == 0) ? 1 : numBytes); p != nullptr)
+		{
+			return p;
+		}
+		else if (auto pHandler = ::std::get_new_handler(); pHandler != nullptr)
+		{
+			pHandler();
+		}
+		else
+		{
+			throw ::std::bad_alloc();
+		}
+	}
+}
+
+void* operator new(size_t numBytes, align_val_t alignment)
+{
+	AllocationStats::countAllocation(numBytes);
+	for (;;)
+	{
+		if (void* p = alignedAlloc((numBytes == 0) ? 1 : numBytes, static_cast<size_t>(alignment));
+			p != nullptr)
+		{
+			return p;
+		}
+		else if (auto pHandler = ::std::get_new_handler(); pHandler != nullptr)
+		{
+			pHandler();
+		}
+		else
+		{
+			throw ::std::bad_alloc();
+		}
+	}
+}
+
+void operator delete(void* p) noexcept
+{
+	::std::free(p);
+}
+
+void operator delete(void* p, align_val_t) noexcept
+{
+#if defined(_WIN32)
+	::_aligned_free(p);
+#else
+	::std::free(p);
+#endif
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete(void* p, size_t, align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+void operator delete[](void* p) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete[](void* p, align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete[](void* p, size_t, align_val_t alignment) noexcept
+{
+	operator delete(p, alignment);
+}
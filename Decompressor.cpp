@@ -0,0 +1,199 @@
+
+#include "Decompressor.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <format>
+#include <new>
+#include <stdexcept>
+#include <zlib.h>
+#include <zstd.h>
+
+using ::std::byte;
+using ::std::format;
+using ::std::invalid_argument;
+using ::std::make_unique;
+using ::std::size_t;
+using ::std::span;
+using ::std::string_view;
+
+// ============================ Detection ============================
+
+static constexpr byte k_gzipMagic[] = { byte{0x1f}, byte{0x8b}, byte{0x08} };	// With deflate, the only method
+static constexpr byte k_zstdMagic[] = { byte{0x28}, byte{0xb5}, byte{0x2f}, byte{0xfd} };
+
+template<size_t N>
+static bool startsWith(span<const byte> block, const byte (&magic)[N]) noexcept
+{
+	return block.size() >= N && ::std::equal(magic, magic + N, block.begin());
+}
+
+Compression detectCompression(span<const byte> firstBlock) noexcept
+{
+	if (startsWith(firstBlock, k_gzipMagic))
+	{
+		return Compression::gzip;
+	}
+	else if (startsWith(firstBlock, k_zstdMagic))
+	{
+		return Compression::zstd;
+	}
+	else
+	{
+		return Compression::none;
+	}
+}
+
+string_view compressionName(Compression compression)
+{
+	switch (compression)
+	{
+	case Compression::none:
+		return "none";
+	case Compression::gzip:
+		return "gzip";
+	case Compression::zstd:
+		return "zstd";
+	default:
+		throw invalid_argument("Unrecognized Compression enumeration value in compressionName");
+	}
+}
+
+string_view compressionExtension(Compression compression)
+{
+	switch (compression)
+	{
+	case Compression::none:
+		return "";
+	case Compression::gzip:
+		return ".gz";
+	case Compression::zstd:
+		return ".zst";
+	default:
+		throw invalid_argument("Unrecognized Compression enumeration value in compressionExtension");
+	}
+}
+
+// ============================ Decompressor ============================
+
+struct Decompressor::State
+{
+	z_stream			m_zStream;
+	ZSTD_DStream*	m_pZstdStream;
+};
+
+Decompressor::Decompressor(Compression compression) :
+	m_compression(compression),
+	m_pState(make_unique<State>()),
+	m_isAtEndOfStream(false)
+{
+	switch (compression)
+	{
+	case Compression::gzip:
+		// 16 selects the gzip wrapper, rather than zlib's own:
+		if (::inflateInit2(&m_pState->m_zStream, 16 + MAX_WBITS) != Z_OK)
+		{
+			throw ::std::bad_alloc();
+		}
+		break;
+	case Compression::zstd:
+		m_pState->m_pZstdStream = ::ZSTD_createDStream();
+		if (m_pState->m_pZstdStream == nullptr)
+		{
+			throw ::std::bad_alloc();
+		}
+		break;
+	default:
+		throw invalid_argument("A Decompressor requires a compressed format");
+	}
+}
+
+Decompressor::~Decompressor()
+{
+	if (m_compression == Compression::gzip)
+	{
+		::inflateEnd(&m_pState->m_zStream);
+	}
+	else
+	{
+		::ZSTD_freeDStream(m_pState->m_pZstdStream);
+	}
+}
+
+size_t Decompressor::decompress(ByteSpan& input, span<byte> output)
+{
+	return (m_compression == Compression::gzip)
+		? inflateGzip(input, output)
+		: decompressZstd(input, output);
+}
+
+size_t Decompressor::inflateGzip(ByteSpan& input, span<byte> output)
+{
+	auto& zStream = m_pState->m_zStream;
+	size_t numBytesOut = 0;
+	while (numBytesOut < output.size())
+	{
+		if (m_isAtEndOfStream)
+		{
+			if (input.empty())
+			{
+				break;
+			}
+			// Another gzip member follows the one just finished:
+			::inflateReset(&zStream);
+			m_isAtEndOfStream = false;
+		}
+
+		// zlib counts in uInt, which is large enough for any one block:
+		zStream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.data()));
+		zStream.avail_in = static_cast<uInt>(input.size());
+		zStream.next_out = reinterpret_cast<Bytef*>(output.data() + numBytesOut);
+		zStream.avail_out = static_cast<uInt>(output.size() - numBytesOut);
+		const auto status = ::inflate(&zStream, Z_NO_FLUSH);
+		const auto numBytesConsumed = input.size() - zStream.avail_in;
+		const auto numBytesProduced = output.size() - numBytesOut - zStream.avail_out;
+		input = input.subspan(numBytesConsumed);
+		numBytesOut += numBytesProduced;
+
+		if (status == Z_STREAM_END)
+		{
+			m_isAtEndOfStream = true;
+		}
+		else if (status == Z_BUF_ERROR || (status == Z_OK && numBytesConsumed == 0 && numBytesProduced == 0))
+		{
+			break;	// More input is needed
+		}
+		else if (status != Z_OK)
+		{
+			throw IOError(format("Invalid gzip data:  {0}",
+				(zStream.msg == nullptr) ? "error decompressing" : zStream.msg));
+		}
+	}
+	return numBytesOut;
+}
+
+size_t Decompressor::decompressZstd(ByteSpan& input, span<byte> output)
+{
+	ZSTD_inBuffer in{ input.data(), input.size(), 0 };
+	ZSTD_outBuffer out{ output.data(), output.size(), 0 };
+	while (out.pos < out.size)
+	{
+		const auto inPos = in.pos;
+		const auto outPos = out.pos;
+		const auto status = ::ZSTD_decompressStream(m_pState->m_pZstdStream, &out, &in);
+		if (::ZSTD_isError(status))
+		{
+			throw IOError(format("Invalid zstd data:  {0}", ::ZSTD_getErrorName(status)));
+		}
+		else if (in.pos == inPos && out.pos == outPos)
+		{
+			break;	// More input is needed
+		}
+		// Zero means that a frame is complete and fully flushed.  (A call
+		// that makes no progress says nothing about that, hence the test
+		// above.)
+		m_isAtEndOfStream = (status == 0);
+	}
+	input = input.subspan(in.pos);
+	return out.pos;
+}
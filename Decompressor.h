@@ -0,0 +1,76 @@
+
+#if !defined(DECOMPRESSOR_H_INCLUDED)
+#define DECOMPRESSOR_H_INCLUDED
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string_view>
+
+/// \brief The compressed formats that the reading layer recognizes.
+enum class Compression
+{
+	none,
+	gzip,
+	zstd
+};
+
+/// \brief Recognizes a compressed stream by the magic number at the start of
+/// its first block.
+Compression detectCompression(::std::span<const ::std::byte> firstBlock) noexcept;
+::std::string_view compressionName(Compression compression);
+
+/// \brief Returns the file name extension conventional for the compression,
+/// e.g., ".gz", or an empty string for Compression::none.
+::std::string_view compressionExtension(Compression compression);
+
+/// \brief Decompresses a gzip or zstd stream as it arrives, block by block,
+/// in memory that does not grow with the size of the stream.  Several
+/// streams concatenated together (as left by "cat a.gz b.gz", or by
+/// multi-threaded compressors) decompress as the concatenation of their
+/// contents.
+///
+/// zlib and libzstd do the work.  Their state is hidden here so that the
+/// rest of the tree does not depend on their headers.
+class Decompressor
+{
+public:
+	using ByteSpan = ::std::span<const ::std::byte>;
+
+	/// \brief Throws ::std::invalid_argument for Compression::none.
+	explicit Decompressor(Compression compression);
+	~Decompressor();
+
+	/// \brief Decompresses from the front of input into output, removing from
+	/// input the bytes consumed.  Returns the number of bytes written, which
+	/// is zero only when all of input has been consumed without producing
+	/// more output, or when there is nothing more to flush.  Throws IOError
+	/// if the input is not a valid stream.
+	::std::size_t decompress(ByteSpan& input, ::std::span< ::std::byte> output);
+
+	/// \brief Returns true if the input consumed so far ends exactly at the
+	/// end of a stream, i.e., if the end of the input now would not mean
+	/// that it was truncated.
+	bool isAtEndOfStream() const noexcept
+		{ return m_isAtEndOfStream; }
+
+	Compression compression() const noexcept
+		{ return m_compression; }
+
+	Decompressor(const Decompressor&) = delete;
+	Decompressor& operator=(const Decompressor&) = delete;
+	Decompressor(Decompressor&&) = delete;
+	Decompressor& operator=(Decompressor&&) = delete;
+
+private:
+	struct State;
+
+	::std::size_t inflateGzip(ByteSpan& input, ::std::span< ::std::byte> output);
+	::std::size_t decompressZstd(ByteSpan& input, ::std::span< ::std::byte> output);
+
+	Compression						m_compression;
+	::std::unique_ptr<State>	m_pState;
+	bool								m_isAtEndOfStream;
+};
+
+#endif // DECOMPRESSOR_H_INCLUDED
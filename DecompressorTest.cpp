@@ -0,0 +1,159 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "BlockReader.h"
+#include "Decompressor.h"
+#include "Exceptions.h"
+#include "TestUtil.h"
+
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using ::std::byte;
+using ::std::istringstream;
+using ::std::size_t;
+using ::std::string;
+using ::std::string_view;
+
+static ByteSpan asBytes(string_view str)
+{
+	return ByteSpan{reinterpret_cast<const byte*>(str.data()), str.size()};
+}
+
+// Some megabytes of loosely repetitive text, so that it compresses well but
+// not so well that a single block of input holds all of it:
+static string makeText(size_t size)
+{
+	static constexpr string_view k_words[] = { "alpha ", "beta ", "gamma\r\n", "delta\t", "\xc3\xa9psilon\n" };
+	::std::mt19937 rng(2024);
+	::std::uniform_int_distribution<size_t> index(0, ::std::size(k_words) - 1);
+	string text;
+	while (text.size() < size)
+	{
+		text += k_words[index(rng)];
+	}
+	return text;
+}
+
+// Reads all of the input through a BlockReader, checking the block sizes:
+static string readAll(const string& input, Compression expectedCompression)
+{
+	istringstream in(input);
+	BlockReader reader(in);
+	BOOST_CHECK(expectedCompression == reader.decompressIfCompressed());
+	string result;
+	for (auto block = reader.next(); !block.empty(); block = reader.next())
+	{
+		BOOST_REQUIRE_LE(block.size(), BlockReader::k_blockSize);
+		result.append(reinterpret_cast<const char*>(block.data()), block.size());
+	}
+	return result;
+}
+
+BOOST_AUTO_TEST_SUITE(DecompressorTestSuite)
+
+BOOST_AUTO_TEST_CASE(detectCompressionTest)
+{
+	BOOST_CHECK(Compression::gzip == detectCompression(asBytes(compressText("x", Compression::gzip))));
+	BOOST_CHECK(Compression::zstd == detectCompression(asBytes(compressText("x", Compression::zstd))));
+	BOOST_CHECK(Compression::none == detectCompression(asBytes("\x1f\x8b")));
+	BOOST_CHECK(Compression::none == detectCompression(asBytes("plain text")));
+	BOOST_CHECK(Compression::none == detectCompression(ByteSpan{}));
+	BOOST_CHECK_EQUAL(".zst", compressionExtension(Compression::zstd));
+	BOOST_CHECK_THROW(Decompressor{Compression::none}, ::std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(roundTripTest)
+{
+	const auto text = makeText(3 * 1024 * 1024);
+	for (auto compression : { Compression::gzip, Compression::zstd })
+	{
+		BOOST_TEST_CONTEXT("Compression " << compressionName(compression))
+		{
+			const auto compressed = compressText(text, compression);
+			BOOST_CHECK_LT(compressed.size(), text.size() / 4);
+			BOOST_CHECK(text == readAll(compressed, compression));
+			BOOST_CHECK(string{} == readAll(compressText("", compression), compression));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(concatenatedStreamsTest)
+{
+	const auto text1 = makeText(100 * 1000);
+	const string text2{"The second stream\n"};
+	for (auto compression : { Compression::gzip, Compression::zstd })
+	{
+		BOOST_TEST_CONTEXT("Compression " << compressionName(compression))
+		{
+			const auto compressed = compressText(text1, compression) + compressText(text2, compression);
+			BOOST_CHECK(text1 + text2 == readAll(compressed, compression));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(plainInputTest)
+{
+	const auto text = makeText(200 * 1000);
+	BOOST_CHECK(text == readAll(text, Compression::none));
+}
+
+BOOST_AUTO_TEST_CASE(badInputTest)
+{
+	const auto text = makeText(300 * 1000);
+	for (auto compression : { Compression::gzip, Compression::zstd })
+	{
+		BOOST_TEST_CONTEXT("Compression " << compressionName(compression))
+		{
+			const auto compressed = compressText(text, compression);
+			BOOST_CHECK_THROW(readAll(compressed.substr(0, compressed.size() - 5), compression), IOError);
+			BOOST_CHECK_THROW(readAll(compressed.substr(0, compressed.size() / 2), compression), IOError);
+
+			auto corrupted = compressed;
+			for (size_t i = 20; i < 60; ++i)
+			{
+				corrupted[i] = static_cast<char>(~corrupted[i]);
+			}
+			BOOST_CHECK_THROW(readAll(corrupted, compression), IOError);
+			BOOST_CHECK_THROW(readAll(compressed + "trailing junk", compression), IOError);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(smallOutputTest)
+{
+	// The Decompressor itself, with output space for just a few bytes at a
+	// time, as when a frame ends in the middle of a call:
+	const auto text = makeText(10 * 1000);
+	for (auto compression : { Compression::gzip, Compression::zstd })
+	{
+		BOOST_TEST_CONTEXT("Compression " << compressionName(compression))
+		{
+			const auto compressed = compressText(text, compression) + compressText(text, compression);
+			Decompressor decompressor(compression);
+			auto input = asBytes(compressed);
+			string result;
+			byte output[7];
+			for (;;)
+			{
+				const auto numBytes = decompressor.decompress(input, output);
+				if (numBytes == 0 && input.empty())
+				{
+					break;
+				}
+				result.append(reinterpret_cast<const char*>(output), numBytes);
+			}
+			BOOST_CHECK(decompressor.isAtEndOfStream());
+			BOOST_CHECK(text + text == result);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,13 @@
 
 #include <stdexcept>
 
+class CanceledError : public ::std::runtime_error
+{
+public:
+	CanceledError() : ::std::runtime_error("Operation canceled") {}
+	CanceledError(const ::std::string& what) : ::std::runtime_error(what) {}
+};
+
 class CmdLineError : public ::std::logic_error
 {
 public:
@@ -18,6 +25,13 @@ public:
 	IOError(const ::std::string& what) : ::std::runtime_error(what) {}
 };
 
+class MemoryLimitError : public ::std::runtime_error
+{
+public:
+	MemoryLimitError() : ::std::runtime_error("") {}
+	MemoryLimitError(const ::std::string& what) : ::std::runtime_error(what) {}
+};
+
 class SyntaxError : public ::std::runtime_error
 {
 public:
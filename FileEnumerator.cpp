@@ -1,22 +1,128 @@
 
 #include "FileEnumerator.h"
+#include "Exceptions.h"
+#include "TarReader.h"
+#include "Utils.h"
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/range/algorithm/for_each.hpp>
 #include <boost/range/algorithm_ext/push_back.hpp>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <ctime>
 #include <format>
+#include <iomanip>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+
+#if !defined(_WIN32)
+#	include <sys/stat.h>
+#endif
 
 namespace b = ::boost;
 namespace bad = ::boost::adaptors;
 namespace balg = ::boost::algorithm;
 
 using ::std::format;
+using ::std::int64_t;
+using ::std::istringstream;
 using ::std::make_pair;
+using ::std::optional;
 using ::std::regex;
 using ::std::runtime_error;
 using ::std::string;
 using ::std::string_view;
+using ::std::uint64_t;
+using ::std::vector;
 
 static constexpr auto k_wildcardSeparator = string_view{")|(?:"};
+static constexpr char k_archiveSeparator = '!';
+static constexpr string_view k_archiveExtensions[] = { ".tar", ".tar.gz", ".tgz", ".tar.zst", ".tzst" };
+
+// What the traversal filters need to know of a file:
+struct FileStatus
+{
+	uint64_t	m_device;
+	uint64_t	m_size;
+	int64_t	m_mtimeNs;	// Since the epoch
+};
+
+// The status of a directory entry, following symbolic links as isFile()
+// does, or nothing if it cannot be had.  On Windows, the entry caches the
+// size and modification time from the directory listing, so they cost
+// nothing.  Elsewhere it caches only the file type, and a single stat()
+// gets all three fields.
+static optional<FileStatus> statusOf(const ::std::filesystem::directory_entry& entry)
+{
+#if defined(_WIN32)
+	::std::error_code ec;
+	const auto size = entry.file_size(ec);
+	if (ec)
+	{
+		return optional<FileStatus>{};
+	}
+	const auto mtime = entry.last_write_time(ec);
+	if (ec)
+	{
+		return optional<FileStatus>{};
+	}
+	const auto sinceEpoch = ::std::chrono::clock_cast< ::std::chrono::system_clock>(mtime).time_since_epoch();
+	return FileStatus{0, size,
+		::std::chrono::duration_cast< ::std::chrono::nanoseconds>(sinceEpoch).count()};
+#else
+	RunStats::countMetadataCalls();
+	struct stat status;
+	if (::stat(entry.path().c_str(), &status) != 0)
+	{
+		return optional<FileStatus>{};
+	}
+#	if defined(__APPLE__)
+	const auto& mtime = status.st_mtimespec;
+#	else
+	const auto& mtime = status.st_mtim;
+#	endif
+	return FileStatus{
+		static_cast<uint64_t>(status.st_dev),
+		static_cast<uint64_t>(status.st_size),
+		static_cast<int64_t>(mtime.tv_sec) * 1'000'000'000 + mtime.tv_nsec};
+#endif
+}
+
+// The value of --newer is either a file, whose modification time is taken,
+// or a local time:
+static int64_t parseNewerThan(const char* pValue)
+{
+	static constexpr const char* k_timeFormats[] = { "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M", "%Y-%m-%d" };
+	static constexpr int64_t k_maxInt64 = ::std::numeric_limits<int64_t>::max();
+
+	if (const auto status = statusOf(::std::filesystem::directory_entry{FileEnumerator::Path{pValue}}); status)
+	{
+		return status->m_mtimeNs;
+	}
+	for (auto pFormat : k_timeFormats)
+	{
+		::std::tm time{};
+		istringstream in(pValue);
+		in >> ::std::get_time(&time, pFormat);
+		if (!in.fail() && in.peek() == istringstream::traits_type::eof())
+		{
+			time.tm_isdst = -1;	// Whatever is in effect on that date
+			const auto seconds = static_cast<int64_t>(::std::mktime(&time));
+			if (seconds != -1)
+			{
+				// Times past 2262 are out of range in nanoseconds, and later than
+				// any file anyway:
+				return (seconds < k_maxInt64 / 1'000'000'000) ? seconds * 1'000'000'000 : k_maxInt64;
+			}
+		}
+	}
+	throw CmdLineError(format(
+		"'{0}' is neither a file nor a time of the form YYYY-MM-DD[THH:MM[:SS]]", pValue));
+}
 
 // ============================ CmdLineFileSpec ============================
 
@@ -49,8 +155,209 @@ string CmdLineFileSpec::wildcard() const
 
 void FileEnumerator::insert(const Path& fileSpecPath)
 {
+	if (m_isArchiveAware)
+	{
+		const auto fileSpec = fileSpecPath.generic_string();
+		const auto separatorPos = fileSpec.find(k_archiveSeparator);
+		if (separatorPos != string::npos && isArchiveName(fileSpec.substr(0, separatorPos)))
+		{
+			const auto memberSpec = fileSpec.substr(separatorPos + 1);
+			CmdLineFileSpec fs(memberSpec.empty() ? string{"*"} : memberSpec);
+			m_archiveSpecMap[Path{fileSpec.substr(0, separatorPos)}].insert(make_pair(fs.dir(), fs));
+			return;
+		}
+	}
 	CmdLineFileSpec fs(fileSpecPath);
 	m_fileSpecMap.insert(make_pair(fs.dir(), fs));
+	if (m_isSameFileSystem)
+	{
+		m_rootDevices.try_emplace(fs.dir(), deviceOf(fs.dir()));
+	}
+}
+
+bool FileEnumerator::parseFilterOption(::std::span<const char*const> args, size_t& i)
+{
+	const auto pArg = args[i];
+	if (isIEqual(pArg, "--min-size"))
+	{
+		m_minSize = parseByteSize(getOptionValue(args, i));
+	}
+	else if (isIEqual(pArg, "--max-size"))
+	{
+		m_maxSize = parseByteSize(getOptionValue(args, i));
+	}
+	else if (isIEqual(pArg, "--newer"))
+	{
+		m_newerThanNs = parseNewerThan(getOptionValue(args, i));
+	}
+	else if (isIEqual(pArg, "--max-depth"))
+	{
+		const string_view value{getOptionValue(args, i)};
+		size_t maxDepth = 0;
+		const auto result = ::std::from_chars(value.data(), value.data() + value.size(), maxDepth);
+		if (result.ec != ::std::errc{} || result.ptr != value.data() + value.size())
+		{
+			throw CmdLineError(format("Invalid maximum depth '{0}'", value));
+		}
+		m_maxDepth = maxDepth;
+	}
+	else if (isIEqual(pArg, "-xdev"))
+	{
+#if defined(_WIN32)
+		throw CmdLineError("The option '-xdev' is not supported on Windows");
+#else
+		m_isSameFileSystem = true;
+		for (const auto& rootDir : rootDirs())
+		{
+			m_rootDevices.try_emplace(rootDir, deviceOf(rootDir));
+		}
+#endif
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+size_t FileEnumerator::numArchiveSpecs() const
+{
+	size_t result = 0;
+	for (const auto& [archivePath, memberSpecMap] : m_archiveSpecMap)
+	{
+		result += memberSpecMap.size();
+	}
+	return result;
+}
+
+bool FileEnumerator::isArchiveName(const string& fileName)
+{
+	return ::std::any_of(::std::begin(k_archiveExtensions), ::std::end(k_archiveExtensions),
+		[&fileName] (string_view ext) { return balg::iends_with(fileName, ext); });
+}
+
+::std::vector<FileEnumerator::Path> FileEnumerator::rootDirs() const
+{
+	::std::vector<Path> result;
+	b::push_back(result, m_fileSpecMap
+		| bad::map_keys
+		| bad::uniqued);
+	return result;
+}
+
+bool FileEnumerator::isMatch(const Path& p) const
+{
+	const Path dir = p.has_parent_path() ? p.parent_path().lexically_normal() : Path{"."};
+	for (const auto& rootDir : rootDirs())
+	{
+		if (isUnderRootDir(dir, rootDir) && matchesWildcard(p, dirToDirPlusRegex(rootDir).second))
+		{
+			const auto entry = entryOf(p);
+			return isFile(entry)
+				&& (!hasFileFilters() || passesFileFilters(entry))
+				&& (!m_isSameFileSystem || deviceOf(entry) == rootDeviceOf(rootDir));
+		}
+	}
+	return false;
+}
+
+bool FileEnumerator::isUnderRootDir(const Path& dir, const Path& rootDir) const
+{
+	const Path relDir = dir.lexically_relative(rootDir.lexically_normal());
+	return (relDir == ".")
+		|| (m_isRecursive && !relDir.empty() && *relDir.begin() != ".."
+			&& (!m_maxDepth || static_cast<size_t>(::std::distance(relDir.begin(), relDir.end())) <= *m_maxDepth));
+}
+
+bool FileEnumerator::passesFileFilters(const DirEntry& entry) const
+{
+	const auto status = statusOf(entry);
+	return status
+		&& passesSizeFilters(status->m_size)
+		&& (!m_newerThanNs || status->m_mtimeNs > *m_newerThanNs);
+}
+
+bool FileEnumerator::isDescendable(const DirEntry& dirEntry, int depth, uint64_t rootDevice) const
+{
+	// The entries of a directory at depth d are at depth d + 1:
+	if (m_maxDepth && static_cast<size_t>(depth) + 1 > *m_maxDepth)
+	{
+		return false;
+	}
+	return !m_isSameFileSystem || deviceOf(dirEntry) == rootDevice;
+}
+
+FileEnumerator::DirEntry FileEnumerator::entryOf(const Path& p)
+{
+	RunStats::countMetadataCalls();
+	::std::error_code ec;
+	return DirEntry{p, ec};	// On error, an entry whose type is unknown
+}
+
+uint64_t FileEnumerator::deviceOf(const DirEntry& entry)
+{
+	const auto status = statusOf(entry);
+	return status ? status->m_device : 0;
+}
+
+uint64_t FileEnumerator::rootDeviceOf(const Path& rootDir) const
+{
+	const auto it = m_rootDevices.find(rootDir);
+	return (it == m_rootDevices.end()) ? deviceOf(rootDir) : it->second;
+}
+
+bool FileEnumerator::isArchiveMemberMatch(const Path& memberPath,
+	const vector<DirPlusRegex>& dirPlusRegexes) const
+{
+	const Path dir = memberPath.has_parent_path() ? memberPath.parent_path().lexically_normal() : Path{"."};
+	return ::std::any_of(dirPlusRegexes.begin(), dirPlusRegexes.end(),
+		[this, &dir, &memberPath] (const DirPlusRegex& dirPlusRegex)
+		{
+			return isUnderRootDir(dir, dirPlusRegex.first)
+				&& matchesWildcard(memberPath, dirPlusRegex.second);
+		});
+}
+
+bool FileEnumerator::enumerateArchiveMembersUntil(const ArchiveMemberPredicate& predicate) const
+{
+	RunStats::PhaseTimer enumerationTimer(RunStats::Phase::enumeration);
+	for (const auto& [archivePath, memberSpecMap] : m_archiveSpecMap)
+	{
+		vector<DirPlusRegex> dirPlusRegexes;
+		b::push_back(dirPlusRegexes, memberSpecMap
+			| bad::map_keys
+			| bad::uniqued
+			| bad::transformed([&memberSpecMap] (const Path& dir)
+				{ return dirToDirPlusRegex(memberSpecMap, dir); }));
+
+		InputFile in(archivePath);
+		BlockReader archiveReader(in.fd());
+		archiveReader.decompressIfCompressed();
+		TarReader tarReader(archiveReader);
+		while (tarReader.nextMember())
+		{
+			const auto& member = tarReader.member();
+			if (!member.m_isRegularFile || !passesSizeFilters(member.m_size)
+				|| !isArchiveMemberMatch(Path{member.m_path}, dirPlusRegexes))
+			{
+				continue;
+			}
+
+			CancellationToken::throwIfRequested();
+			ScratchArena::ResetGuard scratchArenaResetGuard;
+			const Path memberPath{format("{0}{1}{2}", archivePath.generic_string(), k_archiveSeparator,
+				member.m_path)};
+			RunStats::FileTimer fileTimer(memberPath);
+			TarMemberBuf memberBuf(tarReader);
+			::std::istream memberStream(&memberBuf);
+			BlockReader memberReader(memberStream, ScratchArena::forThisThread().resource());
+			if (predicate(memberPath, memberReader))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
 }
 
 #if defined(CMDLINEUTIL_TEST_MODE)
@@ -59,6 +366,13 @@ void FileEnumerator::getFileSpecList(PathList& fileSpecList) const
 	b::push_back(fileSpecList, m_fileSpecMap
 		| bad::map_values
 		| bad::transformed([] (const CmdLineFileSpec& clfs) { return clfs.filePath(); }));
+	for (const auto& [archivePath, memberSpecMap] : m_archiveSpecMap)
+	{
+		b::push_back(fileSpecList, memberSpecMap
+			| bad::map_values
+			| bad::transformed([&archivePath] (const CmdLineFileSpec& clfs)
+				{ return Path{archivePath.generic_string() + k_archiveSeparator + clfs.filePath().generic_string()}; }));
+	}
 }
 #endif
 
@@ -84,9 +398,10 @@ string FileEnumerator::combineRegexPatterns(const RootDirRng& rootRng)
 		: "^" + result + "$";
 }
 
-FileEnumerator::DirPlusRegex FileEnumerator::dirToDirPlusRegex(const Path& dir) const
+FileEnumerator::DirPlusRegex FileEnumerator::dirToDirPlusRegex(const FileSpecMap& fileSpecMap,
+	const Path& dir)
 {
-	RootDirRng rootRng(m_fileSpecMap.equal_range(dir));
+	RootDirRng rootRng(fileSpecMap.equal_range(dir));
 	const regex rex(combineRegexPatterns(rootRng));
 	return make_pair(dir, rex);
 }
@@ -2,20 +2,29 @@
 #if !defined(FILEENUMERATOR_H_INCLUDED)
 #define FILEENUMERATOR_H_INCLUDED
 
-#include <boost/range/adaptor/filtered.hpp>
+#include "BlockReader.h"
+#include "Cancellation.h"
+#include "RunStats.h"
+#include "ScratchArena.h"
+#include "SinceState.h"
+
 #include <boost/range/adaptor/map.hpp>
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/range/adaptor/uniqued.hpp>
-#include <boost/range/algorithm/for_each.hpp>
+#include <boost/range/algorithm/find_if.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <map>
+#include <optional>
 #include <regex>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
-#if defined(CMDLINEUTIL_TEST_MODE)
 #include <vector>
-#endif
 
 class CmdLineFileSpec
 {
@@ -43,30 +52,115 @@ class FileEnumerator
 public:
 	using Path = ::std::filesystem::path;
 
+	// Takes the path of an archive member, as archive.tar!path/inside, and a
+	// BlockReader over its contents, and returns true to stop the enumeration.
+	using ArchiveMemberPredicate = ::std::function<bool(const Path&, BlockReader&)>;
+
 	FileEnumerator()
-		: m_isRecursive(false), m_fileSpecMap() {}
+		: m_isRecursive(false), m_isArchiveAware(false), m_fileSpecMap(), m_archiveSpecMap(),
+			m_minSize(), m_maxSize(), m_newerThanNs(), m_maxDepth(), m_isSameFileSystem(false), m_rootDevices() {}
 
 	void setRecursive(bool newRecursiveValue = true)
 		{ m_isRecursive = newRecursiveValue; }
 
+	// Makes insert() take a file spec of the form archive.tar!pattern, where
+	// archive.tar names a tar archive (possibly compressed with gzip or zstd),
+	// to mean the members of the archive that match pattern, as though the
+	// archive were a directory.  Those are yielded by enumerateArchiveMembers()
+	// rather than enumerateFiles().  Call this before insert().
+	void setArchiveAware(bool newArchiveAwareValue = true)
+		{ m_isArchiveAware = newArchiveAwareValue; }
+
 	void insert(const Path& fileSpecPath);
 
+	// If args[i] is one of the traversal filters that every tool accepts
+	// (see k_filterOptionsUsage), applies it, advances i past its value, and
+	// returns true.  Otherwise returns false.  Throws CmdLineError if the
+	// value is malformed.
+	//
+	// The filters are evaluated during the traversal, from the directory
+	// entry of each candidate file, so that a file they exclude is never
+	// opened, and a directory they exclude is never read.  The type of the
+	// entry comes from the directory listing.  The size and modification
+	// time come from it as well on Windows, and elsewhere from one stat() of
+	// the file, made only if a size or time filter is given.  -xdev costs
+	// one stat() of each directory.
+	bool parseFilterOption(::std::span<const char*const> args, size_t& i);
+
+	// The description of the traversal filters, for the tools' usage text:
+	static constexpr ::std::string_view k_filterOptionsUsage =
+		"   --min-size <size>, --max-size <size> Process only the files of at\n"
+		"      least, or at most, <size> bytes.  The size may have a suffix of\n"
+		"      K, M, or G.\n"
+		"\n"
+		"   --newer <time|file> Process only the files modified after <time>\n"
+		"      (local time, as YYYY-MM-DD or YYYY-MM-DDTHH:MM[:SS]), or after\n"
+		"      the file <file> was\n"
+		"\n"
+		"   --max-depth <n> With -r, descend at most <n> levels below each\n"
+		"      directory searched\n"
+		"\n"
+		"   -xdev With -r, do not descend into directories on other filesystems\n";
+
 	bool isRecursive() const
 		{ return m_isRecursive; }
 	size_t numFileSpecs() const
-		{ return m_fileSpecMap.size(); }
+		{ return m_fileSpecMap.size() + numArchiveSpecs(); }
+	size_t numArchiveSpecs() const;
+
+	// The distinct directories named by the file specs.  If isRecursive(),
+	// enumerateFiles() also searches all of their sub-directories.
+	::std::vector<Path> rootDirs() const;
+
+	// Returns true if p is a file that enumerateFiles() would yield, traversal
+	// filters included.
+	bool isMatch(const Path& p) const;
 
 	// FileProcessingFunctor takes a single parameter of type
-	// "const std::filesystem::path&" and returns "void".
+	// "const std::filesystem::path&" and returns "void".  Given a SinceState,
+	// only the files it reports as changed are passed to the functor.
 	template<typename FileProcessingFunctor>
-	void enumerateFiles(FileProcessingFunctor functor) const
+	void enumerateFiles(FileProcessingFunctor functor, SinceState* pSinceState = nullptr) const
 		{
-			::boost::for_each(m_fileSpecMap
-					| ::boost::adaptors::map_keys
-					| ::boost::adaptors::uniqued
-					| ::boost::adaptors::transformed(
-						[this] (const Path& dir) { return dirToDirPlusRegex(dir); }),
-				[this, functor] (const DirPlusRegex& dirPlusRegex) { processRootDir(dirPlusRegex, functor); });
+			enumerateFilesUntil([functor] (const Path& p)
+				{
+					functor(p);
+					return false;
+				}, pSinceState);
+		}
+
+	// The same as enumerateFiles(), except that FilePredicate returns "bool",
+	// and the enumeration stops at the first file for which it returns true.
+	// Returns true if it stopped early in this way.
+	template<typename FilePredicate>
+	bool enumerateFilesUntil(FilePredicate predicate, SinceState* pSinceState = nullptr) const
+		{
+			RunStats::PhaseTimer enumerationTimer(RunStats::Phase::enumeration);
+			auto rootDirRng = m_fileSpecMap
+				| ::boost::adaptors::map_keys
+				| ::boost::adaptors::uniqued
+				| ::boost::adaptors::transformed(
+					[this] (const Path& dir) { return dirToDirPlusRegex(dir); });
+			return ::boost::find_if(rootDirRng,
+					[this, predicate, pSinceState] (const DirPlusRegex& dirPlusRegex)
+						{ return processRootDir(dirPlusRegex, predicate, pSinceState); })
+				!= ::boost::end(rootDirRng);
+		}
+
+	// Reads each archive named by an archive file spec once, from start to
+	// finish, and passes each matching member to the predicate.  Returns true
+	// if the predicate stopped the enumeration.  Throws IOError if an archive
+	// cannot be read.
+	bool enumerateArchiveMembersUntil(const ArchiveMemberPredicate& predicate) const;
+
+	template<typename ArchiveMemberFunctor>
+	void enumerateArchiveMembers(ArchiveMemberFunctor functor) const
+		{
+			enumerateArchiveMembersUntil([&functor] (const Path& p, BlockReader& reader)
+				{
+					functor(p, reader);
+					return false;
+				});
 		}
 
 #if defined(CMDLINEUTIL_TEST_MODE)
@@ -82,6 +176,11 @@ private:
 	using DirEntry = ::std::filesystem::directory_entry;
 	using DirIter = ::std::filesystem::directory_iterator;
 	using RecDirIter = ::std::filesystem::recursive_directory_iterator;
+	using ArchiveSpecMap = ::std::map<Path, FileSpecMap>;	// Archive -> (directory inside -> spec)
+
+	static bool isArchiveName(const ::std::string& fileName);
+	bool isUnderRootDir(const Path& dir, const Path& rootDir) const;
+	bool isArchiveMemberMatch(const Path& memberPath, const ::std::vector<DirPlusRegex>& dirPlusRegexes) const;
 
 	// If the wildcard patterns for the FileSpecs in the range are
 	// pattern1, pattern2, pattern3, then this method produces a
@@ -89,40 +188,135 @@ private:
 	//    ^(?:pattern1)|(?:pattern2)|(?:pattern3)$
 	static ::std::string combineRegexPatterns(const RootDirRng& rootRng);
 
-	DirPlusRegex dirToDirPlusRegex(const Path& dir) const;
-	static bool isFile(const Path& p)	// canonical() resolves symlinks
-		{ return exists(p) && is_regular_file(canonical(p)); }
+	DirPlusRegex dirToDirPlusRegex(const Path& dir) const
+		{ return dirToDirPlusRegex(m_fileSpecMap, dir); }
+	static DirPlusRegex dirToDirPlusRegex(const FileSpecMap& fileSpecMap, const Path& dir);
+	static bool isFile(const DirEntry& entry)	// Follows symlinks
+		{
+			::std::error_code ec;
+			return entry.is_regular_file(ec);
+		}
+	// The entry for a path not found by a directory iterator:
+	static DirEntry entryOf(const Path& p);
 	static bool matchesWildcard(const Path& p, const ::std::regex& rex)
 		{ return regex_match(p.filename().string(), rex); }
 
-	template<typename DirIterType, typename FileProcessingFunctor>
-	void processRootDirHelper(const DirPlusRegex& dirPlusRegex, FileProcessingFunctor functor) const
+	// The size and modification time filters:
+	bool hasFileFilters() const
+		{ return m_minSize || m_maxSize || m_newerThanNs; }
+	bool passesFileFilters(const DirEntry& entry) const;
+	bool passesSizeFilters(::std::uint64_t size) const
+		{ return (!m_minSize || size >= *m_minSize) && (!m_maxSize || size <= *m_maxSize); }
+	// The depth and filesystem filters, for a directory at the given depth
+	// below the root directory (on rootDevice) of a recursive traversal:
+	bool hasDirFilters() const
+		{ return m_maxDepth || m_isSameFileSystem; }
+	bool isDescendable(const DirEntry& dirEntry, int depth, ::std::uint64_t rootDevice) const;
+	static ::std::uint64_t deviceOf(const DirEntry& entry);
+	static ::std::uint64_t deviceOf(const Path& p)
+		{ return deviceOf(entryOf(p)); }
+	// The device of a root directory, recorded once when -xdev is given:
+	::std::uint64_t rootDeviceOf(const Path& rootDir) const;
+
+	// Passes the entry's path to the predicate if it is a file that the
+	// enumeration yields, and returns the predicate's result.  The path is
+	// used by reference, so that none is copied merely to be tested and,
+	// perhaps, rejected:
+	template<typename FilePredicate>
+	bool processFile(const DirEntry& entry, const ::std::regex& rex, FilePredicate& predicate,
+		SinceState* pSinceState) const
 	{
-		::boost::for_each(::boost::make_iterator_range(
-					DirIterType(dirPlusRegex.first), DirIterType())
-				| ::boost::adaptors::transformed(
-					[] (const DirEntry& de) { return de.path(); })
-				| ::boost::adaptors::filtered(
-					[regex = dirPlusRegex.second] (const Path& p)
-						{ return isFile(p) && matchesWildcard(p, regex); }),
-			functor);
+		const Path& p = entry.path();
+		if (isFile(entry) && matchesWildcard(p, rex)
+			&& (!hasFileFilters() || passesFileFilters(entry))
+			&& (pSinceState == nullptr || pSinceState->isChanged(p)))
+		{
+			CancellationToken::throwIfRequested();
+			ScratchArena::ResetGuard scratchArenaResetGuard;
+			RunStats::FileTimer fileTimer(p);
+			return predicate(p);
+		}
+		return false;
 	}
 
-	template<typename FileProcessingFunctor>
-	void processRootDir(const DirPlusRegex& dirPlusRegex, FileProcessingFunctor functor) const
+	template<typename DirIterType, typename FilePredicate>
+	bool processRootDirHelper(const DirPlusRegex& dirPlusRegex, FilePredicate predicate) const
+	{
+		const auto rootDevice = m_isSameFileSystem ? rootDeviceOf(dirPlusRegex.first) : 0;
+		for (DirIterType it(dirPlusRegex.first), end; it != end; ++it)
+		{
+			// A directory excluded by the filters is pruned before it is read:
+			if constexpr (::std::is_same_v<DirIterType, RecDirIter>)
+			{
+				if (hasDirFilters() && it->is_directory() && !isDescendable(*it, it.depth(), rootDevice))
+				{
+					it.disable_recursion_pending();
+				}
+			}
+
+			if (processFile(*it, dirPlusRegex.second, predicate, nullptr))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// The traversal for a SinceState, which lists each directory through it,
+	// so that a directory unchanged since the previous run is not read again.
+	// The files of a directory come before its sub-directories.
+	template<typename FilePredicate>
+	bool processDirSince(const Path& dir, const ::std::regex& rex, FilePredicate& predicate,
+		SinceState& sinceState, int depth, ::std::uint64_t rootDevice) const
 	{
+		const auto& listing = sinceState.listDirectory(dir);
+		for (const auto& fileName : listing.m_fileNames)
+		{
+			if (processFile(entryOf(dir / fileName), rex, predicate, &sinceState))
+			{
+				return true;
+			}
+		}
 		if (m_isRecursive)
 		{
-			processRootDirHelper<RecDirIter>(dirPlusRegex, functor);
+			for (const auto& subDirName : listing.m_subDirNames)
+			{
+				const auto subDir = entryOf(dir / subDirName);
+				if ((!hasDirFilters() || isDescendable(subDir, depth, rootDevice))
+					&& processDirSince(subDir.path(), rex, predicate, sinceState, depth + 1, rootDevice))
+				{
+					return true;
+				}
+			}
 		}
-		else
+		return false;
+	}
+
+	template<typename FilePredicate>
+	bool processRootDir(const DirPlusRegex& dirPlusRegex, FilePredicate predicate,
+		SinceState* pSinceState) const
+	{
+		if (pSinceState != nullptr)
 		{
-			processRootDirHelper<DirIter>(dirPlusRegex, functor);
+			const auto rootDevice = m_isSameFileSystem ? rootDeviceOf(dirPlusRegex.first) : 0;
+			return processDirSince(dirPlusRegex.first, dirPlusRegex.second, predicate,
+				*pSinceState, 0, rootDevice);
 		}
+		return m_isRecursive
+			? processRootDirHelper<RecDirIter>(dirPlusRegex, predicate)
+			: processRootDirHelper<DirIter>(dirPlusRegex, predicate);
 	}
 
-	bool			m_isRecursive;
-	FileSpecMap	m_fileSpecMap;
+	bool										m_isRecursive;
+	bool										m_isArchiveAware;
+	FileSpecMap								m_fileSpecMap;
+	ArchiveSpecMap							m_archiveSpecMap;
+	::std::optional< ::std::uint64_t>	m_minSize;
+	::std::optional< ::std::uint64_t>	m_maxSize;
+	::std::optional< ::std::int64_t>		m_newerThanNs;	// Modification time, since the epoch
+	::std::optional<size_t>				m_maxDepth;
+	bool										m_isSameFileSystem;
+	::std::map<Path, ::std::uint64_t>	m_rootDevices;	// Root directory -> device, with -xdev
 };
 
 #endif // FILEENUMERATOR_H_INCLUDED
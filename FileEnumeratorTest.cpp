@@ -3,18 +3,26 @@
 #define CMDLINEUTIL_TEST_MODE
 #endif
 
+#include "Exceptions.h"
 #include "FileEnumerator.h"
 #include "PathDeleter.h"
+#include "TestUtil.h"
 #include "Utils.h"
 
 #include <boost/range/algorithm_ext/for_each.hpp>
 #include <boost/range/algorithm/sort.hpp>
 #include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <fstream>
+#include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
 namespace b = ::boost;
 namespace fs = ::std::filesystem;
 
+using ::std::string;
 using ::std::string_view;
 
 BOOST_AUTO_TEST_SUITE(FileEnumeratorTestSuite)
@@ -105,4 +113,173 @@ BOOST_AUTO_TEST_CASE(ExpandWildCardTest)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(IsMatchTest)
+{
+	fs::path cwDir(".");
+	fs::path testDir = cwDir / "TempTestDir";
+	PathDeleter testPathDeleter(testDir);
+	create_directories(testDir);
+	copyFile(cwDir, testDir, "FileEnumerator.cpp");
+
+	FileEnumerator fe;
+	fe.insert("FileEn*.cpp");
+	BOOST_CHECK(fe.isMatch("FileEnumerator.cpp"));
+	BOOST_CHECK(fe.isMatch(cwDir / "FileEnumerator.cpp"));
+	BOOST_CHECK(!fe.isMatch(cwDir / "FileEnumerator.h"));
+	BOOST_CHECK(!fe.isMatch(cwDir / "FileEnumeratorNonexistent.cpp"));
+	BOOST_CHECK(!fe.isMatch(testDir / "FileEnumerator.cpp"));
+
+	fe.setRecursive();
+	BOOST_CHECK(fe.isMatch(testDir / "FileEnumerator.cpp"));
+	BOOST_CHECK(!fe.isMatch(cwDir / ".." / "FileEnumerator.cpp"));
+}
+
+BOOST_AUTO_TEST_CASE(ArchiveMembersTest)
+{
+	fs::path testDir("TempTestDir");
+	PathDeleter testPathDeleter(testDir);
+	create_directories(testDir);
+	const auto archivePath = testDir / "release.tar.gz";
+	::std::ofstream(archivePath, ::std::ios::binary) << compressText(makeTar({
+			{ "README.txt", "Read me\n" },
+			{ "docs/", "", '5' },
+			{ "docs/guide.txt", "Guide\n" },
+			{ "docs/guide.html", "<p>Guide</p>\n" },
+			{ "docs/api/index.txt", "Index\n" },
+		}), Compression::gzip);
+	const auto archiveSpec = archivePath.generic_string();
+
+	auto enumerateMembers = [] (const FileEnumerator& fe)
+		{
+			::std::vector<string> members;
+			fe.enumerateArchiveMembers([&members] (const fs::path& path, BlockReader& reader)
+				{
+					string contents;
+					reader.forEachBlock([&contents] (ByteSpan block)
+						{ contents.append(reinterpret_cast<const char*>(block.data()), block.size()); });
+					members.push_back(path.generic_string() + "=" + contents);
+				});
+			return members;
+		};
+
+	{
+		FileEnumerator fe;
+		fe.setArchiveAware();
+		fe.insert(archiveSpec + "!*.txt");
+		BOOST_CHECK_EQUAL(1u, fe.numFileSpecs());
+		BOOST_CHECK_EQUAL(1u, fe.numArchiveSpecs());
+		FileEnumerator::PathList fileList;
+		fe.enumerateFiles([&fileList] (const fs::path& path) { fileList.push_back(path); });
+		BOOST_CHECK(fileList.empty());
+		const auto members = enumerateMembers(fe);
+		BOOST_REQUIRE_EQUAL(1u, members.size());
+		BOOST_CHECK_EQUAL(archiveSpec + "!README.txt=Read me\n", members[0]);
+	}
+
+	{
+		FileEnumerator fe;
+		fe.setArchiveAware();
+		fe.setRecursive();
+		fe.insert(archiveSpec + "!docs/*.txt");
+		const auto members = enumerateMembers(fe);
+		BOOST_REQUIRE_EQUAL(2u, members.size());
+		BOOST_CHECK_EQUAL(archiveSpec + "!docs/guide.txt=Guide\n", members[0]);
+		BOOST_CHECK_EQUAL(archiveSpec + "!docs/api/index.txt=Index\n", members[1]);
+	}
+
+	{
+		// The size filters apply to the members:
+		static const char*const k_args[] = { "--min-size", "7" };
+		FileEnumerator fe;
+		fe.setArchiveAware();
+		fe.setRecursive();
+		for (size_t i = 0; i < ::std::size(k_args); ++i)
+		{
+			BOOST_REQUIRE(fe.parseFilterOption(k_args, i));
+		}
+		fe.insert(archiveSpec + "!*.txt");
+		const auto members = enumerateMembers(fe);
+		BOOST_REQUIRE_EQUAL(1u, members.size());
+		BOOST_CHECK_EQUAL(archiveSpec + "!README.txt=Read me\n", members[0]);
+	}
+
+	{
+		// Without setArchiveAware(), the spec is just an odd file name:
+		FileEnumerator fe;
+		fe.insert(archiveSpec + "!*.txt");
+		BOOST_CHECK_EQUAL(0u, fe.numArchiveSpecs());
+		BOOST_CHECK(enumerateMembers(fe).empty());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(TraversalFiltersTest)
+{
+	fs::path testDir("TempTestDir");
+	PathDeleter testPathDeleter(testDir);
+	create_directories(testDir / "sub" / "deeper");
+	::std::ofstream(testDir / "old.txt") << "Old and small\n";
+	::std::ofstream(testDir / "big.txt") << string(5000, 'x');
+	::std::ofstream(testDir / "sub" / "mid.txt") << "Middle\n";
+	::std::ofstream(testDir / "sub" / "deeper" / "deep.txt") << "Deep\n";
+	last_write_time(testDir / "old.txt", fs::file_time_type::clock::now() - ::std::chrono::hours(48));
+
+	// Enumerates the text files under testDir recursively, with the filter
+	// options given, and returns their names, sorted:
+	auto enumerate = [&testDir] (::std::vector<const char*> filterArgs)
+		{
+			FileEnumerator fe;
+			fe.setRecursive();
+			const ::std::span<const char*const> args{filterArgs};
+			for (size_t i = 0; i < args.size(); ++i)
+			{
+				BOOST_REQUIRE(fe.parseFilterOption(args, i));
+			}
+			fe.insert(testDir / "*.txt");
+			::std::vector<string> names;
+			fe.enumerateFiles([&names] (const fs::path& p) { names.push_back(p.filename().string()); });
+			b::sort(names);
+			return names;
+		};
+	using Names = ::std::vector<string>;
+
+	BOOST_CHECK(Names({ "big.txt", "deep.txt", "mid.txt", "old.txt" }) == enumerate({}));
+	BOOST_CHECK(Names({ "big.txt" }) == enumerate({ "--min-size", "1K" }));
+	BOOST_CHECK(Names({ "deep.txt", "mid.txt", "old.txt" }) == enumerate({ "--max-size", "100" }));
+	BOOST_CHECK(Names({ "mid.txt", "old.txt" }) == enumerate({ "--min-size", "6", "--max-size", "14" }));
+	const auto oldPath = (testDir / "old.txt").string();
+	BOOST_CHECK(Names({ "big.txt", "deep.txt", "mid.txt" }) == enumerate({ "--newer", oldPath.c_str() }));
+	BOOST_CHECK(Names({ "big.txt", "deep.txt", "mid.txt", "old.txt" }) == enumerate({ "--newer", "2000-01-01" }));
+	BOOST_CHECK(Names({}) == enumerate({ "--newer", "2999-12-31T23:59" }));
+	BOOST_CHECK(Names({ "big.txt", "old.txt" }) == enumerate({ "--max-depth", "0" }));
+	BOOST_CHECK(Names({ "big.txt", "mid.txt", "old.txt" }) == enumerate({ "--max-depth", "1" }));
+	BOOST_CHECK(Names({ "big.txt", "deep.txt", "mid.txt", "old.txt" }) == enumerate({ "-xdev" }));
+
+	{
+		FileEnumerator fe;
+		fe.setRecursive();
+		const char* filterArgs[] = { "--max-depth", "1", "--max-size", "1K" };
+		for (size_t i = 0; i < arrayLen(filterArgs); ++i)
+		{
+			BOOST_REQUIRE(fe.parseFilterOption(filterArgs, i));
+		}
+		fe.insert(testDir / "*.txt");
+		BOOST_CHECK(fe.isMatch(testDir / "sub" / "mid.txt"));
+		BOOST_CHECK(!fe.isMatch(testDir / "sub" / "deeper" / "deep.txt"));
+		BOOST_CHECK(!fe.isMatch(testDir / "big.txt"));
+	}
+
+	{
+		FileEnumerator fe;
+		const char* args[] = { "-r", "--max-depth", "deep", "--newer", "yesterday", "--min-size", "1X" };
+		size_t i = 0;
+		BOOST_CHECK(!fe.parseFilterOption(args, i));
+		i = 1;
+		BOOST_CHECK_THROW(fe.parseFilterOption(args, i), CmdLineError);
+		i = 3;
+		BOOST_CHECK_THROW(fe.parseFilterOption(args, i), CmdLineError);
+		i = 5;
+		BOOST_CHECK_THROW(fe.parseFilterOption(args, i), CmdLineError);
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,223 @@
+
+#include "FileRewriter.h"
+#include "BlockReader.h"
+#include "Exceptions.h"
+#include "MemoryBudget.h"
+#include "PathDeleter.h"
+#include "RunStats.h"
+#include "Utils.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <optional>
+#include <ostream>
+#include <streambuf>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#	include <io.h>
+#	include <sys/stat.h>
+#	define CLOSE_FD ::_close
+#	define WRITE_FD ::_write
+#else
+#	include <unistd.h>
+#	define CLOSE_FD ::close
+#	define WRITE_FD ::write
+#	define O_BINARY 0
+#endif
+
+using ::std::format;
+using ::std::ios_base;
+using ::std::optional;
+using ::std::ostream;
+
+using Path = ::std::filesystem::path;
+
+// The output counterpart of InputFile and BlockReader:  a stream buffer that
+// writes a file through its descriptor in large blocks, so that the time
+// spent writing and the number of bytes written can be measured for --stats.
+// A failed write throws IOError out of the stream.
+class OutputFileBuf : public ::std::streambuf
+{
+public:
+	OutputFileBuf(const Path& p, ::std::pmr::memory_resource* pMemRsrc) :
+#if defined(_WIN32)
+		m_fd(::_wopen(p.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE)),
+#else
+		m_fd(::open(p.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666)),
+#endif
+		m_path(p),
+		m_bufferReservation(MemoryBudget::Reservation::forBuffer(
+			BlockReader::k_blockSize, BlockReader::k_minBlockSize, "a write buffer")),
+		m_buffer(m_bufferReservation.size(), pMemRsrc)
+	{
+		if (m_fd < 0)
+		{
+			throw IOError(format("Unable to create file '{0}':  {1}",
+				p.generic_string(), ::std::strerror(errno)));
+		}
+		setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+	}
+
+	~OutputFileBuf()
+	{
+		CLOSE_FD(m_fd);
+	}
+
+	/// \brief Writes out whatever is buffered, throwing IOError on failure.
+	void flush()
+	{
+		RunStats::PhaseTimer writingTimer(RunStats::Phase::writing);
+		for (const char* pNext = pbase(); pNext < pptr();)
+		{
+			const auto numBytesWritten = WRITE_FD(m_fd, pNext,
+				static_cast<unsigned>(pptr() - pNext));
+			if (numBytesWritten < 0 && errno != EINTR)
+			{
+				throw IOError(format("Unable to write file '{0}':  {1}",
+					m_path.generic_string(), ::std::strerror(errno)));
+			}
+			else if (numBytesWritten > 0)
+			{
+				pNext += numBytesWritten;
+				RunStats::countBytesWritten(static_cast<size_t>(numBytesWritten));
+			}
+		}
+		setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+	}
+
+	OutputFileBuf(const OutputFileBuf&) = delete;
+	OutputFileBuf& operator=(const OutputFileBuf&) = delete;
+	OutputFileBuf(OutputFileBuf&&) = delete;
+	OutputFileBuf& operator=(OutputFileBuf&&) = delete;
+
+protected:
+	int_type overflow(int_type ch) override
+	{
+		flush();
+		if (!traits_type::eq_int_type(ch, traits_type::eof()))
+		{
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	int sync() override
+	{
+		flush();
+		return 0;
+	}
+
+private:
+	int								m_fd;
+	const Path&						m_path;
+	MemoryBudget::Reservation	m_bufferReservation;
+	::std::pmr::vector<char>		m_buffer;
+};
+
+// Runs the scanner made by makeScanner(ostream&) over the file p, writing
+// into a temporary file, and then replaces p with the temporary file if
+// isChanged(result) is true.  Returns the result of the scanner, or nothing
+// if p is binary, in which case it is neither copied nor changed.
+template<typename MakeScanner, typename IsChanged>
+static auto rewriteFile(const Path& p, ::std::pmr::memory_resource* pMemRsrc,
+	ResultsCache* pCache, MakeScanner makeScanner, IsChanged isChanged)
+{
+	using Result = decltype(makeScanner(::std::declval<ostream&>()).finish());
+
+	const auto key = (pCache == nullptr) ? optional<FileKey>{} : pCache->cacheKeyOf(p);
+	if (isCachedAsBinary(pCache, key))
+	{
+		return optional<Result>{};
+	}
+	else if (key)
+	{
+		if (auto cachedResult = pCache->find<Result>(*key); cachedResult && !isChanged(*cachedResult))
+		{
+			return cachedResult;
+		}
+	}
+
+	// The temporary file is claimed only once p is known not to be binary,
+	// so that none is made for a file that is left alone:
+	Path tempPath;
+	optional<PathDeleter> tempPathDeleter;
+	auto result = [&] ()
+		{
+			// Scoped so that both files are closed before the renames:
+			InputFile in(p);
+			BlockReader reader(in.fd(), pMemRsrc);
+			if (isBinaryFile(reader, pCache, key))
+			{
+				return optional<Result>{};
+			}
+			tempPath = getTempPath(p);
+			tempPathDeleter.emplace(tempPath);
+			OutputFileBuf outBuf(tempPath, pMemRsrc);
+			ostream out(&outBuf);
+			out.exceptions(ios_base::badbit);
+			auto scanner = makeScanner(out);
+			reader.feed(scanner);
+			optional<Result> scanResult{scanner.finish()};
+			outBuf.flush();
+			return scanResult;
+		}();
+
+	if (result && isChanged(*result))
+	{
+		replaceOriginalFileWithTemp(p, tempPath);
+	}
+	else if (result && key)
+	{
+		pCache->insert(*key, *result);
+	}
+	return result;
+}
+
+void replaceOriginalFileWithTemp(const Path& originalPath, const Path& tempPath)
+{
+	RunStats::PhaseTimer writingTimer(RunStats::Phase::writing);
+	Path savedOriginalPath(getTempPath(originalPath));
+	RunStats::countMetadataCalls(2);
+	try
+	{
+		rename(originalPath, savedOriginalPath);
+	}
+	catch (const ::std::filesystem::filesystem_error&)
+	{
+		PathDeleter unusedPathDeleter(savedOriginalPath);
+		throw;
+	}
+	rename(tempPath, originalPath);
+	PathDeleter savedOriginalPathDeleter(savedOriginalPath);
+}
+
+optional<EolTranslation> translateEols(const Path& p, EolType targetEolType, bool forceTranslation,
+	::std::pmr::memory_resource* pMemRsrc, ResultsCache* pCache)
+{
+	auto shouldReplace = [targetEolType, forceTranslation] (const EolCounts& counts)
+		{
+			const auto eolType = counts.eolType();
+			return eolType != EolType::INDETERMINATE
+				&& eolType != targetEolType
+				&& (eolType != EolType::MIXED || forceTranslation);
+		};
+	const auto counts = rewriteFile(p, pMemRsrc, pCache,
+		[targetEolType] (ostream& out) { return EolScanner(&out, targetEolType); },
+		shouldReplace);
+	return counts
+		? EolTranslation{*counts, shouldReplace(*counts)}
+		: optional<EolTranslation>{};
+}
+
+optional<WhiteSpaceCounts> stripTrailingWhiteSpace(const Path& p, ::std::pmr::memory_resource* pMemRsrc,
+	ResultsCache* pCache)
+{
+	return rewriteFile(p, pMemRsrc, pCache,
+		[pMemRsrc] (ostream& out) { return WhiteSpaceScanner(&out, pMemRsrc); },
+		[] (const WhiteSpaceCounts& counts) { return counts.m_numLinesAffected > 0; });
+}
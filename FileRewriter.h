@@ -0,0 +1,55 @@
+
+#if !defined(FILEREWRITER_H_INCLUDED)
+#define FILEREWRITER_H_INCLUDED
+
+#include "ResultsCache.h"
+#include "TextScanners.h"
+
+#include <filesystem>
+#include <memory_resource>
+#include <optional>
+
+// ===========================================================================
+//
+// The in-place modes of xeol and stripws.  Each function writes the
+// translated file next to the original and, if anything changed, replaces
+// the original with it.  Otherwise the temporary file is deleted.
+//
+// Given a ResultsCache, each function first looks the file up in the cache,
+// and leaves it unopened if the cached result shows that there is nothing
+// to do.  Results are recorded only for files that are left unmodified.
+//
+// Binary files (see sniffBinary()) are never modified.  Each function judges
+// the file by its first block before creating the temporary file, and
+// returns nothing for a binary file.
+//
+// ===========================================================================
+
+/// \brief Replaces originalPath with tempPath.  The original is renamed out of
+/// the way first, and is deleted only after tempPath has taken its place.
+void replaceOriginalFileWithTemp(const ::std::filesystem::path& originalPath,
+	const ::std::filesystem::path& tempPath);
+
+struct EolTranslation
+{
+	EolCounts	m_counts;
+	bool			m_isFileReplaced;
+};
+
+/// \brief Translates the ends of line in the file to targetEolType, which must
+/// be one of DOS, MACINTOSH, or UNIX.  Files with no ends of line or with the
+/// target type already are left alone, as are files with mixed ends of line
+/// (which may well be binary) unless forceTranslation is true.
+::std::optional<EolTranslation> translateEols(const ::std::filesystem::path& p, EolType targetEolType,
+	bool forceTranslation,
+	::std::pmr::memory_resource* pMemRsrc = ::std::pmr::get_default_resource(),
+	ResultsCache* pCache = nullptr);
+
+/// \brief Strips the white space from the ends of the lines in the file.  The
+/// file was modified if and only if the returned m_numLinesAffected is
+/// non-zero.
+::std::optional<WhiteSpaceCounts> stripTrailingWhiteSpace(const ::std::filesystem::path& p,
+	::std::pmr::memory_resource* pMemRsrc = ::std::pmr::get_default_resource(),
+	ResultsCache* pCache = nullptr);
+
+#endif // FILEREWRITER_H_INCLUDED
@@ -0,0 +1,309 @@
+
+#include "FileWatcher.h"
+#include "Cancellation.h"
+#include "Exceptions.h"
+#include "ScratchArena.h"
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <iostream>
+
+#if defined(__linux__)
+#	include <poll.h>
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif
+
+namespace fs = ::std::filesystem;
+
+using ::std::cerr;
+using ::std::endl;
+using ::std::format;
+
+// The longest that an event waits for its batch, in quiet periods, so that a
+// steady stream of writes cannot starve the files already pending:
+static constexpr int k_maxDelayInQuietPeriods = 10;
+
+// True if the two keys denote the same version of the same file.  The ctime
+// is left out because the rename that puts a rewritten file into place
+// changes it.
+static bool isSameVersion(const FileKey& lhs, const FileKey& rhs)
+{
+	return lhs.m_dev == rhs.m_dev
+		&& lhs.m_ino == rhs.m_ino
+		&& lhs.m_size == rhs.m_size
+		&& lhs.m_mtimeNs == rhs.m_mtimeNs;
+}
+
+void FileWatcher::process(const Path& p, const FileProcessor& processFile)
+{
+	const auto keyBefore = ResultsCache::keyOf(p);
+	processFile(p);
+	const auto keyAfter = ResultsCache::keyOf(p);
+	if (keyAfter && !(keyBefore && isSameVersion(*keyBefore, *keyAfter)))
+	{
+		m_ownWrites[p.generic_string()] = *keyAfter;
+	}
+}
+
+// Each remembered write suppresses exactly one batch, so the table holds
+// only the files rewritten since the last batch.
+bool FileWatcher::isOwnWrite(const Path& p)
+{
+	auto it = m_ownWrites.find(p.generic_string());
+	if (it == m_ownWrites.end())
+	{
+		return false;
+	}
+	const auto ownKey = it->second;
+	m_ownWrites.erase(it);
+	const auto key = ResultsCache::keyOf(p);
+	return key && isSameVersion(*key, ownKey);
+}
+
+void FileWatcher::processBatch(const PathSet& batch, const FileProcessor& processFile)
+{
+	for (const auto& p : batch)
+	{
+		CancellationToken::throwIfRequested();
+		if (!m_fileEnumerator.isMatch(p) || isOwnWrite(p))
+		{
+			continue;
+		}
+
+		ScratchArena::ResetGuard scratchArenaResetGuard;
+		try
+		{
+			process(p, processFile);
+		}
+		catch (const CanceledError&)
+		{
+			throw;
+		}
+		catch (const ::std::exception& ex)
+		{
+			cerr << format("Unable to process '{0}':  {1}", p.generic_string(), ex.what()) << endl;
+		}
+	}
+}
+
+#if defined(__linux__)
+
+static constexpr ::std::uint32_t k_fileEvents = IN_CLOSE_WRITE | IN_MOVED_TO;
+static constexpr ::std::uint32_t k_dirEvents = IN_CREATE | IN_MOVED_TO;
+
+FileWatcher::FileWatcher(const FileEnumerator& fileEnumerator,
+		Duration quietPeriod /* = k_defaultQuietPeriod */) :
+	m_fileEnumerator(fileEnumerator),
+	m_quietPeriod(quietPeriod),
+	m_fd(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+	m_watchedDirs(),
+	m_ownWrites()
+{
+	if (m_fd < 0)
+	{
+		throw IOError(format("Unable to initialize inotify:  {0}", ::std::strerror(errno)));
+	}
+	try
+	{
+		for (const auto& dir : m_fileEnumerator.rootDirs())
+		{
+			addWatches(dir, nullptr);
+		}
+	}
+	catch (...)
+	{
+		::close(m_fd);
+		throw;
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	::close(m_fd);	// Also removes all of the watches
+}
+
+void FileWatcher::addWatch(const Path& dir)
+{
+	const int wd = ::inotify_add_watch(m_fd, dir.c_str(), k_fileEvents | k_dirEvents | IN_ONLYDIR);
+	if (wd >= 0)
+	{
+		m_watchedDirs[wd] = dir;
+	}
+	else if (errno == ENOSPC)
+	{
+		throw IOError(format("Unable to watch '{0}':  Too many watches (see "
+			"/proc/sys/fs/inotify/max_user_watches)", dir.generic_string()));
+	}
+	else if (errno != ENOENT && errno != ENOTDIR)	// Already gone, so nothing to watch
+	{
+		throw IOError(format("Unable to watch '{0}':  {1}", dir.generic_string(),
+			::std::strerror(errno)));
+	}
+}
+
+// Watches dir, and also its sub-directories if the enumerator is recursive.
+// Given pPending, also adds the files already in them, which may have been
+// written before the watches were in place.
+void FileWatcher::addWatches(const Path& dir, PathSet* pPending)
+{
+	addWatch(dir);
+	if (!m_fileEnumerator.isRecursive())
+	{
+		return;
+	}
+
+	::std::error_code ec;
+	for (auto it = fs::recursive_directory_iterator(dir,
+			fs::directory_options::skip_permission_denied, ec);
+		!ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+	{
+		if (it->is_symlink(ec))
+		{
+			continue;
+		}
+		else if (it->is_directory(ec))
+		{
+			addWatch(it->path());
+		}
+		else if (pPending != nullptr)
+		{
+			pPending->insert(it->path());
+		}
+	}
+}
+
+// Drains the inotify queue into pending.  Returns true if anything was added.
+bool FileWatcher::readEvents(PathSet& pending)
+{
+	const auto initialSize = pending.size();
+	alignas(inotify_event) char buffer[16 * 1024];
+	for (;;)
+	{
+		const auto numBytes = ::read(m_fd, buffer, sizeof(buffer));
+		if (numBytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			break;
+		}
+		else if (numBytes < 0 && errno != EINTR)
+		{
+			throw IOError(format("Unable to read inotify events:  {0}", ::std::strerror(errno)));
+		}
+
+		for (char* pNext = buffer; numBytes > 0 && pNext < buffer + numBytes;)
+		{
+			const auto* pEvent = reinterpret_cast<const inotify_event*>(pNext);
+			pNext += sizeof(inotify_event) + pEvent->len;
+
+			if ((pEvent->mask & IN_Q_OVERFLOW) != 0)
+			{
+				// Events were lost, so fall back on a full pass:
+				m_fileEnumerator.enumerateFiles([&pending] (const Path& p) { pending.insert(p); });
+				continue;
+			}
+
+			auto it = m_watchedDirs.find(pEvent->wd);
+			if (it == m_watchedDirs.end())
+			{
+				continue;
+			}
+			else if ((pEvent->mask & IN_IGNORED) != 0)
+			{
+				m_watchedDirs.erase(it);	// The directory was deleted
+				continue;
+			}
+			else if (pEvent->len == 0)
+			{
+				continue;
+			}
+
+			const Path p = it->second / pEvent->name;
+			if ((pEvent->mask & IN_ISDIR) != 0)
+			{
+				if (m_fileEnumerator.isRecursive())
+				{
+					addWatches(p, &pending);
+				}
+			}
+			else if ((pEvent->mask & k_fileEvents) != 0)
+			{
+				pending.insert(p);
+			}
+		}
+	}
+	return pending.size() > initialSize;
+}
+
+void FileWatcher::watch(const FileProcessor& processFile)
+{
+	using Clock = ::std::chrono::steady_clock;
+
+	PathSet pending;
+	Clock::time_point firstEventTime;
+	Clock::time_point lastEventTime;
+	for (;;)
+	{
+		CancellationToken::throwIfRequested();
+
+		pollfd pollFd{m_fd, POLLIN, 0};
+		const int numReady = ::poll(&pollFd, 1, static_cast<int>(m_quietPeriod.count()));
+		if (numReady < 0 && errno != EINTR)
+		{
+			throw IOError(format("Unable to poll for inotify events:  {0}", ::std::strerror(errno)));
+		}
+
+		const auto now = Clock::now();
+		const bool wasIdle = pending.empty();
+		if (numReady > 0 && readEvents(pending))
+		{
+			firstEventTime = wasIdle ? now : firstEventTime;
+			lastEventTime = now;
+		}
+
+		if (!pending.empty() && (now - lastEventTime >= m_quietPeriod
+			|| now - firstEventTime >= k_maxDelayInQuietPeriods * m_quietPeriod))
+		{
+			PathSet batch;
+			batch.swap(pending);
+			processBatch(batch, processFile);
+		}
+	}
+}
+
+#else
+
+FileWatcher::FileWatcher(const FileEnumerator& fileEnumerator,
+		Duration quietPeriod /* = k_defaultQuietPeriod */) :
+	m_fileEnumerator(fileEnumerator),
+	m_quietPeriod(quietPeriod),
+	m_fd(-1),
+	m_watchedDirs(),
+	m_ownWrites()
+{
+	throw IOError("Watching for changes is supported only on Linux");
+}
+
+FileWatcher::~FileWatcher()
+{
+}
+
+void FileWatcher::addWatch(const Path& /* dir */)
+{
+}
+
+void FileWatcher::addWatches(const Path& /* dir */, PathSet* /* pPending */)
+{
+}
+
+bool FileWatcher::readEvents(PathSet& /* pending */)
+{
+	return false;
+}
+
+void FileWatcher::watch(const FileProcessor& /* processFile */)
+{
+	throw IOError("Watching for changes is supported only on Linux");
+}
+
+#endif
@@ -0,0 +1,77 @@
+
+#if !defined(FILEWATCHER_H_INCLUDED)
+#define FILEWATCHER_H_INCLUDED
+
+#include "FileEnumerator.h"
+#include "ResultsCache.h"
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+/// \brief FileWatcher keeps processing the files of a FileEnumerator as they
+/// change, for the --watch modes of xeol and stripws.  It is built on
+/// inotify, and so works only on Linux.
+///
+/// The watcher subscribes to the directories of the enumerator (and, if it is
+/// recursive, to all of their sub-directories, including new ones) for files
+/// that are closed after writing or renamed into place.  Bursts of events are
+/// debounced:  a batch is processed once no new event has arrived for the
+/// quiet period, or once the oldest event in it has waited for ten quiet
+/// periods.
+///
+/// Rewriting a file in place produces events of its own (see
+/// replaceOriginalFileWithTemp()).  The ones for the temporary names are
+/// dropped because those files are gone by the time the batch is processed.
+/// The one for the rewritten file is suppressed by remembering the identity
+/// (inode, size, and mtime) in which process() left the file.
+class FileWatcher
+{
+public:
+	using Path = ::std::filesystem::path;
+	using Duration = ::std::chrono::milliseconds;
+	using FileProcessor = ::std::function<void(const Path&)>;
+
+	static constexpr Duration k_defaultQuietPeriod{250};
+
+	/// \brief Starts watching.  Create the FileWatcher before the initial pass
+	/// over the files, so that no change made during that pass is missed.
+	/// Throws IOError if the watches cannot be set up.
+	explicit FileWatcher(const FileEnumerator& fileEnumerator,
+		Duration quietPeriod = k_defaultQuietPeriod);
+	~FileWatcher();
+
+	/// \brief Calls processFile(p), noting any change it makes to p so that
+	/// the resulting event is ignored.  Use this for the initial pass.
+	void process(const Path& p, const FileProcessor& processFile);
+
+	/// \brief Processes the changed files until cancellation is requested, at
+	/// which point it throws CanceledError.  An error in processing one file
+	/// is reported on cerr, and does not stop the watch.
+	[[noreturn]] void watch(const FileProcessor& processFile);
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	FileWatcher(FileWatcher&&) = delete;
+	FileWatcher& operator=(FileWatcher&&) = delete;
+
+private:
+	using PathSet = ::std::set<Path>;
+
+	void addWatches(const Path& dir, PathSet* pPending);
+	void addWatch(const Path& dir);
+	bool readEvents(PathSet& pending);
+	bool isOwnWrite(const Path& p);
+	void processBatch(const PathSet& batch, const FileProcessor& processFile);
+
+	const FileEnumerator&							m_fileEnumerator;
+	Duration												m_quietPeriod;
+	int													m_fd;
+	::std::unordered_map<int, Path>				m_watchedDirs;
+	::std::unordered_map< ::std::string, FileKey>	m_ownWrites;
+};
+
+#endif // FILEWATCHER_H_INCLUDED
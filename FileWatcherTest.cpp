@@ -0,0 +1,118 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "Cancellation.h"
+#include "Exceptions.h"
+#include "FileRewriter.h"
+#include "FileWatcher.h"
+#include "PathDeleter.h"
+
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = ::std::filesystem;
+
+using ::std::ifstream;
+using ::std::ios_base;
+using ::std::istreambuf_iterator;
+using ::std::lock_guard;
+using ::std::mutex;
+using ::std::ofstream;
+using ::std::string;
+using ::std::vector;
+
+#if defined(__linux__)
+
+BOOST_AUTO_TEST_SUITE(FileWatcherTestSuite)
+
+// Resets the process-wide cancellation flag even if a test case fails
+struct CancellationFixture
+{
+	CancellationFixture() { CancellationToken::reset(); }
+	~CancellationFixture() { CancellationToken::reset(); }
+};
+
+static const fs::path k_testDir{"FileWatcherTestDir"};
+
+static void writeFile(const fs::path& p, const string& contents)
+{
+	ofstream out(p, ios_base::out | ios_base::trunc | ios_base::binary);
+	out << contents;
+}
+
+static string readFile(const fs::path& p)
+{
+	ifstream in(p, ios_base::in | ios_base::binary);
+	return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+BOOST_FIXTURE_TEST_CASE(watchTest, CancellationFixture)
+{
+	using namespace ::std::chrono_literals;
+
+	PathDeleter testDirDeleter(k_testDir);
+	create_directories(k_testDir);
+	writeFile(k_testDir / "a.txt", "a\r\n");
+
+	FileEnumerator fe;
+	fe.insert(k_testDir / "*.txt");
+	FileWatcher watcher(fe, 20ms);
+
+	mutex processedMutex;
+	vector<string> processed;
+	auto numProcessed = [&] ()
+		{
+			lock_guard<mutex> lock(processedMutex);
+			return processed.size();
+		};
+	const FileWatcher::FileProcessor processFile = [&] (const fs::path& p)
+		{
+			translateEols(p, EolType::UNIX, false);
+			lock_guard<mutex> lock(processedMutex);
+			processed.push_back(p.filename().string());
+		};
+
+	// The initial pass rewrites a.txt, which must not trigger the watcher:
+	fe.enumerateFiles([&] (const fs::path& p) { watcher.process(p, processFile); });
+	BOOST_CHECK_EQUAL(1u, numProcessed());
+
+	::std::thread watchThread([&] ()
+		{
+			try
+			{
+				watcher.watch(processFile);
+			}
+			catch (const CanceledError&)
+			{
+			}
+		});
+
+	::std::this_thread::sleep_for(300ms);
+	writeFile(k_testDir / "b.txt", "b\r\n");
+	writeFile(k_testDir / "c.dat", "c\r\n");
+	for (int i = 0; i < 250 && numProcessed() < 2; ++i)
+	{
+		::std::this_thread::sleep_for(20ms);
+	}
+	::std::this_thread::sleep_for(300ms);	// Long enough for any spurious events
+
+	CancellationToken::requestCancellation();
+	watchThread.join();
+
+	BOOST_CHECK(processed == (vector<string>{"a.txt", "b.txt"}));
+	BOOST_CHECK_EQUAL("a\n", readFile(k_testDir / "a.txt"));
+	BOOST_CHECK_EQUAL("b\n", readFile(k_testDir / "b.txt"));
+	BOOST_CHECK_EQUAL("c\r\n", readFile(k_testDir / "c.dat"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
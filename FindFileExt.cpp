@@ -3,6 +3,7 @@
 #include "main.h"
 #include "Utils.h"
 
+#include <boost/range/algorithm/for_each.hpp>
 #include <format>
 #include <iostream>
 
@@ -15,7 +16,9 @@ using ::std::ostream;
 using ::std::string;
 using ::std::string_view;
 
-#if !defined(CMDLINEUTIL_TEST_MODE)
+static constexpr string_view k_recordFields[] = { "ext", "count" };
+
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
 int main(int argCount, const char*const*const argList)
 {
 	return commonMain<FindFileExt>(argCount, argList);
@@ -31,7 +34,7 @@ int FindFileExt::usage(ostream& out, string_view progName, const char* pMsg)
 		out << endl << pMsg << endl;
 	}
 	out << "\n"
-		"Usage:  " << progName << " [-c] [-r] [-w] <dir1> <dir2> ...\n"
+		"Usage:  " << progName << " [-c] [-r] [-w] [--format=<fmt>] <dir1> <dir2> ...\n"
 		"\n"
 		"Compiles a list of all file extensions found within the indicated\n"
 		"directories.\n"
@@ -43,6 +46,13 @@ int FindFileExt::usage(ostream& out, string_view progName, const char* pMsg)
 		"   -r Search in sub-directories recursively\n"
 		"\n"
 		"   -w Report extensions as wildcards\n"
+		"\n"
+		"   --format=<fmt> Write one record per extension in the format <fmt>,\n"
+		"      which is text (the default), jsonl (JSON Lines), or csv.  The\n"
+		"      fields are ext (including the dot, and empty for files without\n"
+		"      an extension) and count.  The options -c and -w do not apply.\n"
+		"\n"
+		<< FileEnumerator::k_filterOptionsUsage
 		<< endl;
 
 	return exitCode;
@@ -51,12 +61,14 @@ int FindFileExt::usage(ostream& out, string_view progName, const char* pMsg)
 FindFileExt::FindFileExt(const ::std::span<const char*const> args) :
 	m_includeCounts(false),
 	m_outputAsWildcards(false),
+	m_outputFormat(OutputFormat::text),
 	m_fileEnumerator(),
 	m_extToCountMap(),
 	m_noExtList()
 {
-	for (auto pArg : args)
+	for (size_t i = 0; i < args.size(); ++i)
 	{
+		auto pArg = args[i];
 		if (isIEqual(pArg, "-?") || isIEqual(pArg, "-h") || isIEqual(pArg, "-help"))
 		{
 			throw CmdLineError();
@@ -69,10 +81,18 @@ FindFileExt::FindFileExt(const ::std::span<const char*const> args) :
 		{
 			m_fileEnumerator.setRecursive();
 		}
+		else if (m_fileEnumerator.parseFilterOption(args, i))
+		{
+			// Nothing more to do
+		}
 		else if (isIEqual(pArg, "-w"))
 		{
 			m_outputAsWildcards = true;
 		}
+		else if (parseOutputFormatOption(pArg, m_outputFormat))
+		{
+			// Nothing more to do
+		}
 		else
 		{
 			auto p = Path{pArg};
@@ -99,6 +119,16 @@ int FindFileExt::run()
 {
 	countFiles();
 
+	if (m_outputFormat != OutputFormat::text)
+	{
+		RecordWriter writer(cout, m_outputFormat, k_recordFields);
+		for (const auto& extToCountMapping : m_extToCountMap)
+		{
+			writeRecord(extToCountMapping, writer);
+		}
+		return EXIT_SUCCESS;
+	}
+
 	cout << endl;
 	b::for_each(m_extToCountMap,
 		[this](const StrToCountMap::value_type& extToCountMapping)
@@ -119,11 +149,19 @@ void FindFileExt::countFiles()
 		result.first->second += 1;
 		if (ext.empty())
 		{
-			m_noExtList.push_back(file);
+			m_noExtList.insert(file);
 		}
 	});
 }
 
+void FindFileExt::writeRecord(const StrToCountMap::value_type& extToCountMapping,
+	RecordWriter& writer)
+{
+	writer.field(extToCountMapping.first)
+		.field(extToCountMapping.second);
+	writer.endRecord();
+}
+
 void FindFileExt::reportExtension(const StrToCountMap::value_type& extToCountMapping)
 {
 	const bool isNoExtensionEntry = extToCountMapping.first.empty();
@@ -142,9 +180,9 @@ void FindFileExt::reportExtension(const StrToCountMap::value_type& extToCountMap
 		cout << format("{0} -- {1}", ext, extToCountMapping.second) << endl;
 		if (isNoExtensionEntry)
 		{
-			for (const auto& noExtPath : m_noExtList)
+			for (size_t i = 0; i < m_noExtList.size(); ++i)
 			{
-				cout << format("   {0}", noExtPath.generic_string()) << endl;
+				cout << format("   {0}", m_noExtList.path(i).generic_string()) << endl;
 			}
 		}
 	}
@@ -2,6 +2,8 @@
 #define FINDFILEEXT_H_INCLUDED
 
 #include "FileEnumerator.h"
+#include "PathStore.h"
+#include "RecordWriter.h"
 #include "Utils.h"
 
 #include <filesystem>
@@ -10,7 +12,6 @@
 #include <span>
 #include <string>
 #include <string_view>
-#include <vector>
 
 class FindFileExt
 {
@@ -28,16 +29,18 @@ public:
 PRIVATE_EXCEPT_IN_TEST:
 	using Path = ::std::filesystem::path;
 	using StrToCountMap = ::std::map< ::std::string, size_t >;
-	using PathList = ::std::vector<Path>;
 
 	void countFiles();
 	void reportExtension(const StrToCountMap::value_type& extToCountMapping);
+	static void writeRecord(const StrToCountMap::value_type& extToCountMapping,
+		RecordWriter& writer);
 
 	bool				m_includeCounts;
 	bool				m_outputAsWildcards;
+	OutputFormat	m_outputFormat;
 	FileEnumerator	m_fileEnumerator;
 	StrToCountMap	m_extToCountMap;
-	PathList			m_noExtList;
+	PathStore		m_noExtList;
 };
 
 #endif // FINDFILEEXT_H_INCLUDED
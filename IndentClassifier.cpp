@@ -1,46 +1,31 @@
 
 #include "IndentClassifier.h"
+#include "BlockReader.h"
+#include "RecordWriter.h"
+#include "ResultsCache.h"
+#include "ScratchArena.h"
 #include "main.h"
 
 #include <format>
-#include <fstream>
 #include <iostream>
-#include <regex>
-#include <stdexcept>
+#include <memory>
+#include <optional>
 
 using ::std::cout;
 using ::std::endl;
-using ::std::format;
-using ::std::ifstream;
 using ::std::istream;
-using ::std::invalid_argument;
+using ::std::make_unique;
+using ::std::nullopt;
+using ::std::optional;
 using ::std::ostream;
-using ::std::regex;
 using ::std::string;
 using ::std::string_view;
+using ::std::unique_ptr;
 
-static const regex k_spacePattern{"^ +([^ \\t].*)?$"};
-static const regex k_tabPattern{"^\\t+([^ \\t].*)?$"};
-static const regex k_javadocTabPattern{"^\\t+ \\*.*$"};
-static const regex k_javadocLeftPattern{"^ \\*.*$"};
-static const regex k_indeterminatePattern{"^([^ \\t].*)?$"};
+static constexpr string_view k_recordFields[] = { "path", "indent", "space", "tab",
+	"javadocTab", "javadocLeft", "mixed", "indeterminate" };
 
-static string getNextLine(istream& in)
-{
-	string line;
-	getline(in, line);
-	return line;
-}
-
-size_t get(const LineTypeCounts& lineTypeCounts, IndentType indentType)
-{
-	auto it{lineTypeCounts.find(indentType)};
-	return (it == end(lineTypeCounts))
-		? 0
-		: it->second;
-}
-
-#if !defined(CMDLINEUTIL_TEST_MODE)
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
 int main(int argCount, const char*const*const argList)
 {
 	return commonMain<IndentClassifier>(argCount, argList);
@@ -56,47 +41,89 @@ int IndentClassifier::usage(ostream& out, string_view progName, const char* pMsg
 		out << endl << pMsg << endl;
 	}
 	out << "\n"
-		"Usage:  " << progName << " [-r] <file1> <file2> ...\n"
+		"Usage:  " << progName << " [-l|-q] [--format=<fmt>] [-r] <file1> <file2> ...\n"
 		"\n"
 		"Lists the indent type of each file, in the following format:\n"
 		"\n"
 		"   X <file-path>\n"
 		"\n"
 		"where X is:\n"
-		"   * '" << indicatorLetter(IndentType::space) << "' for spaces,\n"
-		"   * '" << indicatorLetter(IndentType::tab) << "' for tabs,\n"
-		"   * '" << indicatorLetter(IndentType::javadocTab) << "' for tabs and tab-indented JavaDoc comment lines,\n"
-		"   * '" << indicatorLetter(IndentType::mixed) << "' for mixed, or\n"
-		"   * '" << indicatorLetter(IndentType::indeterminate) << "' for indeterminate (meaning no lines are indented).\n"
+		"   * '" << indentLetter(IndentType::space) << "' for spaces,\n"
+		"   * '" << indentLetter(IndentType::tab) << "' for tabs,\n"
+		"   * '" << indentLetter(IndentType::javadocTab) << "' for tabs and tab-indented JavaDoc comment lines,\n"
+		"   * '" << indentLetter(IndentType::mixed) << "' for mixed, or\n"
+		"   * '" << indentLetter(IndentType::indeterminate) << "' for indeterminate (meaning no lines are indented).\n"
+		"\n"
+		"Binary files, as judged by their first block (by a NUL byte, too many\n"
+		"control characters, or the signature of a known binary format), are\n"
+		"skipped:  they are not listed or counted as offending.\n"
+		"\n"
+		"Files compressed with gzip or zstd are decompressed as they are read,\n"
+		"and their contents examined as for any other file.\n"
 		"\n"
 		"Options:\n"
 		"\n"
+		"   -l List only the names of the files with mixed indentation\n"
+		"\n"
+		"   -q Print nothing, and stop at the first file with mixed indentation\n"
+		"\n"
+		"   With -l or -q, each file is read only up to the point where its\n"
+		"   indentation is certain to be mixed, and the exit status is 0 if\n"
+		"   there is such a file, 1 if not, and 2 on an error.\n"
+		"\n"
+		"   --format=<fmt> Write one record per file in the format <fmt>, which\n"
+		"      is text (the default), jsonl (JSON Lines), or csv.  The fields are\n"
+		"      path, indent (space, tab, javadocTab, mixed, or indeterminate),\n"
+		"      and the number of lines of each type:  space, tab, javadocTab,\n"
+		"      javadocLeft, mixed, and indeterminate.\n"
+		"\n"
 		"   -r Search for files in sub-directories recursively\n"
+		"\n"
+		<< FileEnumerator::k_filterOptionsUsage
 		<< endl;
 
 	return exitCode;
 }
 
 IndentClassifier::IndentClassifier(const ::std::span<const char*const> args) :
+	m_reportMode(ReportMode::full),
+	m_outputFormat(OutputFormat::text),
 	m_fileEnumerator()
 {
-	for (auto pArg : args)
+	for (size_t i = 0; i < args.size(); ++i)
 	{
+		auto pArg = args[i];
 		if (isIEqual(pArg, "-?") || isIEqual(pArg, "-h") || isIEqual(pArg, "-help"))
 		{
 			throw CmdLineError();
 		}
+		else if (parseReportModeOption(pArg, m_reportMode))
+		{
+			// Nothing more to do
+		}
+		else if (parseOutputFormatOption(pArg, m_outputFormat))
+		{
+			// Nothing more to do
+		}
 		else if (isIEqual(pArg, "-r"))
 		{
 			m_fileEnumerator.setRecursive();
 		}
+		else if (m_fileEnumerator.parseFilterOption(args, i))
+		{
+			// Nothing more to do
+		}
 		else
 		{
 			m_fileEnumerator.insert(pArg);
 		}
 	}
 
-	if (m_fileEnumerator.numFileSpecs() <= 0)
+	if (m_reportMode != ReportMode::full && m_outputFormat != OutputFormat::text)
+	{
+		throw CmdLineError("The option '--format' is not allowed with '-l' or '-q'");
+	}
+	else if (m_fileEnumerator.numFileSpecs() <= 0)
 	{
 		throw CmdLineError("No files specified");
 	}
@@ -104,151 +131,108 @@ IndentClassifier::IndentClassifier(const ::std::span<const char*const> args) :
 
 int IndentClassifier::run() const
 {
-	m_fileEnumerator.enumerateFiles([this] (const Path& p) { processFile(p); });
+	if (m_reportMode != ReportMode::full)
+	{
+		return reportOffendingFiles(m_fileEnumerator, m_reportMode,
+			[] (const Path& p) { return isFileOffending(p); });
+	}
+	unique_ptr<RecordWriter> pWriter;
+	if (m_outputFormat != OutputFormat::text)
+	{
+		pWriter = make_unique<RecordWriter>(cout, m_outputFormat, k_recordFields);
+	}
+	m_fileEnumerator.enumerateFiles([this, &pWriter] (const Path& p) { processFile(p, pWriter.get()); });
 	return EXIT_SUCCESS;
 }
 
-void IndentClassifier::processFile(const Path& p) const
+void IndentClassifier::processFile(const Path& p, RecordWriter* pWriter /* = nullptr */) const
 {
-	const auto lineTypeCounts{scanFile(p)};
+	const auto optLineTypeCounts{scanFile(p)};
+	if (!optLineTypeCounts)
+	{
+		return;	// Binary files are skipped
+	}
+
+	const auto& lineTypeCounts = *optLineTypeCounts;
+	if (pWriter != nullptr)
+	{
+		writeRecord(p, lineTypeCounts, *pWriter);
+		return;
+	}
+
 	auto fileType{classifyFile(lineTypeCounts)};
 
-	char iLetter = indicatorLetter(fileType);
+	char iLetter = indentLetter(fileType);
 	string dispPath = displayPath(p);
-	cout << format("{0} {1}", iLetter, dispPath) << endl;
+	formatTo(cout, "{0} {1}", iLetter, dispPath);
+	cout << endl;
 	if (fileType == IndentType::mixed)
 	{
-		cout << format("     (Mixed:  {0} space, {1} tab, {2} JavaDoc tab, {3} mixed, {4} indeterminate)",
-				get(lineTypeCounts, IndentType::space),
-				get(lineTypeCounts, IndentType::tab),
-				get(lineTypeCounts, IndentType::javadocTab) + get(lineTypeCounts, IndentType::javadocLeft),
-				get(lineTypeCounts, IndentType::mixed),
-				get(lineTypeCounts, IndentType::indeterminate))
-			<< endl;
+		formatTo(cout, "     (Mixed:  {0} space, {1} tab, {2} JavaDoc tab, {3} mixed, {4} indeterminate)",
+			get(lineTypeCounts, IndentType::space),
+			get(lineTypeCounts, IndentType::tab),
+			get(lineTypeCounts, IndentType::javadocTab) + get(lineTypeCounts, IndentType::javadocLeft),
+			get(lineTypeCounts, IndentType::mixed),
+			get(lineTypeCounts, IndentType::indeterminate));
+		cout << endl;
 	}
 }
 
-LineTypeCounts IndentClassifier::scanFile(const Path& p)
+void IndentClassifier::writeRecord(const Path& p, const LineTypeCounts& lineTypeCounts,
+	RecordWriter& writer)
 {
-	bool isJavaFile = isIEqual(p.extension().generic_string().c_str(), ".java");
-	ifstream in(p, ::std::ios_base::in);
-	return scanFile(in, isJavaFile);
+	writer.field(p)
+		.field(indentTypeName(classifyFile(lineTypeCounts)))
+		.field(get(lineTypeCounts, IndentType::space))
+		.field(get(lineTypeCounts, IndentType::tab))
+		.field(get(lineTypeCounts, IndentType::javadocTab))
+		.field(get(lineTypeCounts, IndentType::javadocLeft))
+		.field(get(lineTypeCounts, IndentType::mixed))
+		.field(get(lineTypeCounts, IndentType::indeterminate));
+	writer.endRecord();
 }
 
-LineTypeCounts IndentClassifier::scanFile(istream& in, bool isJavaFile)
+bool IndentClassifier::isFileOffending(const Path& p)
 {
-	LineTypeCounts lineTypeCounts;
-
-	for (;;)
+	bool isJavaFile = isIEqual(p.extension().generic_string().c_str(), ".java");
+	auto pArena = ScratchArena::forThisThread().resource();
+	IndentScanner scanner(isJavaFile, pArena);
 	{
-		if (in.eof())
-		{
-			break;
-		}
-		else if (!in.good())
+		InputFile in(p);
+		BlockReader reader(in.fd(), pArena);
+		reader.decompressIfCompressed();
+		if (isBinaryFile(reader, nullptr, nullopt))
 		{
-			throw IOError("Error while reading input file");
+			return false;
 		}
-
-		auto line{getNextLine(in)};
-		auto lineType{classifyLine(line, isJavaFile)};
-		++lineTypeCounts[lineType];
-	}
-
-	return lineTypeCounts;
-}
-
-IndentType IndentClassifier::classifyLine(const string& line, bool isJavaFile)
-{
-	if (regex_match(line, k_indeterminatePattern))
-	{
-		return IndentType::indeterminate;
-	}
-	else if (isJavaFile && regex_match(line, k_javadocLeftPattern))
-	{
-		return IndentType::javadocLeft;
-	}
-	else if (regex_match(line, k_spacePattern))
-	{
-		return IndentType::space;
-	}
-	else if (regex_match(line, k_tabPattern))
-	{
-		return IndentType::tab;
-	}
-	else if (isJavaFile && regex_match(line, k_javadocTabPattern))
-	{
-		return IndentType::javadocTab;
-	}
-	else
-	{
-		return IndentType::mixed;
+		reader.feedUntil(scanner,
+			[&scanner] () { return classifyFile(scanner.lineTypeCounts()) == IndentType::mixed; });
 	}
+	return classifyFile(scanner.finish()) == IndentType::mixed;
 }
 
-IndentType IndentClassifier::classifyFile(const LineTypeCounts& lineTypeCounts)
+optional<LineTypeCounts> IndentClassifier::scanFile(const Path& p)
 {
-	if (get(lineTypeCounts, IndentType::space) > 0
-		&& get(lineTypeCounts, IndentType::tab)
-			+ get(lineTypeCounts, IndentType::javadocTab)
-			+ get(lineTypeCounts, IndentType::mixed) == 0)
-	{
-		return IndentType::space;
-	}
-	else if (get(lineTypeCounts, IndentType::tab) > 0
-		&& get(lineTypeCounts, IndentType::space)
-			+ get(lineTypeCounts, IndentType::javadocTab)
-			+ get(lineTypeCounts, IndentType::javadocLeft)
-			+ get(lineTypeCounts, IndentType::mixed) == 0)
-	{
-		return IndentType::tab;
-	}
-	else if (get(lineTypeCounts, IndentType::tab)
-			+ get(lineTypeCounts, IndentType::javadocTab) > 0
-		&& get(lineTypeCounts, IndentType::space)
-			+ get(lineTypeCounts, IndentType::mixed) == 0)
-	{
-		return IndentType::javadocTab;
-	}
-	else if (get(lineTypeCounts, IndentType::javadocLeft) > 0
-		&& get(lineTypeCounts, IndentType::space)
-			+ get(lineTypeCounts, IndentType::javadocTab)
-			+ get(lineTypeCounts, IndentType::mixed) == 0)
-	{
-		return IndentType::javadocTab;
-	}
-	else if (get(lineTypeCounts, IndentType::space)
-		+ get(lineTypeCounts, IndentType::tab)
-		+ get(lineTypeCounts, IndentType::javadocTab)
-		+ get(lineTypeCounts, IndentType::javadocLeft)
-		+ get(lineTypeCounts, IndentType::mixed) == 0)
-	{
-		return IndentType::indeterminate;
-	}
-	else
+	bool isJavaFile = isIEqual(p.extension().generic_string().c_str(), ".java");
+	auto pArena = ScratchArena::forThisThread().resource();
+	IndentScanner scanner(isJavaFile, pArena);
+	InputFile in(p);
+	BlockReader reader(in.fd(), pArena);
+	reader.decompressIfCompressed();
+	if (isBinaryFile(reader, nullptr, nullopt))
 	{
-		return IndentType::mixed;
+		return nullopt;
 	}
+	reader.feed(scanner);
+	return scanner.finish();
 }
 
-char IndentClassifier::indicatorLetter(IndentType fileType)
+LineTypeCounts IndentClassifier::scanFile(istream& in, bool isJavaFile)
 {
-	switch (fileType)
-	{
-	case IndentType::space:
-		return 'S';
-	case IndentType::tab:
-		return 'T';
-	case IndentType::javadocTab:
-		return 'J';
-	case IndentType::mixed:
-		return 'M';
-	case IndentType::indeterminate:
-		return 'I';
-	default:
-		throw invalid_argument("Unrecognized IndentType enumeration value in "
-			"IndentClassifier::indicatorLetter");
-	}
+	auto pArena = ScratchArena::forThisThread().resource();
+	IndentScanner scanner(isJavaFile, pArena);
+	BlockReader(in, pArena).feed(scanner);
+	return scanner.finish();
 }
 
 // This method breaks the portability of Boost.FileSystem, but it's portable enough.
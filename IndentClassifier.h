@@ -3,37 +3,23 @@
 #define INDENTCLASSIFIER_H_INCLUDED
 
 #include "FileEnumerator.h"
+#include "OffendingFiles.h"
+#include "RecordWriter.h"
+#include "TextScanners.h"
 #include "Utils.h"
 
 #include <filesystem>
 #include <iosfwd>
-#include <map>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
 
-/// \brief IndentType contains the enum constants that indicate the type of
-/// indentation for a line of text or a text file.
-enum class IndentType
-{
-	space, ///< Indents consist entirely of spaces
-	tab, ///< Indents consist entirely of tabs
-	javadocTab,	///< Indents are entirely tabs or tabs followed by exactly one space and asterisk, as in a tab-indented JavaDoc comment
-	javadocLeft,	///< Indented exactly one space followed by an asterisk, as in an unindented JavaDoc comment (single-line only)
-	mixed, ///< Indents are mixed tabs and spaces, or some are tabs and others are spaces
-	indeterminate ///< Refers to lines with no whitespace indent
-};
-
-using LineTypeCounts = ::std::map<IndentType, size_t>;
-
-/// \brief The same as lineTypeCounts.at(indentType) except that it returns zero
-/// if the map does not contain an entry for indentType.
-size_t get(const LineTypeCounts& lineTypeCounts, IndentType indentType);
-
 class IndentClassifier
 {
 public:
 	static int usage(::std::ostream& strm, ::std::string_view progName, const char* pMsg);
+	static constexpr bool k_hasReportModes = true;	///< -l and -q; see commonMain()
 
 	IndentClassifier(::std::span<const char*const> args);
 	int run() const;
@@ -46,17 +32,21 @@ public:
 PRIVATE_EXCEPT_IN_TEST:
 	using Path = ::std::filesystem::path;
 
-	void processFile(const Path& p) const;
-	static char indicatorLetter(IndentType iType);
+	void processFile(const Path& p, RecordWriter* pWriter = nullptr) const;
+	static void writeRecord(const Path& p, const LineTypeCounts& lineTypeCounts,
+		RecordWriter& writer);
+	static bool isFileOffending(const Path& p);
 	static ::std::string displayPath(const Path& p);
 
-	/// \brief Scans the input stream and counts lines of the various indent types.
-	static LineTypeCounts scanFile(const Path& p);
+	/// \brief Runs an IndentScanner over the input, which counts lines of the
+	/// various indent types.  The result lives in the thread's ScratchArena.
+	/// A binary file is not scanned, and yields nothing.
+	static ::std::optional<LineTypeCounts> scanFile(const Path& p);
 	static LineTypeCounts scanFile(::std::istream& in, bool isJavaFile);
-	static IndentType classifyLine(const ::std::string& line, bool isJavaFile);
-	static IndentType classifyFile(const LineTypeCounts& lineTypeCounts);
 
-	FileEnumerator m_fileEnumerator;
+	ReportMode		m_reportMode;
+	OutputFormat	m_outputFormat;
+	FileEnumerator	m_fileEnumerator;
 };
 
 #endif // INDENTCLASSIFIER_H_INCLUDED
@@ -40,6 +40,7 @@ static char const*const k_args01[] = { "indents", "-?" };
 static char const*const k_args02[] = { "indents", "-h" };
 static char const*const k_args03[] = { "indents", "-help" };
 static char const*const k_args04[] = { "indents", "-r" };
+static char const*const k_args05[] = { "indents", "-q", "-l", "IndentClassifier.cpp" };
 
 static CmdLineParseFailTestCase const k_testCases[] =
 {
@@ -48,6 +49,7 @@ static CmdLineParseFailTestCase const k_testCases[] =
 	{ k_args02, "^$" },
 	{ k_args03, "^$" },
 	{ k_args04, ".*no files.*" },
+	{ k_args05, ".*mutually exclusive.*" },
 };
 
 BOOST_DATA_TEST_CASE(cmdLineParseFailTest, utd::make(k_testCases), tc)
@@ -250,7 +252,7 @@ BOOST_DATA_TEST_CASE(scanFileTest, utd::make(k_testCases), tc)
 
 	istringstream in(input);
 	auto lineTypeCounts{IndentClassifier::scanFile(in, tc.m_isJavaFile)};
-	auto fileType{IndentClassifier::classifyFile(lineTypeCounts)};
+	auto fileType{classifyFile(lineTypeCounts)};
 	BOOST_CHECK_EQUAL(tc.m_numSpaceLines, get(lineTypeCounts, IndentType::space));
 	BOOST_CHECK_EQUAL(tc.m_numTabLines, get(lineTypeCounts, IndentType::tab));
 	BOOST_CHECK_EQUAL(tc.m_numMixedLines, get(lineTypeCounts, IndentType::mixed));
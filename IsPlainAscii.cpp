@@ -1,22 +1,29 @@
 
 #include "IsPlainAscii.h"
+#include "BlockReader.h"
+#include "ResultsCache.h"
+#include "ScratchArena.h"
+#include "SinceState.h"
 #include "main.h"
 
 #include <format>
-#include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
 
 using ::std::cout;
 using ::std::endl;
-using ::std::format;
-using ::std::ifstream;
 using ::std::istream;
-using ::std::ios_base;
+using ::std::make_unique;
+using ::std::nullopt;
+using ::std::optional;
 using ::std::ostream;
-using ::std::string;
 using ::std::string_view;
+using ::std::unique_ptr;
 
-#if !defined(CMDLINEUTIL_TEST_MODE)
+static constexpr string_view k_recordFields[] = { "path", "line", "column", "bytes", "text" };
+
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
 int main(int argCount, const char*const*const argList)
 {
 	return commonMain<IsPlainAscii>(argCount, argList);
@@ -32,38 +39,110 @@ int IsPlainAscii::usage(ostream& out, string_view progName, const char* pMsg)
 		out << endl << pMsg << endl;
 	}
 	out << "\n"
-		"Usage:  " << progName << " [-r] <file1> <file2> ...\n"
+		"Usage:  " << progName << " [-l|-q] [--format=<fmt>] [--cache <file>] [--since-state <file>] [-r] <file1> <file2> ...\n"
 		"\n"
 		"Finds characters in the given files that are not strict 7-bit ASCII.\n"
 		"\n"
+		"Binary files, as judged by their first block (by a NUL byte, too many\n"
+		"control characters, or the signature of a known binary format), are\n"
+		"skipped:  they are not listed or counted as offending.  The exception\n"
+		"is text in UTF-16 or UTF-32 that starts with a byte order mark, which\n"
+		"is examined a byte at a time like any other file, and so offends.\n"
+		"\n"
+		"Files compressed with gzip or zstd are decompressed as they are read,\n"
+		"and their contents examined as for any other file.\n"
+		"\n"
+		"A file of the form <archive>!<pattern>, where <archive> is a tar archive\n"
+		"(.tar, or compressed as .tar.gz, .tgz, .tar.zst, or .tzst), names the\n"
+		"members of the archive that match <pattern>, as though the archive were a\n"
+		"directory, e.g., 'release.tar!docs/*.txt'.  The archive is read once,\n"
+		"without extracting it, and each member is reported as\n"
+		"<archive>!<path-inside>.  Members are never cached or tracked by\n"
+		"--since-state.\n"
+		"\n"
 		"Options:\n"
 		"\n"
+		"   -l List only the names of the files that contain non-ASCII characters\n"
+		"\n"
+		"   -q Print nothing, and stop at the first file that contains non-ASCII\n"
+		"      characters\n"
+		"\n"
+		"   With -l or -q, each file is read only up to its first non-ASCII\n"
+		"   character, and the exit status is 0 if any file contains one, 1 if\n"
+		"   none does, and 2 on an error.\n"
+		"\n"
+		"   --format=<fmt> Write one record per run of non-ASCII characters in\n"
+		"      the format <fmt>, which is text (the default), jsonl (JSON Lines),\n"
+		"      or csv.  The fields are path, line, column (approximate), bytes\n"
+		"      (the run in hex), and text (the run as UTF-8, with U+FFFD in place\n"
+		"      of any byte that is not UTF-8).\n"
+		"\n"
+		"   --cache <file> Remember the result for each file in the cache file\n"
+		"      <file>, which xeol, stripws, and isplainascii can share, and skip\n"
+		"      the files that have not changed since their results were cached.\n"
+		"\n"
+		"   --since-state <file> Visit only the files that are new, renamed, or\n"
+		"      changed since the last run with the same state file <file>, and\n"
+		"      then update the state file.\n"
+		"\n"
 		"   -r Search for files in sub-directories recursively\n"
+		"\n"
+		<< FileEnumerator::k_filterOptionsUsage
 	<< endl;
 
 	return exitCode;
 }
 
 IsPlainAscii::IsPlainAscii(::std::span<const char*const> args) :
+	m_reportMode(ReportMode::full),
+	m_outputFormat(OutputFormat::text),
+	m_cachePath(),
+	m_sinceStatePath(),
 	m_fileEnumerator()
 {
-	for (auto pArg : args)
+	m_fileEnumerator.setArchiveAware();
+	for (size_t i = 0; i < args.size(); ++i)
 	{
+		auto pArg = args[i];
 		if (isIEqual(pArg, "-?") || isIEqual(pArg, "-h") || isIEqual(pArg, "-help"))
 		{
 			throw CmdLineError();
 		}
+		else if (parseReportModeOption(pArg, m_reportMode))
+		{
+			// Nothing more to do
+		}
+		else if (parseOutputFormatOption(pArg, m_outputFormat))
+		{
+			// Nothing more to do
+		}
+		else if (isIEqual(pArg, "--cache"))
+		{
+			m_cachePath = getOptionValue(args, i);
+		}
+		else if (isIEqual(pArg, "--since-state"))
+		{
+			m_sinceStatePath = getOptionValue(args, i);
+		}
 		else if (isIEqual(pArg, "-r"))
 		{
 			m_fileEnumerator.setRecursive();
 		}
+		else if (m_fileEnumerator.parseFilterOption(args, i))
+		{
+			// Nothing more to do
+		}
 		else
 		{
 			m_fileEnumerator.insert(pArg);
 		}
 	}
 
-	if (m_fileEnumerator.numFileSpecs() <= 0)
+	if (m_reportMode != ReportMode::full && m_outputFormat != OutputFormat::text)
+	{
+		throw CmdLineError("The option '--format' is not allowed with '-l' or '-q'");
+	}
+	else if (m_fileEnumerator.numFileSpecs() <= 0)
 	{
 		throw CmdLineError("No files specified");
 	}
@@ -71,89 +150,203 @@ IsPlainAscii::IsPlainAscii(::std::span<const char*const> args) :
 
 int IsPlainAscii::run() const
 {
-	m_fileEnumerator.enumerateFiles(&IsPlainAscii::scanFile);
+	unique_ptr<ResultsCache> pCache;
+	if (!m_cachePath.empty())
+	{
+		pCache = make_unique<ResultsCache>(m_cachePath);
+	}
+	unique_ptr<SinceState> pSinceState;
+	if (!m_sinceStatePath.empty())
+	{
+		pSinceState = make_unique<SinceState>(m_sinceStatePath);
+	}
+	if (m_reportMode != ReportMode::full)
+	{
+		return reportOffendingFiles(m_fileEnumerator, m_reportMode,
+			[&pCache] (const Path& p) { return isFileOffending(p, pCache.get()); },
+			[] (const Path&, BlockReader& reader) { return isArchiveMemberOffending(reader); },
+			pSinceState.get());
+	}
+	unique_ptr<RecordWriter> pWriter;
+	if (m_outputFormat != OutputFormat::text)
+	{
+		pWriter = make_unique<RecordWriter>(cout, m_outputFormat, k_recordFields);
+	}
+	m_fileEnumerator.enumerateFiles([&pCache, &pWriter] (const Path& p)
+		{ scanFile(p, pCache.get(), pWriter.get()); },
+		pSinceState.get());
+	m_fileEnumerator.enumerateArchiveMembers([&pWriter] (const Path& p, BlockReader& reader)
+		{ scanArchiveMember(p, reader, pWriter.get()); });
+	if (pSinceState)
+	{
+		pSinceState->save();
+	}
 	return EXIT_SUCCESS;
 }
 
-void IsPlainAscii::scanFile(const Path& filePath)
+// Text in UTF-16 or UTF-32 is binary to the other tools, but not to this
+// one:  its byte order mark alone makes it other than plain ASCII, so it is
+// scanned and reported.
+static bool isSkipped(BlockReader& reader, ResultsCache* pCache, const optional<FileKey>& key)
 {
-	ifstream in(filePath, ios_base::in | ios_base::binary);
-	scanFile2(filePath, in, cout);
-	in.close();
+	return !startsWithWideTextBom(reader.peek()) && isBinaryFile(reader, pCache, key);
 }
 
-void IsPlainAscii::scanFile2(const Path& filePath, istream& in, ostream& out)
+static bool isCachedAsSkipped(const ResultsCache* pCache, const optional<FileKey>& key)
 {
-	static const int k_mask = static_cast<int>((~0u) << 7);
-	string nonAsciiRun;
-	unsigned long lineNum = 1;
-	unsigned long colNum = 1;
-	unsigned long approxColNum = 0;
-	bool wasLastCharCR = false;
+	const auto evidence = key ? pCache->find<BinaryEvidence>(*key) : optional<BinaryEvidence>{};
+	return evidence && *evidence != BinaryEvidence::wideText;
+}
 
-	for (; true; ++colNum)
+void IsPlainAscii::scanFile(const Path& filePath, ResultsCache* pCache /* = nullptr */,
+	RecordWriter* pWriter /* = nullptr */)
+{
+	// Only a plain-ASCII verdict lets us skip the file, because the non-ASCII
+	// runs in any other file have to be reported all over again:
+	const auto key = (pCache == nullptr) ? optional<FileKey>{} : pCache->cacheKeyOf(filePath);
+	if (isCachedAsSkipped(pCache, key))
 	{
-		int ch = in.get();
-		if (in.eof())
-		{
-			reportNonAsciiRun(filePath, lineNum, approxColNum, nonAsciiRun, out);
-			break;
-		}
-		else if (!in.good())
-		{
-			throw IOError("Error while reading input file");
-		}
-		else if (ch == '\r')
-		{
-			reportNonAsciiRun(filePath, lineNum, approxColNum, nonAsciiRun, out);
-			colNum = 0;
-			wasLastCharCR = true;
-		}
-		else if (ch == '\n')
+		return;
+	}
+	else if (key)
+	{
+		if (auto verdict = pCache->find<AsciiVerdict>(*key); verdict && verdict->m_isPlainAscii)
 		{
-			reportNonAsciiRun(filePath, lineNum, approxColNum, nonAsciiRun, out);
-			++lineNum;
-			colNum = 0;
-			wasLastCharCR = false;
+			return;
 		}
-		else
+	}
+
+	InputFile in(filePath);
+	BlockReader reader(in.fd(), ScratchArena::forThisThread().resource());
+	reader.decompressIfCompressed();
+	if (isSkipped(reader, pCache, key))
+	{
+		return;
+	}
+	const bool isPlainAscii = scanForNonAscii(filePath, reader, pWriter);
+
+	if (key)
+	{
+		pCache->insert(*key, AsciiVerdict{isPlainAscii});
+	}
+}
+
+void IsPlainAscii::scanArchiveMember(const Path& filePath, BlockReader& reader,
+	RecordWriter* pWriter /* = nullptr */)
+{
+	reader.decompressIfCompressed();
+	if (!isSkipped(reader, nullptr, nullopt))
+	{
+		scanForNonAscii(filePath, reader, pWriter);
+	}
+}
+
+// Reports each run of non-ASCII characters, and returns true if there are none.
+bool IsPlainAscii::scanForNonAscii(const Path& filePath, BlockReader& reader, RecordWriter* pWriter)
+{
+	bool isPlainAscii = true;
+	NonAsciiScanner scanner([&filePath, &isPlainAscii, pWriter] (const NonAsciiRun& run)
 		{
-			if ((ch & k_mask) != 0)
+			isPlainAscii = false;
+			if (pWriter != nullptr)
 			{
-				if (nonAsciiRun.length() == 0)
-				{
-					approxColNum = colNum;
-				}
-				nonAsciiRun += string::traits_type::to_char_type(ch);
+				writeRecord(filePath, run, *pWriter);
 			}
 			else
 			{
-				reportNonAsciiRun(filePath, lineNum, approxColNum, nonAsciiRun, out);
+				reportNonAsciiRun(filePath, run, cout);
 			}
-			if (wasLastCharCR)
-			{
-				++lineNum;
-				wasLastCharCR = false;
-			}
-		}
-	}
+		}, ScratchArena::forThisThread().resource());
+	reader.feed(scanner);
+	scanner.finish();
+	return isPlainAscii;
 }
 
-void IsPlainAscii::reportNonAsciiRun(const Path& filePath, unsigned long lineNum,
-	unsigned long approxColNum, string& nonAsciiRun, ostream& out)
+bool IsPlainAscii::isFileOffending(const Path& filePath, ResultsCache* pCache /* = nullptr */)
 {
-	if (!nonAsciiRun.empty())
-	{
-		out << format("'{0}', line {1}, approx. column {2}:  \"{3}\" (\"",
-				filePath.generic_string(),
-				lineNum,
-				approxColNum,
-				nonAsciiRun);
-		for (auto ch : nonAsciiRun)
+	const auto key = (pCache == nullptr) ? optional<FileKey>{} : pCache->cacheKeyOf(filePath);
+	if (isCachedAsSkipped(pCache, key))
+	{
+		return false;
+	}
+	else if (key)
+	{
+		if (auto verdict = pCache->find<AsciiVerdict>(*key); verdict)
+		{
+			return !verdict->m_isPlainAscii;
+		}
+	}
+
+	bool isPlainAscii = true;
+	{
+		InputFile in(filePath);
+		BlockReader reader(in.fd(), ScratchArena::forThisThread().resource());
+		reader.decompressIfCompressed();
+		if (isSkipped(reader, pCache, key))
 		{
-			out << format("\\x{0:02x}", static_cast<unsigned int>(static_cast<unsigned char>(ch)));
+			return false;
 		}
-		out << "\")" << endl;
-		nonAsciiRun.clear();
+		isPlainAscii = !findsNonAscii(reader);
 	}
+
+	if (key)
+	{
+		pCache->insert(*key, AsciiVerdict{isPlainAscii});
+	}
+	return !isPlainAscii;
+}
+
+bool IsPlainAscii::isArchiveMemberOffending(BlockReader& reader)
+{
+	reader.decompressIfCompressed();
+	return !isSkipped(reader, nullptr, nullopt) && findsNonAscii(reader);
+}
+
+// Reads only as far as the first non-ASCII character.
+bool IsPlainAscii::findsNonAscii(BlockReader& reader)
+{
+	HighBitScanner scanner;
+	reader.feedUntil(scanner, [&scanner] () { return scanner.isFound(); });
+	return scanner.isFound();
+}
+
+void IsPlainAscii::scanFile2(const Path& filePath, istream& in, ostream& out)
+{
+	auto pArena = ScratchArena::forThisThread().resource();
+	NonAsciiScanner scanner([&filePath, &out] (const NonAsciiRun& run)
+		{ reportNonAsciiRun(filePath, run, out); }, pArena);
+	BlockReader(in, pArena).feed(scanner);
+	scanner.finish();
+}
+
+void IsPlainAscii::reportNonAsciiRun(const Path& filePath, const NonAsciiRun& run, ostream& out)
+{
+	formatTo(out, "'{0}', line {1}, approx. column {2}:  \"{3}\" (\"",
+		filePath.generic_string(),
+		run.m_lineNum,
+		run.m_approxColNum,
+		string_view{run.m_bytes});
+	for (auto ch : run.m_bytes)
+	{
+		formatTo(out, "\\x{0:02x}", static_cast<unsigned int>(static_cast<unsigned char>(ch)));
+	}
+	out << "\")" << endl;
+}
+
+void IsPlainAscii::writeRecord(const Path& filePath, const NonAsciiRun& run, RecordWriter& writer)
+{
+	auto pArena = ScratchArena::forThisThread().resource();
+	::std::pmr::string hexBytes(pArena);
+	hexBytes.reserve(2 * run.m_bytes.size());
+	for (auto ch : run.m_bytes)
+	{
+		appendHexByte(hexBytes, static_cast<unsigned char>(ch));
+	}
+
+	writer.field(filePath)
+		.field(run.m_lineNum)
+		.field(run.m_approxColNum)
+		.field(string_view{hexBytes})
+		.field(string_view{run.m_bytes});
+	writer.endRecord();
 }
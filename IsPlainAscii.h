@@ -3,6 +3,10 @@
 #define ISPLAINASCII_H_INCLUDED
 
 #include "FileEnumerator.h"
+#include "OffendingFiles.h"
+#include "RecordWriter.h"
+#include "ResultsCache.h"
+#include "TextScanners.h"
 #include "Utils.h"
 
 #include <filesystem>
@@ -15,6 +19,7 @@ class IsPlainAscii
 {
 public:
 	static int usage(::std::ostream& strm, ::std::string_view progName, const char* pMsg);
+	static constexpr bool k_hasReportModes = true;	///< -l and -q; see commonMain()
 
 	IsPlainAscii(::std::span<const char*const> args);
 	int run() const;
@@ -27,13 +32,26 @@ public:
 PRIVATE_EXCEPT_IN_TEST:
 	using Path = ::std::filesystem::path;
 
-	static void scanFile(const Path& filePath);
+	static void scanFile(const Path& filePath, ResultsCache* pCache = nullptr,
+		RecordWriter* pWriter = nullptr);
+	static void scanArchiveMember(const Path& filePath, BlockReader& reader,
+		RecordWriter* pWriter = nullptr);
+	static bool scanForNonAscii(const Path& filePath, BlockReader& reader, RecordWriter* pWriter);
+	static bool isFileOffending(const Path& filePath, ResultsCache* pCache = nullptr);
+	static bool isArchiveMemberOffending(BlockReader& reader);
+	static bool findsNonAscii(BlockReader& reader);
 	static void scanFile2(const Path& filePath, ::std::istream& in,
 		::std::ostream& out);
-	static void reportNonAsciiRun(const Path& filePath, unsigned long lineNum,
-		unsigned long approxColNum, ::std::string& nonAsciiRun, ::std::ostream& out);
+	static void writeRecord(const Path& filePath, const NonAsciiRun& run,
+		RecordWriter& writer);
+	static void reportNonAsciiRun(const Path& filePath, const NonAsciiRun& run,
+		::std::ostream& out);
 
-	FileEnumerator m_fileEnumerator;
+	ReportMode		m_reportMode;
+	OutputFormat	m_outputFormat;
+	Path				m_cachePath;
+	Path				m_sinceStatePath;
+	FileEnumerator	m_fileEnumerator;
 };
 
 #endif // ISPLAINASCII_H_INCLUDED
@@ -5,6 +5,7 @@
 
 #include "Exceptions.h"
 #include "IsPlainAscii.h"
+#include "PathDeleter.h"
 #include "TestUtil.h"
 #include "Utils.h"
 
@@ -12,6 +13,8 @@
 #include <boost/range/algorithm/sort.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
+#include <fstream>
+#include <iostream>
 #include <sstream>
 #include <vector>
 
@@ -35,6 +38,7 @@ static char const*const k_args00[] = { "isplainascii" };
 static char const*const k_args01[] = { "isplainascii", "-?" };
 static char const*const k_args02[] = { "isplainascii", "-h" };
 static char const*const k_args03[] = { "isplainascii", "-help" };
+static char const*const k_args04[] = { "isplainascii", "-l", "-q", "IsPlainAscii.cpp" };
 
 static CmdLineParseFailTestCase const k_testCases[] =
 {
@@ -42,6 +46,7 @@ static CmdLineParseFailTestCase const k_testCases[] =
 	{ k_args01, "^$" },
 	{ k_args02, "^$" },
 	{ k_args03, "^$" },
+	{ k_args04, ".*mutually exclusive.*" },
 };
 
 BOOST_DATA_TEST_CASE(cmdLineParseFailTest, utd::make(k_testCases), tc)
@@ -171,6 +176,42 @@ BOOST_DATA_TEST_CASE(scanFileTest, utd::make(k_testCases), tc)
 	BOOST_CHECK_EQUAL(tc.m_pOutput, out.str());
 }
 
+BOOST_AUTO_TEST_CASE(compressedFileTest)
+{
+	const fs::path filePath{"IsPlainAsciiTestInput.txt.zst"};
+	PathDeleter deleter(filePath);
+	std::ofstream(filePath, std::ios::binary)
+		<< compressText("Plain\nNot \xc3\xa9 plain\n", Compression::zstd);
+
+	std::ostringstream out;
+	{
+		CoutRedirect coutRedirect(out);
+		IsPlainAscii::scanFile(filePath);
+	}
+
+	BOOST_CHECK_EQUAL("'IsPlainAsciiTestInput.txt.zst', line 2, approx. column 5:  \"\xc3\xa9\" (\"\\xc3\\xa9\")\n",
+		out.str());
+	BOOST_CHECK(IsPlainAscii::isFileOffending(filePath));
+}
+
+BOOST_AUTO_TEST_CASE(utf16FileTest)
+{
+	// "Hi\n" in UTF-16LE, after its byte order mark:
+	const fs::path filePath{"IsPlainAsciiTestInput.utf16.txt"};
+	PathDeleter deleter(filePath);
+	std::ofstream(filePath, std::ios::binary) << std::string_view{"\xff\xfeH\0i\0\n\0", 8};
+
+	std::ostringstream out;
+	{
+		CoutRedirect coutRedirect(out);
+		IsPlainAscii::scanFile(filePath);
+	}
+
+	BOOST_CHECK_EQUAL("'IsPlainAsciiTestInput.utf16.txt', line 1, approx. column 1:  \"\xff\xfe\" (\"\\xff\\xfe\")\n",
+		out.str());
+	BOOST_CHECK(IsPlainAscii::isFileOffending(filePath));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE_END()
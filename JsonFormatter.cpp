@@ -0,0 +1,204 @@
+
+#include "JsonFormatter.h"
+#include "Exceptions.h"
+#include "MemoryBudget.h"
+
+#include <algorithm>
+#include <format>
+#include <ostream>
+#include <sstream>
+
+namespace json = ::boost::json;
+
+using ::std::error_code;
+using ::std::format;
+using ::std::ostream;
+using ::std::ostringstream;
+using ::std::string;
+
+// ============================ JsonBlockParser ============================
+
+JsonBlockParser::JsonBlockParser(json::storage_ptr sp /* = {} */) :
+	m_parser(sp),
+	m_lineNum(1)
+{
+	m_parser.reset(::std::move(sp));
+}
+
+void JsonBlockParser::scan(ByteSpan block)
+{
+	// Feed the parser one line at a time, so that a syntax error
+	// can be attributed to the line on which it was detected:
+	const char* pBegin = reinterpret_cast<const char*>(block.data());
+	const char* pEnd = pBegin + block.size();
+	for (const char* pLineStart = pBegin; pLineStart != pEnd;)
+	{
+		const char* pLineEnd = ::std::find(pLineStart, pEnd, '\n');
+		if (pLineEnd == pEnd)
+		{
+			write(pLineStart, pEnd);
+			break;
+		}
+		write(pLineStart, pLineEnd + 1);
+		++m_lineNum;
+		pLineStart = pLineEnd + 1;
+	}
+}
+
+JsonBlockParser::JValue JsonBlockParser::finish()
+{
+	m_parser.finish();
+	return m_parser.release();
+}
+
+void JsonBlockParser::write(const char* pBegin, const char* pEnd)
+{
+	error_code ec;
+	m_parser.write(pBegin, static_cast<size_t>(pEnd - pBegin), ec);
+	if (ec)
+	{
+		throw SyntaxError(format("Parse error near line {0}: {1} ({2}:{3})",
+			m_lineNum, ec.message(), ec.category().name(), ec.value()));
+	}
+}
+
+// ============================ Budgeted storage ============================
+
+// Boost.JSON has its own memory_resource base class, so this adapts a
+// MemoryBudget::Resource to it:
+class BudgetedJsonResource : public json::memory_resource
+{
+public:
+	BudgetedJsonResource() : m_resource("a JSON document") {}
+
+private:
+	void* do_allocate(size_t numBytes, size_t alignment) override
+		{ return m_resource.allocate(numBytes, alignment); }
+	void do_deallocate(void* p, size_t numBytes, size_t alignment) override
+		{ m_resource.deallocate(p, numBytes, alignment); }
+	bool do_is_equal(const json::memory_resource& rhs) const noexcept override
+		{ return this == &rhs; }
+
+	MemoryBudget::Resource m_resource;
+};
+
+json::storage_ptr makeBudgetedJsonStorage()
+{
+	return json::make_shared_resource<BudgetedJsonResource>();
+}
+
+// ============================ Free functions ============================
+
+json::value parseJson(ByteSpan bytes)
+{
+	JsonBlockParser parser;
+	parser.scan(bytes);
+	return parser.finish();
+}
+
+json::value parseJson(int fd)
+{
+	JsonBlockParser parser;
+	BlockReader(fd).feed(parser);
+	return parser.finish();
+}
+
+void writeJson(ostream& os, const json::value& jv, JsonStyle style, size_t indentLevel /* = 0 */)
+{
+	const bool minifyMode = (style == JsonStyle::minified);
+	switch(jv.kind())
+	{
+	case json::kind::object:
+	{
+		os << (minifyMode ? "{" : "{\n");
+		auto const& obj = jv.get_object();
+		if(!obj.empty())
+		{
+			for(auto it = obj.begin();;)
+			{
+				if (!minifyMode)
+				{
+					os << string(indentLevel + 1, '\t');
+				}
+				os << json::serialize(it->key()) << (minifyMode ? ":" : " : ");
+				writeJson(os, it->value(), style, indentLevel + 1);
+				if(++it == obj.end())
+				{
+					break;
+				}
+				os << (minifyMode ? "," : ",\n");
+			}
+		}
+		if (!minifyMode)
+		{
+			os << "\n" << string(indentLevel, '\t');
+		}
+		os << "}";
+		break;
+	}
+
+	case json::kind::array:
+	{
+		os << (minifyMode ? "[" : "[\n");
+		auto const& arr = jv.get_array();
+		if(!arr.empty())
+		{
+			for(auto it = arr.begin();;)
+			{
+				if (!minifyMode)
+				{
+					os << string(indentLevel + 1, '\t');
+				}
+				writeJson(os, *it, style, indentLevel + 1);
+				if(++it == arr.end())
+				{
+					break;
+				}
+				os << (minifyMode ? "," : ",\n");
+			}
+		}
+		if (!minifyMode)
+		{
+			os << "\n" << string(indentLevel, '\t');
+		}
+		os << "]";
+		break;
+	}
+
+	case json::kind::string:
+		os << json::serialize(jv.get_string());
+		break;
+
+	case json::kind::uint64:
+		os << jv.get_uint64();
+		break;
+
+	case json::kind::int64:
+		os << jv.get_int64();
+		break;
+
+	case json::kind::double_:
+		os << jv.get_double();
+		break;
+
+	case json::kind::bool_:
+		os << (jv.get_bool() ? "true" : "false");
+		break;
+
+	case json::kind::null:
+		os << "null";
+		break;
+	}
+
+	if(!minifyMode && indentLevel == 0)
+	{
+		os << "\n";
+	}
+}
+
+string reformatJson(ByteSpan bytes, JsonStyle style)
+{
+	ostringstream out;
+	writeJson(out, parseJson(bytes), style);
+	return out.str();
+}
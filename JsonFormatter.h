@@ -0,0 +1,53 @@
+
+#if !defined(JSONFORMATTER_H_INCLUDED)
+#define JSONFORMATTER_H_INCLUDED
+
+#include "BlockReader.h"
+
+#include <boost/json.hpp>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+
+/// \brief Parses JSON fed to it one block at a time.  On a syntax error,
+/// throws SyntaxError citing the line on which the error was detected.
+///
+/// The parser's working storage and the value it builds come from sp, e.g.,
+/// from makeBudgetedJsonStorage().
+class JsonBlockParser
+{
+public:
+	using JValue = ::boost::json::value;
+
+	explicit JsonBlockParser(::boost::json::storage_ptr sp = {});
+
+	void scan(ByteSpan block);
+	JValue finish();
+
+private:
+	void write(const char* pBegin, const char* pEnd);
+
+	::boost::json::stream_parser	m_parser;
+	unsigned long						m_lineNum;
+};
+
+/// \brief Returns storage that reserves each of its allocations against the
+/// MemoryBudget, so that a document too large for --max-memory makes the
+/// parser throw MemoryLimitError rather than exhaust the machine.  Values
+/// built in it keep it alive.
+::boost::json::storage_ptr makeBudgetedJsonStorage();
+
+enum class JsonStyle
+{
+	pretty,	///< One member or element per line, indented with tabs
+	minified	///< No insignificant white space at all
+};
+
+::boost::json::value parseJson(ByteSpan bytes);
+::boost::json::value parseJson(int fd);
+
+void writeJson(::std::ostream& out, const ::boost::json::value& jv, JsonStyle style,
+	::std::size_t indentLevel = 0);
+::std::string reformatJson(ByteSpan bytes, JsonStyle style);
+
+#endif // JSONFORMATTER_H_INCLUDED
@@ -1,24 +1,22 @@
 
 #include "JsonPP.h"
+#include "BlockReader.h"
+#include "JsonFormatter.h"
+#include "MemoryBudget.h"
 #include "main.h"
 
 #include <format>
 #include <fstream>
 #include <string>
 
-namespace json = ::boost::json;
-
 using ::std::endl;
-using ::std::error_code;
 using ::std::format;
-using ::std::ifstream;
 using ::std::ios_base;
 using ::std::ofstream;
 using ::std::ostream;
-using ::std::string;
 using ::std::string_view;
 
-#if !defined(CMDLINEUTIL_TEST_MODE)
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
 int main(int argCount, const char*const*const argList)
 {
 	return commonMain<JsonPP>(argCount, argList);
@@ -40,6 +38,11 @@ int JsonPP::usage(ostream& out, string_view progName, const char* pMsg)
 		"output is placed in a file whose name is the same as the original with\n"
 		"\"-pretty\" or \"-minified\" appended to it, unless the -ip option is given.\n"
 		"\n"
+		"Input compressed with gzip or zstd is decompressed as it is read, and\n"
+		"its output is written uncompressed, without the .gz or .zst extension,\n"
+		"e.g., data-pretty.json for data.json.gz.  Such input cannot be\n"
+		"pretty-printed in place.\n"
+		"\n"
 		"Options:\n"
 		"\n"
 		"   -ip Pretty-prints the file in-place, i.e., overwrites the\n"
@@ -48,6 +51,8 @@ int JsonPP::usage(ostream& out, string_view progName, const char* pMsg)
 		"   -m  Minifies the JSON, instead of pretty-printing it.\n"
 		"\n"
 		"   -r  Search for files in sub-directories recursively.\n"
+		"\n"
+		<< FileEnumerator::k_filterOptionsUsage
 		<< endl;
 
 	return exitCode;
@@ -58,8 +63,9 @@ JsonPP::JsonPP(::std::span<const char*const> args) :
 	m_minifyMode(false),
 	m_fileEnumerator()
 {
-	for (auto pArg : args)
+	for (size_t i = 0; i < args.size(); ++i)
 	{
+		auto pArg = args[i];
 		if (isIEqual(pArg, "-?") || isIEqual(pArg, "-h") || isIEqual(pArg, "-help"))
 		{
 			throw CmdLineError();
@@ -76,6 +82,10 @@ JsonPP::JsonPP(::std::span<const char*const> args) :
 		{
 			m_fileEnumerator.setRecursive();
 		}
+		else if (m_fileEnumerator.parseFilterOption(args, i))
+		{
+			// Nothing more to do
+		}
 		else
 		{
 			m_fileEnumerator.insert(pArg);
@@ -97,12 +107,18 @@ int JsonPP::run() const
 
 void JsonPP::translateFile(const Path& path, bool inPlaceMode, bool minifyMode)
 {
-	auto const jsonValue = JsonPP::parseFile(path);
-	const auto outputPath = getOutputPath(path, minifyMode);
+	auto compression = Compression::none;
+	auto const jsonValue = JsonPP::parseFile(path, &compression);
+	if (inPlaceMode && compression != Compression::none)
+	{
+		throw IOError(format("Unable to pretty-print the {0}-compressed file '{1}' in place",
+			compressionName(compression), path.generic_string()));
+	}
+	const auto outputPath = getOutputPath(path, minifyMode, compression);
 
 	{
 		ofstream out(outputPath, ios_base::out | ios_base::trunc);
-		prettyPrint(out, jsonValue, minifyMode);
+		writeJson(out, jsonValue, minifyMode ? JsonStyle::minified : JsonStyle::pretty);
 	}
 
 	if (inPlaceMode)
@@ -111,136 +127,38 @@ void JsonPP::translateFile(const Path& path, bool inPlaceMode, bool minifyMode)
 	}
 }
 
-JsonPP::JValue JsonPP::parseFile(const Path& path)
+JsonPP::JValue JsonPP::parseFile(const Path& path, Compression* pCompression /* = nullptr */)
 {
-	ifstream in(path, ios_base::in | ios_base::binary);
-	if (!in)
+	InputFile in(path);
+	BlockReader reader(in.fd());
+	const auto compression = reader.decompressIfCompressed();
+	if (pCompression != nullptr)
 	{
-		throw ::std::ios_base::failure(
-			format("Unable to open file '{0}'", path.generic_string()));
+		*pCompression = compression;
 	}
-
-	string line;
-	json::stream_parser p;
-	error_code ec;
-	unsigned long lineNum = 0;
-	do
+	// The whole document is built in memory, so under --max-memory it is
+	// built in storage that counts against the budget:
+	try
 	{
-		++lineNum;
-		getline(in, line);
-		line += '\n';	// ensure equivalent whitespace
-		p.write(line, ec);
-		if (ec)
-		{
-			throw SyntaxError(format("Parse error near line {0}: {1} ({2}:{3})",
-				lineNum, ec.message(), ec.category().name(), ec.value()));
-		}
-	} while(in && !in.eof());
-
-	if (!in && !in.eof())
+		JsonBlockParser parser(MemoryBudget::isLimited() ? makeBudgetedJsonStorage() : ::boost::json::storage_ptr{});
+		reader.feed(parser);
+		return parser.finish();
+	}
+	catch (const MemoryLimitError& ex)
 	{
-		throw ::std::ios_base::failure(
-			format("Unable to read file '{0}'", path.generic_string()));
+		throw MemoryLimitError(format("Unable to parse '{0}':  {1}", path.generic_string(), ex.what()));
 	}
-
-	p.finish();
-	return p.release();
 }
 
-void JsonPP::prettyPrint(ostream& os, JValue const& jv, bool minifyMode, size_t indentLevel /* = 0 */)
+JsonPP::Path JsonPP::getOutputPath(const Path& filePath, bool minifyMode,
+	Compression compression /* = Compression::none */)
 {
-	switch(jv.kind())
-	{
-	case json::kind::object:
-	{
-		os << (minifyMode ? "{" : "{\n");
-		auto const& obj = jv.get_object();
-		if(!obj.empty())
-		{
-			for(auto it = obj.begin();;)
-			{
-				if (!minifyMode)
-				{
-					os << string(indentLevel + 1, '\t');
-				}
-				os << json::serialize(it->key()) << (minifyMode ? ":" : " : ");
-				prettyPrint(os, it->value(), minifyMode, indentLevel + 1);
-				if(++it == obj.end())
-				{
-					break;
-				}
-				os << (minifyMode ? "," : ",\n");
-			}
-		}
-		if (!minifyMode)
-		{
-			os << "\n" << string(indentLevel, '\t');
-		}
-		os << "}";
-		break;
-	}
-
-	case json::kind::array:
+	// The output is not compressed, so it loses the compression extension:
+	if (compression != Compression::none
+		&& isIEqual(filePath.extension().string(), compressionExtension(compression)))
 	{
-		os << (minifyMode ? "[" : "[\n");
-		auto const& arr = jv.get_array();
-		if(!arr.empty())
-		{
-			for(auto it = arr.begin();;)
-			{
-				if (!minifyMode)
-				{
-					os << string(indentLevel + 1, '\t');
-				}
-				prettyPrint(os, *it, minifyMode, indentLevel + 1);
-				if(++it == arr.end())
-				{
-					break;
-				}
-				os << (minifyMode ? "," : ",\n");
-			}
-		}
-		if (!minifyMode)
-		{
-			os << "\n" << string(indentLevel, '\t');
-		}
-		os << "]";
-		break;
+		return getOutputPath(filePath.parent_path() / filePath.stem(), minifyMode);
 	}
-
-	case json::kind::string:
-		os << json::serialize(jv.get_string());
-		break;
-
-	case json::kind::uint64:
-		os << jv.get_uint64();
-		break;
-
-	case json::kind::int64:
-		os << jv.get_int64();
-		break;
-
-	case json::kind::double_:
-		os << jv.get_double();
-		break;
-
-	case json::kind::bool_:
-		os << (jv.get_bool() ? "true" : "false");
-		break;
-
-	case json::kind::null:
-		os << "null";
-		break;
-	}
-
-	if(!minifyMode && indentLevel == 0)
-	{
-		os << "\n";
-	}
-}
-
-JsonPP::Path JsonPP::getOutputPath(const Path& filePath, bool minifyMode)
-{
 	auto stem = filePath.stem().string();
 	auto ext = filePath.extension().string();
 	auto dir = filePath.parent_path();
@@ -2,6 +2,7 @@
 #if !defined(JSONPP_H_INCLUDED)
 #define JSONPP_H_INCLUDED
 
+#include "Decompressor.h"
 #include "FileEnumerator.h"
 #include "Utils.h"
 
@@ -29,9 +30,9 @@ PRIVATE_EXCEPT_IN_TEST:
 	using JValue = ::boost::json::value;
 
 	static void translateFile(const Path& path, bool inPlaceMode, bool minifyMode);
-	static JValue parseFile(const Path& path);
-	static void prettyPrint(::std::ostream& os, const JValue& jv, bool minifyMode, size_t indentLevel = 0);
-	static Path getOutputPath(const Path& filePath, bool minifyMode);
+	static JValue parseFile(const Path& path, Compression* pCompression = nullptr);
+	static Path getOutputPath(const Path& filePath, bool minifyMode,
+		Compression compression = Compression::none);
 
 	bool				m_inPlaceMode;
 	bool				m_minifyMode;
@@ -188,6 +188,22 @@ BOOST_DATA_TEST_CASE(translateFileTest, utd::make(k_testCases), tc)
 	BOOST_CHECK_EQUAL(expectedContent, actualContent);
 }
 
+BOOST_AUTO_TEST_CASE(compressedInputTest)
+{
+	const JsonPP::Path inputPath{"JsonPPTestInput-temp.json.gz"};
+	const JsonPP::Path outputPath{"JsonPPTestInput-temp-pretty.json"};
+	PathDeleter inputDeleter(inputPath);
+	PathDeleter outputDeleter(outputPath);
+	::std::ofstream(inputPath, ios_base::binary)
+		<< compressText(readFile("JsonPPTestInput.json"), Compression::gzip);
+
+	BOOST_CHECK_EQUAL(outputPath.generic_string(),
+		JsonPP::getOutputPath(inputPath, false, Compression::gzip).generic_string());
+	JsonPP::translateFile(inputPath, false, false);
+	BOOST_CHECK_EQUAL(readFile("JsonPPTestOutputPretty.json"), readFile(outputPath));
+	BOOST_CHECK_THROW(JsonPP::translateFile(inputPath, true, false), IOError);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
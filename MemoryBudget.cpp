@@ -0,0 +1,196 @@
+
+#include "MemoryBudget.h"
+#include "Exceptions.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <limits>
+
+using ::std::atomic;
+using ::std::format;
+using ::std::size_t;
+using ::std::string;
+using ::std::string_view;
+
+// A buffer is shrunk until it takes no more than this fraction of what is
+// left of the budget, to leave room for the rest of the process:
+static constexpr size_t k_bufferShareDivisor = 8;
+
+static atomic<size_t> g_numBytesReserved{0};
+static atomic<size_t> g_peakNumBytesReserved{0};
+
+void MemoryBudget::setLimit(size_t numBytes) noexcept
+{
+	s_limit.store(numBytes);
+}
+
+size_t MemoryBudget::numBytesReserved() noexcept
+{
+	return g_numBytesReserved.load(::std::memory_order_relaxed);
+}
+
+size_t MemoryBudget::peakNumBytesReserved() noexcept
+{
+	return g_peakNumBytesReserved.load(::std::memory_order_relaxed);
+}
+
+size_t MemoryBudget::numBytesAvailable() noexcept
+{
+	if (!isLimited())
+	{
+		return ::std::numeric_limits<size_t>::max();
+	}
+	const auto numBytesReserved = g_numBytesReserved.load(::std::memory_order_relaxed);
+	return (numBytesReserved < limit()) ? limit() - numBytesReserved : 0;
+}
+
+bool MemoryBudget::tryReserve(size_t numBytes) noexcept
+{
+	if (!isLimited())
+	{
+		return true;
+	}
+	auto numBytesReserved = g_numBytesReserved.load(::std::memory_order_relaxed);
+	size_t newNumBytesReserved = 0;
+	do
+	{
+		if (numBytesReserved > limit() || numBytes > limit() - numBytesReserved)
+		{
+			return false;
+		}
+		newNumBytesReserved = numBytesReserved + numBytes;
+	}
+	while (!g_numBytesReserved.compare_exchange_weak(numBytesReserved, newNumBytesReserved,
+		::std::memory_order_relaxed));
+
+	auto peak = g_peakNumBytesReserved.load(::std::memory_order_relaxed);
+	while (peak < newNumBytesReserved
+		&& !g_peakNumBytesReserved.compare_exchange_weak(peak, newNumBytesReserved,
+			::std::memory_order_relaxed))
+	{
+	}
+	return true;
+}
+
+void MemoryBudget::reserve(size_t numBytes, string_view purpose)
+{
+	if (!tryReserve(numBytes))
+	{
+		throw MemoryLimitError(format(
+			"Out of memory:  {0} needs {1} more, but only {2} of the --max-memory limit of {3} is left",
+			purpose, formatSize(numBytes), formatSize(numBytesAvailable()), formatSize(limit())));
+	}
+}
+
+void MemoryBudget::release(size_t numBytes) noexcept
+{
+	if (isLimited())
+	{
+		g_numBytesReserved.fetch_sub(numBytes, ::std::memory_order_relaxed);
+	}
+}
+
+unsigned MemoryBudget::fitWorkerCount(unsigned preferredCount, size_t numBytesPerWorker) noexcept
+{
+	if (!isLimited() || numBytesPerWorker == 0)
+	{
+		return preferredCount;
+	}
+	const auto numWorkers = numBytesAvailable() / numBytesPerWorker;
+	return static_cast<unsigned>(::std::clamp<size_t>(numWorkers, 1, ::std::max(preferredCount, 1u)));
+}
+
+size_t MemoryBudget::parseSize(string_view value)
+{
+	const auto numBytes = parseByteSize(value);
+	if (numBytes == 0 || numBytes > ::std::numeric_limits<size_t>::max())
+	{
+		throw CmdLineError(format("Invalid memory size '{0}'", value));
+	}
+	return static_cast<size_t>(numBytes);
+}
+
+string MemoryBudget::formatSize(size_t numBytes)
+{
+	static constexpr ::std::array<string_view, 5> k_units = { "bytes", "KiB", "MiB", "GiB", "TiB" };
+
+	size_t unitIndex = 0;
+	for (; unitIndex + 1 < k_units.size() && numBytes >= (size_t{1} << (10 * (unitIndex + 1))); ++unitIndex)
+	{
+	}
+	if (unitIndex == 0)
+	{
+		return format("{0} bytes", numBytes);
+	}
+	const auto unit = static_cast<double>(size_t{1} << (10 * unitIndex));
+	return format("{0:.1f} {1}", static_cast<double>(numBytes) / unit, k_units[unitIndex]);
+}
+
+// ============================ Reservation ============================
+
+MemoryBudget::Reservation::Reservation(size_t numBytes, string_view purpose) :
+	m_numBytes(numBytes)
+{
+	reserve(numBytes, purpose);
+}
+
+MemoryBudget::Reservation MemoryBudget::Reservation::forBuffer(size_t preferredSize,
+	size_t minSize, string_view purpose)
+{
+	auto size = preferredSize;
+	if (isLimited())
+	{
+		const auto share = numBytesAvailable() / k_bufferShareDivisor;
+		while (size / 2 >= minSize && size > share)
+		{
+			size /= 2;
+		}
+		// Another thread may have taken what was left in the meantime:
+		while (!tryReserve(size))
+		{
+			if (size / 2 < minSize)
+			{
+				reserve(minSize, purpose);	// Throws with the whole story
+				size = minSize;
+				break;
+			}
+			size /= 2;
+		}
+	}
+	return Reservation{size, Reserved{}};
+}
+
+MemoryBudget::Reservation& MemoryBudget::Reservation::operator=(Reservation&& rhs) noexcept
+{
+	if (this != &rhs)
+	{
+		release(m_numBytes);
+		m_numBytes = rhs.m_numBytes;
+		rhs.m_numBytes = 0;
+	}
+	return *this;
+}
+
+// ============================ Resource ============================
+
+void* MemoryBudget::Resource::do_allocate(size_t numBytes, size_t alignment)
+{
+	reserve(numBytes, m_purpose);
+	try
+	{
+		return m_pUpstream->allocate(numBytes, alignment);
+	}
+	catch (...)
+	{
+		release(numBytes);
+		throw;
+	}
+}
+
+void MemoryBudget::Resource::do_deallocate(void* p, size_t numBytes, size_t alignment)
+{
+	m_pUpstream->deallocate(p, numBytes, alignment);
+	release(numBytes);
+}
@@ -0,0 +1,116 @@
+
+#if !defined(MEMORYBUDGET_H_INCLUDED)
+#define MEMORYBUDGET_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+/// \brief MemoryBudget is the process-wide memory budget set by the
+/// --max-memory option of every tool, so that several tools run side by
+/// side on a shared machine can be kept clear of the out-of-memory killer.
+///
+/// The big consumers reserve against it:  the block buffers of the I/O layer
+/// (which shrink when the budget is tight), the worker pools (which start
+/// fewer threads), and the documents built by JsonPP.  A reservation that
+/// cannot be met throws MemoryLimitError.
+///
+/// Until setLimit() is called the budget is unlimited, every reservation
+/// succeeds at the cost of a single relaxed load, and nothing is counted.
+/// All of the members are safe to call from any thread.
+class MemoryBudget
+{
+public:
+	/// \brief Sets the limit in bytes.  Zero means unlimited.  Call this
+	/// before anything is reserved, as commonMain() does.
+	static void setLimit(::std::size_t numBytes) noexcept;
+	static ::std::size_t limit() noexcept
+		{ return s_limit.load(::std::memory_order_relaxed); }
+	static bool isLimited() noexcept
+		{ return limit() != 0; }
+
+	static ::std::size_t numBytesReserved() noexcept;
+	static ::std::size_t peakNumBytesReserved() noexcept;
+	/// \brief Returns the part of the limit not yet reserved, or the largest
+	/// size_t if there is no limit.
+	static ::std::size_t numBytesAvailable() noexcept;
+
+	/// \brief Reserves numBytes if they fit within the limit, and returns
+	/// whether they did.
+	static bool tryReserve(::std::size_t numBytes) noexcept;
+	/// \brief Reserves numBytes, throwing MemoryLimitError (which names the
+	/// purpose) if they do not fit within the limit.
+	static void reserve(::std::size_t numBytes, ::std::string_view purpose);
+	static void release(::std::size_t numBytes) noexcept;
+
+	/// \brief Returns the number of workers, at most preferredCount and at
+	/// least one, that fit in what is left of the budget.
+	static unsigned fitWorkerCount(unsigned preferredCount,
+		::std::size_t numBytesPerWorker) noexcept;
+
+	/// \brief Parses a size such as "512M", as parseByteSize() does.  Throws
+	/// CmdLineError if the value is malformed or zero.
+	static ::std::size_t parseSize(::std::string_view value);
+	static ::std::string formatSize(::std::size_t numBytes);
+
+	/// \brief Holds reserved bytes until it goes out of scope.
+	class Reservation
+	{
+	public:
+		Reservation() noexcept : m_numBytes(0) {}
+		Reservation(::std::size_t numBytes, ::std::string_view purpose);
+		~Reservation()
+			{ release(m_numBytes); }
+
+		/// \brief Reserves a buffer of preferredSize bytes, or, when the budget
+		/// is tight, of the largest size halved down from it that leaves room
+		/// for others, but never less than minSize.  Throws MemoryLimitError
+		/// if even minSize does not fit.
+		static Reservation forBuffer(::std::size_t preferredSize, ::std::size_t minSize,
+			::std::string_view purpose);
+
+		::std::size_t size() const noexcept
+			{ return m_numBytes; }
+
+		Reservation(Reservation&& rhs) noexcept : m_numBytes(rhs.m_numBytes)
+			{ rhs.m_numBytes = 0; }
+		Reservation& operator=(Reservation&& rhs) noexcept;
+		Reservation(const Reservation&) = delete;
+		Reservation& operator=(const Reservation&) = delete;
+
+	private:
+		struct Reserved {};
+		Reservation(::std::size_t numBytes, Reserved) noexcept : m_numBytes(numBytes) {}
+
+		::std::size_t m_numBytes;
+	};
+
+	/// \brief A memory resource that reserves each of its allocations against
+	/// the budget before passing it upstream, for containers that grow with
+	/// their input.
+	class Resource : public ::std::pmr::memory_resource
+	{
+	public:
+		explicit Resource(::std::string_view purpose,
+			::std::pmr::memory_resource* pUpstream = ::std::pmr::new_delete_resource()) :
+			m_purpose(purpose), m_pUpstream(pUpstream) {}
+
+	private:
+		void* do_allocate(::std::size_t numBytes, ::std::size_t alignment) override;
+		void do_deallocate(void* p, ::std::size_t numBytes, ::std::size_t alignment) override;
+		bool do_is_equal(const ::std::pmr::memory_resource& rhs) const noexcept override
+			{ return this == &rhs; }
+
+		::std::string							m_purpose;
+		::std::pmr::memory_resource*		m_pUpstream;
+	};
+
+	MemoryBudget() = delete;
+
+private:
+	static inline ::std::atomic< ::std::size_t> s_limit{0};
+};
+
+#endif // MEMORYBUDGET_H_INCLUDED
@@ -0,0 +1,154 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "BlockReader.h"
+#include "Exceptions.h"
+#include "MemoryBudget.h"
+
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using ::std::istringstream;
+using ::std::size_t;
+using ::std::string;
+
+static constexpr size_t k_kiB = 1024;
+static constexpr size_t k_miB = 1024 * k_kiB;
+
+// Sets a limit for the duration of a test, and lifts it afterward so that
+// the other tests run unlimited:
+struct BudgetFixture
+{
+	explicit BudgetFixture(size_t limit)
+		{ MemoryBudget::setLimit(limit); }
+	~BudgetFixture()
+		{ MemoryBudget::setLimit(0); }
+};
+
+BOOST_AUTO_TEST_SUITE(MemoryBudgetTestSuite)
+
+BOOST_AUTO_TEST_CASE(parseSizeTest)
+{
+	BOOST_CHECK_EQUAL(100u, MemoryBudget::parseSize("100"));
+	BOOST_CHECK_EQUAL(64 * k_kiB, MemoryBudget::parseSize("64K"));
+	BOOST_CHECK_EQUAL(64 * k_kiB, MemoryBudget::parseSize("64KiB"));
+	BOOST_CHECK_EQUAL(512 * k_miB, MemoryBudget::parseSize("512m"));
+	BOOST_CHECK_EQUAL(512 * k_miB, MemoryBudget::parseSize("512MB"));
+	BOOST_CHECK_EQUAL(2 * 1024 * k_miB, MemoryBudget::parseSize("2G"));
+	BOOST_CHECK_EQUAL(3u, MemoryBudget::parseSize("3B"));
+
+	BOOST_CHECK_THROW(MemoryBudget::parseSize(""), CmdLineError);
+	BOOST_CHECK_THROW(MemoryBudget::parseSize("M"), CmdLineError);
+	BOOST_CHECK_THROW(MemoryBudget::parseSize("0"), CmdLineError);
+	BOOST_CHECK_THROW(MemoryBudget::parseSize("-1M"), CmdLineError);
+	BOOST_CHECK_THROW(MemoryBudget::parseSize("12X"), CmdLineError);
+	BOOST_CHECK_THROW(MemoryBudget::parseSize("12MM"), CmdLineError);
+	BOOST_CHECK_THROW(MemoryBudget::parseSize("99999999999999999999"), CmdLineError);
+
+	BOOST_CHECK_EQUAL("512 bytes", MemoryBudget::formatSize(512));
+	BOOST_CHECK_EQUAL("1.5 MiB", MemoryBudget::formatSize(3 * k_miB / 2));
+}
+
+BOOST_AUTO_TEST_CASE(unlimitedTest)
+{
+	BOOST_REQUIRE(!MemoryBudget::isLimited());
+	MemoryBudget::Reservation reservation(1024 * 1024 * k_miB, "a test");
+	BOOST_CHECK(MemoryBudget::tryReserve(1024 * 1024 * k_miB));
+	BOOST_CHECK_EQUAL(0u, MemoryBudget::numBytesReserved());
+	BOOST_CHECK_EQUAL(BlockReader::k_blockSize, MemoryBudget::Reservation::forBuffer(
+		BlockReader::k_blockSize, BlockReader::k_minBlockSize, "a test").size());
+	BOOST_CHECK_EQUAL(16u, MemoryBudget::fitWorkerCount(16, 1024 * k_miB));
+}
+
+BOOST_AUTO_TEST_CASE(reservationTest)
+{
+	BudgetFixture fixture(k_miB);
+	{
+		MemoryBudget::Reservation reservation(600 * k_kiB, "a test");
+		BOOST_CHECK_EQUAL(600 * k_kiB, MemoryBudget::numBytesReserved());
+		BOOST_CHECK(!MemoryBudget::tryReserve(500 * k_kiB));
+		BOOST_CHECK_THROW(MemoryBudget::Reservation(500 * k_kiB, "a test"), MemoryLimitError);
+
+		MemoryBudget::Reservation moved(::std::move(reservation));
+		BOOST_CHECK_EQUAL(0u, reservation.size());
+		BOOST_CHECK_EQUAL(600 * k_kiB, MemoryBudget::numBytesReserved());
+	}
+	BOOST_CHECK_EQUAL(0u, MemoryBudget::numBytesReserved());
+	BOOST_CHECK_GE(MemoryBudget::peakNumBytesReserved(), 600 * k_kiB);
+	BOOST_CHECK(MemoryBudget::tryReserve(k_miB));
+	MemoryBudget::release(k_miB);
+}
+
+BOOST_AUTO_TEST_CASE(buffersShrinkTest)
+{
+	BudgetFixture fixture(256 * k_kiB);
+	{
+		// An eighth of what is left:
+		const auto buffer = MemoryBudget::Reservation::forBuffer(
+			BlockReader::k_blockSize, BlockReader::k_minBlockSize, "a test");
+		BOOST_CHECK_EQUAL(32 * k_kiB, buffer.size());
+
+		// When little is left, down to the minimum, and then no further:
+		MemoryBudget::Reservation bulk(MemoryBudget::numBytesAvailable() - 6 * k_kiB, "a test");
+		const auto smallBuffer = MemoryBudget::Reservation::forBuffer(
+			BlockReader::k_blockSize, BlockReader::k_minBlockSize, "a test");
+		BOOST_CHECK_EQUAL(BlockReader::k_minBlockSize, smallBuffer.size());
+		BOOST_CHECK_THROW(MemoryBudget::Reservation::forBuffer(
+			BlockReader::k_blockSize, BlockReader::k_minBlockSize, "a test"), MemoryLimitError);
+	}
+	BOOST_CHECK_EQUAL(0u, MemoryBudget::numBytesReserved());
+}
+
+BOOST_AUTO_TEST_CASE(blockReaderTest)
+{
+	BudgetFixture fixture(128 * k_kiB);
+	const string input(100 * k_kiB, 'x');
+	istringstream in(input);
+	BlockReader reader(in);
+	BOOST_CHECK_EQUAL(16 * k_kiB, MemoryBudget::numBytesReserved());
+
+	size_t numBytes = 0;
+	reader.forEachBlock([&numBytes] (ByteSpan block)
+		{
+			BOOST_CHECK_LE(block.size(), 16 * k_kiB);
+			numBytes += block.size();
+		});
+	BOOST_CHECK_EQUAL(input.size(), numBytes);
+}
+
+BOOST_AUTO_TEST_CASE(workerCountTest)
+{
+	BudgetFixture fixture(k_miB);
+	BOOST_CHECK_EQUAL(4u, MemoryBudget::fitWorkerCount(16, 256 * k_kiB));
+	BOOST_CHECK_EQUAL(2u, MemoryBudget::fitWorkerCount(2, 256 * k_kiB));
+	BOOST_CHECK_EQUAL(1u, MemoryBudget::fitWorkerCount(16, 2 * k_miB));
+}
+
+BOOST_AUTO_TEST_CASE(resourceTest)
+{
+	BudgetFixture fixture(k_miB);
+	MemoryBudget::Resource resource("a test vector");
+	{
+		::std::pmr::vector<char> small(100 * k_kiB, 'x', &resource);
+		BOOST_CHECK_EQUAL(100 * k_kiB, MemoryBudget::numBytesReserved());
+		try
+		{
+			::std::pmr::vector<char> big(2 * k_miB, 'x', &resource);
+			BOOST_ERROR("Expected MemoryLimitError");
+		}
+		catch (const MemoryLimitError& ex)
+		{
+			BOOST_CHECK_NE(string::npos, string{ex.what()}.find("a test vector"));
+			BOOST_CHECK_NE(string::npos, string{ex.what()}.find("--max-memory"));
+		}
+	}
+	BOOST_CHECK_EQUAL(0u, MemoryBudget::numBytesReserved());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+
+#include "MultiCall.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#	include "Audit.h"
+#	include "FindFileExt.h"
+#	include "IndentClassifier.h"
+#	include "IsPlainAscii.h"
+#	include "JsonPP.h"
+#	include "Random.h"
+#	include "RegExMove.h"
+#	include "ScanServer.h"
+#	include "StripWS.h"
+#	include "Xeol.h"
+#	include "XformCvsStatus.h"
+#	include "main.h"
+#endif
+
+using ::std::cout;
+using ::std::endl;
+using ::std::format;
+using ::std::ostream;
+using ::std::string;
+using ::std::string_view;
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+// Only pointers to function templates, so that nothing here costs anything at
+// start-up.  Each tool builds its own state when (and only if) it runs.
+static constexpr Applet k_applets[] =
+{
+	{ "audit", commonMain<Audit>, "Runs the checks of xeol, stripws, isplainascii, and indents at once" },
+	{ "findext", commonMain<FindFileExt>, "Lists all file extensions in a directory" },
+	{ "indents", commonMain<IndentClassifier>, "Shows how files are indented" },
+	{ "isplainascii", commonMain<IsPlainAscii>, "Finds non-ASCII characters in files" },
+	{ "jsonpp", commonMain<JsonPP>, "Pretty-prints or minifies JSON files" },
+	{ "random", commonMain<Random>, "Generates random numbers" },
+	{ "regexmv", commonMain<RegExMove>, "Renames files using regular expressions" },
+	{ "scanserver", commonMain<ScanServer>, "Answers scan requests over a Unix domain socket" },
+	{ "stripws", commonMain<StripWS>, "Strips white space from the ends of lines" },
+	{ "xeol", commonMain<Xeol>, "Shows or changes the end-of-line convention" },
+	{ "xformcvsstatus", commonMain<XformCvsStatus>, "Reformats the output of cvs status" },
+};
+
+int main(int argCount, const char*const*const argList)
+{
+	return MultiCall::dispatch(k_applets, static_cast<size_t>(argCount), argList);
+}
+#endif
+
+int MultiCall::usage(ostream& out, string_view progName, AppletList applets, const char* pMsg)
+{
+	int exitCode = EXIT_SUCCESS;
+	if (pMsg != nullptr && *pMsg != '\0')
+	{
+		exitCode = EXIT_FAILURE;
+		out << endl << pMsg << endl;
+	}
+	out << "\n"
+		"Usage:  " << progName << " <tool> [<tool-arguments>]\n"
+		"        " << progName << " --serve <socket-path>\n"
+		"        <tool> [<tool-arguments>]\n"
+		"\n"
+		"Runs one of the tools below.  The tool is named either by the first\n"
+		"argument or by the name under which this program is invoked, so that\n"
+		"a symbolic link named for a tool (such as xeol -> " << progName << ")\n"
+		"behaves exactly like that tool.  The option --serve is short for\n"
+		"\"scanserver --serve\".  For the options of a tool, run \"<tool> -h\".\n"
+		"\n"
+		"Tools:\n"
+		"\n";
+	for (const auto& applet : applets)
+	{
+		formatTo(out, "   {0:<16}{1}\n", applet.m_name, applet.m_description);
+	}
+	out << endl;
+
+	return exitCode;
+}
+
+int MultiCall::dispatch(AppletList applets, size_t argCount, const char*const* argList)
+{
+	const auto progName = ::std::filesystem::path{argList[0]}.stem().generic_string();
+	if (auto pApplet = findApplet(applets, progName); pApplet != nullptr)
+	{
+		return pApplet->m_pMain(argCount, argList);
+	}
+	else if (argCount <= 1)
+	{
+		return usage(cout, progName, applets, "No tool specified");
+	}
+
+	const string_view firstArg{argList[1]};
+	if (auto pApplet = findApplet(applets, firstArg); pApplet != nullptr)
+	{
+		// The tool name takes the place of the program name:
+		return pApplet->m_pMain(argCount - 1, argList + 1);
+	}
+	else if (auto pServer = findApplet(applets, "scanserver");
+		pServer != nullptr && isIEqual(firstArg, "--serve"))
+	{
+		return pServer->m_pMain(argCount, argList);
+	}
+	else if (isIEqual(firstArg, "-?") || isIEqual(firstArg, "-h") || isIEqual(firstArg, "-help"))
+	{
+		return usage(cout, progName, applets, nullptr);
+	}
+	else
+	{
+		const auto msg = format("Unrecognized tool '{0}'", firstArg);
+		return usage(cout, progName, applets, msg.c_str());
+	}
+}
+
+const Applet* MultiCall::findApplet(AppletList applets, string_view name)
+{
+	auto it = ::std::find_if(begin(applets), end(applets),
+		[name] (const Applet& applet) { return isIEqual(applet.m_name, name); });
+	return (it == end(applets)) ? nullptr : &*it;
+}
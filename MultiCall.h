@@ -0,0 +1,41 @@
+
+#if !defined(MULTICALL_H_INCLUDED)
+#define MULTICALL_H_INCLUDED
+
+#include "Utils.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <span>
+#include <string_view>
+
+/// \brief One of the tools built into the multi-call binary.
+struct Applet
+{
+	using MainFunction = int (*)(::std::size_t argCount, const char*const* argList);
+
+	::std::string_view	m_name;
+	MainFunction			m_pMain;
+	::std::string_view	m_description;
+};
+
+/// \brief The dispatcher of the busybox-style binary that contains all of
+/// the tools.  The tool to run is named either by the name under which the
+/// binary was invoked (typically via a symbolic link such as xeol ->
+/// cmdlineutil) or by the first argument.
+class MultiCall
+{
+public:
+	using AppletList = ::std::span<const Applet>;
+
+	static int usage(::std::ostream& strm, ::std::string_view progName,
+		AppletList applets, const char* pMsg);
+	static int dispatch(AppletList applets, ::std::size_t argCount, const char*const* argList);
+
+	MultiCall() = delete;
+
+PRIVATE_EXCEPT_IN_TEST:
+	static const Applet* findApplet(AppletList applets, ::std::string_view name);
+};
+
+#endif // MULTICALL_H_INCLUDED
@@ -0,0 +1,75 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "MultiCall.h"
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+using ::std::string;
+using ::std::vector;
+
+static vector<string> g_receivedArgs;
+
+static int recordArgs(size_t argCount, const char*const* argList)
+{
+	g_receivedArgs.assign(argList, argList + argCount);
+	return 42;
+}
+
+static constexpr Applet k_testApplets[] =
+{
+	{ "scanserver", recordArgs, "Server" },
+	{ "xeol", recordArgs, "End of line" },
+};
+
+BOOST_AUTO_TEST_SUITE(MultiCallTestSuite)
+
+BOOST_AUTO_TEST_CASE(findAppletTest)
+{
+	BOOST_CHECK_EQUAL(&k_testApplets[1], MultiCall::findApplet(k_testApplets, "xeol"));
+	BOOST_CHECK_EQUAL(&k_testApplets[1], MultiCall::findApplet(k_testApplets, "XEOL"));
+	BOOST_CHECK(MultiCall::findApplet(k_testApplets, "xeo") == nullptr);
+	BOOST_CHECK(MultiCall::findApplet(k_testApplets, "") == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(dispatchOnProgramNameTest)
+{
+	const char*const args[] = { "/usr/local/bin/xeol", "-u", "a.txt" };
+	g_receivedArgs.clear();
+	BOOST_CHECK_EQUAL(42, MultiCall::dispatch(k_testApplets, 3, args));
+	BOOST_CHECK((vector<string>{ "/usr/local/bin/xeol", "-u", "a.txt" }) == g_receivedArgs);
+}
+
+BOOST_AUTO_TEST_CASE(dispatchOnSubcommandTest)
+{
+	const char*const args[] = { "cmdlineutil", "xeol", "-u", "a.txt" };
+	g_receivedArgs.clear();
+	BOOST_CHECK_EQUAL(42, MultiCall::dispatch(k_testApplets, 4, args));
+	BOOST_CHECK((vector<string>{ "xeol", "-u", "a.txt" }) == g_receivedArgs);
+}
+
+BOOST_AUTO_TEST_CASE(dispatchServeTest)
+{
+	const char*const args[] = { "cmdlineutil", "--serve", "x.sock" };
+	g_receivedArgs.clear();
+	BOOST_CHECK_EQUAL(42, MultiCall::dispatch(k_testApplets, 3, args));
+	BOOST_CHECK((vector<string>{ "cmdlineutil", "--serve", "x.sock" }) == g_receivedArgs);
+}
+
+BOOST_AUTO_TEST_CASE(usageTest)
+{
+	const char*const noToolArgs[] = { "cmdlineutil" };
+	const char*const badToolArgs[] = { "cmdlineutil", "bogus" };
+	const char*const helpArgs[] = { "cmdlineutil", "-h" };
+	g_receivedArgs.clear();
+	BOOST_CHECK_EQUAL(EXIT_FAILURE, MultiCall::dispatch(k_testApplets, 1, noToolArgs));
+	BOOST_CHECK_EQUAL(EXIT_FAILURE, MultiCall::dispatch(k_testApplets, 2, badToolArgs));
+	BOOST_CHECK_EQUAL(EXIT_SUCCESS, MultiCall::dispatch(k_testApplets, 2, helpArgs));
+	BOOST_CHECK(g_receivedArgs.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,89 @@
+
+#if !defined(OFFENDINGFILES_H_INCLUDED)
+#define OFFENDINGFILES_H_INCLUDED
+
+#include "Exceptions.h"
+#include "FileEnumerator.h"
+#include "SinceState.h"
+#include "Utils.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+/// \brief How a query tool reports on the files that break its rule.
+enum class ReportMode
+{
+	full,			///< The usual report on every file
+	listFiles,	///< -l:  List the offending files, and nothing else
+	quiet			///< -q:  Report nothing, and stop at the first offending file
+};
+
+/// \brief If pArg is -l or -q, sets reportMode accordingly and returns true.
+/// Throws CmdLineError if the other of the two was already given.
+inline bool parseReportModeOption(const char* pArg, ReportMode& reportMode)
+{
+	const bool isListOption = isIEqual(pArg, "-l");
+	if (!isListOption && !isIEqual(pArg, "-q"))
+	{
+		return false;
+	}
+	const auto newReportMode = isListOption ? ReportMode::listFiles : ReportMode::quiet;
+	if (reportMode != ReportMode::full && reportMode != newReportMode)
+	{
+		throw CmdLineError("The options '-l' and '-q' are mutually exclusive");
+	}
+	reportMode = newReportMode;
+	return true;
+}
+
+/// \brief Implements -l and -q for a query tool, in the manner of grep.
+/// isOffending(p) returns true if the file p breaks the tool's rule, and is
+/// expected to stop reading p as soon as it knows.  Likewise,
+/// isMemberOffending(p, reader) for each archive member that the file
+/// enumerator yields (see FileEnumerator::setArchiveAware()).  Returns
+/// EXIT_SUCCESS (0) if any file offends and EXIT_FAILURE (1) otherwise.
+/// Errors propagate, and commonMain() exits with k_reportModeErrorExitCode
+/// (2) for them.  Given a SinceState, saves it unless the enumeration was
+/// cut short by -q.
+template<typename IsOffending, typename IsMemberOffending>
+int reportOffendingFiles(const FileEnumerator& fileEnumerator, ReportMode reportMode,
+	IsOffending isOffending, IsMemberOffending isMemberOffending, SinceState* pSinceState = nullptr)
+{
+	bool isAnyFileOffending = false;
+	auto reportOffender = [reportMode, &isAnyFileOffending] (const ::std::filesystem::path& p)
+		{
+			isAnyFileOffending = true;
+			if (reportMode == ReportMode::listFiles)
+			{
+				::std::string dispPath = p.generic_string();
+				::std::cout << (dispPath.starts_with("./") ? dispPath.substr(2) : dispPath) << ::std::endl;
+			}
+			return reportMode == ReportMode::quiet;
+		};
+	const bool isStoppedEarly = fileEnumerator.enumerateFilesUntil(
+			[&isOffending, &reportOffender] (const ::std::filesystem::path& p)
+				{ return isOffending(p) && reportOffender(p); },
+			pSinceState)
+		|| fileEnumerator.enumerateArchiveMembersUntil(
+			[&isMemberOffending, &reportOffender] (const ::std::filesystem::path& p, BlockReader& reader)
+				{ return isMemberOffending(p, reader) && reportOffender(p); });
+
+	if (pSinceState != nullptr && !isStoppedEarly)
+	{
+		pSinceState->save();
+	}
+	return isAnyFileOffending ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/// \brief The same, for a tool that does not read archive members.
+template<typename IsOffending>
+int reportOffendingFiles(const FileEnumerator& fileEnumerator, ReportMode reportMode,
+	IsOffending isOffending, SinceState* pSinceState = nullptr)
+{
+	return reportOffendingFiles(fileEnumerator, reportMode, isOffending,
+		[] (const ::std::filesystem::path&, BlockReader&) { return false; }, pSinceState);
+}
+
+#endif // OFFENDINGFILES_H_INCLUDED
@@ -2,6 +2,8 @@
 #if !defined(FILEDELETER_H_INCLUDED)
 #define FILEDELETER_H_INCLUDED
 
+#include "Cancellation.h"
+
 #include <filesystem>
 #include <format>
 #include <iostream>
@@ -12,7 +14,8 @@ public:
 	using Path = ::std::filesystem::path;
 
 	PathDeleter(const Path& p)
-		: m_path(p), m_ownershipReleased(false) {}
+		: m_path(p), m_ownershipReleased(false)
+		{ TempFileRegistry::insert(m_path); }
 
 	~PathDeleter()
 	{
@@ -35,13 +38,21 @@ public:
 				{
 					::std::cout << ::std::format("Unable to delete \"{0}\":  {1} ({2})",
 						m_path.string(), ex.what(), ex.code().value()) << ::std::endl;
+					return;	// Leave it registered for the final cleanup pass
 				}
 			}
 		}
+		releaseOwnership();
 	}
 
 	void releaseOwnership()
-		{ m_ownershipReleased = true; }
+		{
+			if (!m_ownershipReleased)
+			{
+				m_ownershipReleased = true;
+				TempFileRegistry::erase(m_path);
+			}
+		}
 
 	PathDeleter(const PathDeleter&) = delete;
 	PathDeleter& operator=(const PathDeleter&) = delete;
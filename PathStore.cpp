@@ -0,0 +1,77 @@
+
+#include "PathStore.h"
+
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+using ::std::size_t;
+
+PathStore::PathStore() :
+	m_names(),
+	m_nodes(),
+	m_entries(),
+	m_lastDirChain()
+{
+}
+
+void PathStore::insert(const Path& p)
+{
+	// Every element but the last is a directory.  Share the ones that match
+	// the chain of the last directory, and start a new chain at the first
+	// one that does not:
+	Index parent = k_noParent;
+	size_t depth = 0;
+	auto it = p.begin();
+	for (; it != p.end() && ::std::next(it) != p.end(); ++it, ++depth)
+	{
+		const NameView dirName{it->native()};
+		if (depth < m_lastDirChain.size() && name(m_lastDirChain[depth]) == dirName)
+		{
+			parent = m_lastDirChain[depth];
+		}
+		else
+		{
+			m_lastDirChain.resize(depth);
+			parent = addNode(parent, dirName);
+			m_lastDirChain.push_back(parent);
+		}
+	}
+	m_entries.push_back(addNode(parent, (it == p.end()) ? NameView{} : NameView{it->native()}));
+}
+
+PathStore::Path PathStore::path(size_t i) const
+{
+	Path result;
+	appendPath(result, m_entries.at(i));
+	return result;
+}
+
+size_t PathStore::numBytesAllocated() const noexcept
+{
+	return m_names.capacity() * sizeof(Path::value_type)
+		+ m_nodes.capacity() * sizeof(Node)
+		+ (m_entries.capacity() + m_lastDirChain.capacity()) * sizeof(Index);
+}
+
+PathStore::Index PathStore::addNode(Index parent, NameView nodeName)
+{
+	if (m_names.size() + nodeName.size() + 1 > ::std::numeric_limits<Index>::max()
+		|| m_nodes.size() >= k_noParent)
+	{
+		throw ::std::length_error("Too many paths for a PathStore");
+	}
+	m_nodes.push_back({ parent, static_cast<Index>(m_names.size()) });
+	m_names.append(nodeName);
+	m_names.push_back(Path::value_type{});
+	return static_cast<Index>(m_nodes.size() - 1);
+}
+
+void PathStore::appendPath(Path& result, Index node) const
+{
+	if (m_nodes[node].m_parent != k_noParent)
+	{
+		appendPath(result, m_nodes[node].m_parent);
+	}
+	result /= name(node);
+}
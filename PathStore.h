@@ -0,0 +1,73 @@
+
+#if !defined(PATHSTORE_H_INCLUDED)
+#define PATHSTORE_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// \brief A compact, append-only list of paths, for tools that retain many
+/// of the paths they enumerate.
+///
+/// Each directory and file name is stored once, NUL-terminated, in a single
+/// string arena, and each path is a node holding the index of its parent
+/// directory's node and the offset of its name in the arena.  The
+/// directories of consecutive paths are shared by following the chain of the
+/// last directory inserted, so a depth-first enumeration stores each
+/// directory once.  A path costs one 8-byte node, a 4-byte entry, and its
+/// file name, and is materialized as a ::std::filesystem::path only when
+/// path() is called.
+class PathStore
+{
+public:
+	using Path = ::std::filesystem::path;
+
+	PathStore();
+
+	/// \brief Appends p to the list.  Throws ::std::length_error if the arena
+	/// outgrows 32-bit offsets.
+	void insert(const Path& p);
+
+	::std::size_t size() const noexcept
+		{ return m_entries.size(); }
+	bool empty() const noexcept
+		{ return m_entries.empty(); }
+
+	/// \brief Materializes the i'th path inserted.
+	Path path(::std::size_t i) const;
+
+	/// \brief The number of bytes allocated, for measuring the footprint.
+	::std::size_t numBytesAllocated() const noexcept;
+
+	PathStore(const PathStore&) = delete;
+	PathStore& operator=(const PathStore&) = delete;
+	PathStore(PathStore&&) = default;
+	PathStore& operator=(PathStore&&) = default;
+
+private:
+	using Index = ::std::uint32_t;
+	using NameView = ::std::basic_string_view<Path::value_type>;
+
+	static constexpr Index k_noParent = static_cast<Index>(-1);
+
+	struct Node
+	{
+		Index	m_parent;
+		Index	m_nameOffset;
+	};
+
+	Index addNode(Index parent, NameView nodeName);
+	NameView name(Index node) const noexcept
+		{ return NameView{m_names.data() + m_nodes[node].m_nameOffset}; }
+	void appendPath(Path& result, Index node) const;
+
+	::std::basic_string<Path::value_type>	m_names;		// The arena
+	::std::vector<Node>							m_nodes;		// Directories and files
+	::std::vector<Index>							m_entries;	// The file nodes, in insertion order
+	::std::vector<Index>							m_lastDirChain;	// Root to the last directory inserted
+};
+
+#endif // PATHSTORE_H_INCLUDED
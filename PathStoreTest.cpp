@@ -0,0 +1,78 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "PathStore.h"
+
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <string>
+#include <vector>
+
+using ::std::format;
+using ::std::size_t;
+using ::std::string;
+using ::std::vector;
+
+using Path = ::std::filesystem::path;
+
+BOOST_AUTO_TEST_SUITE(PathStoreTestSuite)
+
+BOOST_AUTO_TEST_CASE(roundTripTest)
+{
+	// In the order of a depth-first enumeration, returning to a directory
+	// after one of its sub-directories, and then some oddities:
+	const vector<Path> paths = {
+		"src/main.cpp",
+		"src/util/strings.cpp",
+		"src/util/deep/er/file",
+		"src/Makefile",
+		"/abs/dir/README",
+		"../up/one",
+		"./dot/two",
+		"bare",
+		"src/util/again.h",
+		"trailing/",
+		"",
+	};
+	PathStore store;
+	BOOST_CHECK(store.empty());
+	for (const auto& p : paths)
+	{
+		store.insert(p);
+	}
+	BOOST_REQUIRE_EQUAL(paths.size(), store.size());
+	for (size_t i = 0; i < paths.size(); ++i)
+	{
+		BOOST_CHECK_EQUAL(paths[i].generic_string(), store.path(i).generic_string());
+	}
+	BOOST_CHECK_THROW(store.path(paths.size()), ::std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(compactTest)
+{
+	// A hundred thousand files spread over a thousand directories, each
+	// with a long path, must cost tens of bytes apiece, far less than a
+	// vector of paths would:
+	const string root = "/home/builder/work/some-project/third-party/library";
+	PathStore store;
+	size_t numPathBytes = 0;
+	for (size_t dir = 0; dir < 1000; ++dir)
+	{
+		for (size_t file = 0; file < 100; ++file)
+		{
+			const Path p{format("{0}/module{1}/sub{2}/File{3}", root, dir / 10, dir % 10, file)};
+			numPathBytes += p.native().size();
+			store.insert(p);
+		}
+	}
+	BOOST_REQUIRE_EQUAL(100'000u, store.size());
+	BOOST_CHECK_EQUAL(format("{0}/module42/sub7/File99", root), store.path(42'799).generic_string());
+	BOOST_CHECK_LT(store.numBytesAllocated() / store.size(), 40u);
+	BOOST_CHECK_LT(store.numBytesAllocated(), numPathBytes / 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,282 @@
+
+#include "PerfCounters.h"
+#include "Utils.h"
+
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+#if defined(__linux__)
+#	include <linux/perf_event.h>
+#	include <sys/ioctl.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+using ::std::array;
+using ::std::atomic;
+using ::std::format;
+using ::std::ostream;
+using ::std::size_t;
+using ::std::string;
+using ::std::string_view;
+using ::std::uint64_t;
+
+using Counter = PerfCounters::Counter;
+using Sample = PerfCounters::Sample;
+
+static constexpr size_t k_timeEnabledIndex = PerfCounters::k_numCounters;
+static constexpr size_t k_timeRunningIndex = PerfCounters::k_numCounters + 1;
+
+static array<atomic<uint64_t>, PerfCounters::k_numCounters> g_totals{};
+static atomic<uint64_t> g_numBytes{0};
+static atomic<unsigned> g_availableCounters{0};	// A bit per Counter
+static atomic<int> g_openErrno{0};					// From the first failure
+
+#if defined(__linux__)
+
+namespace
+{
+	// The counters of one thread, as a group led by the cycle counter so
+	// that they are all scheduled onto the PMU together.
+	class ThreadCounters
+	{
+	public:
+		ThreadCounters() noexcept;
+		~ThreadCounters();
+
+		/// \brief Returns false if the counters are unavailable.
+		bool read(Sample& sample) const noexcept;
+
+		ThreadCounters(const ThreadCounters&) = delete;
+		ThreadCounters& operator=(const ThreadCounters&) = delete;
+		ThreadCounters(ThreadCounters&&) = delete;
+		ThreadCounters& operator=(ThreadCounters&&) = delete;
+
+	private:
+		array<int, PerfCounters::k_numCounters>	m_fds;	// -1 where unavailable
+	};
+}
+
+static constexpr array<uint64_t, PerfCounters::k_numCounters> k_eventConfigs =
+{
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+	PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+static int openCounter(uint64_t config, int groupFd)
+{
+	struct perf_event_attr attr;
+	::std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = config;
+	attr.disabled = (groupFd < 0) ? 1 : 0;
+	attr.exclude_kernel = 1;	// Permitted by perf_event_paranoid up to 2
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP
+		| PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+ThreadCounters::ThreadCounters() noexcept :
+	m_fds()
+{
+	m_fds.fill(-1);
+	for (size_t i = 0; i < m_fds.size(); ++i)
+	{
+		m_fds[i] = openCounter(k_eventConfigs[i], m_fds[0]);
+		if (m_fds[i] >= 0)
+		{
+			g_availableCounters.fetch_or(1u << i);
+		}
+		else if (i == 0)
+		{
+			// Without the group leader there is nothing to count:
+			int expected = 0;
+			g_openErrno.compare_exchange_strong(expected, errno);
+			return;
+		}
+	}
+	::ioctl(m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+ThreadCounters::~ThreadCounters()
+{
+	for (auto fd : m_fds)
+	{
+		if (fd >= 0)
+		{
+			::close(fd);
+		}
+	}
+}
+
+bool ThreadCounters::read(Sample& sample) const noexcept
+{
+	if (m_fds[0] < 0)
+	{
+		return false;
+	}
+
+	// The number of counters, the times enabled and running, and then the
+	// value of each counter in the group in the order they were opened:
+	array<uint64_t, 3 + PerfCounters::k_numCounters> buffer{};
+	if (::read(m_fds[0], buffer.data(), sizeof(buffer)) <= 0)
+	{
+		return false;
+	}
+
+	sample.fill(0);
+	sample[k_timeEnabledIndex] = buffer[1];
+	sample[k_timeRunningIndex] = buffer[2];
+	for (size_t i = 0, valueIndex = 0; i < m_fds.size() && valueIndex < buffer[0]; ++i)
+	{
+		if (m_fds[i] >= 0)
+		{
+			sample[i] = buffer[3 + valueIndex++];
+		}
+	}
+	return true;
+}
+
+static const ThreadCounters& threadCounters()
+{
+	thread_local const ThreadCounters t_counters;
+	return t_counters;
+}
+
+#endif
+
+void PerfCounters::enable()
+{
+	s_isEnabled.store(true);
+}
+
+#if defined(CMDLINEUTIL_TEST_MODE)
+void PerfCounters::reset()
+{
+	s_isEnabled.store(false);
+	for (auto& total : g_totals)
+	{
+		total.store(0);
+	}
+	g_numBytes.store(0);
+}
+#endif
+
+void PerfCounters::Scope::start() noexcept
+{
+#if defined(__linux__)
+	m_isRunning = threadCounters().read(m_start);
+#else
+	m_isRunning = false;
+	int expected = 0;
+	g_openErrno.compare_exchange_strong(expected, ENOSYS);
+#endif
+}
+
+void PerfCounters::Scope::stop() noexcept
+{
+#if defined(__linux__)
+	Sample end;
+	if (!threadCounters().read(end))
+	{
+		return;
+	}
+
+	// Scale up for the time the kernel had the counters multiplexed out:
+	const auto timeEnabled = end[k_timeEnabledIndex] - m_start[k_timeEnabledIndex];
+	const auto timeRunning = end[k_timeRunningIndex] - m_start[k_timeRunningIndex];
+	if (timeRunning == 0)
+	{
+		return;
+	}
+	const auto scale = static_cast<double>(timeEnabled) / static_cast<double>(timeRunning);
+	for (size_t i = 0; i < k_numCounters; ++i)
+	{
+		const auto delta = static_cast<double>(end[i] - m_start[i]) * scale;
+		g_totals[i].fetch_add(static_cast<uint64_t>(delta), ::std::memory_order_relaxed);
+	}
+	g_numBytes.fetch_add(m_numBytes, ::std::memory_order_relaxed);
+#endif
+}
+
+// Why the counters could not be opened, with a hint for the usual cause
+static string unavailableReason(int errorNumber)
+{
+	string reason = ::std::strerror(errorNumber);
+#if defined(__linux__)
+	if (errorNumber == EACCES || errorNumber == EPERM)
+	{
+		string paranoid;
+		::std::ifstream in("/proc/sys/kernel/perf_event_paranoid");
+		if (in >> paranoid)
+		{
+			reason += format(" (perf_event_paranoid is {0}; counting needs 2 or less)", paranoid);
+		}
+	}
+	else if (errorNumber == ENOENT || errorNumber == ENODEV || errorNumber == EOPNOTSUPP)
+	{
+		reason += " (no hardware counters are exposed, as in many virtual machines)";
+	}
+#else
+	reason = "Not supported on this platform";
+#endif
+	return reason;
+}
+
+void PerfCounters::report(ostream& out, string_view toolName)
+{
+	static constexpr array<string_view, k_numCounters> k_counterNames =
+		{ "Cycles:", "Instructions:", "Cache misses:", "Branch misses:" };
+
+	const auto availableCounters = g_availableCounters.load();
+	const auto numBytes = g_numBytes.load();
+	auto isAvailable = [availableCounters] (Counter counter)
+		{ return (availableCounters & (1u << static_cast<size_t>(counter))) != 0; };
+	auto total = [] (Counter counter)
+		{ return g_totals[static_cast<size_t>(counter)].load(); };
+	auto perByte = [numBytes] (uint64_t count)
+		{ return (numBytes > 0) ? static_cast<double>(count) / static_cast<double>(numBytes) : 0.0; };
+
+	formatTo(out, "\nPerformance counters for {0} (scanning kernels, user mode):\n", toolName);
+	if (!isAvailable(Counter::cycles))
+	{
+		const auto errorNumber = g_openErrno.load();
+		formatTo(out, "   Unavailable:  {0}\n",
+			(errorNumber == 0) ? string{"Nothing was scanned"} : unavailableReason(errorNumber));
+		out.flush();
+		return;
+	}
+
+	formatTo(out, "   {0:<16}{1:14}\n", "Bytes scanned:", numBytes);
+	for (size_t i = 0; i < k_numCounters; ++i)
+	{
+		const auto counter = static_cast<Counter>(i);
+		if (!isAvailable(counter))
+		{
+			formatTo(out, "   {0:<16}{1:>14}\n", k_counterNames[i], "n/a");
+		}
+		else if (counter == Counter::cycles || counter == Counter::instructions)
+		{
+			formatTo(out, "   {0:<16}{1:14} ({2:.3f} per byte)\n", k_counterNames[i],
+				total(counter), perByte(total(counter)));
+		}
+		else
+		{
+			formatTo(out, "   {0:<16}{1:14}\n", k_counterNames[i], total(counter));
+		}
+	}
+	if (isAvailable(Counter::instructions) && total(Counter::cycles) > 0)
+	{
+		formatTo(out, "   {0:<16}{1:14.3f}\n", "IPC:", static_cast<double>(total(Counter::instructions))
+			/ static_cast<double>(total(Counter::cycles)));
+	}
+	out.flush();
+}
@@ -0,0 +1,87 @@
+
+#if !defined(PERFCOUNTERS_H_INCLUDED)
+#define PERFCOUNTERS_H_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+
+/// \brief PerfCounters samples the hardware performance counters (cycles,
+/// instructions, cache misses, and branch misses) around the scanning
+/// kernels, for the --perf-counters option of every tool.  It reports
+/// cycles per byte and instructions per cycle, the figures by which SIMD
+/// and data layout changes are judged.
+///
+/// The counters come from perf_event_open, count user-mode events only, and
+/// are opened per thread on first use.  Where they are not available (other
+/// platforms, or Linux with a restrictive perf_event_paranoid setting), the
+/// report says so and nothing else changes.  Until enable() is called, each
+/// Scope costs a single relaxed load.
+class PerfCounters
+{
+public:
+	enum class Counter
+	{
+		cycles,
+		instructions,
+		cacheMisses,
+		branchMisses,
+		numCounters
+	};
+
+	static constexpr auto k_numCounters = static_cast< ::std::size_t>(Counter::numCounters);
+
+	// The counter values, followed by the times enabled and running that
+	// allow for the kernel multiplexing the counters:
+	using Sample = ::std::array< ::std::uint64_t, k_numCounters + 2>;
+
+	static void enable();
+	static bool isEnabled() noexcept
+		{ return s_isEnabled.load(::std::memory_order_relaxed); }
+
+	/// \brief Writes the totals gathered since enable() to out.
+	static void report(::std::ostream& out, ::std::string_view toolName);
+
+#if defined(CMDLINEUTIL_TEST_MODE)
+	// Testing facilities:
+	/// \brief Disables the counting and clears the totals.  The counters
+	/// already opened stay open, so what is known of their availability is
+	/// kept.  Call this only while no Scope is running.
+	static void reset();
+#endif
+
+	/// \brief Counts the events from its construction to its destruction
+	/// against a scan of numBytes bytes.
+	class Scope
+	{
+	public:
+		explicit Scope(::std::size_t numBytes) noexcept :
+			m_numBytes(numBytes), m_isRunning(isEnabled()), m_start()
+			{ if (m_isRunning) { start(); } }
+		~Scope()
+			{ if (m_isRunning) { stop(); } }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		Scope(Scope&&) = delete;
+		Scope& operator=(Scope&&) = delete;
+
+	private:
+		void start() noexcept;
+		void stop() noexcept;
+
+		::std::size_t	m_numBytes;
+		bool				m_isRunning;
+		Sample			m_start;
+	};
+
+	PerfCounters() = delete;
+
+private:
+	static inline ::std::atomic<bool> s_isEnabled{false};
+};
+
+#endif // PERFCOUNTERS_H_INCLUDED
@@ -0,0 +1,71 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "BlockReader.h"
+#include "PerfCounters.h"
+
+#include <boost/test/unit_test.hpp>
+#include <format>
+#include <sstream>
+#include <string>
+
+using ::std::istringstream;
+using ::std::ostringstream;
+using ::std::string;
+
+// Leaves the counters disabled for the tests that follow:
+struct PerfCountersFixture
+{
+	PerfCountersFixture()
+		{ PerfCounters::enable(); }
+	~PerfCountersFixture()
+		{ PerfCounters::reset(); }
+};
+
+BOOST_AUTO_TEST_SUITE(PerfCountersTestSuite)
+
+BOOST_AUTO_TEST_CASE(reportTest)
+{
+	PerfCountersFixture fixture;
+	istringstream in(string(200'000, 'x'));
+	size_t numBytes = 0;
+	BlockReader(in).forEachBlock([&numBytes] (ByteSpan block) { numBytes += block.size(); });
+	BOOST_CHECK_EQUAL(200'000u, numBytes);
+
+	ostringstream out;
+	PerfCounters::report(out, "test");
+	const auto report = out.str();
+	BOOST_CHECK(report.find("Performance counters for test") != string::npos);
+
+	// Whether the counters can be opened depends on the machine, but either
+	// way the report must say which it is:
+	if (report.find("Unavailable:") == string::npos)
+	{
+		for (auto pLabel : { "Bytes scanned:", "Cycles:", "Instructions:", "Cache misses:",
+			"Branch misses:" })
+		{
+			BOOST_CHECK_MESSAGE(report.find(pLabel) != string::npos, pLabel);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(resetTest)
+{
+	{
+		PerfCountersFixture fixture;
+		BOOST_CHECK(PerfCounters::isEnabled());
+		PerfCounters::Scope scope(1000);
+	}
+	BOOST_CHECK(!PerfCounters::isEnabled());
+
+	// What was counted is gone once the counters are reset:
+	ostringstream out;
+	PerfCounters::report(out, "test");
+	const auto report = out.str();
+	BOOST_CHECK(report.find("Unavailable:") != string::npos
+		|| report.find(::std::format("{0:<16}{1:14}\n", "Bytes scanned:", 0)) != string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,23 +2,33 @@
 #include "Random.h"
 #include "main.h"
 
+#include <charconv>
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include <format>
 #include <iostream>
+#include <limits>
 #include <random>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
+using ::std::array;
 using ::std::cout;
 using ::std::default_random_engine;
 using ::std::endl;
+using ::std::format;
 using ::std::invalid_argument;
 using ::std::ostream;
 using ::std::out_of_range;
+using ::std::size_t;
 using ::std::string;
 using ::std::string_view;
+using ::std::uint64_t;
 using ::std::uniform_int_distribution;
+using ::std::vector;
 
 long fromCString(const char* pStr)
 {
@@ -51,7 +61,7 @@ long fromCString(const char* pStr)
 	}
 }
 
-#if !defined(CMDLINEUTIL_TEST_MODE)
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
 int main(int argCount, const char*const*const argList)
 {
 	return commonMain<Random>(argCount, argList);
@@ -68,10 +78,33 @@ int Random::usage(ostream& out, string_view progName, const char* pMsg)
 	}
 	out << "\n"
 		"Usage:  " << progName << " <lower-bound> <upper-bound> [ <count> ]\n"
+		"        " << progName << " --corpus <dir> [ <corpus-options> ]\n"
 		"\n"
 		"Generates <count> uniformly distributed random integers\n"
 		"between <lower-bound> and <upper-bound>.  The two bounds\n"
 		"are required, and <count> defaults to one.\n"
+		"\n"
+		"With --corpus, generates instead a reproducible tree of synthetic\n"
+		"text, source, and JSON files under <dir>, for benchmarks.  The same\n"
+		"options always generate the same bytes.  The corpus options are:\n"
+		"\n"
+		"   --seed <n>           The random seed (default 1)\n"
+		"   --files <n>          The number of files (default 1000)\n"
+		"   --depth <n>          Levels of directories, counting <dir> (default 3)\n"
+		"   --fan-out <n>        Sub-directories per directory (default 4)\n"
+		"   --min-size <size>    The smallest file (default 1K)\n"
+		"   --max-size <size>    The largest file (default 64K); sizes are\n"
+		"                        log-uniform in between, and may end in K, M, or G\n"
+		"   --eol-mix <u:d:m:x>  Relative weights of files with Unix, DOS, Mac,\n"
+		"                        and mixed line endings (default 80:15:0:5)\n"
+		"   --indent-mix <s:t:x> Relative weights of files indented with spaces,\n"
+		"                        tabs, and a mix (default 60:30:10)\n"
+		"   --trailing-ws <pct>  Percentage of lines with trailing white space\n"
+		"                        (default 5)\n"
+		"   --non-ascii <pml>    Words per thousand that are not ASCII (default 1)\n"
+		"   --json <pct>         Percentage of files that are JSON (default 10)\n"
+		"   --json-depth <n>     The maximum nesting of the JSON (default 8)\n"
+		"   --threads <n>        Writer threads (default one per core)\n"
 		<< endl;
 
 	return exitCode;
@@ -80,24 +113,123 @@ int Random::usage(ostream& out, string_view progName, const char* pMsg)
 Random::Random(::std::span<const char*const> args) :
 	m_lowerBound(0),
 	m_upperBound(0),
-	m_count(1)
+	m_count(1),
+	m_corpusDir(),
+	m_corpusSpec()
 {
-	if (args.size() < 3)
+	vector<const char*> positionalArgs;
+	const char* pCorpusOption = nullptr;
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		const string_view arg{args[i]};
+		if (isIEqual(arg, "-?") || isIEqual(arg, "-h") || isIEqual(arg, "-help"))
+		{
+			throw CmdLineError();
+		}
+		else if (!arg.starts_with("--"))
+		{
+			positionalArgs.push_back(args[i]);	// Possibly a negative bound
+			continue;
+		}
+		else if (isIEqual(arg, "--corpus"))
+		{
+			m_corpusDir = getOptionValue(args, i);
+			continue;
+		}
+
+		pCorpusOption = args[i];
+		if (isIEqual(arg, "--seed"))
+		{
+			m_corpusSpec.m_seed = parseCount(arg, getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--files"))
+		{
+			m_corpusSpec.m_numFiles = parseCount(arg, getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--depth"))
+		{
+			m_corpusSpec.m_depth = parseUnsigned(arg, getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--fan-out"))
+		{
+			m_corpusSpec.m_fanOut = parseUnsigned(arg, getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--min-size"))
+		{
+			m_corpusSpec.m_minFileSize = parseByteSize(getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--max-size"))
+		{
+			m_corpusSpec.m_maxFileSize = parseByteSize(getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--eol-mix"))
+		{
+			parseWeights(arg, getOptionValue(args, i), m_corpusSpec.m_eolWeights);
+		}
+		else if (isIEqual(arg, "--indent-mix"))
+		{
+			parseWeights(arg, getOptionValue(args, i), m_corpusSpec.m_indentWeights);
+		}
+		else if (isIEqual(arg, "--trailing-ws"))
+		{
+			m_corpusSpec.m_trailingWsPercent = parseUnsigned(arg, getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--non-ascii"))
+		{
+			m_corpusSpec.m_nonAsciiPermille = parseUnsigned(arg, getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--json"))
+		{
+			m_corpusSpec.m_jsonPercent = parseUnsigned(arg, getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--json-depth"))
+		{
+			m_corpusSpec.m_jsonDepth = parseUnsigned(arg, getOptionValue(args, i));
+		}
+		else if (isIEqual(arg, "--threads"))
+		{
+			m_corpusSpec.m_numThreads = parseUnsigned(arg, getOptionValue(args, i));
+		}
+		else
+		{
+			throw CmdLineError(format("Unrecognized argument '{0}'", arg));
+		}
+	}
+
+	if (!m_corpusDir.empty())
+	{
+		if (!positionalArgs.empty())
+		{
+			throw CmdLineError("The option '--corpus' does not take bounds or a count");
+		}
+		try
+		{
+			CorpusGenerator{m_corpusSpec};
+		}
+		catch (const invalid_argument& ex)
+		{
+			throw CmdLineError(ex.what());
+		}
+		return;
+	}
+	else if (pCorpusOption != nullptr)
+	{
+		throw CmdLineError(format("The option '{0}' requires '--corpus'", pCorpusOption));
+	}
+	else if (positionalArgs.size() < 2)
 	{
 		throw CmdLineError("Too few arguments");
 	}
-	else if (args.size() > 4)
+	else if (positionalArgs.size() > 3)
 	{
 		throw CmdLineError("Too many arguments");
 	}
-	else
+
+	m_lowerBound = fromCString(positionalArgs[0]);
+	m_upperBound = fromCString(positionalArgs[1]);
+	if (positionalArgs.size() == 3)
 	{
-		m_lowerBound = fromCString(args[1]);
-		m_upperBound = fromCString(args[2]);
-		if (args.size() == 4)
-		{
-			m_count = fromCString(args[3]);
-		}
+		m_count = fromCString(positionalArgs[2]);
 	}
 
 	if (m_count <= 0)
@@ -106,8 +238,52 @@ Random::Random(::std::span<const char*const> args) :
 	}
 }
 
+uint64_t Random::parseCount(string_view option, string_view value)
+{
+	uint64_t result = 0;
+	const auto [pEnd, ec] = ::std::from_chars(value.data(), value.data() + value.size(), result);
+	if (ec != ::std::errc{} || pEnd != value.data() + value.size())
+	{
+		throw CmdLineError(format("Invalid value '{0}' for option '{1}'", value, option));
+	}
+	return result;
+}
+
+unsigned Random::parseUnsigned(string_view option, string_view value)
+{
+	const auto result = parseCount(option, value);
+	if (result > ::std::numeric_limits<unsigned>::max())
+	{
+		throw CmdLineError(format("The value '{0}' for option '{1}' is out of range", value, option));
+	}
+	return static_cast<unsigned>(result);
+}
+
+// A colon-separated list of N weights, such as "80:15:0:5"
+template<size_t N>
+void Random::parseWeights(string_view option, string_view value, array<unsigned, N>& weights)
+{
+	auto remainder = value;
+	for (size_t i = 0; i < N; ++i)
+	{
+		const auto colonPos = remainder.find(':');
+		if ((i + 1 < N) == (colonPos == string_view::npos))
+		{
+			throw CmdLineError(format("The option '{0}' requires {1} weights separated by colons",
+				option, N));
+		}
+		weights[i] = parseUnsigned(option, remainder.substr(0, colonPos));
+		remainder.remove_prefix((colonPos == string_view::npos) ? remainder.size() : colonPos + 1);
+	}
+}
+
 int Random::run() const
 {
+	if (!m_corpusDir.empty())
+	{
+		return generateCorpus();
+	}
+
 	for (long i = 0; i < m_count; ++i)
 	{
 		cout << getRandomInteger(m_lowerBound, m_upperBound) << endl;
@@ -115,6 +291,19 @@ int Random::run() const
 	return EXIT_SUCCESS;
 }
 
+int Random::generateCorpus() const
+{
+	const auto start = ::std::chrono::steady_clock::now();
+	const auto totals = CorpusGenerator(m_corpusSpec).generate(m_corpusDir);
+	const auto elapsed = ::std::chrono::duration<double>(
+		::std::chrono::steady_clock::now() - start).count();
+
+	formatTo(cout, "Generated {0} files ({1} bytes) in {2} directories in {3:.3f} s ({4:.1f} MB/s)\n",
+		totals.m_numFiles, totals.m_numBytes, totals.m_numDirs, elapsed,
+		(elapsed > 0.0) ? static_cast<double>(totals.m_numBytes) / elapsed / 1e6 : 0.0);
+	return EXIT_SUCCESS;
+}
+
 long Random::getRandomInteger(long low, long high)
 {
 	default_random_engine generator;
@@ -2,6 +2,12 @@
 #if !defined(RANDOM_H_INCLUDED)
 #define RANDOM_H_INCLUDED
 
+#include "CorpusGenerator.h"
+#include "Utils.h"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
 #include <iosfwd>
 #include <span>
 #include <string_view>
@@ -19,12 +25,20 @@ public:
 	Random(Random&&) = delete;
 	Random& operator=(Random&&) = delete;
 
-private:
+PRIVATE_EXCEPT_IN_TEST:
 	static long getRandomInteger(long low, long high);
-
-	long	m_lowerBound;
-	long	m_upperBound;
-	long	m_count;
+	static ::std::uint64_t parseCount(::std::string_view option, ::std::string_view value);
+	static unsigned parseUnsigned(::std::string_view option, ::std::string_view value);
+	template<::std::size_t N>
+	static void parseWeights(::std::string_view option, ::std::string_view value,
+		::std::array<unsigned, N>& weights);
+	int generateCorpus() const;
+
+	long								m_lowerBound;
+	long								m_upperBound;
+	long								m_count;
+	::std::filesystem::path		m_corpusDir;
+	CorpusSpec						m_corpusSpec;
 };
 
 #endif // RANDOM_H_INCLUDED
@@ -0,0 +1,93 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "Exceptions.h"
+#include "Random.h"
+#include "TestUtil.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+
+namespace utd = ::boost::unit_test::data;
+
+BOOST_AUTO_TEST_SUITE(RandomTestSuite)
+
+BOOST_AUTO_TEST_SUITE(CmdLineParseFailTestSuite)
+
+static char const*const k_args00[] = { "random", "-?" };
+static char const*const k_args01[] = { "random", "-h" };
+static char const*const k_args02[] = { "random", "1" };
+static char const*const k_args03[] = { "random", "1", "10", "5", "7" };
+static char const*const k_args04[] = { "random", "1", "ten" };
+static char const*const k_args05[] = { "random", "1", "10", "--files", "5" };
+static char const*const k_args06[] = { "random", "--corpus", "Corpus", "1", "10" };
+static char const*const k_args07[] = { "random", "--corpus" };
+static char const*const k_args08[] = { "random", "--corpus", "Corpus", "--files", "many" };
+static char const*const k_args09[] = { "random", "--corpus", "Corpus", "--max-size", "4X" };
+static char const*const k_args10[] = { "random", "--corpus", "Corpus", "--eol-mix", "1:2:3" };
+static char const*const k_args11[] = { "random", "--corpus", "Corpus", "--eol-mix", "0:0:0:0" };
+static char const*const k_args12[] = { "random", "--corpus", "Corpus", "--min-size", "1M", "--max-size", "1K" };
+static char const*const k_args13[] = { "random", "--corpus", "Corpus", "--json", "101" };
+static char const*const k_args14[] = { "random", "--corpus", "Corpus", "--bogus" };
+static char const*const k_args15[] = { "random", "--corpus", "Corpus", "--json-depth", "4294967295" };
+static char const*const k_args16[] = { "random", "--corpus", "Corpus", "--json-depth", "4294967296" };
+static char const*const k_args17[] = { "random", "--corpus", "Corpus", "--fan-out", "8589934594" };
+
+static CmdLineParseFailTestCase const k_testCases[] =
+{
+	{ k_args00, "^$" },
+	{ k_args01, "^$" },
+	{ k_args02, ".*too few arguments.*" },
+	{ k_args03, ".*too many arguments.*" },
+	{ k_args04, ".*invalid numeric format.*" },
+	{ k_args05, ".*requires '--corpus'.*" },
+	{ k_args06, ".*does not take bounds.*" },
+	{ k_args07, ".*requires a value.*" },
+	{ k_args08, ".*invalid value 'many'.*" },
+	{ k_args09, ".*invalid size '4x'.*" },
+	{ k_args10, ".*requires 4 weights.*" },
+	{ k_args11, ".*may not all be zero.*" },
+	{ k_args12, ".*minimum file size exceeds.*" },
+	{ k_args13, ".*exceeds 100.*" },
+	{ k_args14, ".*unrecognized argument.*" },
+	{ k_args15, ".*json depth must be between 1 and 255.*" },
+	{ k_args16, ".*'4294967296'.*out of range.*" },
+	{ k_args17, ".*'8589934594'.*out of range.*" },
+};
+
+BOOST_DATA_TEST_CASE(cmdLineParseFailTest, utd::make(k_testCases), tc)
+{
+	BOOST_CHECK_EXCEPTION(Random(tc.m_args), CmdLineError,
+		[&tc](const CmdLineError& ex) { return tc.doesExMatch(ex); });
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_CASE(boundsTest)
+{
+	static char const*const k_args[] = { "-5", "5", "3" };
+	const Random app{ArgSpan{k_args}};
+	BOOST_CHECK_EQUAL(-5, app.m_lowerBound);
+	BOOST_CHECK_EQUAL(5, app.m_upperBound);
+	BOOST_CHECK_EQUAL(3, app.m_count);
+	BOOST_CHECK(app.m_corpusDir.empty());
+}
+
+BOOST_AUTO_TEST_CASE(corpusOptionsTest)
+{
+	static char const*const k_args[] = { "--corpus", "Corpus", "--seed", "7", "--files", "50",
+		"--min-size", "1KiB", "--max-size", "2M", "--eol-mix", "1:2:3:4", "--indent-mix", "0:1:0", "--json", "0" };
+	const Random app{ArgSpan{k_args}};
+	BOOST_CHECK_EQUAL("Corpus", app.m_corpusDir.generic_string());
+	BOOST_CHECK_EQUAL(7u, app.m_corpusSpec.m_seed);
+	BOOST_CHECK_EQUAL(50u, app.m_corpusSpec.m_numFiles);
+	BOOST_CHECK_EQUAL(1024u, app.m_corpusSpec.m_minFileSize);
+	BOOST_CHECK_EQUAL(2u * 1024 * 1024, app.m_corpusSpec.m_maxFileSize);
+	BOOST_CHECK_EQUAL(4u, app.m_corpusSpec.m_eolWeights[3]);
+	BOOST_CHECK_EQUAL(1u, app.m_corpusSpec.m_indentWeights[1]);
+	BOOST_CHECK_EQUAL(0u, app.m_corpusSpec.m_jsonPercent);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,285 @@
+
+#include "RecordWriter.h"
+#include "Exceptions.h"
+
+#include <charconv>
+#include <format>
+#include <ostream>
+#include <stdexcept>
+
+using ::std::format;
+using ::std::logic_error;
+using ::std::ostream;
+using ::std::size_t;
+using ::std::string;
+using ::std::string_view;
+using ::std::uint64_t;
+
+bool parseOutputFormatOption(const char* pArg, OutputFormat& outputFormat)
+{
+	static constexpr string_view k_prefix = "--format=";
+
+	const string_view arg{pArg};
+	if (arg.size() < k_prefix.size() || !isIEqual(arg.substr(0, k_prefix.size()), k_prefix))
+	{
+		return false;
+	}
+
+	const auto value = arg.substr(k_prefix.size());
+	if (isIEqual(value, "text"))
+	{
+		outputFormat = OutputFormat::text;
+	}
+	else if (isIEqual(value, "jsonl"))
+	{
+		outputFormat = OutputFormat::jsonl;
+	}
+	else if (isIEqual(value, "csv"))
+	{
+		outputFormat = OutputFormat::csv;
+	}
+	else
+	{
+		throw CmdLineError(format("Unrecognized output format '{0}'", value));
+	}
+	return true;
+}
+
+RecordWriter::RecordWriter(ostream& out, OutputFormat format, FieldNames fieldNames) :
+	m_out(out),
+	m_format(format),
+	m_fieldNames(fieldNames),
+	m_fieldIndex(0),
+	m_buffer()
+{
+	if (m_format == OutputFormat::text)
+	{
+		throw logic_error("RecordWriter does not write the text format");
+	}
+
+	m_buffer.reserve(k_flushThreshold + 4096);
+	if (m_format == OutputFormat::csv)
+	{
+		for (auto fieldName : m_fieldNames)
+		{
+			field(fieldName);
+		}
+		endRecord();
+	}
+}
+
+RecordWriter::~RecordWriter()
+{
+	try
+	{
+		flush();
+	}
+	catch (...)
+	{
+		// Nothing to be done about a failed write at this point
+	}
+}
+
+void RecordWriter::beginField()
+{
+	if (m_fieldIndex >= m_fieldNames.size())
+	{
+		throw logic_error("Too many fields in record");
+	}
+
+	if (m_format == OutputFormat::csv)
+	{
+		if (m_fieldIndex > 0)
+		{
+			m_buffer += ',';
+		}
+	}
+	else
+	{
+		m_buffer += (m_fieldIndex == 0) ? '{' : ',';
+		appendJsonString(m_buffer, m_fieldNames[m_fieldIndex]);
+		m_buffer += ':';
+	}
+	++m_fieldIndex;
+}
+
+RecordWriter& RecordWriter::field(string_view value)
+{
+	beginField();
+	if (m_format == OutputFormat::csv)
+	{
+		appendCsvString(value);
+	}
+	else
+	{
+		appendJsonString(m_buffer, value);
+	}
+	return *this;
+}
+
+RecordWriter& RecordWriter::field(bool value)
+{
+	beginField();
+	m_buffer += value ? "true" : "false";
+	return *this;
+}
+
+RecordWriter& RecordWriter::field(const ::std::filesystem::path& p)
+{
+	const auto pathStr = p.generic_string();
+	return field(string_view{pathStr}.starts_with("./")
+		? string_view{pathStr}.substr(2)
+		: string_view{pathStr});
+}
+
+RecordWriter& RecordWriter::numberField(uint64_t value)
+{
+	beginField();
+	char digits[24];
+	const auto result = ::std::to_chars(digits, digits + sizeof(digits), value);
+	m_buffer.append(digits, result.ptr);
+	return *this;
+}
+
+void RecordWriter::endRecord()
+{
+	if (m_fieldIndex != m_fieldNames.size())
+	{
+		throw logic_error("Too few fields in record");
+	}
+
+	if (m_format == OutputFormat::jsonl)
+	{
+		m_buffer += '}';
+	}
+	m_buffer += '\n';
+	m_fieldIndex = 0;
+
+	if (m_buffer.size() >= k_flushThreshold)
+	{
+		writeBuffer();
+	}
+}
+
+void RecordWriter::flush()
+{
+	writeBuffer();
+	m_out.flush();
+}
+
+void RecordWriter::writeBuffer()
+{
+	m_out.write(m_buffer.data(), static_cast< ::std::streamsize >(m_buffer.size()));
+	m_buffer.clear();
+}
+
+// Returns the length of the well-formed UTF-8 sequence at the start of str,
+// or zero if there is none (see table 3-7 of the Unicode standard).
+static size_t utf8SequenceLength(string_view str)
+{
+	auto byteAt = [str] (size_t i) { return static_cast<unsigned char>(str[i]); };
+	auto isInRange = [&] (size_t i, unsigned char lo, unsigned char hi)
+		{ return i < str.size() && byteAt(i) >= lo && byteAt(i) <= hi; };
+
+	const auto lead = byteAt(0);
+	if (lead >= 0xc2 && lead <= 0xdf)
+	{
+		return isInRange(1, 0x80, 0xbf) ? 2 : 0;
+	}
+	else if (lead >= 0xe0 && lead <= 0xef)
+	{
+		const unsigned char lo = (lead == 0xe0) ? 0xa0 : 0x80;
+		const unsigned char hi = (lead == 0xed) ? 0x9f : 0xbf;
+		return (isInRange(1, lo, hi) && isInRange(2, 0x80, 0xbf)) ? 3 : 0;
+	}
+	else if (lead >= 0xf0 && lead <= 0xf4)
+	{
+		const unsigned char lo = (lead == 0xf0) ? 0x90 : 0x80;
+		const unsigned char hi = (lead == 0xf4) ? 0x8f : 0xbf;
+		return (isInRange(1, lo, hi) && isInRange(2, 0x80, 0xbf) && isInRange(3, 0x80, 0xbf)) ? 4 : 0;
+	}
+	return 0;
+}
+
+// Copies the runs of bytes that need no escaping in bulk, and handles the
+// rest one at a time.
+void appendJsonString(string& out, string_view str)
+{
+	out += '"';
+	size_t runStart = 0;
+	for (size_t i = 0; i < str.size();)
+	{
+		const auto ch = static_cast<unsigned char>(str[i]);
+		if (ch >= 0x20 && ch < 0x80 && ch != '"' && ch != '\\')
+		{
+			++i;
+			continue;
+		}
+
+		if (ch >= 0x80)
+		{
+			if (const auto seqLen = utf8SequenceLength(str.substr(i)); seqLen > 0)
+			{
+				i += seqLen;
+				continue;
+			}
+		}
+
+		out.append(str.data() + runStart, i - runStart);
+		switch (ch)
+		{
+		case '"':
+			out += "\\\"";
+			break;
+		case '\\':
+			out += "\\\\";
+			break;
+		case '\n':
+			out += "\\n";
+			break;
+		case '\r':
+			out += "\\r";
+			break;
+		case '\t':
+			out += "\\t";
+			break;
+		default:
+			if (ch >= 0x80)
+			{
+				out += "\\ufffd";
+			}
+			else
+			{
+				out += "\\u00";
+				appendHexByte(out, ch);
+			}
+			break;
+		}
+		runStart = ++i;
+	}
+	out.append(str.data() + runStart, str.size() - runStart);
+	out += '"';
+}
+
+void RecordWriter::appendCsvString(string_view str)
+{
+	if (str.find_first_of(",\"\r\n") == string_view::npos)
+	{
+		m_buffer += str;
+		return;
+	}
+
+	m_buffer += '"';
+	for (size_t runStart = 0;;)
+	{
+		const auto quotePos = str.find('"', runStart);
+		m_buffer.append(str.substr(runStart, quotePos - runStart));
+		if (quotePos == string_view::npos)
+		{
+			break;
+		}
+		m_buffer += "\"\"";
+		runStart = quotePos + 1;
+	}
+	m_buffer += '"';
+}
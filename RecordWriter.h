@@ -0,0 +1,101 @@
+
+#if !defined(RECORDWRITER_H_INCLUDED)
+#define RECORDWRITER_H_INCLUDED
+
+#include "Utils.h"
+
+#include <concepts>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <span>
+#include <string>
+#include <string_view>
+
+/// \brief The output formats selected by the --format option of the tools.
+enum class OutputFormat
+{
+	text,		///< The usual human-readable report
+	jsonl,	///< One JSON object per line (JSON Lines)
+	csv		///< RFC 4180 comma-separated values, with a header line
+};
+
+/// \brief If pArg is --format=<fmt>, sets outputFormat accordingly and returns
+/// true.  Throws CmdLineError if <fmt> is not one of text, jsonl, and csv.
+bool parseOutputFormatOption(const char* pArg, OutputFormat& outputFormat);
+
+/// \brief Appends str to out as a quoted JSON string.  Any byte sequence that
+/// is not well-formed UTF-8 is written as U+FFFD, so the result is always
+/// valid JSON.
+void appendJsonString(::std::string& out, ::std::string_view str);
+
+/// \brief Appends byte to out as two lowercase hexadecimal digits.
+template<typename String>
+void appendHexByte(String& out, unsigned char byte)
+{
+	static constexpr char k_hexDigits[] = "0123456789abcdef";
+	out += k_hexDigits[byte >> 4];
+	out += k_hexDigits[byte & 0xf];
+}
+
+/// \brief RecordWriter writes the records of a tool's --format=jsonl or
+/// --format=csv output.  Each tool has a fixed schema, i.e., a list of field
+/// names, and every record supplies exactly those fields in that order.  The
+/// schemas are an interface that consumers of the records rely upon, so a
+/// field may be added at the end of one, but never renamed, removed, or
+/// moved.
+///
+/// The records are escaped straight into an output buffer that is handed to
+/// the stream in large writes, so that no temporary string is built per field.
+/// JSON strings are always valid UTF-8:  a byte sequence that is not UTF-8 is
+/// written as U+FFFD.  CSV fields are copied byte for byte.
+class RecordWriter
+{
+public:
+	using FieldNames = ::std::span<const ::std::string_view>;
+
+	/// \brief fieldNames must outlive the writer.  For CSV, writes the header.
+	RecordWriter(::std::ostream& out, OutputFormat format, FieldNames fieldNames);
+	~RecordWriter();
+
+	RecordWriter& field(::std::string_view value);
+	RecordWriter& field(const char* pValue)
+		{ return field(::std::string_view{pValue}); }
+	RecordWriter& field(const ::std::string& value)
+		{ return field(::std::string_view{value}); }
+	RecordWriter& field(bool value);
+	/// \brief Writes p in generic form, less any leading "./", so that the
+	/// paths in the records of all the tools agree.
+	RecordWriter& field(const ::std::filesystem::path& p);
+	template<::std::unsigned_integral UInt>
+		requires (!::std::same_as<UInt, bool>)
+	RecordWriter& field(UInt value)
+		{ return numberField(static_cast< ::std::uint64_t >(value)); }
+
+	/// \brief Ends the current record, which must have all of its fields.
+	void endRecord();
+
+	/// \brief Hands the buffered records to the stream and flushes it.
+	void flush();
+
+	RecordWriter(const RecordWriter&) = delete;
+	RecordWriter& operator=(const RecordWriter&) = delete;
+	RecordWriter(RecordWriter&&) = delete;
+	RecordWriter& operator=(RecordWriter&&) = delete;
+
+PRIVATE_EXCEPT_IN_TEST:
+	static constexpr ::std::size_t k_flushThreshold = 64 * 1024;
+
+	RecordWriter& numberField(::std::uint64_t value);
+	void beginField();
+	void appendCsvString(::std::string_view str);
+	void writeBuffer();
+
+	::std::ostream&	m_out;
+	OutputFormat		m_format;
+	FieldNames			m_fieldNames;
+	::std::size_t		m_fieldIndex;
+	::std::string		m_buffer;
+};
+
+#endif // RECORDWRITER_H_INCLUDED
@@ -0,0 +1,87 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "Exceptions.h"
+#include "RecordWriter.h"
+
+#include <boost/test/unit_test.hpp>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using ::std::logic_error;
+using ::std::ostringstream;
+using ::std::string;
+using ::std::string_view;
+
+static constexpr string_view k_fieldNames[] = { "path", "count", "flag" };
+
+static string writeRecords(OutputFormat format, string_view text)
+{
+	ostringstream out;
+	{
+		RecordWriter writer(out, format, k_fieldNames);
+		writer.field(::std::filesystem::path{"./dir/file.txt"}).field(42u).field(true);
+		writer.endRecord();
+		writer.field(text).field(size_t{0}).field(false);
+		writer.endRecord();
+	}
+	return out.str();
+}
+
+BOOST_AUTO_TEST_SUITE(RecordWriterTestSuite)
+
+BOOST_AUTO_TEST_CASE(jsonlTest)
+{
+	BOOST_CHECK_EQUAL(
+		"{\"path\":\"dir/file.txt\",\"count\":42,\"flag\":true}\n"
+		"{\"path\":\"a\\\"b\\\\c\\n\\t\\u0001\",\"count\":0,\"flag\":false}\n",
+		writeRecords(OutputFormat::jsonl, "a\"b\\c\n\t\x01"));
+}
+
+BOOST_AUTO_TEST_CASE(jsonlUtf8Test)
+{
+	// Valid UTF-8 passes through, and each byte of anything else (including
+	// an encoded surrogate) becomes U+FFFD:
+	BOOST_CHECK_EQUAL(
+		"{\"path\":\"dir/file.txt\",\"count\":42,\"flag\":true}\n"
+		"{\"path\":\"caf\xc3\xa9 \xf0\x9f\x98\x80 \\ufffd\\ufffd x\\ufffd\\ufffd\\ufffd\",\"count\":0,\"flag\":false}\n",
+		writeRecords(OutputFormat::jsonl, "caf\xc3\xa9 \xf0\x9f\x98\x80 \xe9\xff x\xed\xa0\x80"));
+}
+
+BOOST_AUTO_TEST_CASE(csvTest)
+{
+	BOOST_CHECK_EQUAL(
+		"path,count,flag\n"
+		"dir/file.txt,42,true\n"
+		"\"a,\"\"b\"\"\nc\",0,false\n",
+		writeRecords(OutputFormat::csv, "a,\"b\"\nc"));
+}
+
+BOOST_AUTO_TEST_CASE(fieldCountTest)
+{
+	ostringstream out;
+	RecordWriter writer(out, OutputFormat::jsonl, k_fieldNames);
+	writer.field("x");
+	BOOST_CHECK_THROW(writer.endRecord(), logic_error);
+	writer.field(1u).field(true);
+	BOOST_CHECK_THROW(writer.field("y"), logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(parseOutputFormatOptionTest)
+{
+	OutputFormat format = OutputFormat::text;
+	BOOST_CHECK(!parseOutputFormatOption("--cache", format));
+	BOOST_CHECK(!parseOutputFormatOption("--format", format));
+	BOOST_CHECK(parseOutputFormatOption("--format=jsonl", format));
+	BOOST_CHECK(format == OutputFormat::jsonl);
+	BOOST_CHECK(parseOutputFormatOption("--FORMAT=CSV", format));
+	BOOST_CHECK(format == OutputFormat::csv);
+	BOOST_CHECK_THROW(parseOutputFormatOption("--format=xml", format), CmdLineError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
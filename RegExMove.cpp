@@ -19,7 +19,7 @@ using ::std::string;
 using ::std::string_view;
 using ::std::vector;
 
-#if !defined(CMDLINEUTIL_TEST_MODE)
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
 int main(int argCount, const char*const*const argList)
 {
 	return commonMain<RegExMove>(argCount, argList);
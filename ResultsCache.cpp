@@ -0,0 +1,423 @@
+
+#include "ResultsCache.h"
+#include "Decompressor.h"
+#include "Exceptions.h"
+#include "RunStats.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <vector>
+
+#if !defined(_WIN32)
+#	include <fcntl.h>
+#	include <sys/file.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+using ::std::format;
+using ::std::int64_t;
+using ::std::lock_guard;
+using ::std::mutex;
+using ::std::optional;
+using ::std::uint32_t;
+using ::std::uint64_t;
+using ::std::vector;
+
+// The file is a Header followed by a power-of-two number of Slots, forming
+// an open-addressed hash table with linear probing.  All fields are in the
+// native byte order, which is fine for a cache that never leaves the machine.
+struct ResultsCache::Header
+{
+	char			m_magic[8];
+	uint32_t		m_version;
+	uint32_t		m_slotSize;
+	uint64_t		m_numSlots;
+	uint64_t		m_numEntries;
+	uint64_t		m_reserved[4];
+};
+
+struct ResultsCache::Slot
+{
+	uint64_t		m_dev;
+	uint64_t		m_ino;
+	uint64_t		m_size;
+	::std::int64_t	m_mtimeNs;
+	::std::int64_t	m_ctimeNs;
+	uint32_t		m_tool;			// Zero for an empty slot
+	uint32_t		m_lastUsedDay;	// Days since the epoch
+	Payload		m_payload;
+};
+
+static constexpr char k_magic[8] = { 'C', 'L', 'U', 'C', 'A', 'C', 'H', 'E' };
+static constexpr uint32_t k_version = 3;
+static constexpr size_t k_initialNumSlots = 4096;
+static constexpr uint32_t k_maxIdleDays = 30;
+static constexpr int64_t k_nsPerDay = int64_t{86'400} * 1'000'000'000;
+
+static uint64_t hashKey(uint64_t dev, uint64_t ino, uint32_t tool) noexcept
+{
+	// The splitmix64 finalizer, which spreads consecutive inode numbers well:
+	uint64_t h = ino ^ (dev * 0x9e3779b97f4a7c15u) ^ (uint64_t{tool} << 56);
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9u;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebu;
+	return h ^ (h >> 31);
+}
+
+static uint32_t currentDay()
+{
+	return static_cast<uint32_t>(FileKey::currentTimeNs() / k_nsPerDay);
+}
+
+int64_t FileKey::currentTimeNs()
+{
+	return ::std::chrono::duration_cast< ::std::chrono::nanoseconds>(
+		::std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// The clock is read before the stat(), so that it errs on the side of
+// treating the file as racily clean.
+optional<FileKey> ResultsCache::cacheKeyOf(const Path& p) const
+{
+	const auto lookupStartNs = FileKey::currentTimeNs();
+	auto result = keyOf(p);
+	if (result && result->stampNs() >= lookupStartNs - m_clockSlackNs)
+	{
+		result.reset();
+	}
+	return result;
+}
+
+ResultsCache::Header* ResultsCache::header() const noexcept
+{
+	return static_cast<Header*>(m_pMapping);
+}
+
+ResultsCache::Slot* ResultsCache::slots() const noexcept
+{
+	return reinterpret_cast<Slot*>(static_cast<char*>(m_pMapping) + sizeof(Header));
+}
+
+// Returns the slot that holds the entry for the file and tool, or else the
+// empty slot where that entry belongs.  The table is kept at most half full,
+// so the probe finds one or the other unless the file is damaged.  In that
+// case it returns nullptr after visiting every slot, rather than looping
+// forever.
+ResultsCache::Slot* ResultsCache::probe(const FileKey& key, Tool tool) const
+{
+	const auto toolNum = static_cast<uint32_t>(tool);
+	const auto numSlots = header()->m_numSlots;
+	const auto mask = numSlots - 1;
+	auto i = hashKey(key.m_dev, key.m_ino, toolNum) & mask;
+	for (uint64_t numProbes = 0; numProbes < numSlots; ++numProbes, i = (i + 1) & mask)
+	{
+		Slot* pSlot = slots() + i;
+		if (pSlot->m_tool == 0
+			|| (pSlot->m_tool == toolNum && pSlot->m_dev == key.m_dev && pSlot->m_ino == key.m_ino))
+		{
+			return pSlot;
+		}
+	}
+	return nullptr;
+}
+
+// Empties the slot, and moves back into the gap each later entry in the
+// same run of full slots that probe() would otherwise no longer reach:
+// any whose home slot is not after the gap.  Called with m_mutex held.
+void ResultsCache::erase(Slot* pSlot)
+{
+	const auto numSlots = header()->m_numSlots;
+	const auto mask = numSlots - 1;
+	auto gap = static_cast<uint64_t>(pSlot - slots());
+	auto i = (gap + 1) & mask;
+	for (uint64_t numProbes = 1; numProbes < numSlots && slots()[i].m_tool != 0;
+		++numProbes, i = (i + 1) & mask)
+	{
+		const Slot& slot = slots()[i];
+		const auto home = hashKey(slot.m_dev, slot.m_ino, slot.m_tool) & mask;
+		if (((i - home) & mask) >= ((i - gap) & mask))
+		{
+			slots()[gap] = slot;
+			gap = i;
+		}
+	}
+	slots()[gap] = Slot{};
+	--header()->m_numEntries;
+}
+
+// Discards the contents of a table found to be corrupt, just as the
+// constructor does for a corrupt file.  Called with m_mutex held.
+void ResultsCache::reset()
+{
+	unmapFile();
+	mapFile(k_initialNumSlots, true);
+}
+
+optional<ResultsCache::Payload> ResultsCache::findPayload(const FileKey& key, Tool tool) const
+{
+	optional<Payload> result;
+	lock_guard<mutex> lock(m_mutex);
+	if (isEnabled())
+	{
+		Slot* pSlot = probe(key, tool);
+		if (pSlot == nullptr)
+		{
+			const_cast<ResultsCache*>(this)->reset();
+		}
+		else if (pSlot->m_tool != 0
+			&& pSlot->m_size == key.m_size
+			&& pSlot->m_mtimeNs == key.m_mtimeNs
+			&& pSlot->m_ctimeNs == key.m_ctimeNs)
+		{
+			if (const auto today = currentDay(); pSlot->m_lastUsedDay != today)
+			{
+				pSlot->m_lastUsedDay = today;	// Only once a day, to keep the page clean
+			}
+			result = pSlot->m_payload;
+		}
+		else if (pSlot->m_tool != 0
+			&& key.stampNs() > ::std::max(pSlot->m_mtimeNs, pSlot->m_ctimeNs))
+		{
+			// Recorded for an older version of the file, or for a file since
+			// deleted whose inode has been reused.  (A key older than the entry
+			// comes from a lookup that raced with the recording, and evicts
+			// nothing.)
+			const_cast<ResultsCache*>(this)->erase(pSlot);
+		}
+	}
+	return result;
+}
+
+void ResultsCache::insertPayload(const FileKey& key, Tool tool, const Payload& payload)
+{
+	lock_guard<mutex> lock(m_mutex);
+	if (!isEnabled())
+	{
+		return;
+	}
+
+	Slot* pSlot = probe(key, tool);
+	if (pSlot == nullptr)
+	{
+		reset();
+		pSlot = probe(key, tool);
+	}
+	if (pSlot->m_tool == 0)
+	{
+		// Keep the load factor at one half or less:
+		if (2 * (header()->m_numEntries + 1) > header()->m_numSlots)
+		{
+			grow();
+			pSlot = probe(key, tool);
+		}
+		++header()->m_numEntries;
+	}
+	// An existing entry for the file holds the result for an older version
+	// of it, so it is simply overwritten:
+	*pSlot = Slot{key.m_dev, key.m_ino, key.m_size, key.m_mtimeNs, key.m_ctimeNs,
+		static_cast<uint32_t>(tool), currentDay(), payload};
+}
+
+#if defined(_WIN32)
+
+ResultsCache::ResultsCache(const Path& /* cacheFilePath */, int64_t clockSlackNs) :
+	m_fd(-1),
+	m_pMapping(nullptr),
+	m_mappingSize(0),
+	m_clockSlackNs(clockSlackNs),
+	m_mutex()
+{
+	throw IOError("The results cache is not supported on Windows");
+}
+
+ResultsCache::~ResultsCache()
+{
+}
+
+optional<FileKey> ResultsCache::keyOf(const Path& /* p */)
+{
+	return optional<FileKey>{};
+}
+
+void ResultsCache::mapFile(size_t /* numSlots */, bool /* isNew */)
+{
+}
+
+void ResultsCache::unmapFile() noexcept
+{
+}
+
+void ResultsCache::grow()
+{
+}
+
+#else
+
+ResultsCache::ResultsCache(const Path& cacheFilePath, int64_t clockSlackNs) :
+	m_fd(::open(cacheFilePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)),
+	m_pMapping(nullptr),
+	m_mappingSize(0),
+	m_clockSlackNs(clockSlackNs),
+	m_mutex()
+{
+	if (m_fd < 0)
+	{
+		throw IOError(format("Unable to open cache file '{0}':  {1}",
+			cacheFilePath.generic_string(), ::std::strerror(errno)));
+	}
+	if (::flock(m_fd, LOCK_EX | LOCK_NB) < 0)
+	{
+		return;	// In use by another process, so run without it
+	}
+
+	struct stat status;
+	if (::fstat(m_fd, &status) < 0)
+	{
+		::close(m_fd);
+		throw IOError(format("Unable to stat cache file '{0}':  {1}",
+			cacheFilePath.generic_string(), ::std::strerror(errno)));
+	}
+
+	// Use the existing contents only if they are intact and of this version:
+	Header existing{};
+	const auto fileSize = static_cast<size_t>(status.st_size);
+	bool isUsable = fileSize >= sizeof(Header)
+		&& ::pread(m_fd, &existing, sizeof(existing), 0) == static_cast<ssize_t>(sizeof(existing))
+		&& ::std::equal(::std::begin(k_magic), ::std::end(k_magic), existing.m_magic)
+		&& existing.m_version == k_version
+		&& existing.m_slotSize == sizeof(Slot)
+		&& existing.m_numSlots >= k_initialNumSlots
+		&& (existing.m_numSlots & (existing.m_numSlots - 1)) == 0
+		&& existing.m_numEntries < existing.m_numSlots
+		&& fileSize == sizeof(Header) + existing.m_numSlots * sizeof(Slot);
+	try
+	{
+		mapFile(isUsable ? static_cast<size_t>(existing.m_numSlots) : k_initialNumSlots, !isUsable);
+	}
+	catch (...)
+	{
+		::close(m_fd);
+		throw;
+	}
+}
+
+ResultsCache::~ResultsCache()
+{
+	unmapFile();
+	::close(m_fd);	// Also releases the lock
+}
+
+optional<FileKey> ResultsCache::keyOf(const Path& p)
+{
+	optional<FileKey> result;
+	RunStats::countMetadataCalls();
+	struct stat status;
+	if (::stat(p.c_str(), &status) == 0)
+	{
+#if defined(__APPLE__)
+		const auto& mtime = status.st_mtimespec;
+		const auto& ctime = status.st_ctimespec;
+#else
+		const auto& mtime = status.st_mtim;
+		const auto& ctime = status.st_ctim;
+#endif
+		result = FileKey{
+			static_cast<uint64_t>(status.st_dev),
+			static_cast<uint64_t>(status.st_ino),
+			static_cast<uint64_t>(status.st_size),
+			static_cast< ::std::int64_t>(mtime.tv_sec) * 1'000'000'000 + mtime.tv_nsec,
+			static_cast< ::std::int64_t>(ctime.tv_sec) * 1'000'000'000 + ctime.tv_nsec};
+	}
+	return result;
+}
+
+// Maps the file sized for numSlots.  If isNew, the file is (re)initialized
+// as an empty table; otherwise its contents are used as they are.
+void ResultsCache::mapFile(size_t numSlots, bool isNew)
+{
+	const size_t mappingSize = sizeof(Header) + numSlots * sizeof(Slot);
+	if (isNew && (::ftruncate(m_fd, 0) < 0
+		|| ::ftruncate(m_fd, static_cast<off_t>(mappingSize)) < 0))	// Zero-filled
+	{
+		throw IOError(format("Unable to resize cache file:  {0}", ::std::strerror(errno)));
+	}
+
+	void* pMapping = ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (pMapping == MAP_FAILED)
+	{
+		throw IOError(format("Unable to map cache file:  {0}", ::std::strerror(errno)));
+	}
+	m_pMapping = pMapping;
+	m_mappingSize = mappingSize;
+
+	if (isNew)
+	{
+		Header* pHeader = header();
+		::std::copy(::std::begin(k_magic), ::std::end(k_magic), pHeader->m_magic);
+		pHeader->m_version = k_version;
+		pHeader->m_slotSize = sizeof(Slot);
+		pHeader->m_numSlots = numSlots;
+		pHeader->m_numEntries = 0;
+	}
+}
+
+void ResultsCache::unmapFile() noexcept
+{
+	if (m_pMapping != nullptr)
+	{
+		::munmap(m_pMapping, m_mappingSize);
+		m_pMapping = nullptr;
+		m_mappingSize = 0;
+	}
+}
+
+// Drops the entries not used for k_maxIdleDays, and then doubles the size
+// of the table, unless that has left it no more than a quarter full.  Called
+// with m_mutex held.
+void ResultsCache::grow()
+{
+	const auto today = currentDay();
+	vector<Slot> entries;
+	entries.reserve(static_cast<size_t>(header()->m_numEntries));
+	::std::copy_if(slots(), slots() + header()->m_numSlots, back_inserter(entries),
+		[today] (const Slot& slot)
+			{ return slot.m_tool != 0 && slot.m_lastUsedDay + k_maxIdleDays >= today; });
+	auto newNumSlots = static_cast<size_t>(header()->m_numSlots);
+	if (4 * (entries.size() + 1) > newNumSlots)
+	{
+		newNumSlots *= 2;
+	}
+
+	unmapFile();
+	mapFile(newNumSlots, true);
+	for (const auto& entry : entries)
+	{
+		*probe(FileKey{entry.m_dev, entry.m_ino, entry.m_size, entry.m_mtimeNs, entry.m_ctimeNs},
+			static_cast<Tool>(entry.m_tool)) = entry;
+	}
+	header()->m_numEntries = entries.size();
+}
+
+#endif
+
+bool isBinaryFile(BlockReader& reader, ResultsCache* pCache, const optional<FileKey>& key)
+{
+	const auto firstBlock = reader.peek();
+	const auto evidence = sniffBinary(firstBlock);
+	if (evidence == BinaryEvidence::none)
+	{
+		return false;
+	}
+	RunStats::countBinaryFileSkipped();
+	// A compressed file is binary only to the paths that rewrite files, which
+	// do not decompress it, so that verdict must not hide it from the others:
+	if (key && detectCompression(firstBlock) == Compression::none)
+	{
+		pCache->insert(*key, evidence);
+	}
+	return true;
+}
@@ -0,0 +1,292 @@
+
+#if !defined(RESULTSCACHE_H_INCLUDED)
+#define RESULTSCACHE_H_INCLUDED
+
+#include "TextScanners.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+
+/// \brief The identity and version of a file, as far as the file system can
+/// tell without reading it.  Any write to the file changes the mtime or the
+/// ctime (or both), so a matching FileKey means matching contents.
+struct FileKey
+{
+	::std::uint64_t	m_dev;
+	::std::uint64_t	m_ino;
+	::std::uint64_t	m_size;
+	::std::int64_t		m_mtimeNs;
+	::std::int64_t		m_ctimeNs;
+
+	/// \brief File system timestamps come from a coarser clock than
+	/// currentTimeNs(), and some file systems round them to as much as two
+	/// seconds.  So a file can be written again without changing its key for
+	/// up to this long after its timestamp.
+	static constexpr ::std::int64_t k_clockSlackNs = 2'000'000'000;
+
+	/// \brief The later of the mtime and the ctime.
+	::std::int64_t stampNs() const noexcept
+		{ return (m_mtimeNs < m_ctimeNs) ? m_ctimeNs : m_mtimeNs; }
+
+	/// \brief Returns the time of the system clock, in nanoseconds since the
+	/// epoch.
+	static ::std::int64_t currentTimeNs();
+};
+
+/// \brief The result cached for isplainascii, which needs to know only
+/// whether it can skip the file.
+struct AsciiVerdict
+{
+	bool m_isPlainAscii;
+};
+
+/// \brief ResultsCache is a persistent, memory-mapped table of per-file scan
+/// results, shared by xeol, stripws, and isplainascii.  It is keyed by the
+/// device and inode of the file, and an entry is valid only as long as the
+/// size, mtime, and ctime of the file still match.  A lookup costs a stat()
+/// and a probe of the mapped table, so a file that hits the cache is never
+/// opened.
+///
+/// A file whose timestamp is within the clock slack of the lookup is
+/// "racily clean":  it could be written again without changing its key, so
+/// no result is recorded for it (see cacheKeyOf()).  An entry that no longer
+/// matches its file is evicted when it is looked up, and before the table
+/// grows, the entries not used for a month are dropped.  Those include the
+/// entries for files since deleted, or replaced by a new inode as many
+/// editors do on every save, which would otherwise never be looked up again.
+///
+/// The cache file is locked for exclusive use while a ResultsCache has it
+/// open.  If another process holds the lock, the cache is simply disabled
+/// for this run:  every lookup misses and nothing is recorded.  Because the
+/// cache is only advisory, a corrupt or incompatible cache file is discarded
+/// and started afresh.
+class ResultsCache
+{
+public:
+	using Path = ::std::filesystem::path;
+
+	/// \brief Opens the cache file, creating it if necessary.  Throws IOError
+	/// if the file cannot be opened or mapped.  clockSlackNs is the window
+	/// within which a file is racily clean.
+	explicit ResultsCache(const Path& cacheFilePath,
+		::std::int64_t clockSlackNs = FileKey::k_clockSlackNs);
+	~ResultsCache();
+
+	bool isEnabled() const noexcept
+		{ return m_pMapping != nullptr; }
+
+	/// \brief Returns the FileKey of p, or nothing if p cannot be stat'ed.
+	static ::std::optional<FileKey> keyOf(const Path& p);
+
+	/// \brief Returns the FileKey under which to look up and record the
+	/// results for p, which is nothing if p cannot be stat'ed or is racily
+	/// clean.  No recorded entry can match a racily clean file anyway, since
+	/// it was recorded only once its timestamp was older than the slack.
+	::std::optional<FileKey> cacheKeyOf(const Path& p) const;
+
+	/// \brief Returns the result recorded for the file by insert() with the
+	/// same isDecompressed.  The paths that rewrite files look up only the
+	/// result for the raw bytes, because they never decompress.
+	template<typename Result>
+	::std::optional<Result> find(const FileKey& key, bool isDecompressed = false) const
+		{
+			::std::optional<Result> result;
+			if (auto payload = findPayload(key, toolOf<Result>(isDecompressed)); payload)
+			{
+				result = Traits<Result>::fromPayload(*payload);
+			}
+			return result;
+		}
+
+	/// \brief Returns the result recorded for the file as the read-only paths
+	/// read it:  decompressed, if it is compressed.
+	template<typename Result>
+	::std::optional<Result> findAsRead(const FileKey& key) const
+		{
+			auto result = find<Result>(key, false);
+			return result ? result : find<Result>(key, true);
+		}
+
+	/// \brief Records the result for the file.  isDecompressed says that it
+	/// was computed from the decompressed contents of a compressed file.
+	template<typename Result>
+	void insert(const FileKey& key, const Result& result, bool isDecompressed = false)
+		{ insertPayload(key, toolOf<Result>(isDecompressed), Traits<Result>::toPayload(result)); }
+
+	ResultsCache(const ResultsCache&) = delete;
+	ResultsCache& operator=(const ResultsCache&) = delete;
+	ResultsCache(ResultsCache&&) = delete;
+	ResultsCache& operator=(ResultsCache&&) = delete;
+
+private:
+	using Payload = ::std::array< ::std::uint64_t, 3>;
+
+	// The values are stored in the cache file, so never renumber them.  A
+	// result computed from the decompressed contents of a compressed file is
+	// stored with k_decompressedToolBit set, apart from any for the raw bytes.
+	enum class Tool : ::std::uint32_t
+	{
+		xeol = 1,
+		stripws = 2,
+		isplainascii = 3,
+		binary = 4	///< Shared by all of the tools, since it depends only on the file
+	};
+	static constexpr ::std::uint32_t k_decompressedToolBit = 0x100;
+
+	template<typename Result> struct Traits;
+
+	template<typename Result>
+	static Tool toolOf(bool isDecompressed) noexcept
+		{
+			return static_cast<Tool>(static_cast< ::std::uint32_t>(Traits<Result>::k_tool)
+				| (isDecompressed ? k_decompressedToolBit : 0));
+		}
+
+	struct Header;
+	struct Slot;
+
+	::std::optional<Payload> findPayload(const FileKey& key, Tool tool) const;
+	void insertPayload(const FileKey& key, Tool tool, const Payload& payload);
+	Slot* probe(const FileKey& key, Tool tool) const;
+	void erase(Slot* pSlot);
+	void reset();
+	Header* header() const noexcept;
+	Slot* slots() const noexcept;
+	void mapFile(::std::size_t numSlots, bool isNew);
+	void unmapFile() noexcept;
+	void grow();
+
+	int						m_fd;
+	void*						m_pMapping;
+	::std::size_t			m_mappingSize;
+	::std::int64_t			m_clockSlackNs;
+	mutable ::std::mutex	m_mutex;
+};
+
+template<> struct ResultsCache::Traits<EolCounts>
+{
+	static constexpr Tool k_tool = Tool::xeol;
+	static Payload toPayload(const EolCounts& counts)
+		{ return {counts.m_numDosEols, counts.m_numMacEols, counts.m_numUnixEols}; }
+	static EolCounts fromPayload(const Payload& payload)
+		{
+			return {static_cast<size_t>(payload[0]), static_cast<size_t>(payload[1]),
+				static_cast<size_t>(payload[2])};
+		}
+};
+
+template<> struct ResultsCache::Traits<WhiteSpaceCounts>
+{
+	static constexpr Tool k_tool = Tool::stripws;
+	static Payload toPayload(const WhiteSpaceCounts& counts)
+		{ return {counts.m_numLinesAffected, counts.m_numSpacesStripped, counts.m_numTabsStripped}; }
+	static WhiteSpaceCounts fromPayload(const Payload& payload)
+		{
+			return {static_cast<size_t>(payload[0]), static_cast<size_t>(payload[1]),
+				static_cast<size_t>(payload[2])};
+		}
+};
+
+template<> struct ResultsCache::Traits<AsciiVerdict>
+{
+	static constexpr Tool k_tool = Tool::isplainascii;
+	static Payload toPayload(const AsciiVerdict& verdict)
+		{ return {verdict.m_isPlainAscii ? 1u : 0u, 0, 0}; }
+	static AsciiVerdict fromPayload(const Payload& payload)
+		{ return {payload[0] != 0}; }
+};
+
+template<> struct ResultsCache::Traits<BinaryEvidence>
+{
+	static constexpr Tool k_tool = Tool::binary;
+	static Payload toPayload(const BinaryEvidence& evidence)
+		{ return {static_cast< ::std::uint64_t>(evidence), 0, 0}; }
+	static BinaryEvidence fromPayload(const Payload& payload)
+		{ return static_cast<BinaryEvidence>(payload[0]); }
+};
+
+/// \brief Returns the result for the file p from the cache if possible, and
+/// otherwise computes it via computeResult() and records it in the cache.  A
+/// null pCache means no caching at all, not even the stat() of p.
+template<typename Result, typename ComputeResult>
+Result findOrCompute(ResultsCache* pCache, const ::std::filesystem::path& p,
+	ComputeResult computeResult)
+{
+	const auto key = (pCache == nullptr)
+		? ::std::optional<FileKey>{}
+		: pCache->cacheKeyOf(p);	// Before reading, so that a racing write invalidates
+	if (key)
+	{
+		if (auto cachedResult = pCache->find<Result>(*key); cachedResult)
+		{
+			return *cachedResult;
+		}
+	}
+	Result result = computeResult();
+	if (key)
+	{
+		pCache->insert(*key, result);
+	}
+	return result;
+}
+
+/// \brief Returns true if the cache records the file with the given key as
+/// binary.
+inline bool isCachedAsBinary(const ResultsCache* pCache, const ::std::optional<FileKey>& key)
+{
+	return key && pCache->find<BinaryEvidence>(*key).has_value();
+}
+
+/// \brief Peeks at the first block of the file through reader, and returns
+/// true if it shows the file to be binary (see sniffBinary()).  If so, and
+/// there is a key, the verdict is recorded in the cache, so that the file is
+/// not opened again until it changes.  (The exception is a compressed file
+/// read without BlockReader::decompressIfCompressed(), which is not cached
+/// as binary, because the paths that decompress it read it as text.)
+bool isBinaryFile(BlockReader& reader, ResultsCache* pCache, const ::std::optional<FileKey>& key);
+
+/// \brief The counterpart of findOrCompute() for the text tools:  returns the
+/// result for the file p from the cache if possible, and otherwise opens p
+/// (decompressing it, if it is gzip or zstd) and, unless it is binary,
+/// computes the result via scanFile(BlockReader&) and records it in the
+/// cache.  Returns nothing for a binary file.
+template<typename Result, typename ScanFile>
+::std::optional<Result> findOrScanTextFile(ResultsCache* pCache, const ::std::filesystem::path& p,
+	::std::pmr::memory_resource* pMemRsrc, ScanFile scanFile)
+{
+	const auto key = (pCache == nullptr)
+		? ::std::optional<FileKey>{}
+		: pCache->cacheKeyOf(p);	// Before reading, so that a racing write invalidates
+	if (isCachedAsBinary(pCache, key))
+	{
+		return ::std::nullopt;
+	}
+	else if (key)
+	{
+		if (auto cachedResult = pCache->findAsRead<Result>(*key); cachedResult)
+		{
+			return cachedResult;
+		}
+	}
+
+	InputFile in(p);
+	BlockReader reader(in.fd(), pMemRsrc);
+	const bool isDecompressed = reader.decompressIfCompressed() != Compression::none;
+	if (isBinaryFile(reader, pCache, key))
+	{
+		return ::std::nullopt;
+	}
+	Result result = scanFile(reader);
+	if (key)
+	{
+		pCache->insert(*key, result, isDecompressed);
+	}
+	return result;
+}
+
+#endif // RESULTSCACHE_H_INCLUDED
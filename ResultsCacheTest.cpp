@@ -0,0 +1,292 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "ResultsCache.h"
+#include "PathDeleter.h"
+
+#include <boost/test/unit_test.hpp>
+#include <cstdint>
+#include <fstream>
+#include <ios>
+
+using ::std::ios_base;
+using ::std::ofstream;
+
+#if !defined(_WIN32)
+
+static const ResultsCache::Path k_cachePath{"ResultsCacheTest.cache"};
+
+static FileKey makeKey(::std::uint64_t ino, ::std::int64_t mtimeNs = 1000)
+{
+	return FileKey{42, ino, 100, mtimeNs, mtimeNs};
+}
+
+BOOST_AUTO_TEST_SUITE(ResultsCacheTestSuite)
+
+BOOST_AUTO_TEST_CASE(findAndInsertTest)
+{
+	PathDeleter deleter(k_cachePath);
+	ResultsCache cache(k_cachePath);
+	BOOST_REQUIRE(cache.isEnabled());
+
+	BOOST_CHECK(!cache.find<EolCounts>(makeKey(1)));
+	cache.insert(makeKey(1), EolCounts{1, 2, 3});
+	cache.insert(makeKey(1), WhiteSpaceCounts{4, 5, 6});
+
+	auto eolCounts = cache.find<EolCounts>(makeKey(1));
+	BOOST_REQUIRE(eolCounts);
+	BOOST_CHECK_EQUAL(1u, eolCounts->m_numDosEols);
+	BOOST_CHECK_EQUAL(2u, eolCounts->m_numMacEols);
+	BOOST_CHECK_EQUAL(3u, eolCounts->m_numUnixEols);
+
+	auto wsCounts = cache.find<WhiteSpaceCounts>(makeKey(1));
+	BOOST_REQUIRE(wsCounts);
+	BOOST_CHECK_EQUAL(4u, wsCounts->m_numLinesAffected);
+
+	// A newer version of the same file misses, and then replaces the old entry:
+	BOOST_CHECK(!cache.find<EolCounts>(makeKey(1, 2000)));
+	cache.insert(makeKey(1, 2000), EolCounts{7, 8, 9});
+	BOOST_CHECK(!cache.find<EolCounts>(makeKey(1)));
+	BOOST_CHECK_EQUAL(7u, cache.find<EolCounts>(makeKey(1, 2000))->m_numDosEols);
+	BOOST_CHECK(!cache.find<AsciiVerdict>(makeKey(1, 2000)));
+}
+
+BOOST_AUTO_TEST_CASE(persistenceAndGrowthTest)
+{
+	PathDeleter deleter(k_cachePath);
+	const ::std::uint64_t numFiles = 10000;	// Enough to force the table to grow
+	{
+		ResultsCache cache(k_cachePath);
+		for (::std::uint64_t i = 0; i < numFiles; ++i)
+		{
+			cache.insert(makeKey(i), AsciiVerdict{i % 2 == 0});
+		}
+	}
+
+	ResultsCache cache(k_cachePath);
+	BOOST_REQUIRE(cache.isEnabled());
+	for (::std::uint64_t i = 0; i < numFiles; ++i)
+	{
+		auto verdict = cache.find<AsciiVerdict>(makeKey(i));
+		BOOST_REQUIRE(verdict);
+		BOOST_CHECK_EQUAL(i % 2 == 0, verdict->m_isPlainAscii);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(lockedCacheIsDisabledTest)
+{
+	PathDeleter deleter(k_cachePath);
+	ResultsCache cache(k_cachePath);
+	ResultsCache otherCache(k_cachePath);
+	BOOST_CHECK(cache.isEnabled());
+	BOOST_CHECK(!otherCache.isEnabled());
+	otherCache.insert(makeKey(1), EolCounts{1, 2, 3});
+	BOOST_CHECK(!otherCache.find<EolCounts>(makeKey(1)));
+}
+
+BOOST_AUTO_TEST_CASE(corruptCacheIsDiscardedTest)
+{
+	PathDeleter deleter(k_cachePath);
+	{
+		ofstream out(k_cachePath, ios_base::out | ios_base::trunc | ios_base::binary);
+		out << "This is not a cache file";
+	}
+	ResultsCache cache(k_cachePath);
+	BOOST_REQUIRE(cache.isEnabled());
+	BOOST_CHECK(!cache.find<EolCounts>(makeKey(1)));
+	cache.insert(makeKey(1), EolCounts{1, 2, 3});
+	BOOST_CHECK(cache.find<EolCounts>(makeKey(1)));
+}
+
+BOOST_AUTO_TEST_CASE(fullCacheIsDiscardedTest)
+{
+	PathDeleter deleter(k_cachePath);
+	{
+		ResultsCache cache(k_cachePath);
+	}
+
+	// Mark every slot in use behind the header's back, as a damaged file
+	// might, so that no probe can find an empty slot:
+	{
+		::std::fstream file(k_cachePath, ios_base::in | ios_base::out | ios_base::binary);
+		::std::uint64_t numSlots = 0;
+		file.seekg(16);
+		file.read(reinterpret_cast<char*>(&numSlots), sizeof(numSlots));
+		BOOST_REQUIRE(numSlots > 0);
+		const ::std::uint32_t tool = 3;
+		for (::std::uint64_t i = 0; i < numSlots; ++i)
+		{
+			file.seekp(static_cast< ::std::streamoff>(64 + 72 * i + 40));
+			file.write(reinterpret_cast<const char*>(&tool), sizeof(tool));
+		}
+		BOOST_REQUIRE(file.flush());
+	}
+
+	ResultsCache cache(k_cachePath);
+	BOOST_REQUIRE(cache.isEnabled());
+	BOOST_CHECK(!cache.find<AsciiVerdict>(makeKey(1)));
+	cache.insert(makeKey(1), AsciiVerdict{true});
+	BOOST_CHECK(cache.find<AsciiVerdict>(makeKey(1)));
+}
+
+BOOST_AUTO_TEST_CASE(findOrComputeTest)
+{
+	PathDeleter deleter(k_cachePath);
+	const ResultsCache::Path filePath{"ResultsCacheTestInput.txt"};
+	PathDeleter fileDeleter(filePath);
+	{
+		ofstream out(filePath, ios_base::out | ios_base::trunc | ios_base::binary);
+		out << "a\nb\n";
+	}
+
+	ResultsCache cache(k_cachePath, 0);	// So that the file just written is not racily clean
+	int numComputations = 0;
+	auto compute = [&numComputations] ()
+		{
+			++numComputations;
+			return EolCounts{0, 0, 2};
+		};
+	BOOST_CHECK_EQUAL(2u, findOrCompute<EolCounts>(&cache, filePath, compute).m_numUnixEols);
+	BOOST_CHECK_EQUAL(2u, findOrCompute<EolCounts>(&cache, filePath, compute).m_numUnixEols);
+	BOOST_CHECK_EQUAL(1, numComputations);
+
+	{
+		ofstream out(filePath, ios_base::out | ios_base::app | ios_base::binary);
+		out << "c\n";
+	}
+	findOrCompute<EolCounts>(&cache, filePath, compute);
+	BOOST_CHECK_EQUAL(2, numComputations);
+}
+
+BOOST_AUTO_TEST_CASE(findOrScanTextFileTest)
+{
+	PathDeleter deleter(k_cachePath);
+	const ResultsCache::Path textPath{"ResultsCacheTestInput.txt"};
+	const ResultsCache::Path binaryPath{"ResultsCacheTestInput.bin"};
+	PathDeleter textDeleter(textPath);
+	PathDeleter binaryDeleter(binaryPath);
+	ofstream(textPath, ios_base::binary) << "a\nb\n";
+	ofstream(binaryPath, ios_base::binary) << "a\nb\n" << '\0';
+
+	ResultsCache cache(k_cachePath, 0);
+	int numScans = 0;
+	auto scan = [&numScans] (BlockReader& reader)
+		{
+			++numScans;
+			EolScanner scanner;
+			reader.feed(scanner);
+			return scanner.finish();
+		};
+	auto pMemRsrc = ::std::pmr::get_default_resource();
+	BOOST_CHECK(!findOrScanTextFile<EolCounts>(&cache, binaryPath, pMemRsrc, scan));
+	BOOST_CHECK(isCachedAsBinary(&cache, ResultsCache::keyOf(binaryPath)));
+	BOOST_CHECK(!findOrScanTextFile<EolCounts>(&cache, binaryPath, pMemRsrc, scan));
+	BOOST_CHECK_EQUAL(0, numScans);
+
+	// The peeked first block is still scanned:
+	BOOST_CHECK_EQUAL(2u, findOrScanTextFile<EolCounts>(&cache, textPath, pMemRsrc, scan)->m_numUnixEols);
+	BOOST_CHECK_EQUAL(2u, findOrScanTextFile<EolCounts>(&cache, textPath, pMemRsrc, scan)->m_numUnixEols);
+	BOOST_CHECK_EQUAL(1, numScans);
+	BOOST_CHECK(!isCachedAsBinary(&cache, ResultsCache::keyOf(textPath)));
+}
+
+BOOST_AUTO_TEST_CASE(racilyCleanFileIsNotRecordedTest)
+{
+	PathDeleter deleter(k_cachePath);
+	const ResultsCache::Path filePath{"ResultsCacheTestInput.txt"};
+	PathDeleter fileDeleter(filePath);
+	ofstream(filePath, ios_base::binary) << "a\nb\n";
+
+	ResultsCache cache(k_cachePath);
+	BOOST_CHECK(ResultsCache::keyOf(filePath));
+	BOOST_CHECK(!cache.cacheKeyOf(filePath));
+	int numComputations = 0;
+	auto compute = [&numComputations] ()
+		{
+			++numComputations;
+			return EolCounts{0, 0, 2};
+		};
+	findOrCompute<EolCounts>(&cache, filePath, compute);
+	findOrCompute<EolCounts>(&cache, filePath, compute);
+	BOOST_CHECK_EQUAL(2, numComputations);
+}
+
+static ::std::uint64_t readHeaderField(::std::streamoff offset)
+{
+	::std::uint64_t value = 0;
+	::std::ifstream file(k_cachePath, ios_base::in | ios_base::binary);
+	file.seekg(offset);
+	file.read(reinterpret_cast<char*>(&value), sizeof(value));
+	return value;
+}
+
+static ::std::uint64_t numSlots()
+{
+	return readHeaderField(16);
+}
+
+static ::std::uint64_t numEntries()
+{
+	return readHeaderField(24);
+}
+
+BOOST_AUTO_TEST_CASE(staleEntryIsEvictedTest)
+{
+	PathDeleter deleter(k_cachePath);
+	{
+		ResultsCache cache(k_cachePath);
+		for (::std::uint64_t i = 0; i < 100; ++i)
+		{
+			cache.insert(makeKey(i), AsciiVerdict{true});
+		}
+		BOOST_CHECK(!cache.find<AsciiVerdict>(makeKey(7, 2000)));
+		BOOST_CHECK(!cache.find<AsciiVerdict>(makeKey(7)));
+		for (::std::uint64_t i = 0; i < 100; ++i)
+		{
+			BOOST_CHECK(i == 7 || cache.find<AsciiVerdict>(makeKey(i)));
+		}
+	}
+	BOOST_CHECK_EQUAL(99u, numEntries());
+}
+
+BOOST_AUTO_TEST_CASE(idleEntriesAreDroppedTest)
+{
+	PathDeleter deleter(k_cachePath);
+	const ::std::uint64_t numFiles = 2048;	// As many as fit before the table grows
+	{
+		ResultsCache cache(k_cachePath);
+		for (::std::uint64_t i = 0; i < numFiles; ++i)
+		{
+			cache.insert(makeKey(i), AsciiVerdict{true});
+		}
+	}
+	const auto initialNumSlots = numSlots();
+	BOOST_REQUIRE_EQUAL(numFiles, numEntries());
+
+	// Mark every entry as last used long ago:
+	{
+		::std::fstream file(k_cachePath, ios_base::in | ios_base::out | ios_base::binary);
+		const ::std::uint32_t lastUsedDay = 1;
+		for (::std::uint64_t i = 0; i < initialNumSlots; ++i)
+		{
+			file.seekp(static_cast< ::std::streamoff>(64 + 72 * i + 44));
+			file.write(reinterpret_cast<const char*>(&lastUsedDay), sizeof(lastUsedDay));
+		}
+		BOOST_REQUIRE(file.flush());
+	}
+
+	{
+		ResultsCache cache(k_cachePath);
+		cache.insert(makeKey(numFiles), AsciiVerdict{true});
+		BOOST_CHECK(cache.find<AsciiVerdict>(makeKey(numFiles)));
+		BOOST_CHECK(!cache.find<AsciiVerdict>(makeKey(0)));
+	}
+	BOOST_CHECK_EQUAL(initialNumSlots, numSlots());
+	BOOST_CHECK_EQUAL(1u, numEntries());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
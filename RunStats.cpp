@@ -0,0 +1,261 @@
+
+#include "RunStats.h"
+#include "AllocationStats.h"
+#include "TraceRecorder.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#	include <sys/resource.h>
+#endif
+
+using ::std::array;
+using ::std::atomic;
+using ::std::lock_guard;
+using ::std::mutex;
+using ::std::ostream;
+using ::std::pair;
+using ::std::string;
+using ::std::string_view;
+using ::std::uint64_t;
+using ::std::vector;
+
+using Seconds = ::std::chrono::duration<double>;
+using SlowFile = pair<RunStats::Clock::duration, string>;
+
+static constexpr size_t k_numSlowestFiles = 10;
+static constexpr auto k_numPhases = static_cast<size_t>(RunStats::Phase::numPhases);
+static constexpr array<string_view, k_numPhases> k_phaseNames =
+	{ "Enumeration", "Opening", "Reading", "Scanning", "Writing", "Other" };
+static constexpr array<const char*, k_numPhases> k_traceSpanNames =
+	{ "enumerate", "open", "read", "scan", "write", "other" };
+
+static RunStats::Clock::time_point g_startTime;
+static array<atomic<uint64_t>, k_numPhases> g_phaseTimesNs{};
+static atomic<uint64_t> g_numFiles{0};
+static atomic<uint64_t> g_numBytesRead{0};
+static atomic<uint64_t> g_numBytesWritten{0};
+static atomic<uint64_t> g_numMetadataCalls{0};
+static atomic<uint64_t> g_numBinaryFilesSkipped{0};
+
+static mutex g_slowestFilesMutex;
+static vector<SlowFile> g_slowestFiles;	// Sorted, slowest first
+
+static thread_local RunStats::PhaseTimer* t_pActiveTimer = nullptr;
+
+static uint64_t toNs(RunStats::Clock::duration elapsed) noexcept
+{
+	return static_cast<uint64_t>(
+		::std::chrono::duration_cast< ::std::chrono::nanoseconds>(elapsed).count());
+}
+
+static void chargePhase(RunStats::Phase phase, RunStats::Clock::time_point start,
+	RunStats::Clock::time_point end) noexcept
+{
+	const auto phaseIndex = static_cast<size_t>(phase);
+	g_phaseTimesNs[phaseIndex].fetch_add(toNs(end - start), ::std::memory_order_relaxed);
+	if (TraceRecorder::isEnabled())
+	{
+		TraceRecorder::recordSpan(k_traceSpanNames[phaseIndex], start, end);
+	}
+}
+
+void RunStats::enable()
+{
+	g_startTime = Clock::now();
+	s_isEnabled.store(true);
+}
+
+#if defined(CMDLINEUTIL_TEST_MODE)
+void RunStats::reset()
+{
+	s_isEnabled.store(false);
+	for (auto& phaseTimeNs : g_phaseTimesNs)
+	{
+		phaseTimeNs.store(0);
+	}
+	g_numFiles.store(0);
+	g_numBytesRead.store(0);
+	g_numBytesWritten.store(0);
+	g_numMetadataCalls.store(0);
+	g_numBinaryFilesSkipped.store(0);
+	lock_guard<mutex> lock(g_slowestFilesMutex);
+	g_slowestFiles.clear();
+}
+#endif
+
+void RunStats::countMetadataCalls(size_t numCalls /* = 1 */) noexcept
+{
+	if (isEnabled())
+	{
+		g_numMetadataCalls.fetch_add(numCalls, ::std::memory_order_relaxed);
+	}
+}
+
+void RunStats::countBytesRead(size_t numBytes) noexcept
+{
+	if (isEnabled())
+	{
+		g_numBytesRead.fetch_add(numBytes, ::std::memory_order_relaxed);
+	}
+}
+
+void RunStats::countBytesWritten(size_t numBytes) noexcept
+{
+	if (isEnabled())
+	{
+		g_numBytesWritten.fetch_add(numBytes, ::std::memory_order_relaxed);
+	}
+}
+
+void RunStats::countBinaryFileSkipped() noexcept
+{
+	if (isEnabled())
+	{
+		g_numBinaryFilesSkipped.fetch_add(1, ::std::memory_order_relaxed);
+	}
+}
+
+void RunStats::recordFile(const Path& p, Clock::time_point start, Clock::time_point end) noexcept
+{
+	if (TraceRecorder::isEnabled())
+	{
+		TraceRecorder::recordSpan("file", start, end, &p);
+	}
+
+	const auto elapsed = end - start;
+	g_numFiles.fetch_add(1, ::std::memory_order_relaxed);
+	try
+	{
+		lock_guard<mutex> lock(g_slowestFilesMutex);
+		if (g_slowestFiles.size() < k_numSlowestFiles || elapsed > g_slowestFiles.back().first)
+		{
+			auto it = ::std::upper_bound(g_slowestFiles.begin(), g_slowestFiles.end(), elapsed,
+				[] (Clock::duration lhs, const SlowFile& rhs) { return lhs > rhs.first; });
+			g_slowestFiles.emplace(it, elapsed, p.generic_string());
+			if (g_slowestFiles.size() > k_numSlowestFiles)
+			{
+				g_slowestFiles.pop_back();
+			}
+		}
+	}
+	catch (...)
+	{
+		// Losing one entry is better than failing the file
+	}
+}
+
+void RunStats::PhaseTimer::start() noexcept
+{
+	m_start = Clock::now();
+	m_pOuter = t_pActiveTimer;
+	if (m_pOuter != nullptr)
+	{
+		chargePhase(m_pOuter->m_phase, m_pOuter->m_start, m_start);
+	}
+	t_pActiveTimer = this;
+}
+
+void RunStats::PhaseTimer::stop() noexcept
+{
+	const auto now = Clock::now();
+	chargePhase(m_phase, m_start, now);
+	t_pActiveTimer = m_pOuter;
+	if (m_pOuter != nullptr)
+	{
+		m_pOuter->m_start = now;	// Resume the outer timer
+	}
+}
+
+RunStats::FileTimer::~FileTimer()
+{
+	if (m_start != Clock::time_point{})
+	{
+		// Stop the phase timer first, so that its last span ends within the
+		// span of the file:
+		if (m_phaseTimer.m_isRunning)
+		{
+			m_phaseTimer.stop();
+			m_phaseTimer.m_isRunning = false;
+		}
+		recordFile(m_path, m_start, Clock::now());
+	}
+}
+
+// In KiB, or zero where unknown
+static uint64_t peakRssKiB()
+{
+#if defined(_WIN32)
+	return 0;
+#else
+	struct rusage usage;
+	if (::getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#	if defined(__APPLE__)
+	return static_cast<uint64_t>(usage.ru_maxrss) / 1024;	// In bytes on macOS
+#	else
+	return static_cast<uint64_t>(usage.ru_maxrss);
+#	endif
+#endif
+}
+
+void RunStats::report(ostream& out)
+{
+	const auto elapsed = Seconds(Clock::now() - g_startTime).count();
+	auto perSecond = [elapsed] (double amount) { return (elapsed > 0.0) ? amount / elapsed : 0.0; };
+	const auto numFiles = g_numFiles.load();
+	const auto numBytesRead = g_numBytesRead.load();
+
+	out << "\nStatistics:\n";
+	formatTo(out, "   {0:<16}{1:10.3f} s\n", "Elapsed time:", elapsed);
+	for (size_t i = 0; i < k_numPhases; ++i)
+	{
+		formatTo(out, "   {0:<16}{1:10.3f} s\n", string{k_phaseNames[i]} + ':',
+			static_cast<double>(g_phaseTimesNs[i].load()) / 1e9);
+	}
+	formatTo(out, "   {0:<16}{1:10} ({2:.1f} files/s)\n", "Files:", numFiles,
+		perSecond(static_cast<double>(numFiles)));
+	formatTo(out, "   {0:<16}{1:10} ({2:.1f} MB/s)\n", "Bytes read:", numBytesRead,
+		perSecond(static_cast<double>(numBytesRead) / 1e6));
+	formatTo(out, "   {0:<16}{1:10}\n", "Bytes written:", g_numBytesWritten.load());
+	formatTo(out, "   {0:<16}{1:10}\n", "Metadata calls:", g_numMetadataCalls.load());
+	if (const auto numBinaryFiles = g_numBinaryFilesSkipped.load(); numBinaryFiles > 0)
+	{
+		formatTo(out, "   {0:<16}{1:10}\n", "Binary skipped:", numBinaryFiles);
+	}
+	if (AllocationStats::isCounting())
+	{
+		const auto allocations = AllocationStats::total();
+		auto perFile = [numFiles] (uint64_t amount)
+			{ return (numFiles > 0) ? static_cast<double>(amount) / static_cast<double>(numFiles) : 0.0; };
+		formatTo(out, "   {0:<16}{1:10} ({2:.1f} per file)\n", "Allocations:",
+			allocations.m_numAllocations, perFile(allocations.m_numAllocations));
+		formatTo(out, "   {0:<16}{1:10} ({2:.1f} per file)\n", "Bytes allocated:",
+			allocations.m_numBytes, perFile(allocations.m_numBytes));
+	}
+	if (const auto peakRss = peakRssKiB(); peakRss > 0)
+	{
+		formatTo(out, "   {0:<16}{1:10} KiB\n", "Peak RSS:", peakRss);
+	}
+
+	lock_guard<mutex> lock(g_slowestFilesMutex);
+	if (!g_slowestFiles.empty())
+	{
+		out << "   Slowest files:\n";
+		for (const auto& [fileElapsed, filePath] : g_slowestFiles)
+		{
+			formatTo(out, "      {0:9.6f} s  {1}\n", Seconds(fileElapsed).count(), filePath);
+		}
+	}
+	out.flush();
+}
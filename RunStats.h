@@ -0,0 +1,123 @@
+
+#if !defined(RUNSTATS_H_INCLUDED)
+#define RUNSTATS_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+
+/// \brief RunStats gathers the process-wide statistics reported by the
+/// --stats option of every tool:  the time spent in each phase of the work,
+/// the number of files and bytes processed, the number of filesystem
+/// metadata calls, the number of binary files skipped, and the slowest files.
+///
+/// Nothing is gathered until enable() is called, and until then each
+/// PhaseTimer and FileTimer costs a single relaxed load.  All of the
+/// counters are safe to update from any thread.
+///
+/// When TraceRecorder is enabled as well, each timer also records its span:
+/// a PhaseTimer records the stretches of time charged to its phase, and a
+/// FileTimer records the whole of the file, with its path.
+class RunStats
+{
+public:
+	using Clock = ::std::chrono::steady_clock;
+	using Path = ::std::filesystem::path;
+
+	enum class Phase
+	{
+		enumeration,	///< Traversing directories and matching file names
+		opening,			///< Opening the input files
+		reading,			///< Reading the input files
+		scanning,		///< Scanning the input, less the time spent reading
+		writing,			///< Writing rewritten files, and renaming them into place
+		other,			///< The rest of processing a file, such as reporting
+		numPhases
+	};
+
+	static void enable();
+	static bool isEnabled() noexcept
+		{ return s_isEnabled.load(::std::memory_order_relaxed); }
+
+	static void countMetadataCalls(::std::size_t numCalls = 1) noexcept;
+	static void countBytesRead(::std::size_t numBytes) noexcept;
+	static void countBytesWritten(::std::size_t numBytes) noexcept;
+	/// \brief Counts a file that a text tool skipped because it is binary.
+	static void countBinaryFileSkipped() noexcept;
+
+	/// \brief Writes the statistics gathered since enable() to out.
+	static void report(::std::ostream& out);
+
+	class FileTimer;
+
+	/// \brief Charges the time from its construction to its destruction to
+	/// one phase.  Timers nest:  while an inner timer runs on the same thread,
+	/// the outer one is paused, so each phase gets only its own time.
+	class PhaseTimer
+	{
+	public:
+		explicit PhaseTimer(Phase phase) noexcept :
+			m_phase(phase), m_isRunning(isEnabled()), m_start(), m_pOuter(nullptr)
+			{ if (m_isRunning) { start(); } }
+		~PhaseTimer()
+			{ if (m_isRunning) { stop(); } }
+
+		PhaseTimer(const PhaseTimer&) = delete;
+		PhaseTimer& operator=(const PhaseTimer&) = delete;
+		PhaseTimer(PhaseTimer&&) = delete;
+		PhaseTimer& operator=(PhaseTimer&&) = delete;
+
+	private:
+		friend class FileTimer;
+
+		void start() noexcept;
+		void stop() noexcept;
+
+		Phase					m_phase;
+		bool					m_isRunning;
+		Clock::time_point	m_start;
+		PhaseTimer*			m_pOuter;
+	};
+
+	/// \brief Times the processing of one file, for the files/s figure and
+	/// the list of slowest files.  The time not claimed by an inner
+	/// PhaseTimer is charged to Phase::other.
+	class FileTimer
+	{
+	public:
+		explicit FileTimer(const Path& p) noexcept :
+			m_path(p), m_start(isEnabled() ? Clock::now() : Clock::time_point{}),
+			m_phaseTimer(Phase::other)
+			{}
+		~FileTimer();
+
+		FileTimer(const FileTimer&) = delete;
+		FileTimer& operator=(const FileTimer&) = delete;
+		FileTimer(FileTimer&&) = delete;
+		FileTimer& operator=(FileTimer&&) = delete;
+
+	private:
+		const Path&			m_path;
+		Clock::time_point	m_start;
+		PhaseTimer			m_phaseTimer;
+	};
+
+	RunStats() = delete;
+
+#if defined(CMDLINEUTIL_TEST_MODE)
+	// Testing facilities:
+	/// \brief Disables the statistics and clears what has been gathered.
+	/// Call this only while no timer is running.
+	static void reset();
+#endif
+
+private:
+	static void recordFile(const Path& p, Clock::time_point start, Clock::time_point end) noexcept;
+
+	static inline ::std::atomic<bool> s_isEnabled{false};
+};
+
+#endif // RUNSTATS_H_INCLUDED
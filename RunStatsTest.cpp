@@ -0,0 +1,64 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "BlockReader.h"
+#include "FileEnumerator.h"
+#include "PathDeleter.h"
+#include "RunStats.h"
+
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fs = ::std::filesystem;
+
+using ::std::ofstream;
+using ::std::ostringstream;
+using ::std::string;
+
+// Leaves the statistics disabled for the tests that follow:
+struct RunStatsFixture
+{
+	RunStatsFixture()
+		{ RunStats::enable(); }
+	~RunStatsFixture()
+		{ RunStats::reset(); }
+};
+
+BOOST_AUTO_TEST_SUITE(RunStatsTestSuite)
+
+BOOST_AUTO_TEST_CASE(reportTest)
+{
+	const fs::path testDir{"RunStatsTestDir"};
+	PathDeleter testDirDeleter(testDir);
+	create_directories(testDir);
+	{
+		ofstream out(testDir / "a.txt");
+		out << string(100'000, 'x');
+	}
+
+	RunStatsFixture fixture;
+	FileEnumerator fe;
+	fe.insert(testDir / "*.txt");
+	fe.enumerateFiles([] (const fs::path& p)
+		{
+			InputFile in(p);
+			BlockReader(in.fd()).forEachBlock([] (ByteSpan) {});
+		});
+
+	ostringstream out;
+	RunStats::report(out);
+	const auto report = out.str();
+	for (auto pLabel : { "Elapsed time:", "Enumeration:", "Opening:", "Reading:",
+		"Scanning:", "Writing:", "Files:", "Bytes read:", "Bytes written:",
+		"Metadata calls:", "Allocations:", "Bytes allocated:", "Slowest files:" })
+	{
+		BOOST_CHECK_MESSAGE(report.find(pLabel) != string::npos, pLabel);
+	}
+	BOOST_CHECK(report.find("RunStatsTestDir/a.txt") != string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,622 @@
+
+#include "ScanServer.h"
+#include "FileEnumerator.h"
+#include "FileRewriter.h"
+#include "MemoryBudget.h"
+#include "PathDeleter.h"
+#include "ScratchArena.h"
+#include "TextScanners.h"
+#include "main.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#	include <csignal>
+#	include <fcntl.h>
+#	include <poll.h>
+#	include <sys/socket.h>
+#	include <sys/stat.h>
+#	include <sys/un.h>
+#	include <unistd.h>
+#endif
+
+namespace json = ::boost::json;
+
+using ::std::cout;
+using ::std::endl;
+using ::std::error_code;
+using ::std::format;
+using ::std::invalid_argument;
+using ::std::lock_guard;
+using ::std::make_unique;
+using ::std::mutex;
+using ::std::ostream;
+using ::std::string;
+using ::std::string_view;
+using ::std::thread;
+using ::std::unique_ptr;
+using ::std::vector;
+
+// How often the blocking calls wake up to poll the CancellationToken:
+static constexpr int k_pollIntervalMs = 250;
+
+// What a worker holds while serving a request:  its read, decompression, and
+// write buffers, and the scratch state of the scan:
+static constexpr size_t k_numBytesPerWorker = 4 * BlockReader::k_blockSize;
+
+// The longest request line accepted.  A client that sends more without a
+// newline is answered with an error and disconnected, so that it cannot run
+// the server out of memory:
+static constexpr size_t k_maxRequestLength = 1024 * 1024;
+
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
+int main(int argCount, const char*const*const argList)
+{
+	return commonMain<ScanServer>(argCount, argList);
+}
+#endif
+
+int ScanServer::usage(ostream& out, string_view progName, const char* pMsg)
+{
+	int exitCode = EXIT_SUCCESS;
+	if (pMsg != nullptr && *pMsg != '\0')
+	{
+		exitCode = EXIT_FAILURE;
+		out << endl << pMsg << endl;
+	}
+	out << "\n"
+		"Usage:  " << progName << " --serve <socket-path> [--cache <file>]\n"
+		"\n"
+		"Listens on the Unix domain socket <socket-path> and answers the same\n"
+		"questions as xeol, stripws, isplainascii, and indents, without the cost\n"
+		"of starting a process for each one.  Stop the server with SIGINT or\n"
+		"SIGTERM.  With --cache, the server keeps the results in the cache file\n"
+		"<file>, just as the tools do with the same option.  Only the user who\n"
+		"runs the server may connect to the socket.\n"
+		"\n"
+		"Each request is a single line containing a JSON object such as\n"
+		"\n"
+		"   {\"id\": 1, \"op\": \"eol\", \"paths\": [\"src/*.cpp\"], \"recursive\": true}\n"
+		"\n"
+		"where \"id\" is optional and is echoed in every line of the response, and\n"
+		"\"op\" is one of:\n"
+		"\n"
+		"   eol      Reports the end-of-line type (like xeol)\n"
+		"   xeol     Translates the ends of line to \"target\", which is one of\n"
+		"            \"dos\", \"mac\", or \"unix\" (like xeol -d, -m, or -u).  Set\n"
+		"            \"force\" to true to translate mixed files (like xeol -f)\n"
+		"   ws       Reports white space at the ends of lines (like stripws -s)\n"
+		"   stripws  Strips white space from the ends of lines (like stripws)\n"
+		"   ascii    Reports runs of non-ASCII characters (like isplainascii)\n"
+		"   indents  Reports the indentation type (like indents)\n"
+		"   ping     Does nothing\n"
+		"\n"
+		"The response is one line of JSON for each file, as soon as that file is\n"
+		"done, followed by a line containing \"done\": true.  Relative paths are\n"
+		"resolved against the working directory of the server.  A request line\n"
+		"longer than 1 MiB is refused, and the connection closed.\n"
+		<< endl;
+
+	return exitCode;
+}
+
+ScanServer::ScanServer(::std::span<const char*const> args) :
+	m_socketPath(),
+	m_cachePath(),
+	m_numThreads(MemoryBudget::fitWorkerCount(::std::max(thread::hardware_concurrency(), 1u),
+		k_numBytesPerWorker))
+{
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		auto pArg = args[i];
+		if (isIEqual(pArg, "-?") || isIEqual(pArg, "-h") || isIEqual(pArg, "-help"))
+		{
+			throw CmdLineError();
+		}
+		else if (isIEqual(pArg, "--serve"))
+		{
+			m_socketPath = getOptionValue(args, i);
+		}
+		else if (isIEqual(pArg, "--cache"))
+		{
+			m_cachePath = getOptionValue(args, i);
+		}
+		else
+		{
+			throw CmdLineError(format("Unrecognized argument '{0}'", pArg));
+		}
+	}
+
+	if (m_socketPath.empty())
+	{
+		throw CmdLineError("No socket specified");
+	}
+#if defined(_WIN32)
+	throw CmdLineError("The option '--serve' is not supported on Windows");
+#endif
+}
+
+// ============================ Requests ============================
+
+// Serializes the rewrites of each file, because two requests that rewrite the
+// same file at once would otherwise interleave their renames and lose one of
+// the rewrites, or the file.  A file hashes to one of a fixed set of mutexes,
+// so that unrelated files seldom wait on each other.
+class RewriteLock
+{
+public:
+	explicit RewriteLock(const ScanServer::Path& p) : m_lock(mutexFor(p)) {}
+
+private:
+	static mutex& mutexFor(const ScanServer::Path& p)
+	{
+		static mutex s_mutexes[64];
+
+		// Different spellings of the same path must share a mutex:
+		error_code ec;
+		const auto canonicalPath = weakly_canonical(p, ec);
+		return s_mutexes[hash_value(ec ? p : canonicalPath) % ::std::size(s_mutexes)];
+	}
+
+	lock_guard<mutex> m_lock;
+};
+
+void ScanServer::handleRequest(string_view requestLine, const Responder& respond,
+	ResultsCache* pCache /* = nullptr */)
+{
+	JValue id;	// null unless the request supplies one
+	auto respondWithError = [&id, &respond] (string_view message)
+		{ respond(JObject{{"id", id}, {"error", message}, {"done", true}}); };
+
+	error_code ec;
+	auto request = json::parse(requestLine, ec);
+	if (ec || !request.is_object())
+	{
+		respondWithError("Request is not a JSON object");
+		return;
+	}
+	const auto& requestObj = request.get_object();
+	if (auto pId = requestObj.if_contains("id"); pId != nullptr)
+	{
+		id = *pId;
+	}
+
+	auto pOp = requestObj.if_contains("op");
+	if (pOp == nullptr || !pOp->is_string())
+	{
+		respondWithError("Request has no \"op\"");
+		return;
+	}
+	const string_view op = pOp->get_string();
+	if (op == "ping")
+	{
+		respond(JObject{{"id", id}, {"done", true}});
+		return;
+	}
+	else if (op != "eol" && op != "xeol" && op != "ws" && op != "stripws"
+		&& op != "ascii" && op != "indents")
+	{
+		respondWithError(format("Unrecognized op \"{0}\"", op));
+		return;
+	}
+
+	FileEnumerator fileEnumerator;
+	if (auto pRecursive = requestObj.if_contains("recursive");
+		pRecursive != nullptr && pRecursive->is_bool() && pRecursive->get_bool())
+	{
+		fileEnumerator.setRecursive();
+	}
+	if (auto pPaths = requestObj.if_contains("paths"); pPaths != nullptr && pPaths->is_array())
+	{
+		for (const auto& path : pPaths->get_array())
+		{
+			if (path.is_string())
+			{
+				fileEnumerator.insert(string_view{path.get_string()});
+			}
+		}
+	}
+	if (fileEnumerator.numFileSpecs() <= 0)
+	{
+		respondWithError("Request has no \"paths\"");
+		return;
+	}
+
+	size_t numFiles = 0;
+	try
+	{
+		fileEnumerator.enumerateFiles([&] (const Path& p)
+			{
+				JObject response;
+				try
+				{
+					response = processFile(p, op, requestObj, pCache);
+				}
+				catch (const CanceledError&)
+				{
+					throw;
+				}
+				catch (const ::std::exception& ex)
+				{
+					response = JObject{{"error", ex.what()}};
+				}
+				response["id"] = id;
+				response["path"] = p.generic_string();
+				respond(response);
+				++numFiles;
+			});
+	}
+	catch (const CanceledError&)
+	{
+		throw;
+	}
+	catch (const ::std::exception& ex)
+	{
+		// A failure of the enumeration itself, such as a missing directory:
+		respondWithError(ex.what());
+		return;
+	}
+	respond(JObject{{"id", id}, {"files", numFiles}, {"done", true}});
+}
+
+ScanServer::JObject ScanServer::processFile(const Path& p, string_view op, const JObject& request,
+	ResultsCache* pCache)
+{
+	auto pArena = ScratchArena::forThisThread().resource();
+	JObject result;
+	if (op == "eol" || op == "xeol")
+	{
+		EolCounts counts{0, 0, 0};
+		if (op == "eol")
+		{
+			counts = findOrCompute<EolCounts>(pCache, p, [&p, pArena] ()
+				{
+					InputFile in(p);
+					EolScanner scanner;
+					BlockReader(in.fd(), pArena).feed(scanner);
+					return scanner.finish();
+				});
+		}
+		else
+		{
+			auto pTarget = request.if_contains("target");
+			const string_view target = (pTarget != nullptr && pTarget->is_string())
+				? string_view{pTarget->get_string()}
+				: string_view{};
+			auto targetEolType = (target == "dos") ? EolType::DOS
+				: (target == "mac") ? EolType::MACINTOSH
+				: (target == "unix") ? EolType::UNIX
+				: EolType::INDETERMINATE;
+			if (targetEolType == EolType::INDETERMINATE)
+			{
+				throw invalid_argument("The op \"xeol\" requires a \"target\" of \"dos\", \"mac\", or \"unix\"");
+			}
+			auto pForce = request.if_contains("force");
+			const bool force = pForce != nullptr && pForce->is_bool() && pForce->get_bool();
+			RewriteLock rewriteLock(p);
+			const auto translation = translateEols(p, targetEolType, force, pArena, pCache);
+			counts = translation ? translation->m_counts : counts;
+			result["translated"] = translation && translation->m_isFileReplaced;
+			result["binary"] = !translation;
+		}
+		result["eol"] = eolTypeName(counts.eolType());
+		result["dos"] = counts.m_numDosEols;
+		result["mac"] = counts.m_numMacEols;
+		result["unix"] = counts.m_numUnixEols;
+	}
+	else if (op == "ws" || op == "stripws")
+	{
+		WhiteSpaceCounts counts{0, 0, 0};
+		if (op == "ws")
+		{
+			counts = findOrCompute<WhiteSpaceCounts>(pCache, p, [&p, pArena] ()
+				{
+					InputFile in(p);
+					WhiteSpaceScanner scanner(nullptr, pArena);
+					BlockReader(in.fd(), pArena).feed(scanner);
+					return scanner.finish();
+				});
+		}
+		else
+		{
+			RewriteLock rewriteLock(p);
+			const auto strippedCounts = stripTrailingWhiteSpace(p, pArena, pCache);
+			counts = strippedCounts.value_or(counts);
+			result["stripped"] = (counts.m_numLinesAffected > 0);
+			result["binary"] = !strippedCounts;
+		}
+		result["lines"] = counts.m_numLinesAffected;
+		result["spaces"] = counts.m_numSpacesStripped;
+		result["tabs"] = counts.m_numTabsStripped;
+	}
+	else if (op == "ascii")
+	{
+		json::array runs;
+		NonAsciiScanner scanner([&runs] (const NonAsciiRun& run)
+			{
+				// The bytes are reported in hex, because they need not be valid UTF-8:
+				string hexBytes;
+				for (auto ch : run.m_bytes)
+				{
+					hexBytes += format("{0:02x}", static_cast<unsigned int>(static_cast<unsigned char>(ch)));
+				}
+				runs.push_back(JObject{
+					{"line", run.m_lineNum},
+					{"column", run.m_approxColNum},
+					{"bytes", hexBytes}});
+			}, pArena);
+		{
+			InputFile in(p);
+			BlockReader(in.fd(), pArena).feed(scanner);
+		}
+		scanner.finish();
+		result["runs"] = ::std::move(runs);
+	}
+	else if (op == "indents")
+	{
+		const bool isJavaFile = isIEqual(p.extension().generic_string(), ".java");
+		IndentScanner scanner(isJavaFile, pArena);
+		{
+			InputFile in(p);
+			BlockReader(in.fd(), pArena).feed(scanner);
+		}
+		const auto lineTypeCounts = scanner.finish();
+		JObject counts;
+		for (const auto& [indentType, count] : lineTypeCounts)
+		{
+			counts[indentTypeName(indentType)] = count;
+		}
+		result["indent"] = indentTypeName(classifyFile(lineTypeCounts));
+		result["counts"] = ::std::move(counts);
+	}
+	return result;
+}
+
+// ============================ Sockets ============================
+
+#if defined(_WIN32)
+
+int ScanServer::run() const
+{
+	return EXIT_FAILURE;	// Unreachable, because the constructor throws
+}
+
+void ScanServer::serveConnections(int /* listenFd */, ResultsCache* /* pCache */)
+{
+}
+
+void ScanServer::serveConnection(int /* connectionFd */, string& /* pendingInput */,
+	ResultsCache* /* pCache */)
+{
+}
+
+#else
+
+namespace
+{
+	class SocketFd
+	{
+	public:
+		explicit SocketFd(int fd) noexcept : m_fd(fd) {}
+		~SocketFd()
+			{ ::close(m_fd); }
+
+		int get() const noexcept
+			{ return m_fd; }
+
+		SocketFd(const SocketFd&) = delete;
+		SocketFd& operator=(const SocketFd&) = delete;
+		SocketFd(SocketFd&&) = delete;
+		SocketFd& operator=(SocketFd&&) = delete;
+
+	private:
+		int m_fd;
+	};
+}
+
+static IOError socketError(string_view what)
+{
+	return IOError(format("{0} failed:  {1}", what, ::std::strerror(errno)));
+}
+
+// Returns true when fd is readable, and false when the poll interval elapsed.
+static bool waitUntilReadable(int fd)
+{
+	pollfd pfd{fd, POLLIN, 0};
+	int result = ::poll(&pfd, 1, k_pollIntervalMs);
+	if (result < 0 && errno != EINTR)
+	{
+		throw socketError("poll");
+	}
+	return result > 0;
+}
+
+static void sendAll(int fd, string_view data)
+{
+	while (!data.empty())
+	{
+		auto numSent = ::send(fd, data.data(), data.size(), 0);
+		if (numSent < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			throw socketError("send");
+		}
+		data.remove_prefix(static_cast<size_t>(numSent));
+	}
+}
+
+int ScanServer::run() const
+{
+	// A client that hangs up early must not take the server down with it:
+	::std::signal(SIGPIPE, SIG_IGN);
+
+	sockaddr_un addr{};
+	addr.sun_family = AF_UNIX;
+	const auto socketPath = m_socketPath.string();
+	if (socketPath.size() >= sizeof(addr.sun_path))
+	{
+		throw CmdLineError(format("Socket path '{0}' is too long", socketPath));
+	}
+	::std::copy(cbegin(socketPath), cend(socketPath), addr.sun_path);
+
+	// Clear away the socket left behind by a previous server, but nothing else:
+	if (is_socket(symlink_status(m_socketPath)))
+	{
+		remove(m_socketPath);
+	}
+
+	SocketFd listenFd(::socket(AF_UNIX, SOCK_STREAM, 0));
+	if (listenFd.get() < 0)
+	{
+		throw socketError("socket");
+	}
+	// Since a request may rewrite any file the server can write, only the
+	// server's own user may connect.  The socket takes its mode from the
+	// umask, which is set for the bind alone (before the workers start):
+	const auto previousUmask = ::umask(S_IRWXG | S_IRWXO | S_IXUSR);
+	const auto bindResult = ::bind(listenFd.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+	::umask(previousUmask);
+	if (bindResult < 0)
+	{
+		throw socketError(format("bind to '{0}'", socketPath));
+	}
+	PathDeleter socketDeleter(m_socketPath);
+	if (::listen(listenFd.get(), SOMAXCONN) < 0)
+	{
+		throw socketError("listen");
+	}
+	// Non-blocking, so that a worker that loses the race to accept a
+	// connection goes back to polling instead of blocking:
+	::fcntl(listenFd.get(), F_SETFL, ::fcntl(listenFd.get(), F_GETFL) | O_NONBLOCK);
+
+	unique_ptr<ResultsCache> pCache;
+	if (!m_cachePath.empty())
+	{
+		pCache = make_unique<ResultsCache>(m_cachePath);
+	}
+
+	formatTo(cout, "Listening on {0} with {1} worker threads", socketPath, m_numThreads);
+	cout << endl;
+
+	vector<thread> workers;
+	workers.reserve(m_numThreads);
+	for (unsigned i = 0; i < m_numThreads; ++i)
+	{
+		workers.emplace_back([fd = listenFd.get(), pCache = pCache.get()]
+			{ serveConnections(fd, pCache); });
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	// The workers stop only when cancellation is requested:
+	CancellationToken::throwIfRequested();
+	return EXIT_SUCCESS;
+}
+
+// The body of each worker thread.  Every worker accepts connections for
+// itself, and serves each one to completion before accepting the next.
+void ScanServer::serveConnections(int listenFd, ResultsCache* pCache)
+{
+	string pendingInput;	// Reused from one connection to the next
+	while (!CancellationToken::isRequested())
+	{
+		try
+		{
+			if (!waitUntilReadable(listenFd))
+			{
+				continue;
+			}
+			int connectionFd = ::accept(listenFd, nullptr, nullptr);
+			if (connectionFd < 0)
+			{
+				continue;	// Most likely another worker accepted it first
+			}
+			SocketFd connection(connectionFd);
+			::fcntl(connectionFd, F_SETFL, ::fcntl(connectionFd, F_GETFL) & ~O_NONBLOCK);
+			serveConnection(connectionFd, pendingInput, pCache);
+		}
+		catch (const CanceledError&)
+		{
+			break;
+		}
+		catch (const ::std::exception& ex)
+		{
+			// A failure on one connection, such as a client that hung up
+			// in mid-response, must not stop the worker:
+			formatTo(::std::cerr, "{0}", ex.what());
+			::std::cerr << endl;
+		}
+	}
+}
+
+void ScanServer::serveConnection(int connectionFd, string& pendingInput, ResultsCache* pCache)
+{
+	pendingInput.clear();
+	auto respond = [connectionFd] (const JObject& response)
+		{
+			auto line = json::serialize(response);
+			line += '\n';
+			sendAll(connectionFd, line);
+		};
+
+	::std::array<char, 16 * 1024> buffer;
+	for (;;)
+	{
+		CancellationToken::throwIfRequested();
+		if (!waitUntilReadable(connectionFd))
+		{
+			continue;
+		}
+		auto numRead = ::recv(connectionFd, buffer.data(), buffer.size(), 0);
+		if (numRead < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (numRead < 0)
+		{
+			throw socketError("recv");
+		}
+		else if (numRead == 0)
+		{
+			return;	// The client hung up
+		}
+
+		pendingInput.append(buffer.data(), static_cast<size_t>(numRead));
+		size_t lineStart = 0;
+		for (auto lineEnd = pendingInput.find('\n');
+			lineEnd != string::npos;
+			lineEnd = pendingInput.find('\n', lineStart))
+		{
+			string_view line{pendingInput.data() + lineStart, lineEnd - lineStart};
+			if (line.find_first_not_of(" \t\r") != string_view::npos)
+			{
+				handleRequest(line, respond, pCache);
+			}
+			lineStart = lineEnd + 1;
+		}
+		pendingInput.erase(0, lineStart);
+
+		if (pendingInput.size() > k_maxRequestLength)
+		{
+			respond(JObject{{"error", format("The request exceeds {0} bytes", k_maxRequestLength)},
+				{"done", true}});
+			return;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,62 @@
+
+#if !defined(SCANSERVER_H_INCLUDED)
+#define SCANSERVER_H_INCLUDED
+
+#include "ResultsCache.h"
+#include "Utils.h"
+
+#include <boost/json.hpp>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <span>
+#include <string>
+#include <string_view>
+
+/// \brief A long-running server that answers the same questions as xeol,
+/// stripws, isplainascii, and indents over a Unix domain socket.
+///
+/// Each request is one line of JSON, and each response is a stream of lines
+/// of JSON:  one per file, followed by a final line containing "done".  The
+/// worker threads, and with them their ScratchArenas, stay resident for the
+/// life of the server, so a request costs neither process start-up nor any
+/// warm-up.  So does the ResultsCache, if one is given.  See usage() for the
+/// protocol.
+class ScanServer
+{
+public:
+	static int usage(::std::ostream& strm, ::std::string_view progName, const char* pMsg);
+
+	ScanServer(::std::span<const char*const> args);
+	int run() const;
+
+	ScanServer(const ScanServer&) = delete;
+	ScanServer& operator=(const ScanServer&) = delete;
+	ScanServer(ScanServer&&) = delete;
+	ScanServer& operator=(ScanServer&&) = delete;
+
+PRIVATE_EXCEPT_IN_TEST:
+	using Path = ::std::filesystem::path;
+	using JObject = ::boost::json::object;
+	using JValue = ::boost::json::value;
+	using Responder = ::std::function<void(const JObject&)>;
+
+	/// \brief Carries out the request on one line of input, passing each line
+	/// of the response to respond as soon as it is ready.  Errors in the
+	/// request or in processing a file are reported via respond rather than
+	/// thrown.  Only CanceledError propagates.
+	static void handleRequest(::std::string_view requestLine, const Responder& respond,
+		ResultsCache* pCache = nullptr);
+	static JObject processFile(const Path& p, ::std::string_view op, const JObject& request,
+		ResultsCache* pCache);
+
+	static void serveConnections(int listenFd, ResultsCache* pCache);
+	static void serveConnection(int connectionFd, ::std::string& pendingInput,
+		ResultsCache* pCache);
+
+	Path		m_socketPath;
+	Path		m_cachePath;
+	unsigned	m_numThreads;
+};
+
+#endif // SCANSERVER_H_INCLUDED
@@ -0,0 +1,222 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "ScanServer.h"
+#include "PathDeleter.h"
+#include "TestUtil.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <atomic>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif
+
+namespace json = ::boost::json;
+namespace utd = ::boost::unit_test::data;
+
+using ::std::filesystem::directory_iterator;
+using ::std::format;
+using ::std::ios_base;
+using ::std::ofstream;
+using ::std::string;
+using ::std::string_view;
+using ::std::thread;
+using ::std::vector;
+
+using ResponseList = ::std::vector<ScanServer::JObject>;
+
+static ResponseList handleRequest(string_view requestLine)
+{
+	ResponseList responses;
+	ScanServer::handleRequest(requestLine,
+		[&responses] (const ScanServer::JObject& response) { responses.push_back(response); });
+	return responses;
+}
+
+static bool isDone(const ScanServer::JObject& response)
+{
+	auto pDone = response.if_contains("done");
+	return pDone != nullptr && pDone->is_bool() && pDone->get_bool();
+}
+
+BOOST_AUTO_TEST_SUITE(ScanServerTestSuite)
+
+BOOST_AUTO_TEST_SUITE(CmdLineParseFailTestSuite)
+
+static char const*const k_args00[] = { "scanserver" };
+static char const*const k_args01[] = { "scanserver", "-?" };
+static char const*const k_args02[] = { "scanserver", "--serve" };
+static char const*const k_args03[] = { "scanserver", "-r", "--serve", "x.sock" };
+
+static CmdLineParseFailTestCase const k_testCases[] =
+{
+	{ k_args00, ".*no socket.*" },
+	{ k_args01, "^$" },
+	{ k_args02, ".*requires a value.*" },
+	{ k_args03, ".*unrecognized argument.*" },
+};
+
+BOOST_DATA_TEST_CASE(cmdLineParseFailTest, utd::make(k_testCases), tc)
+{
+	BOOST_CHECK_EXCEPTION(ScanServer(tc.m_args), CmdLineError,
+		[&tc](const CmdLineError& ex) { return tc.doesExMatch(ex); });
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+
+
+BOOST_AUTO_TEST_SUITE(HandleRequestTestSuite)
+
+BOOST_AUTO_TEST_CASE(pingTest)
+{
+	auto responses = handleRequest(R"({"id": 7, "op": "ping"})");
+	BOOST_REQUIRE_EQUAL(1u, responses.size());
+	BOOST_CHECK(isDone(responses[0]));
+	BOOST_CHECK_EQUAL(7, responses[0].at("id").as_int64());
+}
+
+BOOST_AUTO_TEST_CASE(malformedRequestTest)
+{
+	for (auto requestLine : { "not json", R"({"op": "frobnicate", "paths": ["x"]})", R"({"op": "eol"})" })
+	{
+		auto responses = handleRequest(requestLine);
+		BOOST_REQUIRE_EQUAL(1u, responses.size());
+		BOOST_CHECK(isDone(responses[0]));
+		BOOST_CHECK(responses[0].contains("error"));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(eolAndStripTest)
+{
+	const ScanServer::Path path{"ScanServerTestInput.txt"};
+	PathDeleter deleter(path);
+	{
+		ofstream out(path, ios_base::out | ios_base::trunc | ios_base::binary);
+		out << "one \r\ntwo\t\r\n";
+	}
+
+	auto responses = handleRequest(R"({"id": "a", "op": "eol", "paths": ["ScanServerTestInput.txt"]})");
+	BOOST_REQUIRE_EQUAL(2u, responses.size());
+	BOOST_CHECK_EQUAL("dos", string_view{responses[0].at("eol").as_string()});
+	BOOST_CHECK_EQUAL(2u, responses[0].at("dos").to_number<unsigned>());
+	BOOST_CHECK_EQUAL("./ScanServerTestInput.txt", string_view{responses[0].at("path").as_string()});
+	BOOST_CHECK(isDone(responses[1]));
+	BOOST_CHECK_EQUAL(1u, responses[1].at("files").to_number<unsigned>());
+
+	responses = handleRequest(R"({"op": "stripws", "paths": ["ScanServerTestInput.txt"]})");
+	BOOST_REQUIRE_EQUAL(2u, responses.size());
+	BOOST_CHECK_EQUAL(true, responses[0].at("stripped").as_bool());
+	BOOST_CHECK_EQUAL(2u, responses[0].at("lines").to_number<unsigned>());
+
+	responses = handleRequest(R"({"op": "ws", "paths": ["ScanServerTestInput.txt"]})");
+	BOOST_REQUIRE_EQUAL(2u, responses.size());
+	BOOST_CHECK_EQUAL(0u, responses[0].at("lines").to_number<unsigned>());
+}
+
+BOOST_AUTO_TEST_CASE(concurrentRewriteTest)
+{
+	const ScanServer::Path dir{"ScanServerTestConcurrent"};
+	PathDeleter deleter(dir);
+	create_directories(dir);
+	const auto path = dir / "input.txt";
+	string expectedContent;
+	{
+		ofstream out(path, ios_base::out | ios_base::trunc | ios_base::binary);
+		for (int i = 0; i < 1000; ++i)
+		{
+			out << "line " << i << " \r\n";
+			expectedContent += format("line {0}\n", i);
+		}
+	}
+
+	// Each pass translates the file to one EOL type and strips it, so every
+	// rewrite has something to do if the one before it was not lost:
+	static constexpr int k_numThreads = 8;
+	::std::atomic<int> numErrors{0};
+	vector<thread> threads;
+	for (int i = 0; i < k_numThreads; ++i)
+	{
+		threads.emplace_back([&numErrors, i] ()
+			{
+				const auto request = format(
+					R"({{"op": "xeol", "target": "{0}", "paths": ["ScanServerTestConcurrent/input.txt"]}})",
+					(i % 2 == 0) ? "unix" : "mac");
+				for (const auto& response : handleRequest(request))
+				{
+					numErrors += response.contains("error") ? 1 : 0;
+				}
+				for (const auto& response : handleRequest(
+					R"({"op": "stripws", "paths": ["ScanServerTestConcurrent/input.txt"]})"))
+				{
+					numErrors += response.contains("error") ? 1 : 0;
+				}
+			});
+	}
+	for (auto& t : threads)
+	{
+		t.join();
+	}
+	BOOST_CHECK_EQUAL(0, numErrors.load());
+
+	// No temporary files are left behind, and the file is intact:
+	BOOST_CHECK_EQUAL(1, ::std::distance(directory_iterator(dir), directory_iterator()));
+	handleRequest(R"({"op": "xeol", "target": "unix", "paths": ["ScanServerTestConcurrent/input.txt"]})");
+	::std::ifstream in(path, ios_base::in | ios_base::binary);
+	const string content{::std::istreambuf_iterator<char>(in), ::std::istreambuf_iterator<char>()};
+	BOOST_CHECK_EQUAL(expectedContent, content);
+}
+
+#if !defined(_WIN32)
+BOOST_AUTO_TEST_CASE(oversizedRequestTest)
+{
+	int fds[2];
+	BOOST_REQUIRE_EQUAL(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+	const int serverFd = fds[0];
+	const int clientFd = fds[1];
+
+	// A request line that never ends.  The sends fail once the server hangs up:
+	thread client([clientFd] ()
+		{
+			const string chunk(64 * 1024, 'x');
+			while (::send(clientFd, chunk.data(), chunk.size(), MSG_NOSIGNAL) > 0)
+			{
+			}
+		});
+	string pendingInput;
+	ScanServer::serveConnection(serverFd, pendingInput, nullptr);
+	BOOST_CHECK_LE(pendingInput.size(), 2u * 1024 * 1024);
+
+	string response;
+	char ch = '\0';
+	while (ch != '\n' && ::recv(clientFd, &ch, 1, 0) == 1)
+	{
+		response += ch;
+	}
+	::close(serverFd);
+	client.join();
+	::close(clientFd);
+
+	const auto responseValue = json::parse(response);
+	BOOST_REQUIRE(responseValue.is_object());
+	BOOST_CHECK(responseValue.get_object().contains("error"));
+	BOOST_CHECK(isDone(responseValue.get_object()));
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE_END()
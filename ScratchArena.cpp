@@ -0,0 +1,23 @@
+
+#include "ScratchArena.h"
+
+using ::std::pmr::new_delete_resource;
+using ::std::pmr::pool_options;
+
+// Blocks up to this size are cached across resets rather than returned to the
+// heap.  The monotonic arena requests geometrically growing blocks, so this
+// covers several megabytes of scratch state per file.
+static constexpr ::std::size_t k_largestCachedBlock = 4 * 1024 * 1024;
+
+ScratchArena& ScratchArena::forThisThread()
+{
+	thread_local ScratchArena arena;
+	return arena;
+}
+
+ScratchArena::ScratchArena() :
+	m_initialBuffer(),
+	m_blockCache(pool_options{0, k_largestCachedBlock}, new_delete_resource()),
+	m_arena(m_initialBuffer, k_initialBufferSize, &m_blockCache)
+{
+}
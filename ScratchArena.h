@@ -0,0 +1,63 @@
+
+#if !defined(SCRATCHARENA_H_INCLUDED)
+#define SCRATCHARENA_H_INCLUDED
+
+#include <cstddef>
+#include <memory_resource>
+
+/// \brief ScratchArena is a per-thread monotonic arena for the scratch state
+/// that is built up while processing a single file (line buffers, runs of
+/// interesting characters, count maps, and so on).
+///
+/// Allocation is a pointer bump, and deallocation is deferred until the
+/// arena is reset between files.  The blocks obtained from the heap are
+/// cached by a pool resource that survives resets, so once the arena has
+/// grown to fit the largest file seen so far, processing further files
+/// performs no heap allocation at all.  Because each thread has its own
+/// arena, threads never contend on the global allocator for scratch state.
+class ScratchArena
+{
+public:
+	/// \brief Returns the arena that belongs to the calling thread.
+	static ScratchArena& forThisThread();
+
+	::std::pmr::memory_resource* resource() noexcept
+		{ return &m_arena; }
+
+	/// \brief Releases everything allocated since the last reset.  Any object
+	/// still using the arena is left dangling, so call this only between files.
+	void reset() noexcept
+		{ m_arena.release(); }
+
+	/// \brief Resets the calling thread's arena when it goes out of scope.
+	class ResetGuard
+	{
+	public:
+		ResetGuard() noexcept : m_arena(forThisThread()) {}
+		~ResetGuard() { m_arena.reset(); }
+
+		ResetGuard(const ResetGuard&) = delete;
+		ResetGuard& operator=(const ResetGuard&) = delete;
+		ResetGuard(ResetGuard&&) = delete;
+		ResetGuard& operator=(ResetGuard&&) = delete;
+
+	private:
+		ScratchArena& m_arena;
+	};
+
+	ScratchArena(const ScratchArena&) = delete;
+	ScratchArena& operator=(const ScratchArena&) = delete;
+	ScratchArena(ScratchArena&&) = delete;
+	ScratchArena& operator=(ScratchArena&&) = delete;
+
+private:
+	static constexpr ::std::size_t k_initialBufferSize = 16 * 1024;
+
+	ScratchArena();
+
+	alignas(::std::max_align_t) ::std::byte		m_initialBuffer[k_initialBufferSize];
+	::std::pmr::unsynchronized_pool_resource		m_blockCache;
+	::std::pmr::monotonic_buffer_resource			m_arena;
+};
+
+#endif // SCRATCHARENA_H_INCLUDED
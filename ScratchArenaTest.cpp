@@ -0,0 +1,48 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "ScratchArena.h"
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(ScratchArenaTestSuite)
+
+BOOST_AUTO_TEST_CASE(resetReusesMemoryTest)
+{
+	auto& arena = ScratchArena::forThisThread();
+	arena.reset();
+	void* pFirst = arena.resource()->allocate(64);
+	arena.reset();
+	void* pSecond = arena.resource()->allocate(64);
+	BOOST_CHECK_EQUAL(pFirst, pSecond);
+	arena.reset();
+}
+
+BOOST_AUTO_TEST_CASE(growthBeyondInitialBufferTest)
+{
+	auto& arena = ScratchArena::forThisThread();
+	for (int i = 0; i < 3; ++i)
+	{
+		ScratchArena::ResetGuard resetGuard;
+		::std::pmr::string line{arena.resource()};
+		line.assign(1024 * 1024, 'x');
+		line += 'y';
+		BOOST_CHECK_EQUAL(1024u * 1024u + 1u, line.size());
+		BOOST_CHECK_EQUAL('y', line.back());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(arenaIsPerThreadTest)
+{
+	auto pMainArena = &ScratchArena::forThisThread();
+	ScratchArena* pOtherArena = nullptr;
+	::std::thread worker([&pOtherArena] { pOtherArena = &ScratchArena::forThisThread(); });
+	worker.join();
+	BOOST_CHECK(pMainArena != pOtherArena);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
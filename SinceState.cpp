@@ -0,0 +1,278 @@
+
+#include "SinceState.h"
+#include "Exceptions.h"
+#include "PathDeleter.h"
+#include "ResultsCache.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+namespace fs = ::std::filesystem;
+
+using ::std::from_chars;
+using ::std::getline;
+using ::std::ifstream;
+using ::std::int64_t;
+using ::std::ios_base;
+using ::std::numeric_limits;
+using ::std::ofstream;
+using ::std::optional;
+using ::std::string;
+using ::std::string_view;
+using ::std::uint64_t;
+
+// The state file is line-oriented text:
+//
+//    CmdLineUtil since-state 2
+//    mark <nanoseconds since the epoch>
+//    D <absolute directory path>
+//    T <directory timestamp, in nanoseconds since the epoch>
+//    <inode> <name of a file visited>
+//    - <name of another entry>
+//    / <name of a sub-directory>
+//    D <absolute directory path>
+//    ...
+//
+// The T line is present only if the lines that follow list every entry of
+// the directory.  Names containing a newline are left out, which only means
+// that those files are visited, and their directories read, on every run.
+static constexpr auto k_header = string_view{"CmdLineUtil since-state 2"};
+static constexpr auto k_markPrefix = string_view{"mark "};
+static constexpr auto k_dirPrefix = string_view{"D "};
+static constexpr auto k_stampPrefix = string_view{"T "};
+static constexpr auto k_otherPrefix = string_view{"- "};
+static constexpr auto k_subDirPrefix = string_view{"/ "};
+
+template<typename Int>
+static bool parseInt(string_view str, Int& value)
+{
+	const auto pEnd = str.data() + str.size();
+	const auto [ptr, ec] = from_chars(str.data(), pEnd, value);
+	return ec == ::std::errc{} && ptr == pEnd;
+}
+
+SinceState::SinceState(const Path& stateFilePath,
+		int64_t runStartNs /* = FileKey::currentTimeNs() */) :
+	m_stateFilePath(stateFilePath),
+	m_currentDir(fs::current_path()),
+	m_previousMarkNs(numeric_limits<int64_t>::min()),
+	m_runStartNs(runStartNs),
+	m_previousRecords(),
+	m_records(),
+	m_numDirsRead(0)
+{
+	if (exists(m_stateFilePath))
+	{
+		load();
+	}
+}
+
+// A malformed state file is treated as no state at all, so that the worst
+// a damaged file can do is cause one full run.
+void SinceState::load()
+{
+	ifstream in(m_stateFilePath, ios_base::in | ios_base::binary);
+	if (!in)
+	{
+		throw IOError(::std::format("Unable to open state file '{0}'",
+			m_stateFilePath.generic_string()));
+	}
+
+	string line;
+	int64_t markNs = 0;
+	if (!getline(in, line) || line != k_header
+		|| !getline(in, line) || !line.starts_with(k_markPrefix)
+		|| !parseInt(string_view{line}.substr(k_markPrefix.size()), markNs))
+	{
+		return;
+	}
+
+	RecordMap records;
+	DirRecord* pRecord = nullptr;
+	while (getline(in, line))
+	{
+		const auto lineView = string_view{line};
+		const auto spacePos = lineView.find(' ');
+		uint64_t ino = 0;
+		int64_t stampNs = 0;
+		if (lineView.starts_with(k_dirPrefix))
+		{
+			pRecord = &records[string{lineView.substr(k_dirPrefix.size())}];
+		}
+		else if (pRecord == nullptr || spacePos == string_view::npos)
+		{
+			return;
+		}
+		else if (lineView.starts_with(k_stampPrefix)
+			&& parseInt(lineView.substr(k_stampPrefix.size()), stampNs))
+		{
+			pRecord->m_stampNs = stampNs;
+		}
+		else if (lineView.starts_with(k_otherPrefix))
+		{
+			pRecord->m_listing.m_fileNames.emplace_back(lineView.substr(k_otherPrefix.size()));
+		}
+		else if (lineView.starts_with(k_subDirPrefix))
+		{
+			pRecord->m_listing.m_subDirNames.emplace_back(lineView.substr(k_subDirPrefix.size()));
+		}
+		else if (parseInt(lineView.substr(0, spacePos), ino))
+		{
+			const auto name = lineView.substr(spacePos + 1);
+			pRecord->m_files.emplace(name, ino);
+			pRecord->m_listing.m_fileNames.emplace_back(name);
+		}
+		else
+		{
+			return;
+		}
+	}
+
+	m_previousMarkNs = markNs;
+	m_previousRecords.swap(records);
+}
+
+string SinceState::dirKey(const Path& dir) const
+{
+	return (m_currentDir / dir).lexically_normal().generic_string();
+}
+
+SinceState::DirListing SinceState::readDirectory(const Path& dir)
+{
+	DirListing result;
+	for (const auto& entry : fs::directory_iterator(dir))
+	{
+		auto name = entry.path().filename().string();
+		if (entry.is_directory() && !entry.is_symlink())
+		{
+			result.m_subDirNames.push_back(::std::move(name));
+		}
+		else
+		{
+			result.m_fileNames.push_back(::std::move(name));
+		}
+	}
+	return result;
+}
+
+// A directory is read afresh unless its timestamp matches the one recorded
+// with its listing, and that was older than the mark of the run that listed
+// it.  The latter guards against a change made in the same clock tick as
+// the listing, which would leave the timestamp as it was.
+const SinceState::DirListing& SinceState::listDirectory(const Path& dir)
+{
+	const auto key = dirKey(dir);
+	auto& record = m_records[key];
+	if (record.m_stampNs)
+	{
+		return record.m_listing;	// Already listed in this run
+	}
+
+	optional<int64_t> stampNs;
+	if (const auto dirStatus = ResultsCache::keyOf(dir); dirStatus)
+	{
+		stampNs = dirStatus->stampNs();
+	}
+
+	const auto previousIt = m_previousRecords.find(key);
+	if (stampNs && *stampNs < m_previousMarkNs && previousIt != m_previousRecords.end()
+		&& previousIt->second.m_stampNs == stampNs)
+	{
+		record.m_listing = ::std::move(previousIt->second.m_listing);
+	}
+	else
+	{
+		record.m_listing = readDirectory(dir);
+		++m_numDirsRead;
+	}
+	record.m_stampNs = stampNs;
+	return record.m_listing;
+}
+
+bool SinceState::isChanged(const Path& p)
+{
+	const auto key = ResultsCache::keyOf(p);
+	if (!key)
+	{
+		return true;
+	}
+
+	const auto dir = dirKey(p.parent_path());
+	const auto name = p.filename().string();
+	m_records[dir].m_files[name] = key->m_ino;
+
+	bool isListed = false;
+	if (auto dirIt = m_previousRecords.find(dir); dirIt != m_previousRecords.end())
+	{
+		const auto& files = dirIt->second.m_files;
+		auto entryIt = files.find(name);
+		isListed = entryIt != files.end() && entryIt->second == key->m_ino;
+	}
+	return !isListed || key->stampNs() >= m_previousMarkNs;
+}
+
+void SinceState::save() const
+{
+	auto isSavable = [] (string_view str) { return str.find('\n') == string_view::npos; };
+
+	Path tempPath(getTempPath(m_stateFilePath));
+	PathDeleter tempPathDeleter(tempPath);
+	{
+		ofstream out(tempPath, ios_base::out | ios_base::trunc | ios_base::binary);
+		// The mark is set back by the clock slack, so that the files written
+		// just before the run are visited again in the next one:
+		out << k_header << '\n' << k_markPrefix << (m_runStartNs - FileKey::k_clockSlackNs) << '\n';
+		for (const auto& [dir, record] : m_records)
+		{
+			if (!isSavable(dir))
+			{
+				continue;
+			}
+
+			// A listing with an unsavable name is left incomplete:
+			const auto& listing = record.m_listing;
+			const bool isListingSavable = record.m_stampNs
+				&& ::std::all_of(listing.m_fileNames.begin(), listing.m_fileNames.end(), isSavable)
+				&& ::std::all_of(listing.m_subDirNames.begin(), listing.m_subDirNames.end(), isSavable);
+
+			out << k_dirPrefix << dir << '\n';
+			if (isListingSavable)
+			{
+				out << k_stampPrefix << *record.m_stampNs << '\n';
+			}
+			for (const auto& [name, ino] : record.m_files)
+			{
+				if (isSavable(name))
+				{
+					out << ino << ' ' << name << '\n';
+				}
+			}
+			if (isListingSavable)
+			{
+				for (const auto& name : listing.m_fileNames)
+				{
+					if (!record.m_files.contains(name))
+					{
+						out << k_otherPrefix << name << '\n';
+					}
+				}
+				for (const auto& name : listing.m_subDirNames)
+				{
+					out << k_subDirPrefix << name << '\n';
+				}
+			}
+		}
+		if (!out.flush())
+		{
+			throw IOError(::std::format("Unable to write state file '{0}'",
+				tempPath.generic_string()));
+		}
+	}
+	rename(tempPath, m_stateFilePath);
+}
@@ -0,0 +1,106 @@
+
+#if !defined(SINCESTATE_H_INCLUDED)
+#define SINCESTATE_H_INCLUDED
+
+#include "ResultsCache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// \brief SinceState remembers enough about the previous run of a tool to let
+/// the next run visit only the files that have changed since then.  That is
+/// what --since-state <file> does, so that a nightly job costs work in
+/// proportion to the churn in the tree rather than to its size.
+///
+/// The state file records a high-water mark (the start time of the run that
+/// wrote it) and, for each directory seen, the name and inode of each file
+/// enumerated there.  A file is changed if its mtime or ctime is at or past
+/// the mark, or if it is missing from the previous listing of its directory,
+/// or if it has a different inode there.  Diffing the listings is what
+/// catches the files that were renamed or moved into place, which keep their
+/// old mtimes, and the files that were deleted and later restored.  A file
+/// that has been deleted simply drops out of the listing.
+///
+/// The state file also records the complete listing of each directory
+/// read, together with its timestamp (the later of its mtime and ctime).
+/// A directory whose timestamp is unchanged, and was already older than the
+/// mark when it was listed, has gained, lost, and renamed no entries since
+/// then, so its recorded listing is used in place of reading it again.  Its
+/// files must still be stat'ed one by one, because writing to a file does
+/// not touch the timestamp of its directory.
+///
+/// A missing or unreadable state file means that every file is changed, as
+/// does a new directory (including a renamed one).  The state is written
+/// only by save(), which a tool calls after a successful run, so a failed or
+/// canceled run is done over in full the next time.
+class SinceState
+{
+public:
+	using Path = ::std::filesystem::path;
+
+	/// \brief Loads the state file, if it exists.  runStartNs (nanoseconds
+	/// since the epoch) becomes the high-water mark recorded by save().
+	explicit SinceState(const Path& stateFilePath,
+		::std::int64_t runStartNs = FileKey::currentTimeNs());
+
+	/// \brief The names of the entries of a directory.
+	struct DirListing
+	{
+		::std::vector< ::std::string>	m_fileNames;		///< Everything but the sub-directories
+		::std::vector< ::std::string>	m_subDirNames;		///< Not including symbolic links
+	};
+
+	/// \brief Returns the listing of the directory dir, which is the one
+	/// recorded by the previous run if dir has not changed since then, and is
+	/// otherwise read afresh.  Either way, records it for the next run.
+	/// Throws ::std::filesystem::filesystem_error if dir cannot be read.
+	const DirListing& listDirectory(const Path& dir);
+
+	/// \brief Returns true if the file p must be visited in this run, and
+	/// records p in the listing of its directory for the next one.
+	bool isChanged(const Path& p);
+
+	/// \brief Atomically replaces the state file with the state of this run.
+	void save() const;
+
+#if defined(CMDLINEUTIL_TEST_MODE)
+	// Testing facilities:
+	::std::size_t numDirsRead() const
+		{ return m_numDirsRead; }
+#endif
+
+	SinceState(const SinceState&) = delete;
+	SinceState& operator=(const SinceState&) = delete;
+	SinceState(SinceState&&) = delete;
+	SinceState& operator=(SinceState&&) = delete;
+
+private:
+	using Listing = ::std::unordered_map< ::std::string, ::std::uint64_t>;	// Name to inode
+
+	struct DirRecord
+	{
+		Listing									m_files;		// The files visited
+		DirListing								m_listing;	// Every entry, if m_stampNs is set
+		::std::optional< ::std::int64_t>	m_stampNs;	// The directory's, when listed
+	};
+	using RecordMap = ::std::unordered_map< ::std::string, DirRecord>;	// Directory to record
+
+	void load();
+	::std::string dirKey(const Path& dir) const;
+	static DirListing readDirectory(const Path& dir);
+
+	Path				m_stateFilePath;
+	Path				m_currentDir;
+	::std::int64_t	m_previousMarkNs;
+	::std::int64_t	m_runStartNs;
+	RecordMap		m_previousRecords;
+	RecordMap		m_records;
+	::std::size_t	m_numDirsRead;
+};
+
+#endif // SINCESTATE_H_INCLUDED
@@ -0,0 +1,138 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "FileEnumerator.h"
+#include "PathDeleter.h"
+#include "SinceState.h"
+
+#include <boost/range/algorithm/sort.hpp>
+#include <boost/test/unit_test.hpp>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace b = ::boost;
+namespace fs = ::std::filesystem;
+
+using ::std::int64_t;
+using ::std::ofstream;
+using ::std::string;
+using ::std::vector;
+
+#if !defined(_WIN32)
+
+using NameList = vector<string>;
+
+static const fs::path k_testDir{"SinceStateTestDir"};
+static const fs::path k_statePath{"SinceStateTest.state"};
+static constexpr int64_t k_nsPerHour = int64_t{3'600'000'000'000};
+
+static void writeFile(const fs::path& p)
+{
+	ofstream out(p);
+	out << "Some text\n";
+}
+
+// Each run starts an hour after the previous one, so that the files written
+// by the test itself are older than the high-water mark of the previous run.
+// If pNumDirsRead is given, it receives the number of directories read.
+static NameList runEnumerator(int64_t& runStartNs, size_t* pNumDirsRead = nullptr)
+{
+	runStartNs += k_nsPerHour;
+	SinceState sinceState(k_statePath, runStartNs);
+
+	FileEnumerator fe;
+	fe.setRecursive();
+	fe.insert(k_testDir / "*.txt");
+
+	NameList result;
+	fe.enumerateFiles([&result] (const fs::path& p)
+		{ result.push_back(p.lexically_relative(k_testDir).generic_string()); },
+		&sinceState);
+	sinceState.save();
+	if (pNumDirsRead != nullptr)
+	{
+		*pNumDirsRead = sinceState.numDirsRead();
+	}
+
+	b::sort(result);
+	return result;
+}
+
+BOOST_AUTO_TEST_SUITE(SinceStateTestSuite)
+
+BOOST_AUTO_TEST_CASE(sinceStateTest)
+{
+	PathDeleter testDirDeleter(k_testDir);
+	PathDeleter statePathDeleter(k_statePath);
+	create_directories(k_testDir);
+	writeFile(k_testDir / "a.txt");
+	writeFile(k_testDir / "b.txt");
+
+	int64_t runStartNs = FileKey::currentTimeNs();
+	BOOST_CHECK(runEnumerator(runStartNs) == (NameList{"a.txt", "b.txt"}));
+	BOOST_CHECK(runEnumerator(runStartNs).empty());
+
+	// A modified file:
+	last_write_time(k_testDir / "b.txt", fs::file_time_type::clock::now() + ::std::chrono::hours(2));
+	BOOST_CHECK(runEnumerator(runStartNs) == (NameList{"b.txt"}));
+	BOOST_CHECK(runEnumerator(runStartNs).empty());
+
+	// A renamed file keeps its old mtime:
+	rename(k_testDir / "a.txt", k_testDir / "c.txt");
+	BOOST_CHECK(runEnumerator(runStartNs) == (NameList{"c.txt"}));
+
+	// A deleted file that comes back:
+	fs::remove(k_testDir / "b.txt");
+	BOOST_CHECK(runEnumerator(runStartNs).empty());
+	writeFile(k_testDir / "b.txt");
+	BOOST_CHECK(runEnumerator(runStartNs) == (NameList{"b.txt"}));
+
+	// A new directory:
+	create_directories(k_testDir / "sub");
+	writeFile(k_testDir / "sub" / "d.txt");
+	BOOST_CHECK(runEnumerator(runStartNs) == (NameList{"sub/d.txt"}));
+	BOOST_CHECK(runEnumerator(runStartNs).empty());
+
+	// A damaged state file means a full run:
+	{
+		ofstream out(k_statePath);
+		out << "garbage\n";
+	}
+	BOOST_CHECK(runEnumerator(runStartNs) == (NameList{"b.txt", "c.txt", "sub/d.txt"}));
+}
+
+BOOST_AUTO_TEST_CASE(unchangedDirIsNotReadTest)
+{
+	PathDeleter testDirDeleter(k_testDir);
+	PathDeleter statePathDeleter(k_statePath);
+	create_directories(k_testDir / "sub");
+	writeFile(k_testDir / "a.txt");
+	writeFile(k_testDir / "sub" / "b.txt");
+
+	int64_t runStartNs = FileKey::currentTimeNs();
+	size_t numDirsRead = 0;
+	BOOST_CHECK(runEnumerator(runStartNs, &numDirsRead) == (NameList{"a.txt", "sub/b.txt"}));
+	BOOST_CHECK_EQUAL(numDirsRead, 2u);
+	BOOST_CHECK(runEnumerator(runStartNs, &numDirsRead).empty());
+	BOOST_CHECK_EQUAL(numDirsRead, 0u);
+
+	// A modified file does not change its directory:
+	last_write_time(k_testDir / "sub" / "b.txt", fs::file_time_type::clock::now() + ::std::chrono::hours(2));
+	BOOST_CHECK(runEnumerator(runStartNs, &numDirsRead) == (NameList{"sub/b.txt"}));
+	BOOST_CHECK_EQUAL(numDirsRead, 0u);
+
+	// A new file does:
+	writeFile(k_testDir / "sub" / "c.txt");
+	BOOST_CHECK(runEnumerator(runStartNs, &numDirsRead) == (NameList{"sub/c.txt"}));
+	BOOST_CHECK_EQUAL(numDirsRead, 1u);
+	BOOST_CHECK(runEnumerator(runStartNs, &numDirsRead).empty());
+	BOOST_CHECK_EQUAL(numDirsRead, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
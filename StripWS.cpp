@@ -1,25 +1,33 @@
 
 #include "StripWS.h"
-#include "PathDeleter.h"
+#include "BlockReader.h"
+#include "FileRewriter.h"
+#include "FileWatcher.h"
+#include "RecordWriter.h"
+#include "ResultsCache.h"
+#include "ScratchArena.h"
+#include "SinceState.h"
 #include "main.h"
 #include "Utils.h"
 
 #include <boost/algorithm/string/replace.hpp>
 #include <format>
-#include <fstream>
+#include <memory>
+#include <optional>
 
 using ::std::cout;
 using ::std::endl;
-using ::std::format;
-using ::std::ifstream;
 using ::std::istream;
-using ::std::ios_base;
-using ::std::ofstream;
+using ::std::make_unique;
+using ::std::optional;
 using ::std::ostream;
 using ::std::string;
 using ::std::string_view;
+using ::std::unique_ptr;
 
-#if !defined(CMDLINEUTIL_TEST_MODE)
+static constexpr string_view k_recordFields[] = { "path", "lines", "spaces", "tabs", "stripped" };
+
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
 int main(int argCount, const char*const*const argList)
 {
 	return commonMain<StripWS>(argCount, argList);
@@ -35,7 +43,7 @@ int StripWS::usage(ostream& out, string_view progName, const char* pMsg)
 		out << endl << pMsg << endl;
 	}
 	out << "\n"
-		"Usage:  " << progName << " [-s] [-r] <file1> <file2> ...\n"
+		"Usage:  " << progName << " [-s] [--watch] [-l|-q] [--format=<fmt>] [--cache <file>] [--since-state <file>] [-r] <file1> <file2> ...\n"
 		"\n"
 		"Strips white space (tabs and spaces) from the ends of lines and\n"
 		"at the end of the file, if the file is not terminated by an\n"
@@ -44,11 +52,46 @@ int StripWS::usage(ostream& out, string_view progName, const char* pMsg)
 		"With no options operates in query-only mode, i.e., report on the\n"
 		"white space that could be stripped, but do not change the file.\n"
 		"\n"
+		"Binary files, as judged by their first block (by a NUL byte, too many\n"
+		"control characters, or the signature of a known binary format), are\n"
+		"skipped:  they are not listed, counted as offending, or changed.\n"
+		"\n"
+		"Files compressed with gzip or zstd are decompressed as they are read,\n"
+		"and their contents examined as for any other file, except that they are\n"
+		"never changed:  to -s they are binary.\n"
+		"\n"
 		"Options:\n"
 		"\n"
 		"   -s Strip white space, i.e., actually alter the file\n"
 		"\n"
+		"   --watch After the initial pass, keep running and process each file\n"
+		"      again whenever it changes.  (Linux only.)\n"
+		"\n"
+		"   -l List only the names of the files with white space to strip\n"
+		"\n"
+		"   -q Print nothing, and stop at the first file with white space to\n"
+		"      strip\n"
+		"\n"
+		"   With -l or -q, each file is read only up to its first line that\n"
+		"   ends in white space, and the exit status is 0 if there is such a\n"
+		"   file, 1 if not, and 2 on an error.  Neither is allowed with -s.\n"
+		"\n"
+		"   --format=<fmt> Write one record per file in the format <fmt>, which\n"
+		"      is text (the default), jsonl (JSON Lines), or csv.  The fields are\n"
+		"      path, lines (the number of lines that end in white space), spaces,\n"
+		"      tabs, and stripped (true or false).\n"
+		"\n"
+		"   --cache <file> Remember the result for each file in the cache file\n"
+		"      <file>, which xeol, stripws, and isplainascii can share, and skip\n"
+		"      the files that have not changed since their results were cached.\n"
+		"\n"
+		"   --since-state <file> Visit only the files that are new, renamed, or\n"
+		"      changed since the last run with the same state file <file>, and\n"
+		"      then update the state file.\n"
+		"\n"
 		"   -r Search for files in sub-directories recursively\n"
+		"\n"
+		<< FileEnumerator::k_filterOptionsUsage
 		<< endl;
 
 	return exitCode;
@@ -56,10 +99,16 @@ int StripWS::usage(ostream& out, string_view progName, const char* pMsg)
 
 StripWS::StripWS(::std::span<const char*const> args) :
 	m_isInQueryMode(true),
+	m_isWatching(false),
+	m_reportMode(ReportMode::full),
+	m_outputFormat(OutputFormat::text),
+	m_cachePath(),
+	m_sinceStatePath(),
 	m_fileEnumerator()
 {
-	for (auto pArg : args)
+	for (size_t i = 0; i < args.size(); ++i)
 	{
+		auto pArg = args[i];
 		if (isIEqual(pArg, "-?") || isIEqual(pArg, "-h") || isIEqual(pArg, "-help"))
 		{
 			throw CmdLineError();
@@ -68,17 +117,53 @@ StripWS::StripWS(::std::span<const char*const> args) :
 		{
 			m_isInQueryMode = false;
 		}
+		else if (parseReportModeOption(pArg, m_reportMode))
+		{
+			// Nothing more to do
+		}
+		else if (parseOutputFormatOption(pArg, m_outputFormat))
+		{
+			// Nothing more to do
+		}
+		else if (isIEqual(pArg, "--watch"))
+		{
+			m_isWatching = true;
+		}
+		else if (isIEqual(pArg, "--cache"))
+		{
+			m_cachePath = getOptionValue(args, i);
+		}
+		else if (isIEqual(pArg, "--since-state"))
+		{
+			m_sinceStatePath = getOptionValue(args, i);
+		}
 		else if (isIEqual(pArg, "-r"))
 		{
 			m_fileEnumerator.setRecursive();
 		}
+		else if (m_fileEnumerator.parseFilterOption(args, i))
+		{
+			// Nothing more to do
+		}
 		else
 		{
 			m_fileEnumerator.insert(pArg);
 		}
 	}
 
-	if (m_fileEnumerator.numFileSpecs() <= 0)
+	if (!m_isInQueryMode && m_reportMode != ReportMode::full)
+	{
+		throw CmdLineError("The options '-l' and '-q' are not allowed with '-s'");
+	}
+	else if (m_reportMode != ReportMode::full && m_outputFormat != OutputFormat::text)
+	{
+		throw CmdLineError("The option '--format' is not allowed with '-l' or '-q'");
+	}
+	else if (m_isInQueryMode && m_isWatching)
+	{
+		throw CmdLineError("The option '--watch' is allowed only if '-s' is present");
+	}
+	else if (m_fileEnumerator.numFileSpecs() <= 0)
 	{
 		throw CmdLineError("No files specified");
 	}
@@ -86,130 +171,177 @@ StripWS::StripWS(::std::span<const char*const> args) :
 
 int StripWS::run() const
 {
-	m_fileEnumerator.enumerateFiles([this] (const Path& p)
-		{ m_isInQueryMode ? queryFile(p) : translateFile(p); });
+	unique_ptr<ResultsCache> pCache;
+	if (!m_cachePath.empty())
+	{
+		pCache = make_unique<ResultsCache>(m_cachePath);
+	}
+	unique_ptr<SinceState> pSinceState;
+	if (!m_sinceStatePath.empty())
+	{
+		pSinceState = make_unique<SinceState>(m_sinceStatePath);
+	}
+	if (m_reportMode != ReportMode::full)
+	{
+		return reportOffendingFiles(m_fileEnumerator, m_reportMode,
+			[&pCache] (const Path& p) { return isFileOffending(p, pCache.get()); },
+			pSinceState.get());
+	}
+	unique_ptr<RecordWriter> pWriter;
+	if (m_outputFormat != OutputFormat::text)
+	{
+		pWriter = make_unique<RecordWriter>(cout, m_outputFormat, k_recordFields);
+	}
+	unique_ptr<FileWatcher> pWatcher;
+	if (m_isWatching)
+	{
+		pWatcher = make_unique<FileWatcher>(m_fileEnumerator);
+	}
+
+	const FileWatcher::FileProcessor processFile = [this, &pCache, &pWriter] (const Path& p)
+		{
+			m_isInQueryMode
+				? queryFile(p, pCache.get(), pWriter.get())
+				: translateFile(p, pCache.get(), pWriter.get());
+		};
+	m_fileEnumerator.enumerateFiles([&pWatcher, &processFile] (const Path& p)
+		{ pWatcher ? pWatcher->process(p, processFile) : processFile(p); },
+		pSinceState.get());
+	if (pSinceState)
+	{
+		pSinceState->save();
+	}
+	if (pWatcher)
+	{
+		// Records must not sit in the writer's buffer while the watch is idle:
+		auto flushRecords = [&pWriter] () { if (pWriter) { pWriter->flush(); } };
+		flushRecords();
+		pWatcher->watch([&processFile, &flushRecords] (const Path& p)
+			{
+				processFile(p);
+				flushRecords();
+			});
+	}
 	return EXIT_SUCCESS;
 }
 
-void StripWS::queryFile(const Path& p) const
+void StripWS::queryFile(const Path& p, ResultsCache* pCache /* = nullptr */,
+	RecordWriter* pWriter /* = nullptr */) const
 {
-	size_t numLinesAffected = 0;
-	size_t numSpacesStripped = 0;
-	size_t numTabsStripped = 0;
-	ifstream in(p, ios_base::in | ios_base::binary);
-	scanFile(in, numLinesAffected, numSpacesStripped, numTabsStripped);
+	auto pArena = ScratchArena::forThisThread().resource();
+	const auto optCounts = findOrScanTextFile<WhiteSpaceCounts>(pCache, p, pArena,
+		[pArena] (BlockReader& reader)
+		{
+			WhiteSpaceScanner scanner(nullptr, pArena);
+			reader.feed(scanner);
+			return scanner.finish();
+		});
+	if (!optCounts)
+	{
+		return;	// Binary files are skipped
+	}
 
-	if (numLinesAffected > 0)
+	const auto& counts = *optCounts;
+	if (pWriter != nullptr)
 	{
-		cout << format("   {0} -- {3} lines end in {1} spaces and {2} tabs",
-				p.generic_string(),
-				numSpacesStripped,
-				numTabsStripped,
-				numLinesAffected)
-			<< endl;
+		writeRecord(p, counts, false, *pWriter);
+	}
+	else if (counts.m_numLinesAffected > 0)
+	{
+		formatTo(cout, "   {0} -- {3} lines end in {1} spaces and {2} tabs",
+			p.generic_string(),
+			counts.m_numSpacesStripped,
+			counts.m_numTabsStripped,
+			counts.m_numLinesAffected);
+		cout << endl;
 	}
 }
 
-void StripWS::translateFile(const Path& p) const
+void StripWS::translateFile(const Path& p, ResultsCache* pCache /* = nullptr */,
+	RecordWriter* pWriter /* = nullptr */) const
 {
-	size_t numLinesAffected = 0;
-	size_t numSpacesStripped = 0;
-	size_t numTabsStripped = 0;
-
-	ifstream in(p, ios_base::in | ios_base::binary);
-
-	Path tempPath(getTempPath(p));
-	PathDeleter tempPathDeleter(tempPath);
-	ofstream out(tempPath, ios_base::out | ios_base::trunc | ios_base::binary);
-
-	scanFile(in, numLinesAffected, numSpacesStripped, numTabsStripped, &out);
-
-	in.close();
-	out.close();
+	const auto optCounts = stripTrailingWhiteSpace(p, ScratchArena::forThisThread().resource(), pCache);
+	if (!optCounts)
+	{
+		return;	// Binary files are left alone
+	}
 
-	if (numLinesAffected > 0)
+	const auto& counts = *optCounts;
+	if (pWriter != nullptr)
+	{
+		writeRecord(p, counts, counts.m_numLinesAffected > 0, *pWriter);
+	}
+	else if (counts.m_numLinesAffected > 0)
 	{
-		replaceOriginalFileWithTemp(p, tempPath);
-		cout << format("   {0} -- {1} spaces and {2} tabs stripped from {3} lines",
-				p.generic_string(),
-				numSpacesStripped,
-				numTabsStripped,
-				numLinesAffected)
-			<< endl;
+		formatTo(cout, "   {0} -- {1} spaces and {2} tabs stripped from {3} lines",
+			p.generic_string(),
+			counts.m_numSpacesStripped,
+			counts.m_numTabsStripped,
+			counts.m_numLinesAffected);
+		cout << endl;
 	}
 }
 
-void StripWS::scanFile(istream& in, /* out */ size_t& numLinesAffected,
-	/* out */ size_t& numSpacesStripped, /* out */ size_t& numTabsStripped, ostream* pOut)
+void StripWS::writeRecord(const Path& p, const WhiteSpaceCounts& counts, bool isStripped,
+	RecordWriter& writer)
 {
-	numLinesAffected = 0;
-	numSpacesStripped = 0;
-	numTabsStripped = 0;
+	writer.field(p)
+		.field(counts.m_numLinesAffected)
+		.field(counts.m_numSpacesStripped)
+		.field(counts.m_numTabsStripped)
+		.field(isStripped);
+	writer.endRecord();
+}
 
-	for (string wsRun; true;)
+bool StripWS::isFileOffending(const Path& p, ResultsCache* pCache /* = nullptr */)
+{
+	const auto key = (pCache == nullptr) ? optional<FileKey>{} : pCache->cacheKeyOf(p);
+	if (isCachedAsBinary(pCache, key))
 	{
-		int ch = in.get();
-		if (in.eof())
-		{
-			updateCounts(wsRun, numLinesAffected, numSpacesStripped, numTabsStripped);
-			break;
-		}
-		else if (!in.good())
-		{
-			throw IOError("Error while reading input file");
-		}
-		else if (pOut != nullptr && !pOut->good())
-		{
-			throw IOError("Error while writing output to temporary file");
-		}
-		else if (ch == ' ' || ch == '\t')
-		{
-			wsRun += string::traits_type::to_char_type(ch);
-		}
-		else if (ch == '\r' || ch == '\n')
-		{
-			updateCounts(wsRun, numLinesAffected, numSpacesStripped, numTabsStripped);
-			if (pOut != nullptr)
-			{
-				(*pOut) << istream::traits_type::to_char_type(ch);
-			}
-			wsRun.clear();
-		}
-		else
+		return false;
+	}
+	else if (key)
+	{
+		if (auto counts = pCache->findAsRead<WhiteSpaceCounts>(*key); counts)
 		{
-			if (pOut != nullptr)
-			{
-				(*pOut) << wsRun << istream::traits_type::to_char_type(ch);
-			}
-			wsRun.clear();
+			return counts->m_numLinesAffected > 0;
 		}
 	}
-}
 
-void StripWS::updateCounts(string const& wsRun, /* in-out */ size_t& numLinesAffected,
-	/* in-out */ size_t& numSpacesStripped, /* in-out */ size_t& numTabsStripped)
-{
-	if (wsRun.length() > 0)
+	auto pArena = ScratchArena::forThisThread().resource();
+	WhiteSpaceScanner scanner(nullptr, pArena);
+	bool isStoppedEarly = false;
+	bool isDecompressed = false;
 	{
-		++numLinesAffected;
-		for (auto ch : wsRun)
+		InputFile in(p);
+		BlockReader reader(in.fd(), pArena);
+		isDecompressed = reader.decompressIfCompressed() != Compression::none;
+		if (isBinaryFile(reader, pCache, key))
 		{
-			if (ch == ' ')
-			{
-				++numSpacesStripped;
-			}
-			if (ch == '\t')
-			{
-				++numTabsStripped;
-			}
+			return false;
 		}
+		isStoppedEarly = reader.feedUntil(scanner,
+			[&scanner] () { return scanner.counts().m_numLinesAffected > 0; });
 	}
+	const auto counts = scanner.finish();
+
+	// Only the counts of the whole file are worth caching:
+	if (key && !isStoppedEarly)
+	{
+		pCache->insert(*key, counts, isDecompressed);
+	}
+	return counts.m_numLinesAffected > 0;
 }
 
-void StripWS::replaceOriginalFileWithTemp(const Path& originalPath, const Path& tempPath)
+void StripWS::scanFile(istream& in, /* out */ size_t& numLinesAffected,
+	/* out */ size_t& numSpacesStripped, /* out */ size_t& numTabsStripped, ostream* pOut)
 {
-	Path savedOriginalPath(getTempPath(originalPath));
-	rename(originalPath, savedOriginalPath);
-	rename(tempPath, originalPath);
-	PathDeleter savedOriginalPathDeleter(savedOriginalPath);
+	auto pArena = ScratchArena::forThisThread().resource();
+	WhiteSpaceScanner scanner(pOut, pArena);
+	BlockReader(in, pArena).feed(scanner);
+	const auto counts = scanner.finish();
+
+	numLinesAffected = counts.m_numLinesAffected;
+	numSpacesStripped = counts.m_numSpacesStripped;
+	numTabsStripped = counts.m_numTabsStripped;
 }
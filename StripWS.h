@@ -3,6 +3,10 @@
 #define STRIPWS_H_INCLUDED
 
 #include "FileEnumerator.h"
+#include "OffendingFiles.h"
+#include "RecordWriter.h"
+#include "ResultsCache.h"
+#include "TextScanners.h"
 #include "Utils.h"
 
 #include <filesystem>
@@ -15,6 +19,7 @@ class StripWS
 {
 public:
 	static int usage(::std::ostream& strm, ::std::string_view progName, const char* pMsg);
+	static constexpr bool k_hasReportModes = true;	///< -l and -q; see commonMain()
 
 	StripWS(::std::span<const char*const> args);
 	int run() const;
@@ -27,11 +32,17 @@ public:
 PRIVATE_EXCEPT_IN_TEST:
 	using Path = ::std::filesystem::path;
 
-	void queryFile(const Path& p) const;
-	void translateFile(const Path& p) const;
+	void queryFile(const Path& p, ResultsCache* pCache = nullptr,
+		RecordWriter* pWriter = nullptr) const;
+	void translateFile(const Path& p, ResultsCache* pCache = nullptr,
+		RecordWriter* pWriter = nullptr) const;
+	static void writeRecord(const Path& p, const WhiteSpaceCounts& counts, bool isStripped,
+		RecordWriter& writer);
+	static bool isFileOffending(const Path& p, ResultsCache* pCache = nullptr);
 
-	/// \brief Scans the input file, counts the occurrences of white space at
-	/// the end of a line, and optionally strips them into the provided stream.
+	/// \brief Runs a WhiteSpaceScanner over the input stream, which counts the
+	/// occurrences of white space at the end of a line, and optionally strips
+	/// them into the provided stream.
 	///
 	/// If pOut is null, then the method simply counts the occurrences of white
 	/// space at the end of a line.
@@ -42,14 +53,12 @@ PRIVATE_EXCEPT_IN_TEST:
 		/* out */ size_t& numSpacesStripped, /* out */ size_t& numTabsStripped,
 		::std::ostream* pOut = nullptr);
 
-	static void updateCounts(::std::string const& wsRun,
-		/* in-out */ size_t& numLinesAffected,
-		/* in-out */ size_t& numSpacesStripped,
-		/* in-out */ size_t& numTabsStripped);
-	static void replaceOriginalFileWithTemp(const Path& originalPath,
-		const Path& tempPath);
-
 	bool				m_isInQueryMode;
+	bool				m_isWatching;
+	ReportMode		m_reportMode;
+	OutputFormat	m_outputFormat;
+	Path				m_cachePath;
+	Path				m_sinceStatePath;
 	FileEnumerator	m_fileEnumerator;
 };
 
@@ -3,7 +3,10 @@
 #define CMDLINEUTIL_TEST_MODE
 #endif
 
+#include "AllocationStats.h"
 #include "Exceptions.h"
+#include "PathDeleter.h"
+#include "ScratchArena.h"
 #include "StripWS.h"
 #include "TestUtil.h"
 #include "Utils.h"
@@ -13,6 +16,9 @@
 #include <boost/range/algorithm/sort.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
+#include <fstream>
+#include <iostream>
+#include <iterator>
 #include <sstream>
 #include <vector>
 
@@ -23,7 +29,9 @@ namespace utd = ::boost::unit_test::data;
 
 using ::std::begin;
 using ::std::end;
+using ::std::ifstream;
 using ::std::istringstream;
+using ::std::ofstream;
 using ::std::ostringstream;
 using ::std::string;
 
@@ -38,6 +46,9 @@ static char const*const k_args01[] = { "stripws", "-?" };
 static char const*const k_args02[] = { "stripws", "-h" };
 static char const*const k_args03[] = { "stripws", "-help" };
 static char const*const k_args04[] = { "stripws", "-s" };
+static char const*const k_args05[] = { "stripws", "--watch", "StripWS.cpp" };
+static char const*const k_args06[] = { "stripws", "-s", "-l", "StripWS.cpp" };
+static char const*const k_args07[] = { "stripws", "-q", "-l", "StripWS.cpp" };
 
 static CmdLineParseFailTestCase const k_testCases[] =
 {
@@ -46,6 +57,9 @@ static CmdLineParseFailTestCase const k_testCases[] =
 	{ k_args02, "^$" },
 	{ k_args03, "^$" },
 	{ k_args04, ".*no files.*" },
+	{ k_args05, ".*option '--watch' is allowed only if.*" },
+	{ k_args06, ".*not allowed with '-s'.*" },
+	{ k_args07, ".*mutually exclusive.*" },
 };
 
 BOOST_DATA_TEST_CASE(cmdLineParseFailTest, utd::make(k_testCases), tc)
@@ -216,4 +230,74 @@ BOOST_DATA_TEST_CASE(scanFileTest, utd::make(k_testCases), tc)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_CASE(binaryFileIsLeftAloneTest)
+{
+	const fs::path testDir{"StripWSBinaryTestDir"};
+	const auto binaryFile = testDir / "data.bin";
+	const string contents{"header \n\0\t\n  \n", 14};
+	PathDeleter testDirDeleter(testDir);
+	create_directories(testDir);
+	ofstream(binaryFile, ::std::ios::binary) << contents;
+
+	const auto fileSpec = (testDir / "*.bin").string();
+	const char*const args[] = { "-s", fileSpec.c_str() };
+	const StripWS app{ArgSpan{args}};
+	ostringstream out;
+	{
+		CoutRedirect coutRedirect(out);
+		app.translateFile(binaryFile);
+		app.queryFile(binaryFile);
+	}
+
+	BOOST_CHECK_EQUAL("", out.str());
+	BOOST_CHECK(!StripWS::isFileOffending(binaryFile));
+	ifstream in(binaryFile, ::std::ios::binary);
+	BOOST_CHECK_EQUAL(contents, string(::std::istreambuf_iterator<char>(in), {}));
+}
+
+// Querying a file must make the same few allocations however many lines it
+// has, so that a regression such as constructing a string per line is caught:
+BOOST_AUTO_TEST_CASE(queryAllocationBudgetTest)
+{
+	static constexpr uint64_t k_maxAllocationsPerFile = 8;
+
+	const fs::path testDir{"StripWSAllocationTestDir"};
+	const auto smallFile = testDir / "small.txt";
+	const auto largeFile = testDir / "large.txt";
+	PathDeleter testDirDeleter(testDir);
+	create_directories(testDir);
+	ofstream(smallFile, ::std::ios::binary) << "one \ntwo\t\n";
+	{
+		ofstream out(largeFile, ::std::ios::binary);
+		for (int i = 0; i < 100'000; ++i)
+		{
+			out << "line " << i << ((i % 10 == 0) ? " \n" : "\n");
+		}
+	}
+
+	const auto fileSpec = (testDir / "*.txt").string();
+	const char*const args[] = { fileSpec.c_str() };
+	const StripWS app{ArgSpan{args}};
+	auto countQueryAllocations = [&app] (const fs::path& p)
+		{
+			ScratchArena::ResetGuard arenaResetGuard;
+			const auto before = AllocationStats::forThisThread();
+			app.queryFile(p);
+			return (AllocationStats::forThisThread() - before).m_numAllocations;
+		};
+	ostringstream out;
+	uint64_t smallFileAllocations = 0;
+	uint64_t largeFileAllocations = 0;
+	{
+		CoutRedirect coutRedirect(out);
+		countQueryAllocations(largeFile);	// Warm up the arena
+		smallFileAllocations = countQueryAllocations(smallFile);
+		largeFileAllocations = countQueryAllocations(largeFile);
+	}
+
+	BOOST_REQUIRE(AllocationStats::isCounting());
+	BOOST_CHECK_LE(smallFileAllocations, k_maxAllocationsPerFile);
+	BOOST_CHECK_EQUAL(smallFileAllocations, largeFileAllocations);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,302 @@
+
+#include "TarReader.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <optional>
+#include <string_view>
+
+using ::std::byte;
+using ::std::format;
+using ::std::min;
+using ::std::optional;
+using ::std::size_t;
+using ::std::string;
+using ::std::string_view;
+using ::std::uint64_t;
+
+// Offsets and lengths of the header fields that matter here:
+static constexpr size_t k_nameOffset = 0;
+static constexpr size_t k_nameLength = 100;
+static constexpr size_t k_sizeOffset = 124;
+static constexpr size_t k_sizeLength = 12;
+static constexpr size_t k_checksumOffset = 148;
+static constexpr size_t k_checksumLength = 8;
+static constexpr size_t k_typeOffset = 156;
+static constexpr size_t k_magicOffset = 257;
+static constexpr size_t k_prefixOffset = 345;
+static constexpr size_t k_prefixLength = 155;
+
+// A pax or GNU long-name header this large is surely corrupt:
+static constexpr uint64_t k_maxExtendedHeaderSize = 1024 * 1024;
+
+static string_view stringField(const unsigned char* pHeader, size_t offset, size_t length)
+{
+	const auto pField = reinterpret_cast<const char*>(pHeader + offset);
+	return string_view{pField, ::strnlen(pField, length)};
+}
+
+// An octal number, possibly padded with spaces and terminated by a NUL or a
+// space, or, if the high bit of the first byte is set, GNU's base-256 form:
+static uint64_t numericField(const unsigned char* pHeader, size_t offset, size_t length)
+{
+	const auto pField = pHeader + offset;
+	uint64_t result = 0;
+	if ((pField[0] & 0x80) != 0)
+	{
+		result = pField[0] & 0x7f;
+		for (size_t i = 1; i < length; ++i)
+		{
+			result = (result << 8) | pField[i];
+		}
+		return result;
+	}
+
+	size_t i = 0;
+	for (; i < length && pField[i] == ' '; ++i)
+	{
+	}
+	for (; i < length && pField[i] >= '0' && pField[i] <= '7'; ++i)
+	{
+		result = (result << 3) | static_cast<uint64_t>(pField[i] - '0');
+	}
+	return result;
+}
+
+// The checksum is the sum of the header's bytes with the checksum field
+// taken as spaces.  Some old tar programs summed signed chars.
+static bool isChecksumValid(const unsigned char* pHeader)
+{
+	uint64_t unsignedSum = 0;
+	::std::int64_t signedSum = 0;
+	for (size_t i = 0; i < 512; ++i)
+	{
+		const bool isInChecksum = (i >= k_checksumOffset && i < k_checksumOffset + k_checksumLength);
+		const unsigned char ch = isInChecksum ? ' ' : pHeader[i];
+		unsignedSum += ch;
+		signedSum += static_cast<signed char>(ch);
+	}
+	const auto checksum = numericField(pHeader, k_checksumOffset, k_checksumLength);
+	return checksum == unsignedSum || static_cast< ::std::int64_t>(checksum) == signedSum;
+}
+
+static uint64_t paddingAfter(uint64_t size)
+{
+	return (512 - size % 512) % 512;
+}
+
+// The records of a pax extended header look like "30 path=some/long/name\n",
+// where the leading number is the length of the whole record:
+static void parsePaxRecords(string_view records, string& path, optional<uint64_t>& size)
+{
+	while (!records.empty())
+	{
+		size_t recordLength = 0;
+		const auto [pEnd, ec] = ::std::from_chars(records.data(), records.data() + records.size(), recordLength);
+		if (ec != ::std::errc{} || recordLength == 0 || recordLength > records.size())
+		{
+			throw IOError("Corrupt pax extended header in tar archive");
+		}
+		const auto record = records.substr(0, recordLength);
+		records.remove_prefix(recordLength);
+
+		const auto keyPos = static_cast<size_t>(pEnd - record.data()) + 1;
+		const auto equalsPos = record.find('=', keyPos);
+		if (equalsPos == string_view::npos || record.back() != '\n')
+		{
+			throw IOError("Corrupt pax extended header in tar archive");
+		}
+		const auto key = record.substr(keyPos, equalsPos - keyPos);
+		const auto value = record.substr(equalsPos + 1, record.size() - equalsPos - 2);
+		if (key == "path")
+		{
+			path = value;
+		}
+		else if (key == "size")
+		{
+			uint64_t paxSize = 0;
+			::std::from_chars(value.data(), value.data() + value.size(), paxSize);
+			size = paxSize;
+		}
+	}
+}
+
+// ============================ TarReader ============================
+
+TarReader::TarReader(BlockReader& archiveReader) :
+	m_archiveReader(archiveReader),
+	m_block(),
+	m_member(),
+	m_numBytesLeft(0),
+	m_numPaddingBytes(0)
+{
+}
+
+bool TarReader::nextMember()
+{
+	skip(m_numBytesLeft + m_numPaddingBytes);
+	m_numBytesLeft = 0;
+	m_numPaddingBytes = 0;
+
+	string longPath;
+	optional<uint64_t> paxSize;
+	for (;;)
+	{
+		byte header[k_recordSize];
+		if (!readHeader(header))
+		{
+			return false;	// Tolerate a missing end-of-archive marker
+		}
+		const auto pHeader = reinterpret_cast<const unsigned char*>(header);
+		if (::std::all_of(pHeader, pHeader + k_recordSize, [] (unsigned char ch) { return ch == 0; }))
+		{
+			return false;	// The end-of-archive marker
+		}
+		else if (!isChecksumValid(pHeader))
+		{
+			throw IOError("Corrupt tar archive:  header checksum mismatch");
+		}
+
+		const auto size = numericField(pHeader, k_sizeOffset, k_sizeLength);
+		const auto type = static_cast<char>(pHeader[k_typeOffset]);
+		if (type == 'x')
+		{
+			parsePaxRecords(readExtendedHeader(size), longPath, paxSize);
+			continue;
+		}
+		else if (type == 'L')
+		{
+			const auto name = readExtendedHeader(size);
+			longPath.assign(name.c_str());	// Up to the terminating NUL
+			continue;
+		}
+		else if (type == 'g' || type == 'K')
+		{
+			skip(size + paddingAfter(size));	// Global pax headers and GNU long link names
+			continue;
+		}
+
+		if (longPath.empty())
+		{
+			longPath = stringField(pHeader, k_nameOffset, k_nameLength);
+			const auto prefix = stringField(pHeader, k_prefixOffset, k_prefixLength);
+			if (stringField(pHeader, k_magicOffset, 5) == "ustar" && !prefix.empty())
+			{
+				longPath = string{prefix} + '/' + longPath;
+			}
+		}
+		while (longPath.starts_with("./"))
+		{
+			longPath.erase(0, 2);
+		}
+
+		// Links, devices, directories, and FIFOs have no contents in the archive:
+		const bool hasContents = (type < '1' || type > '6');
+		m_member.m_path = ::std::move(longPath);
+		m_member.m_size = hasContents ? paxSize.value_or(size) : 0;
+		m_member.m_isRegularFile = (type == '0' || type == '\0' || type == '7');
+		m_numBytesLeft = m_member.m_size;
+		m_numPaddingBytes = paddingAfter(m_member.m_size);
+		return true;
+	}
+}
+
+ByteSpan TarReader::nextMemberBlock()
+{
+	if (m_numBytesLeft == 0)
+	{
+		return ByteSpan{};
+	}
+	else if (m_block.empty())
+	{
+		m_block = m_archiveReader.next();
+		if (m_block.empty())
+		{
+			throw IOError("Truncated tar archive");
+		}
+	}
+	const auto numBytes = static_cast<size_t>(min<uint64_t>(m_numBytesLeft, m_block.size()));
+	const auto result = m_block.first(numBytes);
+	m_block = m_block.subspan(numBytes);
+	m_numBytesLeft -= numBytes;
+	return result;
+}
+
+bool TarReader::readHeader(byte (&header)[k_recordSize])
+{
+	size_t numBytes = 0;
+	while (numBytes < k_recordSize)
+	{
+		if (m_block.empty())
+		{
+			m_block = m_archiveReader.next();
+			if (m_block.empty())
+			{
+				if (numBytes == 0)
+				{
+					return false;
+				}
+				throw IOError("Truncated tar archive");
+			}
+		}
+		const auto numBytesToCopy = min(k_recordSize - numBytes, m_block.size());
+		::std::memcpy(header + numBytes, m_block.data(), numBytesToCopy);
+		m_block = m_block.subspan(numBytesToCopy);
+		numBytes += numBytesToCopy;
+	}
+	return true;
+}
+
+string TarReader::readExtendedHeader(uint64_t size)
+{
+	if (size > k_maxExtendedHeaderSize)
+	{
+		throw IOError(format("Corrupt tar archive:  {0}-byte extended header", size));
+	}
+	string result;
+	result.reserve(static_cast<size_t>(size));
+	m_numBytesLeft = size;
+	for (auto block = nextMemberBlock(); !block.empty(); block = nextMemberBlock())
+	{
+		result.append(reinterpret_cast<const char*>(block.data()), block.size());
+	}
+	skip(paddingAfter(size));
+	return result;
+}
+
+void TarReader::skip(uint64_t numBytes)
+{
+	while (numBytes > 0)
+	{
+		if (m_block.empty())
+		{
+			m_block = m_archiveReader.next();
+			if (m_block.empty())
+			{
+				throw IOError("Truncated tar archive");
+			}
+		}
+		const auto numBytesSkipped = static_cast<size_t>(min<uint64_t>(numBytes, m_block.size()));
+		m_block = m_block.subspan(numBytesSkipped);
+		numBytes -= numBytesSkipped;
+	}
+}
+
+// ============================ TarMemberBuf ============================
+
+TarMemberBuf::int_type TarMemberBuf::underflow()
+{
+	const auto block = m_tarReader.nextMemberBlock();
+	if (block.empty())
+	{
+		return traits_type::eof();
+	}
+	// The buffer is only ever read, so pointing it into the archive's block
+	// saves a copy:
+	const auto pBegin = const_cast<char*>(reinterpret_cast<const char*>(block.data()));
+	setg(pBegin, pBegin, pBegin + block.size());
+	return traits_type::to_int_type(*pBegin);
+}
@@ -0,0 +1,77 @@
+
+#if !defined(TARREADER_H_INCLUDED)
+#define TARREADER_H_INCLUDED
+
+#include "BlockReader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+
+/// \brief Reads the members of a tar archive in a single sequential pass,
+/// without extracting them.  Each member's contents are streamed straight
+/// out of the blocks of the archive's BlockReader, so the archive may also
+/// be compressed (see BlockReader::decompressIfCompressed()).
+///
+/// POSIX ustar archives are understood, with the long names of both the pax
+/// ("x" headers) and GNU ("L" headers) formats, and GNU's base-256 sizes for
+/// members over 8 GiB.  Throws IOError if the archive is truncated or a
+/// header is corrupt.
+class TarReader
+{
+public:
+	struct Member
+	{
+		::std::string		m_path;				///< As stored, less any leading "./"
+		::std::uint64_t	m_size;
+		bool					m_isRegularFile;	///< Rather than a directory, link, device, etc.
+	};
+
+	explicit TarReader(BlockReader& archiveReader);
+
+	/// \brief Advances to the next member, skipping whatever has not been read
+	/// of the current one.  Returns false at the end of the archive.
+	bool nextMember();
+
+	const Member& member() const noexcept
+		{ return m_member; }
+
+	/// \brief Returns the next part of the contents of the current member, or
+	/// an empty span at its end.  The span remains valid until the next call.
+	ByteSpan nextMemberBlock();
+
+	TarReader(const TarReader&) = delete;
+	TarReader& operator=(const TarReader&) = delete;
+	TarReader(TarReader&&) = delete;
+	TarReader& operator=(TarReader&&) = delete;
+
+private:
+	static constexpr ::std::size_t k_recordSize = 512;
+
+	bool readHeader(::std::byte (&header)[k_recordSize]);
+	::std::string readExtendedHeader(::std::uint64_t size);
+	void skip(::std::uint64_t numBytes);
+
+	BlockReader&		m_archiveReader;
+	ByteSpan				m_block;				// The unread part of the archive's current block
+	Member				m_member;
+	::std::uint64_t	m_numBytesLeft;	// In the current member
+	::std::uint64_t	m_numPaddingBytes;	// After the current member
+};
+
+/// \brief A read-only stream buffer over the contents of the current member
+/// of a TarReader, so that a BlockReader can scan the member like a file.
+class TarMemberBuf : public ::std::streambuf
+{
+public:
+	explicit TarMemberBuf(TarReader& tarReader) : m_tarReader(tarReader) {}
+
+protected:
+	int_type underflow() override;
+
+private:
+	TarReader& m_tarReader;
+};
+
+#endif // TARREADER_H_INCLUDED
@@ -0,0 +1,126 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "BlockReader.h"
+#include "Exceptions.h"
+#include "TarReader.h"
+#include "TestUtil.h"
+
+#include <boost/test/unit_test.hpp>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using ::std::istringstream;
+using ::std::string;
+using ::std::vector;
+
+struct MemberContents
+{
+	string	m_path;
+	bool		m_isRegularFile;
+	string	m_contents;
+};
+
+// Reads every member of the archive, each through a BlockReader over a
+// TarMemberBuf, as FileEnumerator does:
+static vector<MemberContents> readArchive(const string& archive)
+{
+	istringstream in(archive);
+	BlockReader archiveReader(in);
+	archiveReader.decompressIfCompressed();
+	TarReader tarReader(archiveReader);
+	vector<MemberContents> result;
+	while (tarReader.nextMember())
+	{
+		TarMemberBuf memberBuf(tarReader);
+		::std::istream memberStream(&memberBuf);
+		BlockReader memberReader(memberStream);
+		string contents;
+		memberReader.forEachBlock([&contents] (ByteSpan block)
+			{ contents.append(reinterpret_cast<const char*>(block.data()), block.size()); });
+		BOOST_CHECK_EQUAL(tarReader.member().m_size, contents.size());
+		result.push_back({tarReader.member().m_path, tarReader.member().m_isRegularFile, contents});
+	}
+	return result;
+}
+
+BOOST_AUTO_TEST_SUITE(TarReaderTestSuite)
+
+BOOST_AUTO_TEST_CASE(membersTest)
+{
+	const string bigContents(200 * 1000 + 7, 'x');
+	const string longPath = string(60, 'd') + '/' + string(70, 'f') + ".txt";
+	const auto archive = makeTar({
+		{ "./docs/", "", '5' },
+		{ "./docs/a.txt", "Line 1\r\nLine 2\r\n" },
+		{ "empty.txt", "" },
+		{ "big.txt", bigContents },
+		{ "link.txt", "", '2' },
+		{ longPath, "long\n" },
+	});
+
+	for (auto compression : { Compression::none, Compression::gzip, Compression::zstd })
+	{
+		BOOST_TEST_CONTEXT("Compression " << compressionName(compression))
+		{
+			const auto members = readArchive(compressText(archive, compression));
+			BOOST_REQUIRE_EQUAL(6u, members.size());
+			BOOST_CHECK_EQUAL("docs/", members[0].m_path);
+			BOOST_CHECK(!members[0].m_isRegularFile);
+			BOOST_CHECK_EQUAL("docs/a.txt", members[1].m_path);
+			BOOST_CHECK(members[1].m_isRegularFile);
+			BOOST_CHECK_EQUAL("Line 1\r\nLine 2\r\n", members[1].m_contents);
+			BOOST_CHECK_EQUAL("", members[2].m_contents);
+			BOOST_CHECK(bigContents == members[3].m_contents);
+			BOOST_CHECK(!members[4].m_isRegularFile);
+			BOOST_CHECK_EQUAL(longPath, members[5].m_path);
+			BOOST_CHECK_EQUAL("long\n", members[5].m_contents);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(unreadMembersAreSkippedTest)
+{
+	const auto archive = makeTar({ { "a.txt", string(70 * 1000, 'a') }, { "b.txt", "bee" } });
+	istringstream in(archive);
+	BlockReader archiveReader(in);
+	TarReader tarReader(archiveReader);
+	BOOST_REQUIRE(tarReader.nextMember());
+	BOOST_CHECK_EQUAL(70u * 1000u, tarReader.nextMemberBlock().size() + tarReader.nextMemberBlock().size());
+	BOOST_REQUIRE(tarReader.nextMember());
+	BOOST_CHECK_EQUAL("b.txt", tarReader.member().m_path);
+	BOOST_CHECK(!tarReader.nextMember());
+	BOOST_CHECK(!tarReader.nextMember());
+}
+
+BOOST_AUTO_TEST_CASE(gnuLongNameTest)
+{
+	const string longPath = string(150, 'n') + ".txt";
+	string archive = makeTarHeader("././@LongLink", longPath.size() + 1, 'L');
+	archive += longPath;
+	archive.append(512 - longPath.size(), '\0');
+	archive += makeTarHeader(longPath.substr(0, 100), 3, '0');
+	archive += string{"abc"} + string(509, '\0');
+
+	const auto members = readArchive(archive);	// Without the end-of-archive marker
+	BOOST_REQUIRE_EQUAL(1u, members.size());
+	BOOST_CHECK_EQUAL(longPath, members[0].m_path);
+	BOOST_CHECK_EQUAL("abc", members[0].m_contents);
+}
+
+BOOST_AUTO_TEST_CASE(badArchiveTest)
+{
+	const auto archive = makeTar({ { "a.txt", string(3000, 'a') }, { "b.txt", "bee" } });
+	BOOST_CHECK_THROW(readArchive(archive.substr(0, 2000)), IOError);
+	BOOST_CHECK_THROW(readArchive(archive.substr(0, 100)), IOError);
+
+	auto corrupted = archive;
+	corrupted[10] = 'Z';
+	BOOST_CHECK_THROW(readArchive(corrupted), IOError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,8 +4,13 @@
 #include "TestUtil.h"
 
 #include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <format>
 #include <ostream>
 #include <regex>
+#include <stdexcept>
+#include <zlib.h>
+#include <zstd.h>
 
 #if !defined(_WIN32)
 #	define USE_OSTREAM_JOINER_CODE
@@ -24,6 +29,7 @@ using ::std::experimental::make_ostream_joiner;
 #endif
 using ::std::regex;
 using ::std::string;
+using ::std::string_view;
 
 bool CmdLineParseFailTestCase::doesExMatch(CmdLineError const& ex) const
 {
@@ -58,3 +64,98 @@ bool CmdLineParseFailTestCase::doesExMatch(CmdLineError const& ex) const
 
 	return ostrm << '\"';
 }
+
+string compressText(string_view text, Compression compression)
+{
+	string result;
+	if (compression == Compression::gzip)
+	{
+		z_stream zStream{};
+		// 16 selects the gzip wrapper:
+		if (::deflateInit2(&zStream, Z_BEST_SPEED, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			throw ::std::runtime_error("deflateInit2 failed");
+		}
+		result.resize(::deflateBound(&zStream, static_cast<uLong>(text.size())));
+		zStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+		zStream.avail_in = static_cast<uInt>(text.size());
+		zStream.next_out = reinterpret_cast<Bytef*>(result.data());
+		zStream.avail_out = static_cast<uInt>(result.size());
+		const auto status = ::deflate(&zStream, Z_FINISH);
+		result.resize(zStream.total_out);
+		::deflateEnd(&zStream);
+		if (status != Z_STREAM_END)
+		{
+			throw ::std::runtime_error("deflate failed");
+		}
+	}
+	else if (compression == Compression::zstd)
+	{
+		result.resize(::ZSTD_compressBound(text.size()));
+		const auto size = ::ZSTD_compress(result.data(), result.size(), text.data(), text.size(), 1);
+		if (::ZSTD_isError(size))
+		{
+			throw ::std::runtime_error(::ZSTD_getErrorName(size));
+		}
+		result.resize(size);
+	}
+	else
+	{
+		result = text;
+	}
+	return result;
+}
+
+string makeTarHeader(string_view name, ::std::uint64_t size, char type)
+{
+	string header(512, '\0');
+	name.copy(header.data(), ::std::min<size_t>(name.size(), 100));
+	::std::memcpy(header.data() + 100, "0000644", 7);
+	::std::memcpy(header.data() + 108, "0000000", 7);
+	::std::memcpy(header.data() + 116, "0000000", 7);
+	const auto sizeField = ::std::format("{0:011o}", size);
+	sizeField.copy(header.data() + 124, 11);
+	::std::memcpy(header.data() + 136, "00000000000", 11);
+	header[156] = type;
+	::std::memcpy(header.data() + 257, "ustar\0" "00", 8);
+
+	::std::memset(header.data() + 148, ' ', 8);
+	unsigned checksum = 0;
+	for (auto ch : header)
+	{
+		checksum += static_cast<unsigned char>(ch);
+	}
+	const auto checksumField = ::std::format("{0:06o}", checksum);
+	checksumField.copy(header.data() + 148, 6);
+	header[154] = '\0';
+	return header;
+}
+
+static void appendTarMember(string& archive, string_view name, string_view contents, char type)
+{
+	archive += makeTarHeader(name, contents.size(), type);
+	archive += contents;
+	archive.append((512 - contents.size() % 512) % 512, '\0');
+}
+
+string makeTar(::std::initializer_list<TarTestMember> members)
+{
+	string archive;
+	for (const auto& member : members)
+	{
+		if (member.m_path.size() > 100)
+		{
+			// A pax record's length includes the digits of the length itself:
+			const auto record = " path=" + member.m_path + "\n";
+			auto length = record.size() + 1;
+			while (length != record.size() + ::std::to_string(length).size())
+			{
+				length = record.size() + ::std::to_string(length).size();
+			}
+			appendTarMember(archive, "PaxHeader", ::std::to_string(length) + record, 'x');
+		}
+		appendTarMember(archive, member.m_path.substr(0, 100), member.m_contents, member.m_type);
+	}
+	archive.append(1024, '\0');
+	return archive;
+}
@@ -2,10 +2,15 @@
 #if !defined(TESTUTIL_H_INCLUDED)
 #define TESTUTIL_H_INCLUDED
 
+#include "Decompressor.h"
 #include "Exceptions.h"
 
-#include <iosfwd>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
 #include <span>
+#include <string>
+#include <string_view>
 
 // ===========================================================================
 //
@@ -38,4 +43,57 @@ struct CmdLineParseFailTestCase : public CmdLineParseTestCase
 
 ::std::ostream& operator<<(::std::ostream& ostrm, CmdLineParseTestCase const& tc);
 
+// ===========================================================================
+//
+// Output capture
+//
+// ===========================================================================
+
+/// \brief Redirects cout into target until it goes out of scope, so that cout
+/// is restored even if the code under test throws.  Close its scope before
+/// any BOOST_ checks, which log to cout.
+class CoutRedirect
+{
+public:
+	explicit CoutRedirect(::std::ostream& target)
+		: m_pOriginalBuf(::std::cout.rdbuf(target.rdbuf())) {}
+	~CoutRedirect()
+		{ ::std::cout.rdbuf(m_pOriginalBuf); }
+
+	CoutRedirect(const CoutRedirect&) = delete;
+	CoutRedirect& operator=(const CoutRedirect&) = delete;
+	CoutRedirect(CoutRedirect&&) = delete;
+	CoutRedirect& operator=(CoutRedirect&&) = delete;
+
+private:
+	::std::streambuf*	m_pOriginalBuf;
+};
+
+// ===========================================================================
+//
+// Test data
+//
+// ===========================================================================
+
+/// \brief Compresses text in the given format, for testing the reading of
+/// compressed files.
+::std::string compressText(::std::string_view text, Compression compression);
+
+/// \brief One member of a tar archive made by makeTar().  The type is that of
+/// the tar header, e.g., '0' for a regular file or '5' for a directory.
+struct TarTestMember
+{
+	::std::string	m_path;
+	::std::string	m_contents;
+	char				m_type = '0';
+};
+
+/// \brief Returns a ustar header block for a member with the given name (at
+/// most 100 bytes long), size, and type.
+::std::string makeTarHeader(::std::string_view name, ::std::uint64_t size, char type);
+
+/// \brief Builds a tar archive in memory, with a pax extended header for
+/// each path too long for the ustar header.
+::std::string makeTar(::std::initializer_list<TarTestMember> members);
+
 #endif // TESTUTIL_H_INCLUDED
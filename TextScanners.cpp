@@ -0,0 +1,823 @@
+
+#include "TextScanners.h"
+#include "ByteKernels.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <iterator>
+#include <ostream>
+#include <regex>
+#include <stdexcept>
+#include <utility>
+
+using ::std::invalid_argument;
+using ::std::ostream;
+using ::std::regex;
+using ::std::string_view;
+using ::std::vector;
+
+static const char* toChars(const ::std::byte* p)
+{
+	return reinterpret_cast<const char*>(p);
+}
+
+static bool isSpaceOrTab(char ch)
+{
+	return ch == ' ' || ch == '\t';
+}
+
+static constexpr ByteKernels::ByteSet k_eolBytes{"\r\n"};
+static constexpr ByteKernels::ByteSet k_lineFeed{"\n"};
+static constexpr ByteKernels::ByteSet k_eolOrNonAsciiBytes{"\r\n", true};
+
+static void checkStream(const ostream* pOut)
+{
+	if (pOut != nullptr && !pOut->good())
+	{
+		throw IOError("Error while writing output to temporary file");
+	}
+}
+
+// ============================ EolScanner ============================
+
+EolType EolCounts::eolType() const noexcept
+{
+	EolType eolType = EolType::MIXED;
+	if (m_numDosEols == 0 && m_numMacEols == 0 && m_numUnixEols == 0)
+	{
+		eolType = EolType::INDETERMINATE;
+	}
+	else if (m_numDosEols > 0 && m_numMacEols == 0 && m_numUnixEols == 0)
+	{
+		eolType = EolType::DOS;
+	}
+	else if (m_numDosEols == 0 && m_numMacEols > 0 && m_numUnixEols == 0)
+	{
+		eolType = EolType::MACINTOSH;
+	}
+	else if (m_numDosEols == 0 && m_numMacEols == 0 && m_numUnixEols > 0)
+	{
+		eolType = EolType::UNIX;
+	}
+	return eolType;
+}
+
+EolScanner::EolScanner(ostream* pOut, EolType targetEolType) :
+	m_pOut(pOut),
+	m_eol(toEolString(targetEolType)),
+	m_lastCharWasReturn(false),
+	m_counts{0, 0, 0}
+{
+	if (m_pOut != nullptr && m_eol.empty())
+	{
+		throw invalid_argument("Invalid value for argument targetEolType in EolScanner");
+	}
+}
+
+void EolScanner::scan(ByteSpan block)
+{
+	const char* pBegin = toChars(block.data());
+	const char* pEnd = pBegin + block.size();
+	const char* pRunStart = pBegin;	// Start of the bytes that are not yet written
+	for (const char* p = pBegin; p != pEnd; ++p)
+	{
+		if (m_lastCharWasReturn && *p != '\r' && *p != '\n')
+		{
+			++m_counts.m_numMacEols;
+			writeEol();
+			m_lastCharWasReturn = false;
+		}
+
+		// Only the ends of line matter, so skip ahead to the next:
+		p = ByteKernels::findFirstOf(p, pEnd, k_eolBytes);
+		if (p == pEnd)
+		{
+			break;
+		}
+		else if (*p == '\r')
+		{
+			write(pRunStart, p);
+			if (m_lastCharWasReturn)
+			{
+				++m_counts.m_numMacEols;
+				writeEol();
+			}
+			m_lastCharWasReturn = true;
+			pRunStart = p + 1;
+		}
+		else if (*p == '\n')
+		{
+			write(pRunStart, p);
+			if (m_lastCharWasReturn)
+			{
+				++m_counts.m_numDosEols;
+			}
+			else
+			{
+				++m_counts.m_numUnixEols;
+			}
+			writeEol();
+			m_lastCharWasReturn = false;
+			pRunStart = p + 1;
+		}
+	}
+	write(pRunStart, pEnd);
+	checkStream(m_pOut);
+}
+
+EolCounts EolScanner::finish()
+{
+	if (m_lastCharWasReturn)
+	{
+		++m_counts.m_numMacEols;
+		writeEol();
+		m_lastCharWasReturn = false;
+	}
+	checkStream(m_pOut);
+	return m_counts;
+}
+
+void EolScanner::write(const char* pBegin, const char* pEnd)
+{
+	if (m_pOut != nullptr && pBegin != pEnd)
+	{
+		m_pOut->write(pBegin, pEnd - pBegin);
+	}
+}
+
+void EolScanner::writeEol()
+{
+	if (m_pOut != nullptr)
+	{
+		m_pOut->write(m_eol.data(), static_cast< ::std::streamsize>(m_eol.size()));
+	}
+}
+
+string_view toEolString(EolType eolType)
+{
+	switch (eolType)
+	{
+	case EolType::DOS:
+		return "\r\n";
+	case EolType::MACINTOSH:
+		return "\r";
+	case EolType::UNIX:
+		return "\n";
+	default:
+		return "";
+	}
+}
+
+string_view eolTypeName(EolType eolType)
+{
+	switch (eolType)
+	{
+	case EolType::INDETERMINATE:
+		return "none";
+	case EolType::MIXED:
+		return "mixed";
+	case EolType::DOS:
+		return "dos";
+	case EolType::MACINTOSH:
+		return "mac";
+	case EolType::UNIX:
+		return "unix";
+	default:
+		throw invalid_argument("Unrecognized EolType enumeration value in eolTypeName");
+	}
+}
+
+char eolLetter(EolType eolType)
+{
+	switch (eolType)
+	{
+	case EolType::INDETERMINATE:
+		return 'I';
+	case EolType::MIXED:
+		return 'X';
+	case EolType::DOS:
+		return 'D';
+	case EolType::MACINTOSH:
+		return 'M';
+	case EolType::UNIX:
+		return 'U';
+	default:
+		throw invalid_argument("Unrecognized EolType enumeration value in eolLetter");
+	}
+}
+
+EolCounts scanEols(ByteSpan bytes)
+{
+	EolScanner scanner;
+	scanner.scan(bytes);
+	return scanner.finish();
+}
+
+EolCounts scanEols(int fd)
+{
+	EolScanner scanner;
+	BlockReader(fd).feed(scanner);
+	return scanner.finish();
+}
+
+// ============================ WhiteSpaceScanner ============================
+
+WhiteSpaceScanner::WhiteSpaceScanner(ostream* pOut, ::std::pmr::memory_resource* pMemRsrc) :
+	m_pOut(pOut),
+	m_wsRun(pMemRsrc),
+	m_counts{0, 0, 0}
+{
+}
+
+void WhiteSpaceScanner::scan(ByteSpan block)
+{
+	const char* pBegin = toChars(block.data());
+	const char* pEnd = pBegin + block.size();
+	const char* pRunStart = pBegin;	// Start of the bytes that are not yet written
+	const char* p = pBegin;
+
+	// White space held back from the end of the last block continues here
+	// until we see what follows it:
+	if (!m_wsRun.empty())
+	{
+		const auto ws = ByteKernels::leadingWhiteSpace(p, pEnd);
+		m_wsRun.append(p, p + ws.m_length);
+		p = pRunStart = p + ws.m_length;
+		if (p != pEnd)
+		{
+			if (*p == '\r' || *p == '\n')
+			{
+				updateCounts(m_wsRun);
+			}
+			else
+			{
+				write(m_wsRun.data(), m_wsRun.data() + m_wsRun.size());
+			}
+			m_wsRun.clear();
+		}
+	}
+
+	// Then go from one end of line to the next, looking back from each for
+	// the white space before it:
+	while (p != pEnd)
+	{
+		const char* pEol = ByteKernels::findFirstOf(p, pEnd, k_eolBytes);
+		const char* pWsStart = pEol;
+		while (pWsStart != p && isSpaceOrTab(pWsStart[-1]))
+		{
+			--pWsStart;
+		}
+		if (pEol == pEnd)
+		{
+			// Hold the white space back until we see what follows it:
+			write(pRunStart, pWsStart);
+			m_wsRun.append(pWsStart, pEnd);
+			pRunStart = pEnd;
+			break;
+		}
+		else if (pWsStart != pEol)
+		{
+			write(pRunStart, pWsStart);
+			updateCounts(string_view(pWsStart, pEol - pWsStart));
+			pRunStart = pEol;
+		}
+		p = pEol + 1;
+	}
+	write(pRunStart, pEnd);
+	checkStream(m_pOut);
+}
+
+WhiteSpaceCounts WhiteSpaceScanner::finish()
+{
+	updateCounts(m_wsRun);
+	m_wsRun.clear();
+	return m_counts;
+}
+
+void WhiteSpaceScanner::write(const char* pBegin, const char* pEnd)
+{
+	if (m_pOut != nullptr && pBegin != pEnd)
+	{
+		m_pOut->write(pBegin, pEnd - pBegin);
+	}
+}
+
+void WhiteSpaceScanner::updateCounts(string_view wsRun)
+{
+	if (!wsRun.empty())
+	{
+		++m_counts.m_numLinesAffected;
+		auto numSpaces = ByteKernels::count(wsRun.data(), wsRun.data() + wsRun.size(), ' ');
+		m_counts.m_numSpacesStripped += numSpaces;
+		m_counts.m_numTabsStripped += wsRun.size() - numSpaces;
+	}
+}
+
+WhiteSpaceCounts countTrailingWhiteSpace(ByteSpan bytes)
+{
+	WhiteSpaceScanner scanner;
+	scanner.scan(bytes);
+	return scanner.finish();
+}
+
+WhiteSpaceCounts countTrailingWhiteSpace(int fd)
+{
+	WhiteSpaceScanner scanner;
+	BlockReader(fd).feed(scanner);
+	return scanner.finish();
+}
+
+// ============================ NonAsciiScanner ============================
+
+NonAsciiScanner::NonAsciiScanner(RunHandler runHandler, ::std::pmr::memory_resource* pMemRsrc) :
+	m_runHandler(::std::move(runHandler)),
+	m_run{1, 0, ::std::pmr::string{pMemRsrc}},
+	m_colNum(1),
+	m_wasLastCharCR(false)
+{
+}
+
+void NonAsciiScanner::scan(ByteSpan block)
+{
+	const char* pEnd = toChars(block.data()) + block.size();
+	for (const char* p = toChars(block.data()); p != pEnd; ++p)
+	{
+		// A stretch of plain ASCII characters has the effect of its first one,
+		// apart from the column number, so skip over it:
+		if (const char* pNext = ByteKernels::findFirstOf(p, pEnd, k_eolOrNonAsciiBytes); pNext != p)
+		{
+			reportRun();
+			if (m_wasLastCharCR)
+			{
+				++m_run.m_lineNum;
+				m_wasLastCharCR = false;
+			}
+			m_colNum += static_cast<size_t>(pNext - p);
+			p = pNext;
+			if (p == pEnd)
+			{
+				break;
+			}
+		}
+
+		auto ch = *p;
+		if (ch == '\r')
+		{
+			reportRun();
+			m_colNum = 0;
+			m_wasLastCharCR = true;
+		}
+		else if (ch == '\n')
+		{
+			reportRun();
+			++m_run.m_lineNum;
+			m_colNum = 0;
+			m_wasLastCharCR = false;
+		}
+		else
+		{
+			// Only a non-ASCII character gets here:
+			if (m_run.m_bytes.empty())
+			{
+				m_run.m_approxColNum = m_colNum;
+			}
+			m_run.m_bytes += ch;
+			if (m_wasLastCharCR)
+			{
+				++m_run.m_lineNum;
+				m_wasLastCharCR = false;
+			}
+		}
+		++m_colNum;
+	}
+}
+
+void NonAsciiScanner::finish()
+{
+	reportRun();
+}
+
+void NonAsciiScanner::reportRun()
+{
+	if (!m_run.m_bytes.empty())
+	{
+		m_runHandler(m_run);
+		m_run.m_bytes.clear();
+	}
+}
+
+::std::vector<NonAsciiRun> findNonAsciiRuns(ByteSpan bytes)
+{
+	vector<NonAsciiRun> runs;
+	NonAsciiScanner scanner([&runs] (const NonAsciiRun& run) { runs.push_back(run); });
+	scanner.scan(bytes);
+	scanner.finish();
+	return runs;
+}
+
+::std::vector<NonAsciiRun> findNonAsciiRuns(int fd)
+{
+	vector<NonAsciiRun> runs;
+	NonAsciiScanner scanner([&runs] (const NonAsciiRun& run) { runs.push_back(run); });
+	BlockReader(fd).feed(scanner);
+	scanner.finish();
+	return runs;
+}
+
+void HighBitScanner::scan(ByteSpan block) noexcept
+{
+	const char* pEnd = toChars(block.data()) + block.size();
+	m_isFound = m_isFound || ByteKernels::findHighBit(toChars(block.data()), pEnd) != pEnd;
+}
+
+// ============================ IndentScanner ============================
+
+size_t get(const LineTypeCounts& lineTypeCounts, IndentType indentType)
+{
+	auto it{lineTypeCounts.find(indentType)};
+	return (it == end(lineTypeCounts))
+		? 0
+		: it->second;
+}
+
+string_view indentTypeName(IndentType indentType)
+{
+	switch (indentType)
+	{
+	case IndentType::space:
+		return "space";
+	case IndentType::tab:
+		return "tab";
+	case IndentType::javadocTab:
+		return "javadocTab";
+	case IndentType::javadocLeft:
+		return "javadocLeft";
+	case IndentType::mixed:
+		return "mixed";
+	case IndentType::indeterminate:
+		return "indeterminate";
+	default:
+		throw invalid_argument("Unrecognized IndentType enumeration value in indentTypeName");
+	}
+}
+
+char indentLetter(IndentType indentType)
+{
+	switch (indentType)
+	{
+	case IndentType::space:
+		return 'S';
+	case IndentType::tab:
+		return 'T';
+	case IndentType::javadocTab:
+		return 'J';
+	case IndentType::mixed:
+		return 'M';
+	case IndentType::indeterminate:
+		return 'I';
+	default:
+		throw invalid_argument("Unrecognized IndentType enumeration value in indentLetter");
+	}
+}
+
+// The definition of the line types, which classifyLine() follows except for
+// lines containing a carriage return.  Such a line (from a file with Mac or
+// mixed ends of line) never matches a pattern ending in ".*", so it is left
+// to the patterns themselves.
+static IndentType classifyLineViaRegex(string_view line, bool isJavaFile)
+{
+	// Function-local, so that the patterns are compiled on first use
+	// rather than at start-up by every program that links this file:
+	static const regex k_spacePattern{"^ +([^ \\t].*)?$"};
+	static const regex k_tabPattern{"^\\t+([^ \\t].*)?$"};
+	static const regex k_javadocTabPattern{"^\\t+ \\*.*$"};
+	static const regex k_javadocLeftPattern{"^ \\*.*$"};
+	static const regex k_indeterminatePattern{"^([^ \\t].*)?$"};
+
+	auto matches = [line] (const regex& rex)
+		{ return regex_match(cbegin(line), cend(line), rex); };
+
+	if (matches(k_indeterminatePattern))
+	{
+		return IndentType::indeterminate;
+	}
+	else if (isJavaFile && matches(k_javadocLeftPattern))
+	{
+		return IndentType::javadocLeft;
+	}
+	else if (matches(k_spacePattern))
+	{
+		return IndentType::space;
+	}
+	else if (matches(k_tabPattern))
+	{
+		return IndentType::tab;
+	}
+	else if (isJavaFile && matches(k_javadocTabPattern))
+	{
+		return IndentType::javadocTab;
+	}
+	else
+	{
+		return IndentType::mixed;
+	}
+}
+
+// Looks only at the indent itself, which is several times faster than
+// matching the whole line against the patterns above.
+IndentType classifyLine(string_view line, bool isJavaFile)
+{
+	const char* pLineEnd = line.data() + line.size();
+	if (ByteKernels::findFirstOf(line.data(), pLineEnd, k_eolBytes) != pLineEnd)
+	{
+		return classifyLineViaRegex(line, isJavaFile);
+	}
+
+	const auto indent = ByteKernels::leadingWhiteSpace(line.data(), pLineEnd);
+	if (indent.m_length == 0)
+	{
+		return IndentType::indeterminate;
+	}
+	else if (isJavaFile && line.starts_with(" *"))
+	{
+		return IndentType::javadocLeft;
+	}
+	else if (!indent.m_hasTab)
+	{
+		return IndentType::space;
+	}
+	else if (!indent.m_hasSpace)
+	{
+		return IndentType::tab;
+	}
+	else if (const auto numTabs = line.find_first_not_of('\t');
+		isJavaFile && numTabs > 0 && line.substr(numTabs).starts_with(" *"))
+	{
+		return IndentType::javadocTab;
+	}
+	else
+	{
+		return IndentType::mixed;
+	}
+}
+
+IndentType classifyFile(const LineTypeCounts& lineTypeCounts)
+{
+	if (get(lineTypeCounts, IndentType::space) > 0
+		&& get(lineTypeCounts, IndentType::tab)
+			+ get(lineTypeCounts, IndentType::javadocTab)
+			+ get(lineTypeCounts, IndentType::mixed) == 0)
+	{
+		return IndentType::space;
+	}
+	else if (get(lineTypeCounts, IndentType::tab) > 0
+		&& get(lineTypeCounts, IndentType::space)
+			+ get(lineTypeCounts, IndentType::javadocTab)
+			+ get(lineTypeCounts, IndentType::javadocLeft)
+			+ get(lineTypeCounts, IndentType::mixed) == 0)
+	{
+		return IndentType::tab;
+	}
+	else if (get(lineTypeCounts, IndentType::tab)
+			+ get(lineTypeCounts, IndentType::javadocTab) > 0
+		&& get(lineTypeCounts, IndentType::space)
+			+ get(lineTypeCounts, IndentType::mixed) == 0)
+	{
+		return IndentType::javadocTab;
+	}
+	else if (get(lineTypeCounts, IndentType::javadocLeft) > 0
+		&& get(lineTypeCounts, IndentType::space)
+			+ get(lineTypeCounts, IndentType::javadocTab)
+			+ get(lineTypeCounts, IndentType::mixed) == 0)
+	{
+		return IndentType::javadocTab;
+	}
+	else if (get(lineTypeCounts, IndentType::space)
+		+ get(lineTypeCounts, IndentType::tab)
+		+ get(lineTypeCounts, IndentType::javadocTab)
+		+ get(lineTypeCounts, IndentType::javadocLeft)
+		+ get(lineTypeCounts, IndentType::mixed) == 0)
+	{
+		return IndentType::indeterminate;
+	}
+	else
+	{
+		return IndentType::mixed;
+	}
+}
+
+IndentScanner::IndentScanner(bool isJavaFile, ::std::pmr::memory_resource* pMemRsrc) :
+	m_isJavaFile(isJavaFile),
+	m_partialLine(pMemRsrc),
+	m_lineTypeCounts(pMemRsrc)
+{
+}
+
+void IndentScanner::scan(ByteSpan block)
+{
+	const char* pBegin = toChars(block.data());
+	const char* pEnd = pBegin + block.size();
+	for (const char* pLineStart = pBegin; pLineStart != pEnd;)
+	{
+		const char* pLineEnd = ByteKernels::findFirstOf(pLineStart, pEnd, k_lineFeed);
+		if (pLineEnd == pEnd)
+		{
+			m_partialLine.append(pLineStart, pEnd);
+			break;
+		}
+		else if (m_partialLine.empty())
+		{
+			countLine(string_view(pLineStart, pLineEnd - pLineStart));
+		}
+		else
+		{
+			m_partialLine.append(pLineStart, pLineEnd);
+			countLine(m_partialLine);
+			m_partialLine.clear();
+		}
+		pLineStart = pLineEnd + 1;
+	}
+}
+
+LineTypeCounts IndentScanner::finish()
+{
+	countLine(m_partialLine);
+	m_partialLine.clear();
+	return ::std::move(m_lineTypeCounts);
+}
+
+void IndentScanner::countLine(string_view line)
+{
+	if (!line.empty() && line.back() == '\r')
+	{
+		line.remove_suffix(1);
+	}
+	++m_lineTypeCounts[classifyLine(line, m_isJavaFile)];
+}
+
+IndentReport classifyIndentation(ByteSpan bytes, bool isJavaFile)
+{
+	IndentScanner scanner(isJavaFile);
+	scanner.scan(bytes);
+	auto lineTypeCounts = scanner.finish();
+	const auto fileType = classifyFile(lineTypeCounts);
+	return IndentReport{::std::move(lineTypeCounts), fileType};
+}
+
+IndentReport classifyIndentation(int fd, bool isJavaFile)
+{
+	IndentScanner scanner(isJavaFile);
+	BlockReader(fd).feed(scanner);
+	auto lineTypeCounts = scanner.finish();
+	const auto fileType = classifyFile(lineTypeCounts);
+	return IndentReport{::std::move(lineTypeCounts), fileType};
+}
+
+// ============================ AuditScanner ============================
+
+AuditScanner::AuditScanner(bool isJavaFile, ::std::pmr::memory_resource* pMemRsrc) :
+	m_nonAsciiRuns(pMemRsrc),
+	m_eolScanner(),
+	m_whiteSpaceScanner(nullptr, pMemRsrc),
+	m_nonAsciiScanner([this] (const NonAsciiRun& run)
+		{
+			m_nonAsciiRuns.push_back(NonAsciiRun{run.m_lineNum, run.m_approxColNum,
+				::std::pmr::string{run.m_bytes, m_nonAsciiRuns.get_allocator()}});
+		}, pMemRsrc),
+	m_indentScanner(isJavaFile, pMemRsrc)
+{
+}
+
+void AuditScanner::scan(ByteSpan block)
+{
+	m_eolScanner.scan(block);
+	m_whiteSpaceScanner.scan(block);
+	m_nonAsciiScanner.scan(block);
+	m_indentScanner.scan(block);
+}
+
+AuditReport AuditScanner::finish()
+{
+	m_nonAsciiScanner.finish();
+	auto lineTypeCounts = m_indentScanner.finish();
+	const auto fileType = classifyFile(lineTypeCounts);
+	return AuditReport{m_eolScanner.finish(), m_whiteSpaceScanner.finish(),
+		::std::move(m_nonAsciiRuns), IndentReport{::std::move(lineTypeCounts), fileType}};
+}
+
+AuditReport auditText(ByteSpan bytes, bool isJavaFile)
+{
+	AuditScanner scanner(isJavaFile);
+	scanner.scan(bytes);
+	return scanner.finish();
+}
+
+AuditReport auditText(int fd, bool isJavaFile)
+{
+	AuditScanner scanner(isJavaFile);
+	BlockReader(fd).feed(scanner);
+	return scanner.finish();
+}
+
+// ============================ Binary files ============================
+
+// Each of these formats can begin without a NUL byte or many control
+// characters, so only its signature gives it away.  PDFs are here because
+// their first block is often text, but their cross-reference tables hold
+// byte offsets, which a changed end of line would break.
+static constexpr string_view k_magicNumbers[] =
+{
+	"\x89PNG\r\n\x1a\n",
+	"GIF87a",
+	"GIF89a",
+	"\xff\xd8\xff",						// JPEG
+	"%PDF-",
+	"PK\x03\x04",							// Zip, and so jar, docx, etc.
+	"PK\x05\x06",							// Empty zip
+	"\x1f\x8b",								// gzip
+	"\x28\xb5\x2f\xfd",					// zstd
+	"\xfd" "7zXZ",							// xz
+	"7z\xbc\xaf\x27\x1c",
+	"\x7f" "ELF",
+	"\xca\xfe\xba\xbe",					// Java class file, or universal Mach-O
+	"\xfe\xed\xfa\xce",					// Mach-O
+	"\xfe\xed\xfa\xcf",
+	"\xce\xfa\xed\xfe",
+	"\xcf\xfa\xed\xfe",
+	"\xd0\xcf\x11\xe0\xa1\xb1\x1a\xe1",	// OLE compound file (doc, xls, msi)
+};
+
+static constexpr size_t k_controlSampleSize = 8 * 1024;
+
+// The control characters that turn up in text:  white space, backspace (for
+// overstriking, as in formatted man pages), escape (for ANSI color codes in
+// logs), and Ctrl-Z (the DOS end-of-file mark).
+static constexpr bool isTextControlChar(unsigned char ch) noexcept
+{
+	return (ch >= '\b' && ch <= '\r') || ch == '\x1a' || ch == '\x1b';
+}
+
+BinaryEvidence sniffBinary(ByteSpan firstBlock) noexcept
+{
+	const string_view block{toChars(firstBlock.data()), firstBlock.size()};
+	if (::std::any_of(::std::begin(k_magicNumbers), ::std::end(k_magicNumbers),
+		[block] (string_view magicNumber) { return block.starts_with(magicNumber); }))
+	{
+		return BinaryEvidence::magicNumber;
+	}
+
+	if (startsWithWideTextBom(firstBlock))
+	{
+		return BinaryEvidence::wideText;	// Full of NULs, if its characters are ASCII
+	}
+
+	static constexpr ByteKernels::ByteSet k_nul{string_view{"", 1}};
+	if (ByteKernels::findFirstOf(block.data(), block.data() + block.size(), k_nul)
+		!= block.data() + block.size())
+	{
+		return BinaryEvidence::nulByte;
+	}
+
+	const auto sample = block.substr(0, k_controlSampleSize);
+	const auto numControlChars = ::std::count_if(cbegin(sample), cend(sample), [] (char ch)
+		{
+			const auto uch = static_cast<unsigned char>(ch);
+			return (uch < 0x20 || uch == 0x7f) && !isTextControlChar(uch);
+		});
+	return (static_cast<size_t>(numControlChars) * 10 > sample.size())
+		? BinaryEvidence::controlCharacters
+		: BinaryEvidence::none;
+}
+
+bool startsWithWideTextBom(ByteSpan firstBlock) noexcept
+{
+	// UTF-16LE is a prefix of UTF-32LE, so this covers both:
+	static constexpr string_view k_boms[] =
+	{
+		"\xff\xfe",					// UTF-16LE
+		"\xfe\xff",					// UTF-16BE
+		string_view{"\0\0\xfe\xff", 4},	// UTF-32BE
+	};
+	const string_view block{toChars(firstBlock.data()), firstBlock.size()};
+	return ::std::any_of(::std::begin(k_boms), ::std::end(k_boms),
+		[block] (string_view bom) { return block.starts_with(bom); });
+}
+
+string_view binaryEvidenceName(BinaryEvidence evidence)
+{
+	switch (evidence)
+	{
+	case BinaryEvidence::none:
+		return "none";
+	case BinaryEvidence::magicNumber:
+		return "magic number";
+	case BinaryEvidence::nulByte:
+		return "NUL byte";
+	case BinaryEvidence::controlCharacters:
+		return "control characters";
+	case BinaryEvidence::wideText:
+		return "UTF-16 or UTF-32 text";
+	default:
+		throw invalid_argument("Unrecognized BinaryEvidence enumeration value in binaryEvidenceName");
+	}
+}
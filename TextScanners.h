@@ -0,0 +1,318 @@
+
+#if !defined(TEXTSCANNERS_H_INCLUDED)
+#define TEXTSCANNERS_H_INCLUDED
+
+#include "BlockReader.h"
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ===========================================================================
+//
+// The scanning cores of xeol, stripws, isplainascii, and indents, usable
+// in-process without the command-line front ends.  Each scanner is fed the
+// input one block at a time via scan() and then produces its result via
+// finish().  The free functions at the end of each section are conveniences
+// that scan a whole buffer or everything readable from a file descriptor.
+//
+// Scanners that need scratch memory take a memory resource.  The command-line
+// tools pass their ScratchArena; library callers normally use the default.
+//
+// ===========================================================================
+
+// ============================ End-of-line ============================
+
+/// \brief EolType contains the enum constants that indicate the type of
+/// end-of-line for a text file.
+enum class EolType
+{
+	INDETERMINATE, ///< File contains no ends-of-line
+	MIXED, ///< Inconsistent end-of-line convention, may be binary
+	DOS, ///< End-of-line is "\r\n"
+	MACINTOSH, ///< End-of-line is "\r" (now archaic)
+	UNIX ///< End-of-line is "\n"
+};
+
+struct EolCounts
+{
+	size_t totalEols() const noexcept
+		{ return m_numDosEols + m_numMacEols + m_numUnixEols; }
+	EolType eolType() const noexcept;
+
+	size_t	m_numDosEols;
+	size_t	m_numMacEols;
+	size_t	m_numUnixEols;
+};
+
+/// \brief Counts the end-of-line types, and optionally translates the ends
+/// of line into the provided stream.
+///
+/// If pOut is null, then the scanner simply counts the end-of-line types.
+/// Otherwise it additionally translates the input into *pOut, in which case
+/// targetEolType must be one of DOS, MACINTOSH, or UNIX.
+class EolScanner
+{
+public:
+	EolScanner(::std::ostream* pOut = nullptr, EolType targetEolType = EolType::INDETERMINATE);
+
+	void scan(ByteSpan block);
+	EolCounts finish();
+
+	/// \brief The counts so far, not including a carriage return at the very
+	/// end of the input scanned so far.
+	const EolCounts& counts() const noexcept
+		{ return m_counts; }
+
+private:
+	void write(const char* pBegin, const char* pEnd);
+	void writeEol();
+
+	::std::ostream*	m_pOut;
+	::std::string_view	m_eol;
+	bool					m_lastCharWasReturn;
+	EolCounts			m_counts;
+};
+
+::std::string_view toEolString(EolType eolType);
+/// \brief Returns a stable lower-case name for eolType, for use in
+/// machine-readable output:  "none", "mixed", "dos", "mac", or "unix".
+::std::string_view eolTypeName(EolType eolType);
+/// \brief Returns the letter that stands for eolType in the listings of
+/// xeol and audit:  'I', 'X', 'D', 'M', or 'U'.
+char eolLetter(EolType eolType);
+EolCounts scanEols(ByteSpan bytes);
+EolCounts scanEols(int fd);
+
+// ============================ Trailing white space ============================
+
+struct WhiteSpaceCounts
+{
+	size_t	m_numLinesAffected;
+	size_t	m_numSpacesStripped;
+	size_t	m_numTabsStripped;
+};
+
+/// \brief Counts the occurrences of white space at the end of a line (and at
+/// the end of the input), and optionally strips them into the provided stream.
+class WhiteSpaceScanner
+{
+public:
+	WhiteSpaceScanner(::std::ostream* pOut = nullptr,
+		::std::pmr::memory_resource* pMemRsrc = ::std::pmr::get_default_resource());
+
+	void scan(ByteSpan block);
+	WhiteSpaceCounts finish();
+
+	/// \brief The counts so far, not including white space at the very end of
+	/// the input scanned so far.
+	const WhiteSpaceCounts& counts() const noexcept
+		{ return m_counts; }
+
+private:
+	void write(const char* pBegin, const char* pEnd);
+	void updateCounts(::std::string_view wsRun);
+
+	::std::ostream*		m_pOut;
+	::std::pmr::string	m_wsRun;
+	WhiteSpaceCounts		m_counts;
+};
+
+WhiteSpaceCounts countTrailingWhiteSpace(ByteSpan bytes);
+WhiteSpaceCounts countTrailingWhiteSpace(int fd);
+
+// ============================ Non-ASCII characters ============================
+
+/// \brief A maximal run of consecutive bytes with the high bit set.
+struct NonAsciiRun
+{
+	unsigned long		m_lineNum;
+	unsigned long		m_approxColNum;
+	::std::pmr::string	m_bytes;
+};
+
+/// \brief Finds the runs of non-ASCII bytes and passes each one to a handler
+/// as soon as the run is complete.
+class NonAsciiScanner
+{
+public:
+	using RunHandler = ::std::function<void(const NonAsciiRun&)>;
+
+	NonAsciiScanner(RunHandler runHandler,
+		::std::pmr::memory_resource* pMemRsrc = ::std::pmr::get_default_resource());
+
+	void scan(ByteSpan block);
+	void finish();
+
+private:
+	void reportRun();
+
+	RunHandler		m_runHandler;
+	NonAsciiRun		m_run;
+	unsigned long	m_colNum;
+	bool				m_wasLastCharCR;
+};
+
+::std::vector<NonAsciiRun> findNonAsciiRuns(ByteSpan bytes);
+::std::vector<NonAsciiRun> findNonAsciiRuns(int fd);
+
+/// \brief Finds only whether there is any non-ASCII byte, which is all that a
+/// verdict needs, and which is cheaper than finding the runs.
+class HighBitScanner
+{
+public:
+	HighBitScanner() noexcept : m_isFound(false) {}
+
+	void scan(ByteSpan block) noexcept;
+
+	bool isFound() const noexcept
+		{ return m_isFound; }
+
+private:
+	bool	m_isFound;
+};
+
+// ============================ Indentation ============================
+
+/// \brief IndentType contains the enum constants that indicate the type of
+/// indentation for a line of text or a text file.
+enum class IndentType
+{
+	space, ///< Indents consist entirely of spaces
+	tab, ///< Indents consist entirely of tabs
+	javadocTab,	///< Indents are entirely tabs or tabs followed by exactly one space and asterisk, as in a tab-indented JavaDoc comment
+	javadocLeft,	///< Indented exactly one space followed by an asterisk, as in an unindented JavaDoc comment (single-line only)
+	mixed, ///< Indents are mixed tabs and spaces, or some are tabs and others are spaces
+	indeterminate ///< Refers to lines with no whitespace indent
+};
+
+/// \brief Counts of lines by indent type.  The maps built by the command-line
+/// tools live in the thread's ScratchArena, so they must not outlive the
+/// processing of the file.
+using LineTypeCounts = ::std::pmr::map<IndentType, size_t>;
+
+/// \brief The same as lineTypeCounts.at(indentType) except that it returns zero
+/// if the map does not contain an entry for indentType.
+size_t get(const LineTypeCounts& lineTypeCounts, IndentType indentType);
+
+/// \brief Returns a stable name for indentType, for use in machine-readable
+/// output.  The names are the same as those of the enum constants.
+::std::string_view indentTypeName(IndentType indentType);
+/// \brief Returns the letter that stands for indentType, as the type of a
+/// file, in the listings of indents and audit:  'S', 'T', 'J', 'M', or 'I'.
+char indentLetter(IndentType indentType);
+
+IndentType classifyLine(::std::string_view line, bool isJavaFile);
+/// \brief Classifies a file by its counts of lines.  Once a file is mixed
+/// it stays mixed no matter what lines follow, so a partial count that
+/// classifies as mixed is already the final verdict.
+IndentType classifyFile(const LineTypeCounts& lineTypeCounts);
+
+/// \brief Counts the lines of the various indent types.  As with getline,
+/// the text after the last end-of-line counts as a line even if it is empty.
+/// A carriage return preceding a line feed is not part of the line.
+class IndentScanner
+{
+public:
+	IndentScanner(bool isJavaFile,
+		::std::pmr::memory_resource* pMemRsrc = ::std::pmr::get_default_resource());
+
+	void scan(ByteSpan block);
+	LineTypeCounts finish();
+
+	/// \brief The counts so far, not including the last, partial line.
+	const LineTypeCounts& lineTypeCounts() const noexcept
+		{ return m_lineTypeCounts; }
+
+private:
+	void countLine(::std::string_view line);
+
+	bool						m_isJavaFile;
+	::std::pmr::string	m_partialLine;
+	LineTypeCounts			m_lineTypeCounts;
+};
+
+struct IndentReport
+{
+	LineTypeCounts	m_lineTypeCounts;
+	IndentType		m_fileType;
+};
+
+IndentReport classifyIndentation(ByteSpan bytes, bool isJavaFile);
+IndentReport classifyIndentation(int fd, bool isJavaFile);
+
+// ============================ Fused audit ============================
+
+/// \brief The findings of all four analyses for one input.
+struct AuditReport
+{
+	EolCounts								m_eolCounts;
+	WhiteSpaceCounts						m_whiteSpaceCounts;
+	::std::pmr::vector<NonAsciiRun>	m_nonAsciiRuns;
+	IndentReport							m_indentReport;
+};
+
+/// \brief Runs the end-of-line, trailing white space, non-ASCII, and
+/// indentation analyses together, so that the input is read only once.
+/// Each block goes to all four scanners in turn while it is still in cache.
+class AuditScanner
+{
+public:
+	AuditScanner(bool isJavaFile,
+		::std::pmr::memory_resource* pMemRsrc = ::std::pmr::get_default_resource());
+
+	void scan(ByteSpan block);
+	AuditReport finish();
+
+	AuditScanner(const AuditScanner&) = delete;
+	AuditScanner& operator=(const AuditScanner&) = delete;
+	AuditScanner(AuditScanner&&) = delete;
+	AuditScanner& operator=(AuditScanner&&) = delete;
+
+private:
+	::std::pmr::vector<NonAsciiRun>	m_nonAsciiRuns;	// Before m_nonAsciiScanner, which fills it
+	EolScanner								m_eolScanner;
+	WhiteSpaceScanner						m_whiteSpaceScanner;
+	NonAsciiScanner						m_nonAsciiScanner;
+	IndentScanner							m_indentScanner;
+};
+
+AuditReport auditText(ByteSpan bytes, bool isJavaFile);
+AuditReport auditText(int fd, bool isJavaFile);
+
+// ============================ Binary files ============================
+
+/// \brief What marks a file as binary rather than text.
+enum class BinaryEvidence
+{
+	none,						///< Text, as far as the first block shows
+	magicNumber,			///< The signature of a known binary format
+	nulByte,
+	controlCharacters,	///< Too many control characters that text never contains
+	wideText				///< UTF-16 or UTF-32 text, by its byte order mark
+};
+
+/// \brief Decides from the first block of a file whether it is binary, so
+/// that the text tools can skip it without reading the rest.  A file is
+/// binary if it starts with the signature of a common binary format (images,
+/// archives, compressed files, PDFs, executables, and object files), if it
+/// contains a NUL byte, or if more than a tenth of its first 8 KiB are control
+/// characters other than white space, backspace, escape, and Ctrl-Z.
+///
+/// Text in UTF-16 or UTF-32 that starts with a byte order mark is reported
+/// as wideText rather than nulByte.  The byte-oriented tools skip it like
+/// any binary file, since rewriting it a byte at a time would corrupt it,
+/// but isplainascii reports it, because it is certainly not plain ASCII.
+BinaryEvidence sniffBinary(ByteSpan firstBlock) noexcept;
+
+/// \brief Returns true if the block starts with the byte order mark of UTF-16
+/// or UTF-32 text.
+bool startsWithWideTextBom(ByteSpan firstBlock) noexcept;
+::std::string_view binaryEvidenceName(BinaryEvidence evidence);
+
+#endif // TEXTSCANNERS_H_INCLUDED
@@ -0,0 +1,271 @@
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "TextScanners.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <boost/test/data/monomorphic.hpp>
+#include <regex>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace utd = ::boost::unit_test::data;
+
+using ::std::as_bytes;
+using ::std::ostringstream;
+using ::std::regex;
+using ::std::span;
+using ::std::string;
+using ::std::string_view;
+
+static ByteSpan toBytes(string_view str)
+{
+	return as_bytes(span{str.data(), str.size()});
+}
+
+static constexpr string_view k_testCases[] =
+{
+	"",
+	"a",
+	"\r",
+	"\r\r\n\n",
+	"line one  \r\nline two\t\r\n\tline three \t",
+	"mixed\rendings\nin \t\r\none\r\n\r",
+	"caf\xc3\xa9 \r\n\xe2\x80\x9cquoted\xe2\x80\x9d\rend\xff",
+	"\tint x;\n    int y;\n * javadoc\r\n\t * more\n",
+};
+
+BOOST_AUTO_TEST_SUITE(TextScannersTestSuite)
+
+// Each of these feeds the input in two blocks, split at every possible
+// position, and checks that the result is the same as for a single block.
+
+BOOST_DATA_TEST_CASE(eolScannerSplitTest, utd::make(k_testCases), tc)
+{
+	ostringstream expectedOut;
+	EolScanner wholeScanner(&expectedOut, EolType::UNIX);
+	wholeScanner.scan(toBytes(tc));
+	auto expected = wholeScanner.finish();
+
+	for (size_t i = 0; i <= tc.size(); ++i)
+	{
+		ostringstream actualOut;
+		EolScanner scanner(&actualOut, EolType::UNIX);
+		scanner.scan(toBytes(tc.substr(0, i)));
+		scanner.scan(toBytes(tc.substr(i)));
+		auto actual = scanner.finish();
+		BOOST_CHECK_EQUAL(expected.m_numDosEols, actual.m_numDosEols);
+		BOOST_CHECK_EQUAL(expected.m_numMacEols, actual.m_numMacEols);
+		BOOST_CHECK_EQUAL(expected.m_numUnixEols, actual.m_numUnixEols);
+		BOOST_CHECK_EQUAL(expectedOut.str(), actualOut.str());
+	}
+}
+
+BOOST_DATA_TEST_CASE(whiteSpaceScannerSplitTest, utd::make(k_testCases), tc)
+{
+	ostringstream expectedOut;
+	WhiteSpaceScanner wholeScanner(&expectedOut);
+	wholeScanner.scan(toBytes(tc));
+	auto expected = wholeScanner.finish();
+
+	for (size_t i = 0; i <= tc.size(); ++i)
+	{
+		ostringstream actualOut;
+		WhiteSpaceScanner scanner(&actualOut);
+		scanner.scan(toBytes(tc.substr(0, i)));
+		scanner.scan(toBytes(tc.substr(i)));
+		auto actual = scanner.finish();
+		BOOST_CHECK_EQUAL(expected.m_numLinesAffected, actual.m_numLinesAffected);
+		BOOST_CHECK_EQUAL(expected.m_numSpacesStripped, actual.m_numSpacesStripped);
+		BOOST_CHECK_EQUAL(expected.m_numTabsStripped, actual.m_numTabsStripped);
+		BOOST_CHECK_EQUAL(expectedOut.str(), actualOut.str());
+	}
+}
+
+BOOST_DATA_TEST_CASE(nonAsciiScannerSplitTest, utd::make(k_testCases), tc)
+{
+	auto expected = findNonAsciiRuns(toBytes(tc));
+
+	for (size_t i = 0; i <= tc.size(); ++i)
+	{
+		::std::vector<NonAsciiRun> actual;
+		NonAsciiScanner scanner([&actual] (const NonAsciiRun& run) { actual.push_back(run); });
+		scanner.scan(toBytes(tc.substr(0, i)));
+		scanner.scan(toBytes(tc.substr(i)));
+		scanner.finish();
+		BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+		for (size_t j = 0; j < expected.size(); ++j)
+		{
+			BOOST_CHECK_EQUAL(expected[j].m_lineNum, actual[j].m_lineNum);
+			BOOST_CHECK_EQUAL(expected[j].m_approxColNum, actual[j].m_approxColNum);
+			BOOST_CHECK(expected[j].m_bytes == actual[j].m_bytes);
+		}
+	}
+}
+
+BOOST_DATA_TEST_CASE(highBitScannerSplitTest, utd::make(k_testCases), tc)
+{
+	const bool expected = !findNonAsciiRuns(toBytes(tc)).empty();
+
+	for (size_t i = 0; i <= tc.size(); ++i)
+	{
+		HighBitScanner scanner;
+		scanner.scan(toBytes(tc.substr(0, i)));
+		scanner.scan(toBytes(tc.substr(i)));
+		BOOST_CHECK_EQUAL(expected, scanner.isFound());
+	}
+}
+
+BOOST_DATA_TEST_CASE(indentScannerSplitTest, utd::make(k_testCases), tc)
+{
+	auto expected = classifyIndentation(toBytes(tc), true);
+
+	for (size_t i = 0; i <= tc.size(); ++i)
+	{
+		IndentScanner scanner(true);
+		scanner.scan(toBytes(tc.substr(0, i)));
+		scanner.scan(toBytes(tc.substr(i)));
+		auto actual = scanner.finish();
+		BOOST_CHECK(expected.m_lineTypeCounts == actual);
+		BOOST_CHECK(expected.m_fileType == classifyFile(actual));
+	}
+}
+
+BOOST_DATA_TEST_CASE(auditScannerSplitTest, utd::make(k_testCases), tc)
+{
+	const auto expectedEols = scanEols(toBytes(tc));
+	const auto expectedWs = countTrailingWhiteSpace(toBytes(tc));
+	const auto expectedRuns = findNonAsciiRuns(toBytes(tc));
+	const auto expectedIndents = classifyIndentation(toBytes(tc), true);
+
+	for (size_t i = 0; i <= tc.size(); ++i)
+	{
+		AuditScanner scanner(true);
+		scanner.scan(toBytes(tc.substr(0, i)));
+		scanner.scan(toBytes(tc.substr(i)));
+		const auto actual = scanner.finish();
+		BOOST_CHECK_EQUAL(expectedEols.m_numDosEols, actual.m_eolCounts.m_numDosEols);
+		BOOST_CHECK_EQUAL(expectedEols.m_numMacEols, actual.m_eolCounts.m_numMacEols);
+		BOOST_CHECK_EQUAL(expectedEols.m_numUnixEols, actual.m_eolCounts.m_numUnixEols);
+		BOOST_CHECK_EQUAL(expectedWs.m_numLinesAffected, actual.m_whiteSpaceCounts.m_numLinesAffected);
+		BOOST_CHECK_EQUAL(expectedWs.m_numSpacesStripped, actual.m_whiteSpaceCounts.m_numSpacesStripped);
+		BOOST_CHECK_EQUAL(expectedWs.m_numTabsStripped, actual.m_whiteSpaceCounts.m_numTabsStripped);
+		BOOST_REQUIRE_EQUAL(expectedRuns.size(), actual.m_nonAsciiRuns.size());
+		for (size_t j = 0; j < expectedRuns.size(); ++j)
+		{
+			BOOST_CHECK_EQUAL(expectedRuns[j].m_lineNum, actual.m_nonAsciiRuns[j].m_lineNum);
+			BOOST_CHECK_EQUAL(expectedRuns[j].m_approxColNum, actual.m_nonAsciiRuns[j].m_approxColNum);
+			BOOST_CHECK(expectedRuns[j].m_bytes == actual.m_nonAsciiRuns[j].m_bytes);
+		}
+		BOOST_CHECK(expectedIndents.m_lineTypeCounts == actual.m_indentReport.m_lineTypeCounts);
+		BOOST_CHECK(expectedIndents.m_fileType == actual.m_indentReport.m_fileType);
+	}
+}
+
+// The regular expressions that define the line types, against which
+// classifyLine() is checked for every short line over a small alphabet:
+static IndentType classifyLineReference(string_view line, bool isJavaFile)
+{
+	static const regex k_spacePattern{"^ +([^ \\t].*)?$"};
+	static const regex k_tabPattern{"^\\t+([^ \\t].*)?$"};
+	static const regex k_javadocTabPattern{"^\\t+ \\*.*$"};
+	static const regex k_javadocLeftPattern{"^ \\*.*$"};
+	static const regex k_indeterminatePattern{"^([^ \\t].*)?$"};
+
+	auto matches = [line] (const regex& rex)
+		{ return regex_match(cbegin(line), cend(line), rex); };
+
+	if (matches(k_indeterminatePattern))
+	{
+		return IndentType::indeterminate;
+	}
+	else if (isJavaFile && matches(k_javadocLeftPattern))
+	{
+		return IndentType::javadocLeft;
+	}
+	else if (matches(k_spacePattern))
+	{
+		return IndentType::space;
+	}
+	else if (matches(k_tabPattern))
+	{
+		return IndentType::tab;
+	}
+	else if (isJavaFile && matches(k_javadocTabPattern))
+	{
+		return IndentType::javadocTab;
+	}
+	else
+	{
+		return IndentType::mixed;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(classifyLineTest)
+{
+	static constexpr string_view k_alphabet{" \t*x\r"};
+	string line;
+	auto checkAllExtensions = [&line] (auto& self, size_t maxLength) -> void
+		{
+			for (bool isJavaFile : { false, true })
+			{
+				BOOST_CHECK_MESSAGE(classifyLine(line, isJavaFile) == classifyLineReference(line, isJavaFile),
+					"Misclassified \"" << line << "\" (isJavaFile = " << isJavaFile << ")");
+			}
+			if (line.size() < maxLength)
+			{
+				for (char ch : k_alphabet)
+				{
+					line.push_back(ch);
+					self(self, maxLength);
+					line.pop_back();
+				}
+			}
+		};
+	checkAllExtensions(checkAllExtensions, 6);
+}
+
+BOOST_AUTO_TEST_CASE(scanEolsTest)
+{
+	auto counts = scanEols(toBytes("a\r\nb\nc\rd\r\n"));
+	BOOST_CHECK_EQUAL(2u, counts.m_numDosEols);
+	BOOST_CHECK_EQUAL(1u, counts.m_numMacEols);
+	BOOST_CHECK_EQUAL(1u, counts.m_numUnixEols);
+	BOOST_CHECK(EolType::MIXED == counts.eolType());
+}
+
+BOOST_AUTO_TEST_CASE(indentLineCountTest)
+{
+	// As with getline, the text after the last end-of-line is a line:
+	auto report = classifyIndentation(toBytes("\ta\r\n\tb\r\n"), false);
+	BOOST_CHECK_EQUAL(2u, get(report.m_lineTypeCounts, IndentType::tab));
+	BOOST_CHECK_EQUAL(1u, get(report.m_lineTypeCounts, IndentType::indeterminate));
+	BOOST_CHECK(IndentType::tab == report.m_fileType);
+}
+
+BOOST_AUTO_TEST_CASE(sniffBinaryTest)
+{
+	for (auto tc : k_testCases)
+	{
+		BOOST_CHECK(BinaryEvidence::none == sniffBinary(toBytes(tc)));
+	}
+	BOOST_CHECK(BinaryEvidence::none == sniffBinary(toBytes("\x1b[1mbold\x1b[0m\f\v\x1a")));
+	BOOST_CHECK(BinaryEvidence::magicNumber == sniffBinary(toBytes("\x89PNG\r\n\x1a\nIHDR")));
+	BOOST_CHECK(BinaryEvidence::magicNumber == sniffBinary(toBytes("%PDF-1.7\n%text\n")));
+	BOOST_CHECK(BinaryEvidence::nulByte == sniffBinary(toBytes(string_view{"text\0text", 9})));
+	BOOST_CHECK(BinaryEvidence::wideText == sniffBinary(toBytes(string_view{"\xff\xfet\0x\0t\0", 8})));
+	BOOST_CHECK(BinaryEvidence::wideText == sniffBinary(toBytes(string_view{"\xfe\xff\0t\0x\0t", 8})));
+	BOOST_CHECK(BinaryEvidence::wideText == sniffBinary(toBytes(string_view{"\0\0\xfe\xff\0\0\0t", 8})));
+	BOOST_CHECK(BinaryEvidence::controlCharacters == sniffBinary(toBytes("ab\x01\x02" "cdefgh\x7f")));
+	BOOST_CHECK(BinaryEvidence::none == sniffBinary(toBytes("abcdefghi\x01")));
+
+	// Only the start of the block is sampled for control characters:
+	const string lateControls = string(8 * 1024, 'x') + string(8 * 1024, '\x01');
+	BOOST_CHECK(BinaryEvidence::none == sniffBinary(toBytes(lateControls)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
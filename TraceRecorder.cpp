@@ -0,0 +1,190 @@
+
+#include "TraceRecorder.h"
+#include "Exceptions.h"
+#include "RecordWriter.h"
+
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#	include <process.h>
+#	define GETPID ::_getpid
+#else
+#	include <unistd.h>
+#	define GETPID ::getpid
+#endif
+
+using ::std::back_inserter;
+using ::std::format;
+using ::std::format_to;
+using ::std::lock_guard;
+using ::std::make_shared;
+using ::std::mutex;
+using ::std::ofstream;
+using ::std::shared_ptr;
+using ::std::size_t;
+using ::std::string;
+using ::std::string_view;
+using ::std::uint64_t;
+using ::std::vector;
+
+using Clock = TraceRecorder::Clock;
+using Path = TraceRecorder::Path;
+using Microseconds = ::std::chrono::duration<double, ::std::micro>;
+
+// Past this many spans, a thread drops the rest rather than let the trace
+// of a very long run exhaust memory:
+static constexpr size_t k_maxSpansPerThread = size_t{1} << 22;
+
+namespace
+{
+	struct Span
+	{
+		const char*			m_pName;
+		Clock::time_point	m_start;
+		Clock::duration	m_duration;
+		size_t				m_pathOffset;	// Into ThreadTrace::m_paths
+		size_t				m_pathLength;	// Zero if the span has no path
+	};
+
+	// The spans of one thread.  Only the owning thread writes to it, and
+	// write() reads it only after that thread is done.
+	struct ThreadTrace
+	{
+		explicit ThreadTrace(uint64_t threadNum) :
+			m_threadNum(threadNum), m_spans(), m_paths(), m_numDropped(0)
+			{ m_spans.reserve(4096); }
+
+		uint64_t		m_threadNum;
+		vector<Span>	m_spans;
+		string			m_paths;
+		uint64_t		m_numDropped;
+	};
+}
+
+static Path g_tracePath;
+static Clock::time_point g_startTime;
+
+// Taken only when a thread records its first span, and by write():
+static mutex g_threadsMutex;
+static vector<shared_ptr<ThreadTrace>> g_threads;
+
+static ThreadTrace& threadTrace()
+{
+	thread_local const auto t_pTrace = []
+		{
+			lock_guard<mutex> lock(g_threadsMutex);
+			return g_threads.emplace_back(make_shared<ThreadTrace>(g_threads.size() + 1));
+		}();
+	return *t_pTrace;
+}
+
+void TraceRecorder::enable(const Path& tracePath)
+{
+	g_tracePath = tracePath;
+	g_startTime = Clock::now();
+	s_isEnabled.store(true);
+}
+
+#if defined(CMDLINEUTIL_TEST_MODE)
+// The trace of a thread that has exited is held only by g_threads, and is
+// dropped.  Those of the threads still running are emptied in place, since
+// each thread keeps a reference to its own.
+void TraceRecorder::reset()
+{
+	s_isEnabled.store(false);
+	lock_guard<mutex> lock(g_threadsMutex);
+	::std::erase_if(g_threads, [] (const shared_ptr<ThreadTrace>& pTrace) { return pTrace.use_count() == 1; });
+	for (auto& pTrace : g_threads)
+	{
+		pTrace->m_spans.clear();
+		pTrace->m_paths.clear();
+		pTrace->m_numDropped = 0;
+	}
+	g_tracePath.clear();
+}
+#endif
+
+void TraceRecorder::recordSpan(const char* pName, Clock::time_point start,
+	Clock::time_point end, const Path* pPath /* = nullptr */) noexcept
+{
+	try
+	{
+		auto& trace = threadTrace();
+		if (trace.m_spans.size() >= k_maxSpansPerThread)
+		{
+			++trace.m_numDropped;
+			return;
+		}
+
+		const auto pathOffset = trace.m_paths.size();
+		if (pPath != nullptr)
+		{
+			trace.m_paths += pPath->generic_string();
+		}
+		trace.m_spans.push_back(Span{pName, start, end - start,
+			pathOffset, trace.m_paths.size() - pathOffset});
+	}
+	catch (...)
+	{
+		// Losing one span is better than failing the file
+	}
+}
+
+void TraceRecorder::write()
+{
+	const auto pid = static_cast<long>(GETPID());
+	auto toUs = [] (Clock::duration d) { return Microseconds(d).count(); };
+
+	string json = "{\"traceEvents\":[\n";
+	uint64_t numDropped = 0;
+	bool isFirstEvent = true;
+	auto beginEvent = [&json, &isFirstEvent] ()
+		{
+			json += isFirstEvent ? "" : ",\n";
+			isFirstEvent = false;
+		};
+
+	lock_guard<mutex> lock(g_threadsMutex);
+	for (const auto& pTrace : g_threads)
+	{
+		beginEvent();
+		format_to(back_inserter(json),
+			"{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{0},\"tid\":{1},"
+			"\"args\":{{\"name\":\"thread {1}\"}}}}", pid, pTrace->m_threadNum);
+		for (const auto& span : pTrace->m_spans)
+		{
+			beginEvent();
+			format_to(back_inserter(json),
+				"{{\"name\":\"{0}\",\"ph\":\"X\",\"pid\":{1},\"tid\":{2},\"ts\":{3:.3f},\"dur\":{4:.3f}",
+				span.m_pName, pid, pTrace->m_threadNum, toUs(span.m_start - g_startTime),
+				toUs(span.m_duration));
+			if (span.m_pathLength > 0)
+			{
+				json += ",\"args\":{\"path\":";
+				appendJsonString(json, string_view{pTrace->m_paths}.substr(span.m_pathOffset, span.m_pathLength));
+				json += '}';
+			}
+			json += '}';
+		}
+		numDropped += pTrace->m_numDropped;
+	}
+	format_to(back_inserter(json),
+		"\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{{\"droppedSpans\":\"{0}\"}}}}\n",
+		numDropped);
+
+	ofstream out(g_tracePath, ::std::ios::binary);
+	out.write(json.data(), static_cast< ::std::streamsize >(json.size()));
+	out.close();
+	if (!out)
+	{
+		throw IOError(format("Unable to write trace file '{0}'", g_tracePath.generic_string()));
+	}
+}
@@ -0,0 +1,49 @@
+
+#if !defined(TRACERECORDER_H_INCLUDED)
+#define TRACERECORDER_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+/// \brief TraceRecorder records the spans written by the --trace option of
+/// every tool, in the Chrome trace-event format that chrome://tracing and
+/// Perfetto both load.
+///
+/// Each thread appends its spans to a buffer of its own, so recording a span
+/// takes no lock and no atomic read-modify-write.  The buffers are merged
+/// only when the trace is written at exit.
+class TraceRecorder
+{
+public:
+	using Clock = ::std::chrono::steady_clock;
+	using Path = ::std::filesystem::path;
+
+	static void enable(const Path& tracePath);
+	static bool isEnabled() noexcept
+		{ return s_isEnabled.load(::std::memory_order_relaxed); }
+
+	/// \brief Records a complete span on the calling thread.  pName must
+	/// outlive the recorder (in practice, it is a string literal), and pPath,
+	/// if given, is copied.
+	static void recordSpan(const char* pName, Clock::time_point start,
+		Clock::time_point end, const Path* pPath = nullptr) noexcept;
+
+	/// \brief Writes the spans recorded so far to the file given to enable().
+	/// Call this only after the threads that record spans have finished.
+	static void write();
+
+	TraceRecorder() = delete;
+
+#if defined(CMDLINEUTIL_TEST_MODE)
+	// Testing facilities:
+	/// \brief Disables the recorder and discards the spans recorded so far.
+	/// Call this only while no other thread is recording spans.
+	static void reset();
+#endif
+
+private:
+	static inline ::std::atomic<bool> s_isEnabled{false};
+};
+
+#endif // TRACERECORDER_H_INCLUDED
@@ -0,0 +1,80 @@
+
+#if !defined(CMDLINEUTIL_TEST_MODE)
+#define CMDLINEUTIL_TEST_MODE
+#endif
+
+#include "BlockReader.h"
+#include "FileEnumerator.h"
+#include "PathDeleter.h"
+#include "RunStats.h"
+#include "TraceRecorder.h"
+
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+namespace fs = ::std::filesystem;
+
+using ::std::ifstream;
+using ::std::istreambuf_iterator;
+using ::std::ofstream;
+using ::std::string;
+
+// Leaves the recorder and the statistics disabled for the tests that follow:
+struct TraceFixture
+{
+	explicit TraceFixture(const fs::path& tracePath)
+		{
+			TraceRecorder::enable(tracePath);
+			RunStats::enable();
+		}
+	~TraceFixture()
+		{
+			RunStats::reset();
+			TraceRecorder::reset();
+		}
+};
+
+BOOST_AUTO_TEST_SUITE(TraceRecorderTestSuite)
+
+BOOST_AUTO_TEST_CASE(writeTest)
+{
+	const fs::path testDir{"TraceRecorderTestDir"};
+	const auto tracePath = testDir / "trace.json";
+	PathDeleter testDirDeleter(testDir);
+	create_directories(testDir);
+	{
+		ofstream out(testDir / "a.txt");
+		out << "x\n";
+	}
+
+	TraceFixture fixture(tracePath);
+	FileEnumerator fe;
+	fe.insert(testDir / "*.txt");
+	fe.enumerateFiles([] (const fs::path& p)
+		{
+			InputFile in(p);
+			BlockReader(in.fd()).forEachBlock([] (ByteSpan) {});
+		});
+	::std::thread([] ()
+		{
+			const auto now = TraceRecorder::Clock::now();
+			TraceRecorder::recordSpan("worker", now, now);
+		}).join();
+	TraceRecorder::write();
+
+	ifstream in(tracePath, ::std::ios::binary);
+	const string trace{istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+	BOOST_CHECK(trace.starts_with("{\"traceEvents\":["));
+	for (auto pEvent : { "\"name\":\"thread_name\",\"ph\":\"M\"", "\"name\":\"enumerate\",\"ph\":\"X\"",
+		"\"name\":\"open\",\"ph\":\"X\"", "\"name\":\"read\",\"ph\":\"X\"",
+		"\"name\":\"file\",\"ph\":\"X\"", "\"args\":{\"path\":\"TraceRecorderTestDir/a.txt\"}",
+		"\"name\":\"worker\",\"ph\":\"X\"", "\"droppedSpans\":\"0\"" })
+	{
+		BOOST_CHECK_MESSAGE(trace.find(pEvent) != string::npos, pEvent);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,13 +1,73 @@
 
 #include "Utils.h"
 #include "Exceptions.h"
+#include "RunStats.h"
 
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
 #include <format>
+#include <limits>
+
+#if defined(_WIN32)
+#	include <io.h>
+#	include <sys/stat.h>
+#else
+#	include <unistd.h>
+#endif
 
 namespace fs = ::std::filesystem;
 
 using ::std::format;
 using ::std::string;
+using ::std::string_view;
+using ::std::uint64_t;
+
+const char* getOptionValue(::std::span<const char*const> args, size_t& i)
+{
+	if (i + 1 >= args.size())
+	{
+		throw CmdLineError(format("The option '{0}' requires a value", args[i]));
+	}
+	return args[++i];
+}
+
+uint64_t parseByteSize(string_view value)
+{
+	static constexpr string_view k_suffixes = "KMGT";
+
+	uint64_t number = 0;
+	const auto pEnd = value.data() + value.size();
+	const auto [pSuffix, ec] = ::std::from_chars(value.data(), pEnd, number);
+	auto suffix = value.substr(static_cast<size_t>(pSuffix - value.data()));
+	uint64_t multiplier = 1;
+	if (!suffix.empty())
+	{
+		const auto suffixPos = k_suffixes.find(static_cast<char>(::std::toupper(
+			static_cast<unsigned char>(suffix.front()))));
+		if (suffixPos != string_view::npos)
+		{
+			multiplier = uint64_t{1} << (10 * (suffixPos + 1));
+			suffix.remove_prefix(1);
+			if (!suffix.empty() && (suffix.front() == 'i' || suffix.front() == 'I'))
+			{
+				suffix.remove_prefix(1);
+			}
+		}
+		if (suffix == "B" || suffix == "b")
+		{
+			suffix.remove_prefix(1);
+		}
+	}
+	if (ec != ::std::errc{} || pSuffix == value.data() || !suffix.empty()
+		|| number > ::std::numeric_limits<uint64_t>::max() / multiplier)
+	{
+		throw CmdLineError(format("Invalid size '{0}'", value));
+	}
+	return number * multiplier;
+}
 
 fs::path getTempPath(const fs::path& filePath)
 {
@@ -20,11 +80,30 @@ fs::path getTempPath(const fs::path& filePath)
 	{
 		fs::path tempPath(dir);
 		tempPath /= format("{0}-{1:05}{2}", stem, i,  ext);
-		if (!exists(tempPath))
+		RunStats::countMetadataCalls();
+
+		// Creating the file exclusively claims the name, so that two threads
+		// or processes can never be handed the same one:
+#if defined(_WIN32)
+		const int fd = ::_wopen(tempPath.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY,
+			_S_IREAD | _S_IWRITE);
+#else
+		const int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+#endif
+		if (fd >= 0)
 		{
+#if defined(_WIN32)
+			::_close(fd);
+#else
+			::close(fd);
+#endif
 			return tempPath;
 		}
+		else if (errno != EEXIST)
+		{
+			break;
+		}
 	}
-	throw IOError(format("Unable to create temporary file for '{0}'",
-		filePath.generic_string()));
+	throw IOError(format("Unable to create temporary file for '{0}':  {1}",
+		filePath.generic_string(), ::std::strerror(errno)));
 }
@@ -3,9 +3,15 @@
 #define UTILS_H_INCLUDED
 
 #include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <format>
+#include <iterator>
 #include <locale>
+#include <ostream>
+#include <span>
 #include <string_view>
+#include <utility>
 
 #if defined(CMDLINEUTIL_TEST_MODE)
 #	define PRIVATE_EXCEPT_IN_TEST public
@@ -33,6 +39,29 @@ inline bool isIEqual(::std::string_view str1, ::std::string_view str2)
 		isIEqual);
 }
 
+/// \brief The same as "out << ::std::format(fmt, args...)", except that the
+/// text is formatted directly into the stream buffer instead of into a
+/// temporary string.
+template<typename... Args>
+void formatTo(::std::ostream& out, ::std::format_string<Args...> fmt, Args&&... args)
+{
+	::std::format_to(::std::ostreambuf_iterator<char>{out}, fmt, ::std::forward<Args>(args)...);
+}
+
+/// \brief For an option that takes a value, such as "--cache <file>", where
+/// args[i] is the option, returns the value and advances i past it.  Throws
+/// CmdLineError if the option is the last argument.
+const char* getOptionValue(::std::span<const char*const> args, ::std::size_t& i);
+
+/// \brief Parses a number of bytes such as "512M", with an optional suffix
+/// of K, M, G, or T (powers of 1024, in either case, optionally followed by
+/// "B" or "iB").  Throws CmdLineError if the value is malformed.
+::std::uint64_t parseByteSize(::std::string_view value);
+
+/// \brief Creates an empty file next to filePath, under a name derived from it
+/// that no other file has, and returns its path.  The name is claimed
+/// atomically, so concurrent callers always get distinct files.  Throws
+/// IOError if no file can be created.
 ::std::filesystem::path getTempPath(const ::std::filesystem::path& filePath);
 
 #endif // UTILS_H_INCLUDED
@@ -1,28 +1,34 @@
 
 #include "Xeol.h"
-#include "PathDeleter.h"
+#include "BlockReader.h"
+#include "FileRewriter.h"
+#include "FileWatcher.h"
+#include "RecordWriter.h"
+#include "ResultsCache.h"
+#include "ScratchArena.h"
+#include "SinceState.h"
 #include "main.h"
 #include "Utils.h"
 
 #include <format>
-#include <fstream>
 #include <iostream>
-#include <stdexcept>
+#include <memory>
+#include <optional>
 
 using ::std::cout;
 using ::std::endl;
-using ::std::format;
-using ::std::ifstream;
 using ::std::istream;
-using ::std::invalid_argument;
-using ::std::ios_base;
-using ::std::logic_error;
-using ::std::ofstream;
+using ::std::make_unique;
+using ::std::nullopt;
+using ::std::optional;
 using ::std::ostream;
 using ::std::string;
 using ::std::string_view;
+using ::std::unique_ptr;
 
-#if !defined(CMDLINEUTIL_TEST_MODE)
+static constexpr string_view k_recordFields[] = { "path", "eol", "dos", "mac", "unix", "translated" };
+
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
 int main(int argCount, const char*const*const argList)
 {
 	return commonMain<Xeol>(argCount, argList);
@@ -38,8 +44,9 @@ int Xeol::usage(ostream& out, string_view progName, const char* pMsg)
 		out << endl << pMsg << endl;
 	}
 	out << "\n"
-		"Usage 1:  " << progName << " [-r] <file1> <file2> ...\n"
-		"Usage 2:  " << progName << " {-d|-m|-u} [-f] [-r] <file1> <file2> ...\n"
+		"Usage 1:  " << progName << " [--format=<fmt>] [--cache <file>] [--since-state <file>] [-r] <file1> <file2> ...\n"
+		"Usage 2:  " << progName << " {-d|-m|-u} [-f] [--watch] [--format=<fmt>] [--cache <file>] [--since-state <file>] [-r] <file1> <file2> ...\n"
+		"Usage 3:  " << progName << " {-l|-q} [-d|-m|-u] [--cache <file>] [--since-state <file>] [-r] <file1> <file2> ...\n"
 		"\n"
 		"The first usage lists the line ending convention of each file,\n"
 		"in the following format:\n"
@@ -50,8 +57,31 @@ int Xeol::usage(ostream& out, string_view progName, const char* pMsg)
 		"'I' for indeterminate (meaning the file has no line endings),\n"
 		"or 'X' for mixed.\n"
 		"\n"
+		"Binary files, as judged by their first block (by a NUL byte, too many\n"
+		"control characters, or the signature of a known binary format), are\n"
+		"skipped:  they are not listed, counted as offending, or changed.\n"
+		"\n"
+		"Files compressed with gzip or zstd are decompressed as they are read,\n"
+		"and their contents examined as for any other file, except that they are\n"
+		"never changed:  to the second usage they are binary.\n"
+		"\n"
+		"A file of the form <archive>!<pattern>, where <archive> is a tar archive\n"
+		"(.tar, or compressed as .tar.gz, .tgz, .tar.zst, or .tzst), names the\n"
+		"members of the archive that match <pattern>, as though the archive were a\n"
+		"directory, e.g., 'release.tar!docs/*.txt'.  The archive is read once,\n"
+		"without extracting it, and each member is reported as\n"
+		"<archive>!<path-inside>.  Members are never cached or tracked by\n"
+		"--since-state, and cannot be translated.\n"
+		"\n"
 		"The second usage changes the line endings to the indicated type.\n"
 		"\n"
+		"The third usage, like grep, lists the names of the offending files\n"
+		"(-l) or just stops at the first one (-q), and exits with status 0 if\n"
+		"there is one, 1 if not, and 2 on an error.  A file offends if it has\n"
+		"mixed line endings, or, given one of '-d', '-m', and '-u', if it has\n"
+		"any line ending of another type.  Each file is read only up to the\n"
+		"point where this is certain, and no file is changed.\n"
+		"\n"
 		"Options:\n"
 		"\n"
 		"   -d Change to DOS line endings\n"
@@ -62,7 +92,29 @@ int Xeol::usage(ostream& out, string_view progName, const char* pMsg)
 		"\n"
 		"   -f Force translation of files with mixed line endings\n"
 		"\n"
+		"   -l List only the names of the offending files\n"
+		"\n"
+		"   -q Print nothing, and stop at the first offending file\n"
+		"\n"
+		"   --watch After the initial pass, keep running and process each file\n"
+		"      again whenever it changes.  (Linux only.)\n"
+		"\n"
+		"   --format=<fmt> Write one record per file in the format <fmt>, which\n"
+		"      is text (the default), jsonl (JSON Lines), or csv.  The fields are\n"
+		"      path, eol (none, mixed, dos, mac, or unix), dos, mac, and unix\n"
+		"      (the counts of each line ending), and translated (true or false).\n"
+		"\n"
+		"   --cache <file> Remember the result for each file in the cache file\n"
+		"      <file>, which xeol, stripws, and isplainascii can share, and skip\n"
+		"      the files that have not changed since their results were cached.\n"
+		"\n"
+		"   --since-state <file> Visit only the files that are new, renamed, or\n"
+		"      changed since the last run with the same state file <file>, and\n"
+		"      then update the state file.\n"
+		"\n"
 		"   -r Search for files in sub-directories recursively\n"
+		"\n"
+		<< FileEnumerator::k_filterOptionsUsage
 		<< endl;
 
 	return exitCode;
@@ -72,11 +124,18 @@ Xeol::Xeol(::std::span<const char*const> args) :
 	m_isInQueryMode(true),
 	m_targetEolType(EolType::INDETERMINATE),
 	m_forceTranslation(false),
+	m_isWatching(false),
+	m_reportMode(ReportMode::full),
+	m_outputFormat(OutputFormat::text),
+	m_cachePath(),
+	m_sinceStatePath(),
 	m_fileEnumerator()
 {
+	m_fileEnumerator.setArchiveAware();
 	unsigned numTargetTypeArgs = 0;
-	for (auto pArg : args)
+	for (size_t i = 0; i < args.size(); ++i)
 	{
+		auto pArg = args[i];
 		if (isIEqual(pArg, "-?") || isIEqual(pArg, "-h") || isIEqual(pArg, "-help"))
 		{
 			throw CmdLineError();
@@ -112,24 +171,69 @@ Xeol::Xeol(::std::span<const char*const> args) :
 		{
 			m_forceTranslation = true;
 		}
+		else if (parseReportModeOption(pArg, m_reportMode))
+		{
+			// Nothing more to do
+		}
+		else if (parseOutputFormatOption(pArg, m_outputFormat))
+		{
+			// Nothing more to do
+		}
+		else if (isIEqual(pArg, "--watch"))
+		{
+			m_isWatching = true;
+		}
+		else if (isIEqual(pArg, "--cache"))
+		{
+			m_cachePath = getOptionValue(args, i);
+		}
+		else if (isIEqual(pArg, "--since-state"))
+		{
+			m_sinceStatePath = getOptionValue(args, i);
+		}
 		else if (isIEqual(pArg, "-r"))
 		{
 			m_fileEnumerator.setRecursive();
 		}
+		else if (m_fileEnumerator.parseFilterOption(args, i))
+		{
+			// Nothing more to do
+		}
 		else
 		{
 			m_fileEnumerator.insert(pArg);
 		}
 	}
 
-	if (m_isInQueryMode && m_forceTranslation)
+	const bool isReportingOffenders = m_reportMode != ReportMode::full;
+	if (isReportingOffenders && m_forceTranslation)
+	{
+		throw CmdLineError("The option '-f' is not allowed with '-l' or '-q'");
+	}
+	else if (isReportingOffenders && m_isWatching)
+	{
+		throw CmdLineError("The option '--watch' is not allowed with '-l' or '-q'");
+	}
+	else if (isReportingOffenders && m_outputFormat != OutputFormat::text)
+	{
+		throw CmdLineError("The option '--format' is not allowed with '-l' or '-q'");
+	}
+	else if (m_isInQueryMode && m_forceTranslation)
 	{
 		throw CmdLineError("The option '-f' is allowed only if one of '-d', '-m', and '-u' is present");
 	}
+	else if (m_isInQueryMode && m_isWatching)
+	{
+		throw CmdLineError("The option '--watch' is allowed only if one of '-d', '-m', and '-u' is present");
+	}
 	else if (numTargetTypeArgs > 1)
 	{
 		throw CmdLineError("The options '-d', '-m', and '-u' are mutually exclusive");
 	}
+	else if (!m_isInQueryMode && !isReportingOffenders && m_fileEnumerator.numArchiveSpecs() > 0)
+	{
+		throw CmdLineError("Archive members can be queried, but not translated");
+	}
 	else if (m_fileEnumerator.numFileSpecs() <= 0)
 	{
 		throw CmdLineError("No files specified");
@@ -138,223 +242,256 @@ Xeol::Xeol(::std::span<const char*const> args) :
 
 int Xeol::run() const
 {
-	m_fileEnumerator.enumerateFiles([this] (const Path& p)
-		{ m_isInQueryMode ? queryFile(p) : translateFile(p); });
+	unique_ptr<ResultsCache> pCache;
+	if (!m_cachePath.empty())
+	{
+		pCache = make_unique<ResultsCache>(m_cachePath);
+	}
+	unique_ptr<SinceState> pSinceState;
+	if (!m_sinceStatePath.empty())
+	{
+		pSinceState = make_unique<SinceState>(m_sinceStatePath);
+	}
+	if (m_reportMode != ReportMode::full)
+	{
+		return reportOffendingFiles(m_fileEnumerator, m_reportMode,
+			[this, &pCache] (const Path& p) { return isFileOffending(p, pCache.get()); },
+			[this] (const Path&, BlockReader& reader) { return isArchiveMemberOffending(reader); },
+			pSinceState.get());
+	}
+	unique_ptr<RecordWriter> pWriter;
+	if (m_outputFormat != OutputFormat::text)
+	{
+		pWriter = make_unique<RecordWriter>(cout, m_outputFormat, k_recordFields);
+	}
+	unique_ptr<FileWatcher> pWatcher;
+	if (m_isWatching)
+	{
+		pWatcher = make_unique<FileWatcher>(m_fileEnumerator);
+	}
+
+	const FileWatcher::FileProcessor processFile = [this, &pCache, &pWriter] (const Path& p)
+		{
+			m_isInQueryMode
+				? queryFile(p, pCache.get(), pWriter.get())
+				: translateFile(p, pCache.get(), pWriter.get());
+		};
+	m_fileEnumerator.enumerateFiles([&pWatcher, &processFile] (const Path& p)
+		{ pWatcher ? pWatcher->process(p, processFile) : processFile(p); },
+		pSinceState.get());
+	m_fileEnumerator.enumerateArchiveMembers([this, &pWriter] (const Path& p, BlockReader& reader)
+		{ queryArchiveMember(p, reader, pWriter.get()); });
+	if (pSinceState)
+	{
+		pSinceState->save();
+	}
+	if (pWatcher)
+	{
+		// Records must not sit in the writer's buffer while the watch is idle:
+		auto flushRecords = [&pWriter] () { if (pWriter) { pWriter->flush(); } };
+		flushRecords();
+		pWatcher->watch([&processFile, &flushRecords] (const Path& p)
+			{
+				processFile(p);
+				flushRecords();
+			});
+	}
 	return EXIT_SUCCESS;
 }
 
-void Xeol::queryFile(const Path& p) const
+void Xeol::queryFile(const Path& p, ResultsCache* pCache /* = nullptr */,
+	RecordWriter* pWriter /* = nullptr */) const
 {
-	size_t numDosEols = 0;
-	size_t numMacEols = 0;
-	size_t numUnixEols = 0;
-	size_t totalEols = 0;
-	ifstream in(p, ios_base::in | ios_base::binary);
-	EolType eolType = scanFile(in, numDosEols, numMacEols, numUnixEols, totalEols);
-
-	char iLetter = getIndicatorLetter(eolType);
-	string dispPath = displayPath(p);
-	if (eolType == EolType::MIXED)
+	const auto optCounts = findOrScanTextFile<EolCounts>(pCache, p,
+		ScratchArena::forThisThread().resource(), countEols);
+	if (optCounts)	// Binary files are skipped
 	{
-		cout << format("{0} {1}\n     (Mixed:  {2} DOS, {3} Mac, {4} Unix)",
-				iLetter,
-				dispPath,
-				numDosEols,
-				numMacEols,
-				numUnixEols)
-			<< endl;
+		reportCounts(p, *optCounts, pWriter);
 	}
-	else
+}
+
+void Xeol::queryArchiveMember(const Path& p, BlockReader& reader, RecordWriter* pWriter /* = nullptr */) const
+{
+	reader.decompressIfCompressed();
+	if (!isBinaryFile(reader, nullptr, nullopt))
 	{
-		cout << format("{0} {1}",
-				iLetter,
-				dispPath)
-			<< endl;
+		reportCounts(p, countEols(reader), pWriter);
 	}
 }
 
-void Xeol::translateFile(const Path& p) const
+EolCounts Xeol::countEols(BlockReader& reader)
 {
-	size_t numDosEols = 0;
-	size_t numMacEols = 0;
-	size_t numUnixEols = 0;
-	size_t totalEols = 0;
-
-	ifstream in(p, ios_base::in | ios_base::binary);
-
-	Path tempPath(getTempPath(p));
-	PathDeleter tempPathDeleter(tempPath);
-	ofstream out(tempPath, ios_base::out | ios_base::trunc | ios_base::binary);
-
-	EolType eolType = scanFile(in, numDosEols, numMacEols, numUnixEols,
-		totalEols, &out, m_targetEolType);
-
-	in.close();
-	out.close();
+	EolScanner scanner;
+	reader.feed(scanner);
+	return scanner.finish();
+}
 
-	if (eolType == EolType::INDETERMINATE || eolType == m_targetEolType)
+void Xeol::reportCounts(const Path& p, const EolCounts& counts, RecordWriter* pWriter)
+{
+	if (pWriter != nullptr)
 	{
-		// Do nothing
+		writeRecord(p, counts, false, *pWriter);
+		return;
 	}
-	else if (eolType == EolType::MIXED && !m_forceTranslation)
+
+	const auto eolType = counts.eolType();
+	char iLetter = eolLetter(eolType);
+	string dispPath = displayPath(p);
+	if (eolType == EolType::MIXED)
 	{
-		cout << format("---- {0}\n        (Skipped, possibly binary:  {1} DOS, {2} Mac, {3} Unix)",
-				p.generic_string(),
-				numDosEols,
-				numMacEols,
-				numUnixEols)
-			<< endl;
+		formatTo(cout, "{0} {1}\n     (Mixed:  {2} DOS, {3} Mac, {4} Unix)",
+			iLetter,
+			dispPath,
+			counts.m_numDosEols,
+			counts.m_numMacEols,
+			counts.m_numUnixEols);
+		cout << endl;
 	}
 	else
 	{
-		if (eolType != EolType::DOS
-			&& eolType != EolType::MACINTOSH
-			&& eolType != EolType::UNIX
-			&& !(eolType == EolType::MIXED && m_forceTranslation))
-		{
-			throw logic_error("Unrecognized EolType enumeration value in Xeol::translateFile");
-		}
-
-		replaceOriginalFileWithTemp(p, tempPath);
-		cout << format("{0}->{1} {2}",
-				getIndicatorLetter(eolType),
-				getIndicatorLetter(m_targetEolType),
-				p.generic_string())
-			<< endl;
+		formatTo(cout, "{0} {1}",
+			iLetter,
+			dispPath);
+		cout << endl;
 	}
 }
 
-Xeol::EolType Xeol::scanFile(istream& in, /* out */ size_t& numDosEols, /* out */ size_t& numMacEols,
-	/* out */ size_t& numUnixEols, /* out */ size_t& totalEols, ostream* pOut,
-	EolType targetEolType)
+void Xeol::translateFile(const Path& p, ResultsCache* pCache /* = nullptr */,
+	RecordWriter* pWriter /* = nullptr */) const
 {
-	numDosEols = 0;
-	numMacEols = 0;
-	numUnixEols = 0;
-	totalEols = 0;
-
-	string eol(toEolString(targetEolType));
-	if (pOut != nullptr && eol.length() <= 0)
+	const auto optTranslation = translateEols(p, m_targetEolType, m_forceTranslation,
+		ScratchArena::forThisThread().resource(), pCache);
+	if (!optTranslation)
 	{
-		throw invalid_argument("Invalid value for argument targetEolType in method Xeol::scanFile");
-	}
-
-	for (bool lastCharWasReturn = false; true;)
-	{
-		int ch = in.get();
-		if (in.eof())
-		{
-			if (lastCharWasReturn)
-			{
-				++numMacEols;
-				if (pOut != nullptr) { (*pOut) << eol; }
-			}
-			break;
-		}
-		else if (!in.good())
+		if (pWriter == nullptr)
 		{
-			throw IOError("Error while reading input file");
+			formatTo(cout, "---- {0}\n        (Skipped, binary)", p.generic_string());
+			cout << endl;
 		}
-		else if (pOut != nullptr && !pOut->good())
-		{
-			throw IOError("Error while writing output to temporary file");
-		}
-		else if (lastCharWasReturn)
-		{
-			if (ch == '\r')
-			{
-				++numMacEols;
-				if (pOut != nullptr) { (*pOut) << eol; }
-				lastCharWasReturn = true;
-			}
-			else if (ch == '\n')
-			{
-				++numDosEols;
-				if (pOut != nullptr) { (*pOut) << eol; }
-				lastCharWasReturn = false;
-			}
-			else
-			{
-				++numMacEols;
-				if (pOut != nullptr) { (*pOut) << eol << istream::traits_type::to_char_type(ch); }
-				lastCharWasReturn = false;
-			}
-		}
-		else
-		{
-			if (ch == '\r')
-			{
-				lastCharWasReturn = true;
-			}
-			else if (ch == '\n')
-			{
-				++numUnixEols;
-				if (pOut != nullptr) { (*pOut) << eol; }
-				lastCharWasReturn = false;
-			}
-			else
-			{
-				if (pOut != nullptr) { (*pOut) << istream::traits_type::to_char_type(ch); }
-				lastCharWasReturn = false;
-			}
-		}
-	}
-
-	totalEols = numDosEols + numMacEols + numUnixEols;
-
-	EolType eolType = EolType::MIXED;
-	if (numDosEols == 0 && numMacEols == 0 && numUnixEols == 0)
-	{
-		eolType = EolType::INDETERMINATE;
+		return;
 	}
-	else if (numDosEols > 0 && numMacEols == 0 && numUnixEols == 0)
+	const auto& translation = *optTranslation;
+	const auto& counts = translation.m_counts;
+	if (pWriter != nullptr)
 	{
-		eolType = EolType::DOS;
+		writeRecord(p, counts, translation.m_isFileReplaced, *pWriter);
+		return;
 	}
-	else if (numDosEols == 0 && numMacEols > 0 && numUnixEols == 0)
+
+	const auto eolType = counts.eolType();
+
+	if (translation.m_isFileReplaced)
 	{
-		eolType = EolType::MACINTOSH;
+		formatTo(cout, "{0}->{1} {2}",
+			eolLetter(eolType),
+			eolLetter(m_targetEolType),
+			p.generic_string());
+		cout << endl;
 	}
-	else if (numDosEols == 0 && numMacEols == 0 && numUnixEols > 0)
+	else if (eolType == EolType::MIXED)
 	{
-		eolType = EolType::UNIX;
+		formatTo(cout, "---- {0}\n        (Skipped, possibly binary:  {1} DOS, {2} Mac, {3} Unix)",
+			p.generic_string(),
+			counts.m_numDosEols,
+			counts.m_numMacEols,
+			counts.m_numUnixEols);
+		cout << endl;
 	}
-	return eolType;
 }
 
-char Xeol::getIndicatorLetter(EolType eolType)
+void Xeol::writeRecord(const Path& p, const EolCounts& counts, bool isTranslated,
+	RecordWriter& writer)
 {
-	switch (eolType)
+	writer.field(p)
+		.field(eolTypeName(counts.eolType()))
+		.field(counts.m_numDosEols)
+		.field(counts.m_numMacEols)
+		.field(counts.m_numUnixEols)
+		.field(isTranslated);
+	writer.endRecord();
+}
+
+// Both kinds of offense are certain as soon as they appear, because the
+// counts only ever grow.
+bool Xeol::isOffending(const EolCounts& counts) const
+{
+	switch (m_targetEolType)
 	{
-	case EolType::INDETERMINATE:
-		return 'I';
-	case EolType::MIXED:
-		return 'X';
 	case EolType::DOS:
-		return 'D';
+		return counts.totalEols() > counts.m_numDosEols;
 	case EolType::MACINTOSH:
-		return 'M';
+		return counts.totalEols() > counts.m_numMacEols;
 	case EolType::UNIX:
-		return 'U';
+		return counts.totalEols() > counts.m_numUnixEols;
 	default:
-		throw invalid_argument("Unrecognized EolType enumeration value in "
-			"Xeol::getIndicatorLetter");
+		return counts.eolType() == EolType::MIXED;
 	}
 }
 
-string Xeol::toEolString(EolType eolType)
+bool Xeol::isFileOffending(const Path& p, ResultsCache* pCache /* = nullptr */) const
 {
-	switch (eolType)
+	const auto key = (pCache == nullptr) ? optional<FileKey>{} : pCache->cacheKeyOf(p);
+	if (isCachedAsBinary(pCache, key))
 	{
-	case EolType::DOS:
-		return "\r\n";
-	case EolType::MACINTOSH:
-		return "\r";
-	case EolType::UNIX:
-		return "\n";
-	default:
-		return "";
+		return false;
+	}
+	else if (key)
+	{
+		if (auto counts = pCache->findAsRead<EolCounts>(*key); counts)
+		{
+			return isOffending(*counts);
+		}
 	}
+
+	EolScanner scanner;
+	bool isStoppedEarly = false;
+	bool isDecompressed = false;
+	{
+		InputFile in(p);
+		BlockReader reader(in.fd(), ScratchArena::forThisThread().resource());
+		isDecompressed = reader.decompressIfCompressed() != Compression::none;
+		if (isBinaryFile(reader, pCache, key))
+		{
+			return false;
+		}
+		isStoppedEarly = reader.feedUntil(scanner,
+			[this, &scanner] () { return isOffending(scanner.counts()); });
+	}
+	const auto counts = scanner.finish();
+
+	// Only the counts of the whole file are worth caching:
+	if (key && !isStoppedEarly)
+	{
+		pCache->insert(*key, counts, isDecompressed);
+	}
+	return isOffending(counts);
+}
+
+bool Xeol::isArchiveMemberOffending(BlockReader& reader) const
+{
+	reader.decompressIfCompressed();
+	if (isBinaryFile(reader, nullptr, nullopt))
+	{
+		return false;
+	}
+	EolScanner scanner;
+	reader.feedUntil(scanner, [this, &scanner] () { return isOffending(scanner.counts()); });
+	return isOffending(scanner.finish());
+}
+
+Xeol::EolType Xeol::scanFile(istream& in, /* out */ size_t& numDosEols, /* out */ size_t& numMacEols,
+	/* out */ size_t& numUnixEols, /* out */ size_t& totalEols, ostream* pOut,
+	EolType targetEolType)
+{
+	EolScanner scanner(pOut, targetEolType);
+	BlockReader(in).feed(scanner);
+	const auto counts = scanner.finish();
+
+	numDosEols = counts.m_numDosEols;
+	numMacEols = counts.m_numMacEols;
+	numUnixEols = counts.m_numUnixEols;
+	totalEols = counts.totalEols();
+	return counts.eolType();
 }
 
 // This method breaks the portability of Boost.FileSystem, but it's portable enough.
@@ -365,11 +502,3 @@ string Xeol::displayPath(const Path& p)
 		? result.substr(2)
 		: result;
 }
-
-void Xeol::replaceOriginalFileWithTemp(const Path& originalPath, const Path& tempPath)
-{
-	Path savedOriginalPath(getTempPath(originalPath));
-	rename(originalPath, savedOriginalPath);
-	rename(tempPath, originalPath);
-	PathDeleter savedOriginalPathDeleter(savedOriginalPath);
-}
@@ -3,6 +3,10 @@
 #define XEOL_H_INCLUDED
 
 #include "FileEnumerator.h"
+#include "OffendingFiles.h"
+#include "RecordWriter.h"
+#include "ResultsCache.h"
+#include "TextScanners.h"
 #include "Utils.h"
 
 #include <filesystem>
@@ -15,6 +19,7 @@ class Xeol
 {
 public:
 	static int usage(::std::ostream& strm, ::std::string_view progName, const char* pMsg);
+	static constexpr bool k_hasReportModes = true;	///< -l and -q; see commonMain()
 
 	Xeol(::std::span<const char*const> args);
 	int run() const;
@@ -25,27 +30,26 @@ public:
 	Xeol& operator=(Xeol&&) = delete;
 
 PRIVATE_EXCEPT_IN_TEST:
-	/// \brief EolType contains the enum constants that indicate the type of
-	/// end-of-line for a text file.
-	enum class EolType
-	{
-		INDETERMINATE, ///< File contains no ends-of-line
-		MIXED, ///< Inconsistent end-of-line convention, may be binary
-		DOS, ///< End-of-line is "\r\n"
-		MACINTOSH, ///< End-of-line is "\r" (now archaic)
-		UNIX ///< End-of-line is "\n"
-	};
-
+	using EolType = ::EolType;
 	using Path = ::std::filesystem::path;
 
-	void queryFile(const Path& p) const;
-	void translateFile(const Path& p) const;
-	static char getIndicatorLetter(EolType eolType);
-	static ::std::string toEolString(EolType eolType);
+	void queryFile(const Path& p, ResultsCache* pCache = nullptr,
+		RecordWriter* pWriter = nullptr) const;
+	void queryArchiveMember(const Path& p, BlockReader& reader, RecordWriter* pWriter = nullptr) const;
+	static EolCounts countEols(BlockReader& reader);
+	static void reportCounts(const Path& p, const EolCounts& counts, RecordWriter* pWriter);
+	void translateFile(const Path& p, ResultsCache* pCache = nullptr,
+		RecordWriter* pWriter = nullptr) const;
+	static void writeRecord(const Path& p, const EolCounts& counts, bool isTranslated,
+		RecordWriter& writer);
+	bool isOffending(const EolCounts& counts) const;
+	bool isFileOffending(const Path& p, ResultsCache* pCache = nullptr) const;
+	bool isArchiveMemberOffending(BlockReader& reader) const;
 	static ::std::string displayPath(const Path& p);
 
-	/// \brief Scans the input file, counts the end-of-line types, and
-	/// optionally translates the ends-of-line into the provided stream.
+	/// \brief Runs an EolScanner over the input stream, which counts the
+	/// end-of-line types and optionally translates the ends-of-line into the
+	/// provided stream.
 	///
 	/// If pOut is null, then the method simply counts the end-of-line types and
 	/// returns the corresponding EolType constant.  In this case, the
@@ -59,12 +63,14 @@ PRIVATE_EXCEPT_IN_TEST:
 		/* out */ size_t& numUnixEols, /* out */ size_t& totalEols,
 		::std::ostream* pOut = nullptr, EolType targetEolType = EolType::INDETERMINATE);
 
-	static void replaceOriginalFileWithTemp(const Path& originalPath,
-		const Path& tempPath);
-
 	bool				m_isInQueryMode;
 	EolType			m_targetEolType;
 	bool				m_forceTranslation;
+	bool				m_isWatching;
+	ReportMode		m_reportMode;
+	OutputFormat	m_outputFormat;
+	Path				m_cachePath;
+	Path				m_sinceStatePath;
 	FileEnumerator	m_fileEnumerator;
 };
 
@@ -3,16 +3,23 @@
 #define CMDLINEUTIL_TEST_MODE
 #endif
 
+#include "BlockReader.h"
 #include "Exceptions.h"
 #include "PathDeleter.h"
+#include "ResultsCache.h"
 #include "TestUtil.h"
+#include "TextScanners.h"
 #include "Utils.h"
 #include "Xeol.h"
+#include "main.h"
 
 #include <boost/range/algorithm_ext/for_each.hpp>
 #include <boost/range/algorithm/sort.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
+#include <fstream>
+#include <iostream>
+#include <iterator>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -24,7 +31,9 @@ namespace utd = ::boost::unit_test::data;
 
 using ::std::begin;
 using ::std::end;
+using ::std::ifstream;
 using ::std::istringstream;
+using ::std::ofstream;
 using ::std::ostringstream;
 using ::std::string;
 
@@ -51,6 +60,13 @@ static char const*const k_args13[] = { "xeol", "-d", "-u", "Xeol.cpp" };
 static char const*const k_args14[] = { "xeol", "-m", "-u", "Xeol.cpp" };
 static char const*const k_args15[] = { "xeol", "-d", "-m", "-f", "Xeol.cpp" };
 static char const*const k_args16[] = { "xeol", "-d", "-m", "-u", "Xeol.cpp" };
+static char const*const k_args17[] = { "xeol", "--watch", "Xeol.cpp" };
+static char const*const k_args18[] = { "xeol", "-l", "-q", "Xeol.cpp" };
+static char const*const k_args19[] = { "xeol", "-u", "-l", "--watch", "Xeol.cpp" };
+static char const*const k_args20[] = { "xeol", "-u", "-q", "-f", "Xeol.cpp" };
+static char const*const k_args21[] = { "xeol", "--format=xml", "Xeol.cpp" };
+static char const*const k_args22[] = { "xeol", "-l", "--format=csv", "Xeol.cpp" };
+static char const*const k_args23[] = { "xeol", "--max-size", "lots", "Xeol.cpp" };
 
 static CmdLineParseFailTestCase const k_testCases[] =
 {
@@ -71,6 +87,13 @@ static CmdLineParseFailTestCase const k_testCases[] =
 	{ k_args14, ".*mutually exclusive.*" },
 	{ k_args15, ".*mutually exclusive.*" },
 	{ k_args16, ".*mutually exclusive.*" },
+	{ k_args17, ".*option '--watch' is allowed only if.*" },
+	{ k_args18, ".*mutually exclusive.*" },
+	{ k_args19, ".*option '--watch' is not allowed with.*" },
+	{ k_args20, ".*option '-f' is not allowed with.*" },
+	{ k_args21, ".*unrecognized output format 'xml'.*" },
+	{ k_args22, ".*option '--format' is not allowed with.*" },
+	{ k_args23, ".*invalid size 'lots'.*" },
 };
 
 BOOST_DATA_TEST_CASE(cmdLineParseFailTest, utd::make(k_testCases), tc)
@@ -115,6 +138,7 @@ static char const*const k_args07[] = { "xeol", "-u", "-f", "Xeol.cpp" };
 static char const*const k_args08[] = { "xeol", "Xeol.cpp", "Xeol.h", "XeolTest.cpp" };
 static char const*const k_args09[] = { "xeol", "Eol*.h" };
 static char const*const k_args10[] = { "xeol", "Eol*.h", "Eol*.cpp" };
+static char const*const k_args11[] = { "xeol", "--max-size", "1M", "-r", "--max-depth", "2", "Xeol.cpp" };
 
 static char const*const k_files00[] = { "Xeol.cpp" };
 static char const*const k_files01[] = { "Xeol.cpp", "Xeol.h", "XeolTest.cpp" };
@@ -134,6 +158,7 @@ static CmdLineParseOkTestCase const k_testCases[] =
 	{ k_args08, true, Xeol::EolType::INDETERMINATE, false, k_files01 },
 	{ k_args09, true, Xeol::EolType::INDETERMINATE, false, k_files02 },
 	{ k_args10, true, Xeol::EolType::INDETERMINATE, false, k_files03 },
+	{ k_args11, true, Xeol::EolType::INDETERMINATE, false, k_files00 },
 };
 
 static void checkEqual(const fs::path& tcPath, const fs::path& appPath)
@@ -303,4 +328,193 @@ BOOST_DATA_TEST_CASE(scanFileTest, utd::make(k_testCases), tc)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+// A PNG has a CR LF in its signature, and so looks like a file with mixed
+// line endings, which "xeol -u -f" would once have translated and corrupted:
+BOOST_AUTO_TEST_CASE(binaryFileIsLeftAloneTest)
+{
+	const fs::path testDir{"XeolBinaryTestDir"};
+	const auto binaryFile = testDir / "image.png";
+	const string contents{"\x89PNG\r\n\x1a\nIHDR\r\rdata\n"};
+	PathDeleter testDirDeleter(testDir);
+	create_directories(testDir);
+	ofstream(binaryFile, ::std::ios::binary) << contents;
+
+	const auto fileSpec = (testDir / "*.png").string();
+	const char*const translateArgs[] = { "-u", "-f", fileSpec.c_str() };
+	const char*const queryArgs[] = { "-l", fileSpec.c_str() };
+	const Xeol translateApp{ArgSpan{translateArgs}};
+	const Xeol queryApp{ArgSpan{queryArgs}};
+	ostringstream out;
+	{
+		CoutRedirect coutRedirect(out);
+		translateApp.translateFile(binaryFile);
+		queryApp.queryFile(binaryFile);
+	}
+
+	BOOST_CHECK_EQUAL("---- " + binaryFile.generic_string() + "\n        (Skipped, binary)\n", out.str());
+	BOOST_CHECK(!queryApp.isFileOffending(binaryFile));
+	ifstream in(binaryFile, ::std::ios::binary);
+	BOOST_CHECK_EQUAL(contents, string(::std::istreambuf_iterator<char>(in), {}));
+}
+
+BOOST_AUTO_TEST_CASE(compressedFileIsReadButNotChangedTest)
+{
+	const fs::path testDir{"XeolCompressedTestDir"};
+	const auto compressedFile = testDir / "notes.txt.gz";
+	const auto contents = compressText("one\r\ntwo\r\n", Compression::gzip);
+	PathDeleter testDirDeleter(testDir);
+	create_directories(testDir);
+	ofstream(compressedFile, ::std::ios::binary) << contents;
+
+	const auto fileSpec = (testDir / "*.gz").string();
+	const char*const translateArgs[] = { "-u", fileSpec.c_str() };
+	const char*const queryArgs[] = { "-l", "-u", fileSpec.c_str() };
+	const Xeol translateApp{ArgSpan{translateArgs}};
+	const Xeol queryApp{ArgSpan{queryArgs}};
+	ostringstream out;
+	{
+		CoutRedirect coutRedirect(out);
+		translateApp.translateFile(compressedFile);
+	}
+
+	BOOST_CHECK_EQUAL("---- " + compressedFile.generic_string() + "\n        (Skipped, binary)\n", out.str());
+	BOOST_CHECK(queryApp.isFileOffending(compressedFile));
+	ifstream in(compressedFile, ::std::ios::binary);
+	BOOST_CHECK_EQUAL(contents, string(::std::istreambuf_iterator<char>(in), {}));
+}
+
+#if !defined(_WIN32)
+BOOST_AUTO_TEST_CASE(compressedFileIsNotChangedWithCacheTest)
+{
+	const fs::path testDir{"XeolCompressedCacheTestDir"};
+	const auto compressedFile = testDir / "notes.txt.gz";
+	const auto cacheFile = testDir / "results.cache";
+	PathDeleter testDirDeleter(testDir);
+	create_directories(testDir);
+	ofstream(compressedFile, ::std::ios::binary) << compressText("one\r\ntwo\r\n", Compression::gzip);
+
+	// Querying caches the counts of the decompressed contents, which must
+	// not persuade a translation that the file is text already in shape:
+	const auto fileSpec = (testDir / "*.gz").string();
+	const char*const queryArgs[] = { fileSpec.c_str() };
+	const char*const translateArgs[] = { "-d", fileSpec.c_str() };
+	ostringstream queryOut;
+	ostringstream translateOut;
+	{
+		ResultsCache cache(cacheFile, 0);	// So that the file just written is not racily clean
+		CoutRedirect coutRedirect(queryOut);
+		Xeol{ArgSpan{queryArgs}}.queryFile(compressedFile, &cache);
+	}
+	{
+		ResultsCache cache(cacheFile, 0);
+		CoutRedirect coutRedirect(translateOut);
+		Xeol{ArgSpan{translateArgs}}.translateFile(compressedFile, &cache);
+	}
+
+	BOOST_CHECK_EQUAL("D " + compressedFile.generic_string() + "\n", queryOut.str());
+	BOOST_CHECK_EQUAL("---- " + compressedFile.generic_string() + "\n        (Skipped, binary)\n",
+		translateOut.str());
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(archiveMembersTest)
+{
+	const fs::path testDir{"XeolArchiveTestDir"};
+	const auto archiveFile = testDir / "release.tar";
+	PathDeleter testDirDeleter(testDir);
+	create_directories(testDir);
+	ofstream(archiveFile, ::std::ios::binary) << makeTar({
+			{ "dos.txt", "one\r\ntwo\r\n" },
+			{ "unix.txt", "one\ntwo\n" },
+			{ "image.png", "\x89PNG\r\n\x1a\n" },
+		});
+
+	const auto archiveSpec = archiveFile.generic_string() + "!*";
+	const char*const queryArgs[] = { archiveSpec.c_str() };
+	const char*const listArgs[] = { "-l", "-u", archiveSpec.c_str() };
+	const char*const translateArgs[] = { "-u", archiveSpec.c_str() };
+	ostringstream out;
+	int queryExitCode = EXIT_FAILURE;
+	int listExitCode = EXIT_FAILURE;
+	{
+		CoutRedirect coutRedirect(out);
+		queryExitCode = Xeol{ArgSpan{queryArgs}}.run();
+		listExitCode = Xeol{ArgSpan{listArgs}}.run();
+	}
+
+	BOOST_CHECK_EQUAL(EXIT_SUCCESS, queryExitCode);
+	BOOST_CHECK_EQUAL(EXIT_SUCCESS, listExitCode);
+	BOOST_CHECK_EQUAL(
+		"D " + archiveFile.generic_string() + "!dos.txt\n"
+		"U " + archiveFile.generic_string() + "!unix.txt\n"
+		+ archiveFile.generic_string() + "!dos.txt\n",
+		out.str());
+	BOOST_CHECK_THROW(Xeol{ArgSpan{translateArgs}}, CmdLineError);
+}
+
+BOOST_AUTO_TEST_CASE(isOffendingTest)
+{
+	static char const*const k_queryArgs[] = { "xeol", "-l", "Xeol.cpp" };
+	static char const*const k_unixArgs[] = { "xeol", "-l", "-u", "Xeol.cpp" };
+	const Xeol queryXeol(k_queryArgs);
+	const Xeol unixXeol(k_unixArgs);
+
+	BOOST_CHECK(!queryXeol.isOffending(EolCounts{0, 0, 0}));
+	BOOST_CHECK(!queryXeol.isOffending(EolCounts{3, 0, 0}));
+	BOOST_CHECK(queryXeol.isOffending(EolCounts{3, 0, 1}));
+	BOOST_CHECK(!unixXeol.isOffending(EolCounts{0, 0, 0}));
+	BOOST_CHECK(!unixXeol.isOffending(EolCounts{0, 0, 5}));
+	BOOST_CHECK(unixXeol.isOffending(EolCounts{1, 0, 0}));
+	BOOST_CHECK(unixXeol.isOffending(EolCounts{0, 1, 5}));
+}
+
+BOOST_AUTO_TEST_CASE(reportModeExitStatusTest)
+{
+	static char const*const k_offendingArgs[] = { "xeol", "-q", "-d", "Xeol.cpp" };
+	static char const*const k_notOffendingArgs[] = { "xeol", "-q", "-u", "Xeol.cpp" };
+	static char const*const k_ioErrorArgs[] = { "xeol", "-l", "-u", "--cache", "NoSuchDir/x.cache", "Xeol.cpp" };
+	static char const*const k_badOptionArgs[] = { "xeol", "-q", "--max-size", "lots", "Xeol.cpp" };
+	static char const*const k_fullBadOptionArgs[] = { "xeol", "--max-size", "lots", "Xeol.cpp" };
+	static char const*const k_helpArgs[] = { "xeol", "-q", "-?" };
+	auto runXeol = [] (ArgSpan args)
+		{
+			ostringstream out;
+			CoutRedirect coutRedirect(out);
+			return commonMain<Xeol>(args.size(), args.data());
+		};
+
+	// As for grep:  0 if a file offends, 1 if none does, and 2 on an error:
+	BOOST_CHECK_EQUAL(0, runXeol(k_offendingArgs));
+	BOOST_CHECK_EQUAL(1, runXeol(k_notOffendingArgs));
+	BOOST_CHECK_EQUAL(2, runXeol(k_ioErrorArgs));
+	BOOST_CHECK_EQUAL(2, runXeol(k_badOptionArgs));
+	BOOST_CHECK_EQUAL(EXIT_SUCCESS, runXeol(k_helpArgs));
+
+	// Without -l or -q, an error is just a failure:
+	BOOST_CHECK_EQUAL(EXIT_FAILURE, runXeol(k_fullBadOptionArgs));
+}
+
+BOOST_AUTO_TEST_CASE(feedUntilTest)
+{
+	const string input(3 * BlockReader::k_blockSize, '\n');
+
+	// Stopping after the first block reads no further:
+	istringstream in(input);
+	BlockReader reader(in);
+	EolScanner scanner;
+	size_t numBlocks = 0;
+	BOOST_CHECK(reader.feedUntil(scanner, [&numBlocks] () { return ++numBlocks >= 1; }));
+	BOOST_CHECK_EQUAL(1u, numBlocks);
+	BOOST_CHECK_EQUAL(BlockReader::k_blockSize, scanner.finish().m_numUnixEols);
+	BOOST_CHECK_EQUAL(BlockReader::k_blockSize, reader.next().size());
+
+	// Never stopping reads to the end:
+	istringstream fullIn(input);
+	BlockReader fullReader(fullIn);
+	EolScanner fullScanner;
+	BOOST_CHECK(!fullReader.feedUntil(fullScanner, [] () { return false; }));
+	BOOST_CHECK_EQUAL(input.size(), fullScanner.finish().m_numUnixEols);
+	BOOST_CHECK(fullReader.next().empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -38,7 +38,7 @@ static const char k_lastWorkingDirPattern[] = "^cvs (?:server|status): Examining
 static const char k_newFilePattern[] = "^(\\?) (.*)$";
 static const char k_fileStatusPattern[] = "^File: (?:no file )?(.*)[ \t]+Status: (.*)$";
 
-#if !defined(CMDLINEUTIL_TEST_MODE)
+#if !defined(CMDLINEUTIL_TEST_MODE) && !defined(CMDLINEUTIL_MULTI_CALL)
 int main(int argCount, const char*const*const argList)
 {
 	return commonMain<XformCvsStatus>(argCount, argList);
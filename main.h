@@ -2,32 +2,101 @@
 #if !defined(MAIN_H_INCLUDED)
 #define MAIN_H_INCLUDED
 
+#include "Cancellation.h"
 #include "Exceptions.h"
+#include "MemoryBudget.h"
+#include "PerfCounters.h"
+#include "RunStats.h"
+#include "TraceRecorder.h"
+#include "Utils.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
 #include <span>
 #include <stdexcept>
+#include <vector>
+
+/// \brief The exit status of a query tool that fails in one of its report
+/// modes (-l or -q), where, as for grep, 0 means that some file offends and
+/// 1 means that none does (see reportOffendingFiles()).
+inline constexpr int k_reportModeErrorExitCode = 2;
 
 template <typename T>
 int commonMain(size_t argCount, const char*const*const argList)
 {
 	using ::std::filesystem::path;
 	using ::std::span;
+	using ::std::cerr;
 	using ::std::cout;
 	using ::std::endl;
 
-	auto exitCode{EXIT_FAILURE};
+	const span<const char*const> allArgs{argList, argCount};
+	auto errorExitCode{EXIT_FAILURE};
+	if constexpr (requires { T::k_hasReportModes; })
+	{
+		if (::std::any_of(allArgs.begin() + 1, allArgs.end(), [] (const char* pArg)
+			{ return isIEqual(pArg, "-l") || isIEqual(pArg, "-q"); }))
+		{
+			errorExitCode = k_reportModeErrorExitCode;
+		}
+	}
+
+	auto exitCode{errorExitCode};
+	bool isStatsRequested = false;
+	CancellationToken::installSignalHandlers();
 	try
 	{
-		// Pass the argument list, not including the program name (0th element):
-		T program{span{argList + 1, argCount - 1}};
+		// The argument list, not including the program name (0th element).
+		// The options --stats, --trace, --perf-counters, and --max-memory
+		// apply to every tool, so they are handled here.  Tracing needs the
+		// timers that gather the statistics, but not their report:
+		::std::vector<const char*> args;
+		for (size_t i = 1; i < allArgs.size(); ++i)
+		{
+			if (isIEqual(allArgs[i], "--stats"))
+			{
+				isStatsRequested = true;
+				RunStats::enable();
+			}
+			else if (isIEqual(allArgs[i], "--perf-counters"))
+			{
+				PerfCounters::enable();
+			}
+			else if (isIEqual(allArgs[i], "--trace"))
+			{
+				TraceRecorder::enable(getOptionValue(allArgs, i));
+				RunStats::enable();
+			}
+			else if (isIEqual(allArgs[i], "--max-memory"))
+			{
+				MemoryBudget::setLimit(MemoryBudget::parseSize(getOptionValue(allArgs, i)));
+			}
+			else
+			{
+				args.push_back(allArgs[i]);
+			}
+		}
+
+		T program{span<const char*const>{args}};
 		exitCode = program.run();
 	}
 	catch (const CmdLineError& ex)
 	{
 		exitCode = T::usage(cout, path{argList[0]}.stem().generic_string(), ex.what());
+		exitCode = (exitCode == EXIT_SUCCESS) ? exitCode : errorExitCode;
+	}
+	catch (const CanceledError& ex)
+	{
+		cout << endl << ex.what() << endl;
+		// By convention, a process stopped by signal N exits with 128 + N:
+		auto signalNumber = CancellationToken::signalNumber();
+		exitCode = (signalNumber > 0) ? 128 + signalNumber : errorExitCode;
+	}
+	catch (const MemoryLimitError& ex)
+	{
+		cout << endl << ex.what() << endl;
 	}
 	catch (const ::std::exception& ex)
 	{
@@ -36,6 +105,26 @@ int commonMain(size_t argCount, const char*const*const argList)
 			<< "   " << ex.what() << endl
 			<< endl;
 	}
+	TempFileRegistry::deleteAll();
+	if (isStatsRequested)
+	{
+		RunStats::report(cerr);
+	}
+	if (PerfCounters::isEnabled())
+	{
+		PerfCounters::report(cerr, path{argList[0]}.stem().generic_string());
+	}
+	if (TraceRecorder::isEnabled())
+	{
+		try
+		{
+			TraceRecorder::write();
+		}
+		catch (const ::std::exception& ex)
+		{
+			cerr << ex.what() << endl;
+		}
+	}
 	return exitCode;
 }
 